@@ -0,0 +1,107 @@
+/*
+ *  benchutil.h
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// What the benchmarks in TEST_PROGS have in common.  Each one checks a new
+// way of doing something against the old way, then times both over the
+// same random fixtures and reports how much faster the new way is.  The
+// timed loops add up their results one way and subtract them the other,
+// so neither can be optimized away and any difference between them shows.
+
+#ifndef _BENCHUTIL_H_
+#define _BENCHUTIL_H_
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <QString>
+#include <QStringList>
+
+// the same fixtures every run, so runs can be compared
+#define BENCH_SEED 42
+
+#define RANDOM(a) (a[rand() % (sizeof(a) / sizeof(a[0]))])
+
+//----------------------------------------------------------------------
+// BenchMessages
+//
+// Chat, combat and loot lines like the ones the message windows see.
+// Benches add names and items of their own for the patterns they check.
+class BenchMessages
+{
+ public:
+  BenchMessages()
+  {
+    names << "Fippy Darkpaw" << "a gnoll pup" << "Soandso" << "Yourname"
+	  << "Lady Vox" << "Guard Jenkins" << "a kobold shaman"
+	  << "Phinigel Autropos";
+    items << "Rusty Short Sword" << "Bone Chips" << "Gnoll Fang"
+	  << "Cloth Cap" << "Tiny Dagger";
+  }
+
+  QString name() const { return names[rand() % names.size()]; }
+  QString item() const { return items[rand() % items.size()]; }
+
+  QString message() const
+  {
+    switch (rand() % 6)
+    {
+    case 0:
+      return QString("%1 tells you, 'wts %2 %3pp'")
+	.arg(name()).arg(item()).arg(rand() % 1000);
+    case 1:
+      return QString("%1 hits %2 for %3 points of damage.")
+	.arg(name()).arg(name()).arg(rand() % 500);
+    case 2:
+      return QString("--You have looted a %1 from %2's corpse.--")
+	.arg(item()).arg(name());
+    case 3:
+      return QString("%1 shouts, 'LFG %2 at %3:%4'")
+	.arg(name()).arg(rand() % 60).arg(rand() % 24)
+	.arg(rand() % 60, 2, 10, QChar('0'));
+    case 4:
+      return QString("You have slain %1!").arg(name());
+    }
+
+    return QString("Your faction standing with %1 got better.").arg(name());
+  }
+
+  QStringList names;
+  QStringList items;
+};
+
+// the time per unit of the old way and the new one, over count units
+static inline void benchReport(const char* unit, double count,
+			       const char* oldName, qint64 oldTime,
+			       const char* newName, qint64 newTime)
+{
+  printf("%-12s %10.1f ns/%s\n", oldName, double(oldTime) / count, unit);
+  printf("%-12s %10.1f ns/%s (%.2fx)\n", newName, double(newTime) / count,
+	 unit, newTime ? double(oldTime) / double(newTime) : 0.0);
+}
+
+// the exit code, failing on any mismatch or if the timed loops disagreed
+static inline int benchResult(int mismatches, qint64 check)
+{
+  return ((mismatches == 0) && (check == 0)) ? 0 : 1;
+}
+
+#endif // _BENCHUTIL_H_
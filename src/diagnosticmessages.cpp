@@ -30,6 +30,8 @@
 #include <cstdlib>
 
 #include <QString>
+#include <QThread>
+#include <QMetaObject>
 
 //----------------------------------------------------------------------
 // constants
@@ -43,8 +45,17 @@ static int seqMessage(MessageType type, const char* format, va_list ap)
   int ret = vsnprintf(buff, sizeof(buff), format, ap);
   Messages* messages = Messages::messages();
 
-  // if the message object exists, use it, otherwise dump to stderr
-  if (messages)
+  // if the message object exists, use it, otherwise dump to stderr.
+  // messages from other threads, like the map loader, are queued to it
+  if (messages && (QThread::currentThread() != messages->thread()))
+  {
+    QString text = QString::fromUtf8(buff);
+    QMetaObject::invokeMethod(messages, "addMessage", Qt::QueuedConnection,
+			      Q_ARG(MessageType, type),
+			      Q_ARG(QString, text),
+			      Q_ARG(uint32_t, ME_InvalidColor));
+  }
+  else if (messages)
     messages->addMessage(type, buff);
   else 
     fprintf(stderr, "%s\n", buff);
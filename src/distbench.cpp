@@ -0,0 +1,120 @@
+/*
+ *  distbench.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+
+#include <QList>
+#include <QElapsedTimer>
+
+#include "spawn.h"
+#include "itempositions.h"
+#include "benchutil.h"
+
+// Micro-benchmark comparing the per-item distance calculation that
+// SpawnShell used to do with the batch ItemPositions kernel.  Also
+// checks the vectorized kernel against the scalar reference.
+// usage: distbench [items] [iterations]
+int main (int argc, char *argv[])
+{
+  int numItems = (argc > 1) ? atoi(argv[1]) : 1000;
+  int iterations = (argc > 2) ? atoi(argv[2]) : 10000;
+  int i, j;
+
+  srand(BENCH_SEED);
+
+  QList<Item*> items;
+  ItemPositions positions;
+  for (i = 0; i < numItems; i++)
+  {
+    Spawn* spawn = new Spawn(i + 1,
+			     int16_t((rand() % 20000) - 10000),
+			     int16_t((rand() % 20000) - 10000),
+			     int16_t((rand() % 2000) - 1000),
+			     0, 0, 0, 0, 0, 0);
+    items.append(spawn);
+    positions.add(spawn);
+  }
+
+  Spawn player(0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+  // validate the kernel against the scalar reference
+  QVector<int16_t> x(numItems), y(numItems), z(numItems);
+  QVector<float> ref2D(numItems), ref3D(numItems);
+  QVector<float> vec2D(numItems), vec3D(numItems);
+  for (i = 0; i < numItems; i++)
+  {
+    x[i] = items[i]->x();
+    y[i] = items[i]->y();
+    z[i] = items[i]->z();
+  }
+  calcDistancesScalar(x.constData(), y.constData(), z.constData(), numItems,
+		      123, -456, 78, ref2D.data(), ref3D.data());
+  calcDistances(x.constData(), y.constData(), z.constData(), numItems,
+		123, -456, 78, vec2D.data(), vec3D.data());
+  int mismatches = 0;
+  for (i = 0; i < numItems; i++)
+  {
+    if ((fabsf(ref2D[i] - vec2D[i]) > 0.01f) ||
+	(fabsf(ref3D[i] - vec3D[i]) > 0.01f))
+      mismatches++;
+  }
+
+  printf("kernel: %s, items: %d, iterations: %d, mismatches: %d\n",
+	 distanceKernelName(), numItems, iterations, mismatches);
+
+  QElapsedTimer timer;
+  int16_t px, py, pz;
+
+  // the old way, one item at a time through the Item pointers
+  timer.start();
+  for (j = 0; j < iterations; j++)
+  {
+    px = int16_t(j & 0x3ff);
+    py = int16_t(-(j & 0x1ff));
+    pz = int16_t(j & 0x3f);
+    player.setPoint(px, py, pz);
+    for (i = 0; i < numItems; i++)
+      items[i]->setDistanceToPlayer(player.calcDist(*items[i]));
+  }
+  qint64 perItem = timer.nsecsElapsed();
+
+  // the batch kernel, including pushing the results back to the items
+  timer.start();
+  for (j = 0; j < iterations; j++)
+  {
+    px = int16_t(j & 0x3ff);
+    py = int16_t(-(j & 0x1ff));
+    pz = int16_t(j & 0x3f);
+    positions.calcDistances(px, py, pz, true, true);
+  }
+  qint64 batch = timer.nsecsElapsed();
+
+  benchReport("item", double(numItems) * iterations,
+	      "per-item:", perItem, "batch:", batch);
+
+  positions.clear();
+  qDeleteAll(items);
+
+  return benchResult(mismatches, 0);
+}
@@ -29,31 +29,44 @@
 #include <cstdio>
 
 #include <QFile>
-#include <QStringList>
 #include <QVector>
 #include <QString>
 
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-#include <QRegularExpression>
-#else
-#include <QRegExp>
-#endif
+//----------------------------------------------------------------------
+// constants
+
+// how deep %T templates may substitute further templates
+static const int maxTemplateDepth = 4;
+
+//----------------------------------------------------------------------
+// helpers
+static inline bool isLineEnd(QChar c)
+{
+  return (c == QChar('\r')) || (c == QChar('\n'));
+}
+
+static inline bool isDigit(QChar c)
+{
+  return (c.unicode() >= '0') && (c.unicode() <= '9');
+}
 
+//----------------------------------------------------------------------
+// EQStr
 EQStr::EQStr()
-  : m_messageStrings(),
-    m_loaded(false)
+  : m_loaded(false)
 {
 }
 
 EQStr::~EQStr()
 {
-  m_messageStrings.clear();
 }
 
 bool EQStr::load(const QString& fileName)
 {
   // clear out any existing contents
-  m_messageStrings.clear();
+  m_text = QString();
+  m_segments.clear();
+  m_formats.clear();
 
   // create a QFile on the file
   QFile formatFile(fileName);
@@ -65,77 +78,156 @@ bool EQStr::load(const QString& fileName)
     return false;
   }
 
-  // allocate a QByteArray large enough to hold the entire file
-  QByteArray textData(formatFile.size() + 1, '\0');
+  // the text of the whole file is the arena all the templates point into
+  QByteArray textData = formatFile.readAll();
+  m_text = QString::fromUtf8(textData.constData(), textData.size());
 
-  // read in the entire file
-  formatFile.read(textData.data(), textData.size());
-  
-  // construct a regex to deal with either style line termination
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-  QRegularExpression lineTerm("[\r\n]{1,2}");
-#else
-  QRegExp lineTerm("[\r\n]{1,2}");
-#endif
-
-  // split the data into lines at the line termination
-#if (QT_VERSION >= QT_VERSION_CHECK(5,14,0))
-  QStringList lines = QString::fromUtf8(textData).split(lineTerm, Qt::SkipEmptyParts);
-#else
-  QStringList lines = QString::fromUtf8(textData).split(lineTerm, QString::SkipEmptyParts);
-#endif
-
-  // start iterating over the lines
-  QStringList::Iterator it = lines.begin();
-  
-  // first is the magic id string
-  QString magicString = (*it++);
-  int spc;
-  uint32_t formatId;
-  QString formatString;
+  const QChar* text = m_text.constData();
+  int length = m_text.length();
+  int lineNumber = 0;
   uint32_t maxFormatId = 0;
-  
-  // next skip over the count, etc...
-  it++;
-  
-  // now iterate over the format lines
-  for (; it != lines.end(); ++it)
+
+  // iterate over the lines, skipping empty ones whichever the line ends
+  int start = 0;
+  while (start < length)
   {
-    // find the beginning space
-    spc = (*it).indexOf(' ');
-
-    // convert the beginnign of the string to a ULong
-    formatId = (*it).left(spc).toULong();
-    
-    if (formatId > maxFormatId) 
-      maxFormatId = formatId;
-    
-    // insert the format string into the dictionary.
-    m_messageStrings.insert(formatId, QString((*it).mid(spc+1)));    
+    if (isLineEnd(text[start]))
+    {
+      start++;
+      continue;
+    }
+
+    int end = start;
+    while ((end < length) && !isLineEnd(text[end]))
+      end++;
+
+    // first is the magic id string, then the count, etc...
+    if (lineNumber++ >= 2)
+    {
+      // the format id is up to the first space, the template after it
+      int spc = start;
+      while ((spc < end) && (text[spc] != QChar(' ')))
+	spc++;
+
+      uint32_t formatId = 0;
+      for (int i = start; i < spc; i++)
+      {
+	if (!isDigit(text[i]))
+	{
+	  formatId = 0;
+	  break;
+	}
+	formatId = formatId * 10 + (text[i].unicode() - '0');
+      }
+
+      if (formatId > maxFormatId)
+	maxFormatId = formatId;
+
+      addFormat(formatId, (spc < end) ? spc + 1 : start, end);
+    }
+
+    start = end;
   }
 
+  m_segments.squeeze();
+
   // note that strings are loaded
   m_loaded = true;
 
   seqInfo("Loaded %d message strings from '%s' maxFormat=%d",
-          m_messageStrings.count(), fileName.toLatin1().data(),
+          m_formats.count(), fileName.toLatin1().data(),
           maxFormatId);
 
   return true;
 }
 
+void EQStr::addFormat(uint32_t formatid, int start, int end)
+{
+  EQStrFormat format;
+  format.textOffset = start;
+  format.textLength = end - start;
+  format.firstSegment = m_segments.size();
+
+  // split the template at its %n and %Tn arguments, up to 3 digits each
+  const QChar* text = m_text.constData();
+  EQStrSegment segment;
+  int literal = start;
+  int i = start;
+  while (i < end)
+  {
+    if (text[i] != QChar('%'))
+    {
+      i++;
+      continue;
+    }
+
+    int j = i + 1;
+    bool isTemplate = false;
+    if ((j + 1 < end) && (text[j] == QChar('T')) && isDigit(text[j + 1]))
+    {
+      isTemplate = true;
+      j++;
+    }
+
+    int arg = 0;
+    int digits = 0;
+    for (; (j < end) && (digits < 3) && isDigit(text[j]); j++, digits++)
+      arg = arg * 10 + (text[j].unicode() - '0');
+
+    if (!digits)
+    {
+      i++;
+      continue;
+    }
+
+    if (i > literal)
+    {
+      segment.offset = literal;
+      segment.length = i - literal;
+      segment.arg = 0;
+      m_segments.append(segment);
+    }
+
+    // there's never an argument 0, so it's just dropped
+    if (arg)
+    {
+      segment.offset = i;
+      segment.length = j - i;
+      segment.arg = isTemplate ? -arg : arg;
+      m_segments.append(segment);
+    }
+
+    literal = i = j;
+  }
+
+  if (end > literal)
+  {
+    segment.offset = literal;
+    segment.length = end - literal;
+    segment.arg = 0;
+    m_segments.append(segment);
+  }
+
+  format.segmentCount = m_segments.size() - format.firstSegment;
+
+  // a later line with the same id replaces the template
+  m_formats.insert(formatid, format);
+}
+
 QString EQStr::find(uint32_t formatid) const
 {
   // attempt to find the message string
-  QString res = m_messageStrings.value(formatid, QString());
+  QHash<uint32_t, EQStrFormat>::const_iterator it = m_formats.find(formatid);
+  if (it == m_formats.end())
+    return QString();
 
-  return res;
+  return m_text.mid(it->textOffset, it->textLength);
 }
 
 QString EQStr::message(uint32_t formatid) const
 {
   // attempt to find the message string
-  QString res = m_messageStrings.value(formatid, QString());
+  QString res = find(formatid);
 
   // if the message string was found, return it
   if (!res.isEmpty())
@@ -148,11 +240,12 @@ QString EQStr::message(uint32_t formatid) const
 QString EQStr::formatMessage(uint32_t formatid, 
 			     const char* arguments, size_t argsLen) const
 {
-  QString formatStringRes = m_messageStrings.value(formatid, QString());
+  QHash<uint32_t, EQStrFormat>::const_iterator format =
+    m_formats.find(formatid);
 
   QString tempStr;
 
-    if (formatStringRes.isEmpty())
+    if ((format == m_formats.end()) || !format->textLength)
     {
 	uint32_t arg_len;
 	unsigned char *cp;
@@ -196,150 +289,55 @@ QString EQStr::formatMessage(uint32_t formatid,
 	    totalArgsLen += curSize + 4;
 	}
 
-	bool ok;
-	int curPos;
-	int substArg;
-	int substArgValue;
-	QString substFormatStringRes;
-	QString substFormatString;
-
-	////////////////////////////
-	// replace template (%T) arguments in formatted string
-	QString formatString = formatStringRes;
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-    QRegularExpression rxt("%T(\\d{1,3})");
-    // find first template substitution
-    auto match = rxt.match(formatString, 0);
-    curPos = match.capturedStart(1);
-#else
-    QRegExp rxt("%T(\\d{1,3})");
-    // find first template substitution
-    curPos = rxt.indexIn(formatString, 0);
-#endif
-
-    while (curPos != -1)
-    {
-        substFormatStringRes = QString();
-
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-        substArg = match.captured(1).toInt(&ok);
-#else
-        substArg = rxt.cap(1).toInt(&ok);
-#endif
-
+	// the template was split into its literal text and arguments when
+	// it was loaded, so it's just a matter of appending them in order
+	tempStr.reserve(format->textLength + int(argsLen));
+	appendFormat(tempStr, *format, argList, 0);
 
-        if (ok && (substArg <= argList.size()))
-        {
-            substArgValue = argList[substArg-1].toInt(&ok);
-
-            if (ok)
-                substFormatStringRes = m_messageStrings.value(substArgValue, QString());
-        }
-
-        // replace template argument with subst string
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-        if (!substFormatStringRes.isEmpty())
-        {
-            formatString.replace(curPos-2, match.capturedLength(1)+2, substFormatStringRes);
-        }
-        else
-        {
-            formatString.replace(curPos-2, match.capturedLength(1)+2, "");
-            curPos = match.capturedEnd(1); // if no replacement string, skip over
-        }
-
-        // find next substitution
-        match = rxt.match(formatString, curPos);
-        curPos = match.capturedStart(1);
-#else
-        if (!substFormatStringRes.isEmpty())
-        {
-            formatString.replace(curPos, rxt.matchedLength(), substFormatStringRes);
-        }
-        else
-        {
-            formatString.replace(curPos, rxt.matchedLength(), "");
-            curPos += rxt.matchedLength(); // if no replacement string, skip over
-        }
-
-        // find next substitution
-        curPos = rxt.indexIn(formatString, curPos);
-#endif
+	return tempStr;
     }
+}
 
-	////////////////////////////
-	// now replace substitution arguments in formatted string
-	// NOTE: not using QString::arg() because not all arguments are always used
-	//       and it will do screwy stuff in this situation
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-    QRegularExpression rx("%(\\d{1,3})");
-    match = rx.match(formatString, 0);
-    curPos = match.capturedStart(1);
-#else
-    QRegExp rx("%(\\d{1,3})");
-    // find first template substitution
-    curPos = rx.indexIn(formatString, 0);
-#endif
+void EQStr::appendFormat(QString& result, const EQStrFormat& format,
+			 const QVector<QString>& args, int depth) const
+{
+  const EQStrSegment* segment = m_segments.constData() + format.firstSegment;
+  const EQStrSegment* end = segment + format.segmentCount;
 
-    while (curPos != -1)
+  for (; segment != end; ++segment)
+  {
+    if (!segment->arg)
+      result.append(m_text.constData() + segment->offset, int(segment->length));
+    else if (segment->arg > 0)
     {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-        substArg = match.captured(1).toInt(&ok);
-
-        // replace substitution argument with argument from list
-        if (ok && (substArg <= argList.size()))
-        {
-            QString sub = argList[substArg-1];
-            // some messages contains spell names with additional delimited fields
-            if (sub.contains('^'))
-            {
-                sub = sub.mid(sub.lastIndexOf('^')+1);
-                // they also contain an oddball apostrophe
-                if (sub.startsWith("'"))
-                    sub.replace(0, 1, "");
-            }
-            formatString.replace(curPos-1, match.capturedLength(1)+1, sub);
-        }
-        else
-        {
-            //no argument for this replacement, so replace with empty string
-            formatString.replace(curPos-1, match.capturedLength(1)+1, "");
-            curPos = match.capturedEnd(1); // if no such argument, skip over
-        }
-
-        // find next substitution
-        match = rx.match(formatString, curPos);
-        curPos = match.capturedStart(1);
-#else
-        substArg = rx.cap(1).toInt(&ok);
-
-        // replace substitution argument with argument from list
-        if (ok && (substArg <= argList.size()))
-        {
-            QString sub = argList[substArg-1];
-            // some messages contains spell names with additional delimited fields
-            if (sub.contains('^'))
-            {
-                sub = sub.mid(sub.lastIndexOf('^')+1);
-                // they also contain an oddball apostrophe
-                if (sub.startsWith("'"))
-                    sub.replace(0, 1, "");
-            }
-            formatString.replace(curPos, rx.matchedLength(), sub);
-        }
-        else
-        {
-            //no argument for this replacement, so replace with empty string
-            formatString.replace(curPos, rx.matchedLength(), "");
-            curPos += rx.matchedLength(); // if no such argument, skip over
-        }
-
-        // find next substitution
-        curPos = rx.indexIn(formatString, curPos);
-#endif
+      // arguments missing from the message are left out
+      if (segment->arg > args.size())
+	continue;
+
+      // some messages contains spell names with additional delimited
+      // fields, which also contain an oddball apostrophe
+      const QString& arg = args[segment->arg - 1];
+      int from = arg.lastIndexOf('^') + 1;
+      if (from && (from < arg.length()) && (arg[from] == QChar('\'')))
+	from++;
+      result.append(arg.constData() + from, arg.length() - from);
     }
-
-    return formatString;
+    else
+    {
+      // the argument is the id of the template to put here, if there's
+      // no such template it's left out
+      if ((-segment->arg > args.size()) || (depth >= maxTemplateDepth))
+	continue;
+
+      bool ok;
+      int formatid = args[-segment->arg - 1].toInt(&ok);
+      if (!ok)
+	continue;
+
+      QHash<uint32_t, EQStrFormat>::const_iterator it =
+	m_formats.find(formatid);
+      if ((it != m_formats.end()) && it->textLength)
+	appendFormat(result, *it, args, depth + 1);
     }
-
+  }
 }
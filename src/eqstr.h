@@ -29,9 +29,40 @@
 
 #include <QHash>
 #include <QString>
+#include <QVector>
+
+//----------------------------------------------------------------------
+// EQStrSegment
+//
+// A piece of a message template, either literal text in the arena or
+// an argument to substitute (%n when arg is positive, the template whose
+// id is argument n, %Tn, when arg is negative).
+struct EQStrSegment
+{
+  uint32_t offset;
+  uint32_t length;
+  int32_t arg;
+};
+
+//----------------------------------------------------------------------
+// EQStrFormat
+//
+// A message template, as its text in the arena and its run of segments
+struct EQStrFormat
+{
+  uint32_t textOffset;
+  uint32_t textLength;
+  uint32_t firstSegment;
+  uint32_t segmentCount;
+};
 
 //----------------------------------------------------------------------
 // EQStr
+//
+// The message templates from eqstr_us.txt.  The file's text is kept as
+// one string that all the templates point into, and each template is
+// split into its segments when it's loaded, so formatting a message is
+// just appending the segments and arguments one after another.
 class EQStr
 {
  public:
@@ -45,10 +76,14 @@ class EQStr
 			const char* arguments, size_t argslen) const;
 
  protected:
-   QHash<int, QString> m_messageStrings;
+   void addFormat(uint32_t formatid, int start, int end);
+   void appendFormat(QString& result, const EQStrFormat& format,
+		     const QVector<QString>& args, int depth) const;
+
+   QString m_text;
+   QVector<EQStrSegment> m_segments;
+   QHash<uint32_t, EQStrFormat> m_formats;
    bool m_loaded;
 };
 
 #endif // _EQSTR_H_
-
-
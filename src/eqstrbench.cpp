@@ -0,0 +1,288 @@
+/*
+ *  eqstrbench.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QRegExp>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+
+#include "eqstr.h"
+#include "packetcommon.h"
+#include "benchutil.h"
+
+static const char* spells[] =
+{
+  "1234^5^'Ignite Blood", "93^0^'Burst of Flame", "200^3^Minor Healing",
+  "Complete Heal", "4587^1^'Clarity II",
+};
+
+// combat and loot templates shaped like the ones in eqstr_us.txt, with
+// the verbs and damage types as templates of their own
+static void writeTemplates(QTextStream& out, int fillers)
+{
+  out << "EQST0002\n" << "0 1 " << (fillers + 16) << "\n";
+  out << "100 %1 hits %2 for %3 points of damage.\n";
+  out << "101 %1 slashes %2 for %3 points of damage.\n";
+  out << "102 You have been healed for %1 points by %2.\n";
+  out << "103 --You have looted %1 from %2's corpse.--\n";
+  out << "104 %1 has been slain by %2!\n";
+  out << "105 %1 %T2 %3 for %4 points of %T5 damage.\n";
+  out << "106 %1 begins to cast %2.\n";
+  out << "107 %1 tries to %T2 %3, but misses!\n";
+  out << "200 crushes\n";
+  out << "201 bashes\n";
+  out << "202 kicks\n";
+  out << "300 fire\n";
+  out << "301 cold\n";
+  out << "302 magic\n";
+
+  // the rest of the file, which only makes the tables bigger
+  for (int i = 0; i < fillers; i++)
+    out << (1000 + i) << " Filler string " << i
+	<< " with %1 and %2 in the middle of it.\n";
+}
+
+static void addArgument(QByteArray& args, const QString& arg)
+{
+  QByteArray utf8 = arg.toUtf8();
+  uint32_t size = utf8.size();
+  args.append((const char*)&size, sizeof(size));
+  args.append(utf8);
+}
+
+// the arguments of a formatted message packet for one of the templates
+static uint32_t makeMessage(const BenchMessages& generator,
+			    QByteArray& args)
+{
+  args.clear();
+  uint32_t formatId = 100 + (rand() % 8);
+
+  switch (formatId)
+  {
+  case 100:
+  case 101:
+    addArgument(args, generator.name());
+    addArgument(args, generator.name());
+    addArgument(args, QString::number(rand() % 500));
+    break;
+  case 102:
+    addArgument(args, QString::number(rand() % 500));
+    addArgument(args, generator.name());
+    break;
+  case 103:
+    addArgument(args, generator.item());
+    addArgument(args, generator.name());
+    break;
+  case 104:
+    addArgument(args, generator.name());
+    addArgument(args, generator.name());
+    break;
+  case 105:
+    addArgument(args, generator.name());
+    addArgument(args, QString::number(200 + (rand() % 3)));
+    addArgument(args, generator.name());
+    addArgument(args, QString::number(rand() % 500));
+    addArgument(args, QString::number(300 + (rand() % 3)));
+    break;
+  case 106:
+    addArgument(args, generator.name());
+    addArgument(args, RANDOM(spells));
+    break;
+  case 107:
+    addArgument(args, generator.name());
+    addArgument(args, QString::number(200 + (rand() % 3)));
+    addArgument(args, generator.name());
+    break;
+  }
+
+  return formatId;
+}
+
+// formatMessage() as it was, looking the template up and substituting
+// its arguments with a regexp every time
+static QString regexpFormat(const EQStr& eqstr, uint32_t formatid,
+			    const char* arguments, size_t argsLen)
+{
+  QString formatString = eqstr.find(formatid);
+
+  QVector<QString> argList;
+  size_t totalArgsLen = 0;
+  while (totalArgsLen < argsLen)
+  {
+    const char* curArg = arguments + totalArgsLen;
+    uint32_t curSize = eqtohuint32((const uint8_t*)curArg);
+    curArg += 4;
+    if (curSize > 0)
+      argList.push_back(QString::fromUtf8(curArg, curSize));
+    totalArgsLen += curSize + 4;
+  }
+
+  bool ok;
+  QRegExp rxt("%T(\\d{1,3})");
+  int curPos = rxt.indexIn(formatString, 0);
+  while (curPos != -1)
+  {
+    QString subst;
+    int substArg = rxt.cap(1).toInt(&ok);
+    if (ok && (substArg <= argList.size()))
+    {
+      int substArgValue = argList[substArg - 1].toInt(&ok);
+      if (ok)
+	subst = eqstr.find(substArgValue);
+    }
+
+    if (!subst.isEmpty())
+      formatString.replace(curPos, rxt.matchedLength(), subst);
+    else
+    {
+      formatString.replace(curPos, rxt.matchedLength(), "");
+      curPos += rxt.matchedLength();
+    }
+
+    curPos = rxt.indexIn(formatString, curPos);
+  }
+
+  QRegExp rx("%(\\d{1,3})");
+  curPos = rx.indexIn(formatString, 0);
+  while (curPos != -1)
+  {
+    int substArg = rx.cap(1).toInt(&ok);
+    if (ok && (substArg <= argList.size()))
+    {
+      QString sub = argList[substArg - 1];
+      if (sub.contains('^'))
+      {
+	sub = sub.mid(sub.lastIndexOf('^') + 1);
+	if (sub.startsWith("'"))
+	  sub.replace(0, 1, "");
+      }
+      formatString.replace(curPos, rx.matchedLength(), sub);
+    }
+    else
+    {
+      formatString.replace(curPos, rx.matchedLength(), "");
+      curPos += rx.matchedLength();
+    }
+
+    curPos = rx.indexIn(formatString, curPos);
+  }
+
+  return formatString;
+}
+
+// Micro-benchmark comparing formatting messages with the regexp
+// substitution formatMessage() used to do against the templates split
+// at load time, checking that both produce the same text.
+// usage: eqstrbench [messages] [iterations] [eqstr_us.txt]
+int main (int argc, char *argv[])
+{
+  int numMessages = (argc > 1) ? atoi(argv[1]) : 1000;
+  int iterations = (argc > 2) ? atoi(argv[2]) : 50;
+  int i, j;
+
+  srand(BENCH_SEED);
+
+  QString fileName;
+  QTemporaryFile templates;
+  if (argc > 3)
+    fileName = argv[3];
+  else
+  {
+    if (!templates.open())
+    {
+      fprintf(stderr, "Failed to create a template file\n");
+      return 1;
+    }
+
+    QTextStream out(&templates);
+    writeTemplates(out, 8000);
+    out.flush();
+    fileName = templates.fileName();
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  EQStr eqstr;
+  if (!eqstr.load(fileName))
+    return 1;
+  printf("load: %.2f ms\n", double(timer.nsecsElapsed()) / 1000000.0);
+
+  BenchMessages generator;
+  QList<uint32_t> formatIds;
+  QList<QByteArray> arguments;
+  QByteArray args;
+  for (i = 0; i < numMessages; i++)
+  {
+    formatIds.append(makeMessage(generator, args));
+    arguments.append(args);
+  }
+
+  // validate the split templates against the regexp substitution
+  int mismatches = 0;
+  for (i = 0; i < numMessages; i++)
+  {
+    QString expected = regexpFormat(eqstr, formatIds[i],
+				    arguments[i].constData(),
+				    arguments[i].size());
+    QString formatted = eqstr.formatMessage(formatIds[i],
+					    arguments[i].constData(),
+					    arguments[i].size());
+    if (formatted != expected)
+    {
+      mismatches++;
+      fprintf(stderr, "mismatch: '%s' != '%s'\n",
+	      formatted.toUtf8().data(), expected.toUtf8().data());
+    }
+  }
+
+  printf("messages: %d, iterations: %d, mismatches: %d\n",
+	 numMessages, iterations, mismatches);
+
+  int length = 0;
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (i = 0; i < numMessages; i++)
+      length += regexpFormat(eqstr, formatIds[i], arguments[i].constData(),
+			     arguments[i].size()).length();
+  qint64 regexp = timer.nsecsElapsed();
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (i = 0; i < numMessages; i++)
+      length -= eqstr.formatMessage(formatIds[i], arguments[i].constData(),
+				    arguments[i].size()).length();
+  qint64 split = timer.nsecsElapsed();
+
+  benchReport("message", double(numMessages) * iterations,
+	      "regexp:", regexp, "split:", split);
+
+  return benchResult(mismatches, length);
+}
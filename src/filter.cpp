@@ -189,6 +189,7 @@ void FilterItem::init(const QString& regexString, bool caseSensitive,
 {
   m_minLevel = minLevel;
   m_maxLevel = maxLevel;
+  m_caseSensitive = caseSensitive;
 
 #ifdef DEBUG_FILTER
   seqDebug("regexString=%s minLevel=%d maxLevel=%d", 
@@ -282,26 +283,9 @@ bool FilterItem::save(QString& indent, QTextStream& out)
 
 bool FilterItem::isFiltered(const QString& filterString, uint8_t level) const
 {
-  // check the main filter string
+  // check the main filter string, then any level range component
   if (filterString.indexOf(m_regexp) != -1)
-  {
-    // is there is a level range component to this filter
-    if ((m_minLevel > 0) || (m_maxLevel > 0))
-    {
-      if (m_maxLevel != m_minLevel)
-      {
-        if ((level >= m_minLevel) && (level <= m_maxLevel))
-          return true; // filter matched
-      }
-      else
-      {
-        if (level == m_minLevel)
-         return true;
-      }
-    }
-    else 
-      return true; // filter matched
-  }
+    return levelMatches(level);
 
   return false;
 }
@@ -554,7 +538,8 @@ int Filter::getMaxLevel(int index) const
 //----------------------------------------------------------------------
 //  Filters
 Filters::Filters(const FilterTypes& types)
-  : m_types(types)
+  : m_types(types),
+    m_compiledValid(false)
 {
 }
 
@@ -580,6 +565,8 @@ bool Filters::clear(void)
   // empty the container
   m_filters.clear();
 
+  m_compiledValid = false;
+
   return true;
 }
 
@@ -604,6 +591,8 @@ bool Filters::clearType(uint8_t type)
   // delete the filter
   delete filter;
 
+  m_compiledValid = false;
+
   return true;
 }
 
@@ -759,9 +748,29 @@ void Filters::setCaseSensitive(bool caseSensitive)
     // set the case sensitivity of each one
     it->second->setCaseSensitive(caseSensitive);
   }
+
+  m_compiledValid = false;
 }
 
 uint32_t Filters::filterMask(const QString& filterString, uint8_t level) const
+{
+  // bring the compiled filters up to date with any changes
+  compile();
+
+  return m_compiled.filterMask(filterString, level);
+}
+
+void Filters::compile(void) const
+{
+  if (m_compiledValid)
+    return;
+
+  m_compiled.compile(m_filters);
+  m_compiledValid = true;
+}
+
+uint32_t Filters::filterMaskPerItem(const QString& filterString,
+				    uint8_t level) const
 {
   uint32_t mask = 0;
   FilterMap::const_iterator it;
@@ -803,6 +812,8 @@ bool Filters::addFilter(uint8_t type, const QString& filterPattern,
   else // use the existing filter
     filter = it->second;
 
+  m_compiledValid = false;
+
   if (filter)
     return filter->addFilter(filterPattern, minLevel, maxLevel);
 
@@ -830,6 +841,8 @@ void Filters::remFilter(uint8_t type, const QString& filterPattern)
 
   if (filter)
     filter->remFilter(filterPattern);
+
+  m_compiledValid = false;
 }
 
 int Filters::numFilters(uint8_t type) const
@@ -885,6 +898,268 @@ int Filters::getMaxLevel(uint8_t type, int index) const
 
 
 
+//----------------------------------------------------------------------
+//  CompiledFilters
+CompiledFilters::CompiledFilters()
+  : m_hasAny(false),
+    m_numPatterns(0),
+    m_numMerged(0),
+    m_numRegex(0)
+{
+}
+
+CompiledFilters::~CompiledFilters()
+{
+  clear();
+}
+
+void CompiledFilters::clear(void)
+{
+  m_groups.clear();
+
+  m_hasAny = false;
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  m_any = QRegularExpression();
+#else
+  m_any = QRegExp();
+#endif
+  m_numPatterns = 0;
+  m_numMerged = 0;
+  m_numRegex = 0;
+}
+
+bool CompiledFilters::mergeable(const FilterItem* item)
+{
+  // invalid patterns never match, leave them to FilterItem
+  if (!item->valid())
+    return false;
+
+  // reject anything whose meaning could change when it's wrapped in a
+  // group and joined with other patterns: numbered/named back references
+  // and groups, recursion, conditionals, \Q...\E quoting, verbs and
+  // extended mode (which would turn the closing paren into a comment)
+  QString pattern = item->filterPattern();
+  int len = pattern.length();
+  for (int i = 0; i < len; i++)
+  {
+    QChar c = pattern[i];
+
+    if (c == '\\')
+    {
+      if (++i >= len)
+	return false;
+
+      c = pattern[i];
+      if ((c.isDigit() && (c != '0')) ||
+	  (c == 'g') || (c == 'k') || (c == 'Q'))
+	return false;
+
+      continue;
+    }
+
+    if ((c != '(') || ((i + 1) >= len))
+      continue;
+
+    c = pattern[i + 1];
+    if (c == '*')
+      return false;
+
+    if (c != '?')
+      continue;
+
+    if ((i + 2) >= len)
+      return false;
+
+    c = pattern[i + 2];
+    if ((c == 'P') || (c == '\'') || (c == 'R') || (c == '&') ||
+	(c == '|') || (c == '(') || (c == '+') || c.isDigit())
+      return false;
+
+    // named group, but not a lookbehind
+    if ((c == '<') && ((i + 3) < len) &&
+	(pattern[i + 3] != '=') && (pattern[i + 3] != '!'))
+      return false;
+
+    // option settings, (?-1) is a relative recursion
+    if ((c == '-') || (c == '^') || c.isLetter())
+    {
+      for (int j = i + 2; j < len; j++)
+      {
+	c = pattern[j];
+	if ((c == ')') || (c == ':'))
+	  break;
+
+	if ((c == 'x') || c.isDigit())
+	  return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void CompiledFilters::compile(const FilterMap& filters)
+{
+  clear();
+
+  FilterMap::const_iterator it;
+  QStringList anyPatterns;
+
+  // sort the filter items into groups by type, level range and case
+  for (it = filters.begin(); it != filters.end(); ++it)
+  {
+    const Filter* filter = it->second;
+    if (!filter)
+      continue;
+
+    for (int i = 0; i < filter->numFilters(); i++)
+    {
+      const FilterItem* item = filter->filterItem(i);
+      if (!item)
+	break;
+
+      m_numPatterns++;
+
+      int index;
+      for (index = 0; index < m_groups.size(); index++)
+      {
+	const Group& g = m_groups[index];
+	if ((g.mask == it->first) &&
+	    (g.minLevel == item->minLevel()) &&
+	    (g.maxLevel == item->maxLevel()) &&
+	    (g.caseSensitive == item->caseSensitive()))
+	  break;
+      }
+
+      if (index == m_groups.size())
+      {
+	Group g;
+	g.mask = it->first;
+	g.minLevel = item->minLevel();
+	g.maxLevel = item->maxLevel();
+	g.caseSensitive = item->caseSensitive();
+	g.hasMerged = false;
+	m_groups.append(g);
+      }
+
+      Group* group = &m_groups[index];
+      if (mergeable(item))
+	group->patterns.append(item->filterPattern());
+      else
+	group->unmerged.append(*item);
+    }
+  }
+
+  // build the alternation for each group
+  for (int j = 0; j < m_groups.size(); j++)
+  {
+    Group* group = &m_groups[j];
+    if (group->patterns.isEmpty())
+    {
+      m_numRegex += group->unmerged.size();
+      continue;
+    }
+
+    QString merged = "(?:" + group->patterns.join(")|(?:") + ")";
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+    group->merged.setPattern(merged);
+    if (!group->caseSensitive)
+      group->merged.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+#else
+    group->merged.setPatternSyntax(QRegExp::RegExp);
+    group->merged.setCaseSensitivity(group->caseSensitive ?
+				     Qt::CaseSensitive : Qt::CaseInsensitive);
+    group->merged.setPattern(merged);
+#endif
+
+    if (group->merged.isValid())
+    {
+      group->hasMerged = true;
+      m_numMerged += group->patterns.size();
+      m_numRegex++;
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+      // level independent groups also go into the union, with their
+      // case sensitivity scoped to just their alternatives
+      if (!group->minLevel && !group->maxLevel)
+	anyPatterns.append((group->caseSensitive ? "(?:" : "(?i:") +
+			   merged + ")");
+#endif
+    }
+    else
+    {
+      // shouldn't happen, but fall back on checking them one at a time
+      seqWarn("Filter: failed to merge %d patterns - %s",
+	      group->patterns.size(),
+	      group->merged.errorString().toLatin1().data());
+
+      const Filter* filter = filters.find(group->mask)->second;
+      for (int i = 0; i < filter->numFilters(); i++)
+      {
+	const FilterItem* item = filter->filterItem(i);
+	if ((item->minLevel() == group->minLevel) &&
+	    (item->maxLevel() == group->maxLevel) &&
+	    (item->caseSensitive() == group->caseSensitive) &&
+	    mergeable(item))
+	  group->unmerged.append(*item);
+      }
+    }
+
+    m_numRegex += group->unmerged.size();
+  }
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  // only worth it if it replaces more than one search
+  if (anyPatterns.size() > 1)
+  {
+    m_any.setPattern(anyPatterns.join("|"));
+    m_hasAny = m_any.isValid();
+  }
+#endif
+}
+
+uint32_t CompiledFilters::filterMask(const QString& filterString,
+				     uint8_t level) const
+{
+  uint32_t mask = 0;
+
+  // if none of the level independent patterns match anywhere, their
+  // groups don't need to be searched individually
+  bool anyMatch = !m_hasAny || (filterString.indexOf(m_any) != -1);
+
+  QListIterator<Group> it(m_groups);
+  while (it.hasNext())
+  {
+    const Group* group = &it.next();
+
+    // type already matched, or level out of range for the whole group
+    if ((mask & group->mask) ||
+	!FilterItem::levelMatches(group->minLevel, group->maxLevel, level))
+      continue;
+
+    if (group->hasMerged &&
+	(anyMatch || group->minLevel || group->maxLevel) &&
+	(filterString.indexOf(group->merged) != -1))
+    {
+      mask |= group->mask;
+      continue;
+    }
+
+    QListIterator<FilterItem> uit(group->unmerged);
+    while (uit.hasNext())
+    {
+      if (uit.next().isFiltered(filterString, level))
+      {
+	mask |= group->mask;
+	break;
+      }
+    }
+  }
+
+  return mask;
+}
+
+
 ///////////////////////////////////
 //  FilterTypes
 FilterTypes::FilterTypes()
@@ -33,6 +33,7 @@
 
 #include <QString>
 #include <QList>
+#include <QStringList>
 #include <QTextStream>
 
 #if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
@@ -135,13 +136,17 @@ public:
    bool save(QString& indent, QTextStream& out);
 
   bool isFiltered(const QString& filterString, uint8_t level) const;
+  bool levelMatches(uint8_t level) const
+    { return levelMatches(m_minLevel, m_maxLevel, level); }
+  static bool levelMatches(uint8_t minLevel, uint8_t maxLevel, uint8_t level);
 
   QString name() const { return m_regexp.pattern(); }
   QString filterPattern() const { return m_regexp.pattern(); }
   QString origFilterPattern() const { return m_regexpOriginalPattern; }
   uint8_t minLevel() const { return m_minLevel; }
   uint8_t maxLevel() const { return m_maxLevel; }
-  bool valid() { return m_regexp.isValid(); }
+  bool caseSensitive() const { return m_caseSensitive; }
+  bool valid() const { return m_regexp.isValid(); }
 
  protected:
   void init(const QString& filterPattern, bool caseSensitive, uint8_t minLevel,
@@ -155,8 +160,22 @@ public:
   QString m_regexpOriginalPattern;
   uint8_t m_minLevel;
   uint8_t m_maxLevel;
+  bool m_caseSensitive;
 };
 
+inline bool FilterItem::levelMatches(uint8_t minLevel, uint8_t maxLevel,
+				     uint8_t level)
+{
+  // no level range component to the filter
+  if ((minLevel == 0) && (maxLevel == 0))
+    return true;
+
+  if (maxLevel != minLevel)
+    return ((level >= minLevel) && (level <= maxLevel));
+
+  return (level == minLevel);
+}
+
 
 //--------------------------------------------------
 // Filter
@@ -175,6 +194,7 @@ public:
    void setCaseSensitive(bool caseSensitive);
 
    int numFilters() const { return m_filterItems.size(); }
+   const FilterItem* filterItem(int index) const { return m_filterItems[index]; }
    QString getFilterString(int index) const;
    QString getOrigFilterString(int index) const;
    int getMinLevel(int index) const;
@@ -187,6 +207,64 @@ private:
    bool m_caseSensitive;
 };
 
+//--------------------------------------------------
+// CompiledFilters
+//
+// All the patterns of a Filters object merged into as few regular
+// expressions as possible.  Patterns of the same type with the same level
+// range and case sensitivity are joined into a single alternation, and the
+// level range is checked once for the whole group before the regex is run.
+// A union of all the level independent groups is tried first, so a string
+// that matches nothing (the common case) costs a single regex search.
+// Patterns that can't be safely merged (back references, named groups,
+// \Q...\E, etc.) are still checked individually.
+// Everything is held by value, so a copy is an independent snapshot that
+// can be used from another thread while the original is recompiled.
+class CompiledFilters
+{
+ public:
+  CompiledFilters();
+  ~CompiledFilters();
+
+  void compile(const FilterMap& filters);
+  void clear(void);
+  uint32_t filterMask(const QString& filterString, uint8_t level) const;
+
+  int numPatterns() const { return m_numPatterns; }
+  int numMerged() const { return m_numMerged; }
+  int numRegex() const { return m_numRegex; }
+
+  static bool mergeable(const FilterItem* item);
+
+ protected:
+  struct Group
+  {
+    uint32_t mask;
+    uint8_t minLevel;
+    uint8_t maxLevel;
+    bool caseSensitive;
+    bool hasMerged;
+    QStringList patterns;
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+    QRegularExpression merged;
+#else
+    QRegExp merged;
+#endif
+    QList<FilterItem> unmerged;
+  };
+
+  QList<Group> m_groups;
+  bool m_hasAny;
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  QRegularExpression m_any;
+#else
+  QRegExp m_any;
+#endif
+  int m_numPatterns;
+  int m_numMerged;
+  int m_numRegex;
+};
+
 //--------------------------------------------------
 // Filters
 class Filters
@@ -205,6 +283,9 @@ class Filters
   bool caseSensitive(void) const { return m_caseSensitive; }
   void setCaseSensitive(bool caseSensitive);
   uint32_t filterMask(const QString& filterString, uint8_t level) const;
+  uint32_t filterMaskPerItem(const QString& filterString, uint8_t level) const;
+  void compile(void) const;
+  const CompiledFilters& compiled(void) const { compile(); return m_compiled; }
   bool addFilter(uint8_t type, const QString& filterString, 
 		 uint8_t minLevel = 0, uint8_t maxLevel = 0);
   void remFilter(uint8_t type, const QString& filterString);
@@ -220,6 +301,8 @@ class Filters
   FilterMap m_filters;
   const FilterTypes& m_types;
   bool m_caseSensitive;
+  mutable CompiledFilters m_compiled;
+  mutable bool m_compiledValid;
 };
 
 //--------------------------------------------------
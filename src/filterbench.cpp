@@ -0,0 +1,220 @@
+/*
+ *  filterbench.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <QString>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "filter.h"
+#include "benchutil.h"
+
+static const char* names[] =
+{
+  "a_gnoll_pup", "a_gnoll", "Fippy_Darkpaw", "an_orc_pawn", "an_orc_centurion",
+  "a_decaying_skeleton", "a_large_rat", "a_fire_beetle", "Guard_Jenkins",
+  "Lord_Nagafen", "Lady_Vox", "Emperor_Crush", "a_bloodgill_goblin",
+  "Innoruuk", "a_willowisp", "Ghoul_Lord", "a_dark_elf_warrior", "Sir_Lucan",
+  "a_kobold_shaman", "a_froglok_tad", "Phinigel_Autropos", "a_shadowed_man",
+};
+
+static const char* races[] =
+{
+  "Gnoll", "Orc", "Human", "Skeleton", "Rat", "Beetle", "Barbarian", "Dragon",
+  "Goblin", "Kobold", "Froglok", "Dark Elf", "Wisp", "Ghoul", "Giant",
+};
+
+static const char* classes[] =
+{
+  "Warrior", "Cleric", "Paladin", "Ranger", "Shadow Knight", "Druid", "Monk",
+  "Bard", "Rogue", "Shaman", "Necromancer", "Wizard", "Magician",
+  "Enchanter", "Banker", "Merchant", "Unknown",
+};
+
+static const char* guilds[] =
+{
+  "", "", "", "Ashen Order", "Unrest", "Seekers of Souls", "Tax Collectors",
+};
+
+// a filter string in the same format Spawn::filterString() generates
+static QString makeFilterString(uint8_t& level)
+{
+  QString name = RANDOM(names);
+  int num = rand() % 10;
+  if (num)
+    name += QString::number(num, 10).rightJustified(2, '0');
+
+  level = uint8_t(1 + (rand() % 70));
+
+  return QString("Name:%1:Level:%2:Race:%3:Class:%4:NPC:%5:"
+		 "X:%6:Y:%7:Z:%8:"
+		 "Light:%9:")
+    .arg(name).arg(level).arg(RANDOM(races)).arg(RANDOM(classes))
+    .arg(rand() % 2).arg((rand() % 4000) - 2000).arg((rand() % 4000) - 2000)
+    .arg((rand() % 200) - 100).arg((rand() % 4) ? "None" : "CAN")
+    + QString("Deity:Agnostic:RTeam:%1:DTeam:%2:Type:NPC:LastName::"
+	      "Guild:%3:Spawn:12.00.00:Info:H:0:C:0:A:0:W:0:G:0:L:0:F:0:"
+	      "1:%4:2:0:GM:0:")
+    .arg(rand() % 5).arg(rand() % 5).arg(RANDOM(guilds)).arg(rand() % 20);
+}
+
+// a filter set shaped like a well used filters.xml
+static void makeFilters(Filters& filters, int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    uint8_t type = uint8_t(rand() % 7);
+    uint8_t minLevel = 0;
+    uint8_t maxLevel = 0;
+    QString pattern;
+
+    switch (rand() % 10)
+    {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+      pattern = QString("Name:%1").arg(RANDOM(names));
+      break;
+    case 4:
+      pattern = QString("^Name:%1%2")
+	.arg(RANDOM(names)).arg(rand() % 10, 2, 10, QChar('0'));
+      break;
+    case 5:
+      pattern = QString("Race:%1").arg(RANDOM(races));
+      minLevel = uint8_t(1 + (rand() % 50));
+      maxLevel = uint8_t(minLevel + (rand() % 20));
+      break;
+    case 6:
+      pattern = QString("Race:%1.*Class:%2")
+	.arg(RANDOM(races)).arg(RANDOM(classes));
+      break;
+    case 7:
+      pattern = QString("Guild:%1:").arg(RANDOM(guilds));
+      break;
+    case 8:
+      pattern = QString("Name:(a|an)_%1.*NPC:1")
+	.arg(QString(RANDOM(races)).toLower());
+      break;
+    case 9:
+      // something the compiled filters can't merge
+      pattern = QString("Name:(%1)_\\1").arg(RANDOM(names));
+      break;
+    }
+
+    filters.addFilter(type, pattern, minLevel, maxLevel);
+  }
+}
+
+// Micro-benchmark comparing the per-pattern filter evaluation with the
+// compiled filters, checking that both produce the same masks.
+// usage: filterbench [patterns] [strings] [iterations] [filters.xml]
+int main (int argc, char *argv[])
+{
+  int numPatterns = (argc > 1) ? atoi(argv[1]) : 300;
+  int numStrings = (argc > 2) ? atoi(argv[2]) : 1000;
+  int iterations = (argc > 3) ? atoi(argv[3]) : 20;
+  int i, j;
+
+  srand(BENCH_SEED);
+
+  FilterTypes types;
+  uint8_t type;
+  uint32_t mask;
+  types.registerType("Hunt", type, mask);
+  types.registerType("Caution", type, mask);
+  types.registerType("Danger", type, mask);
+  types.registerType("Locate", type, mask);
+  types.registerType("Alert", type, mask);
+  types.registerType("Filtered", type, mask);
+  types.registerType("Tracer", type, mask);
+
+  Filters filters(types);
+  if (argc > 4)
+  {
+    if (!filters.load(argv[4]))
+    {
+      fprintf(stderr, "Failed to load filters from '%s'\n", argv[4]);
+      return 1;
+    }
+  }
+  else
+    makeFilters(filters, numPatterns);
+
+  QStringList strings;
+  QList<uint8_t> levels;
+  uint8_t level;
+  for (i = 0; i < numStrings; i++)
+  {
+    strings.append(makeFilterString(level));
+    levels.append(level);
+  }
+
+  const CompiledFilters& compiled = filters.compiled();
+  printf("patterns: %d, merged: %d, regex: %d, strings: %d, iterations: %d\n",
+	 compiled.numPatterns(), compiled.numMerged(), compiled.numRegex(),
+	 numStrings, iterations);
+
+  // validate the compiled filters against the per-pattern evaluation
+  int mismatches = 0;
+  int matches = 0;
+  for (i = 0; i < numStrings; i++)
+  {
+    uint32_t perItem = filters.filterMaskPerItem(strings[i], levels[i]);
+    if (perItem)
+      matches++;
+
+    if (filters.filterMask(strings[i], levels[i]) != perItem)
+    {
+      mismatches++;
+      fprintf(stderr, "mismatch: %s (level %d)\n",
+	      strings[i].toLatin1().data(), levels[i]);
+    }
+  }
+
+  printf("matching strings: %d, mismatches: %d\n", matches, mismatches);
+
+  QElapsedTimer timer;
+  uint32_t sum = 0;
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (i = 0; i < numStrings; i++)
+      sum += filters.filterMaskPerItem(strings[i], levels[i]);
+  qint64 perItem = timer.nsecsElapsed();
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (i = 0; i < numStrings; i++)
+      sum -= filters.filterMask(strings[i], levels[i]);
+  qint64 merged = timer.nsecsElapsed();
+
+  benchReport("string", double(numStrings) * iterations,
+	      "per-pattern:", perItem, "compiled:", merged);
+
+  filters.clear();
+
+  return benchResult(mismatches, sum);
+}
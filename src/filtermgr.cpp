@@ -116,6 +116,16 @@ uint32_t FilterMgr::filterMask(const QString& filterString, uint8_t level) const
   return mask;
 }
 
+const CompiledFilters& FilterMgr::compiledFilters(void) const
+{
+  return m_filters->compiled();
+}
+
+const CompiledFilters& FilterMgr::compiledZoneFilters(void) const
+{
+  return m_zoneFilters->compiled();
+}
+
 QString FilterMgr::filterString(uint32_t mask) const
 {
   return m_types->names(mask);
@@ -308,6 +318,11 @@ uint32_t FilterMgr::runtimeFilterMask(const QString& filterString,
   return m_runtimeFilters->filterMask(filterString, level);
 }
 
+const CompiledFilters& FilterMgr::compiledRuntimeFilters(void) const
+{
+  return m_runtimeFilters->compiled();
+}
+
 QString FilterMgr::runtimeFilterString(uint32_t filterMask) const
 {
   return m_runtimeTypes->names(filterMask);
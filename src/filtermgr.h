@@ -52,6 +52,7 @@
 class Filter;
 class Filters;
 class FilterTypes;
+class CompiledFilters;
 class DataLocationMgr;
 
 //
@@ -107,6 +108,8 @@ class FilterMgr : public QObject
   void setCaseSensitive(bool caseSensitive);
 
   uint32_t filterMask(const QString& filterString, uint8_t level) const;
+  const CompiledFilters& compiledFilters(void) const;
+  const CompiledFilters& compiledZoneFilters(void) const;
   QString filterString(uint32_t mask) const;
   QString filterName(uint8_t filter) const;
   bool addFilter(uint8_t filter, const QString& filterString);
@@ -119,6 +122,7 @@ class FilterMgr : public QObject
 			     uint32_t& flagMask);
   void unregisterRuntimeFilter(uint8_t flag);
   uint32_t runtimeFilterMask(const QString& filterString, uint8_t level) const;
+  const CompiledFilters& compiledRuntimeFilters(void) const;
   QString runtimeFilterString(uint32_t filterMask) const;
   bool runtimeFilterAddFilter(uint8_t flag, const QString& filter);
   void runtimeFilterRemFilter(uint8_t flag, const QString& filter);
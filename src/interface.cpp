@@ -880,6 +880,8 @@ EQInterface::EQInterface(DataLocationMgr* dlm,
 	   this, SLOT(killSpawn(const Item*)));
    connect(m_spawnShell, SIGNAL(changeItem(const Item*, uint32_t)),
 	   this, SLOT(changeItem(const Item*)));
+   connect(m_spawnShell, SIGNAL(changeItems(const ItemList&, uint32_t)),
+	   this, SLOT(changeItems(const ItemList&)));
    connect(m_spawnShell, SIGNAL(spawnConsidered(const Item*)),
 	   this, SLOT(spawnConsidered(const Item*)));
 
@@ -2607,6 +2609,7 @@ void EQInterface::createDebugMenu() {
    pDebugMenu->addAction("List I&nterface", this, SLOT(listInterfaceInfo()));
    pDebugMenu->addAction("List S&pawns", this, SLOT(listSpawns()), Qt::ALT|Qt::CTRL|Qt::Key_P);
    pDebugMenu->addAction("List &Drops", this, SLOT(listDrops()), Qt::ALT|Qt::CTRL|Qt::Key_D);
+   pDebugMenu->addAction("List &Item Allocations", this, SLOT(listItemAllocations()));
    pDebugMenu->addAction("List &Map Info", this, SLOT(listMapInfo()), Qt::ALT|Qt::CTRL|Qt::Key_M);
    pDebugMenu->addAction("List G&uild Info", m_guildmgr, SLOT(listGuildInfo()));
    pDebugMenu->addAction("List &Group", this, SLOT(listGroup()), Qt::ALT|Qt::CTRL|Qt::Key_G);
@@ -3639,6 +3642,22 @@ void EQInterface::listDrops (void)
   seqInfo(outText.toLatin1().data());
 }
 
+void EQInterface::listItemAllocations(void)
+{
+#ifdef DEBUG
+  qDebug ("listItemAllocations()");
+#endif /* DEBUG */
+  QString outText;
+
+  // open the output data stream
+  QTextStream out(&outText, QIODevice::WriteOnly);
+
+  // dump the item arena counters
+  m_spawnShell->dumpArenaInfo(out);
+
+  seqInfo(outText.toLatin1().data());
+}
+
 void EQInterface::listMapInfo(void)
 {
 #ifdef DEBUG
@@ -5141,6 +5160,12 @@ void EQInterface::changeItem(const Item* item)
   updateSelectedSpawnStatus(item);
 }
 
+void EQInterface::changeItems(const ItemList& items)
+{
+  if (items.contains(m_selectedSpawn))
+    updateSelectedSpawnStatus(m_selectedSpawn);
+}
+
 void EQInterface::updateSelectedSpawnStatus(const Item* item)
 {
   if (item == 0)
@@ -5578,7 +5603,7 @@ void EQInterface::init_view_menu()
    // set initial view options
   if (m_spawnList != 0)
   {
-    SEQListView* spawnList = m_spawnList->spawnList();
+    SpawnList* spawnList = m_spawnList->spawnList();
 
     // make sure the menu bar settings are correct
     for (int i = 0; i < tSpawnColMaxCols; i++)
@@ -166,6 +166,7 @@ class EQInterface:public QMainWindow
    void delItem(const Item* item);
    void killSpawn(const Item* item);
    void changeItem(const Item* item);
+   void changeItems(const ItemList& items);
 
    void updateSelectedSpawnStatus(const Item* item);
 
@@ -187,6 +188,7 @@ class EQInterface:public QMainWindow
    void toggle_log_RawData();
    void listSpawns(void);
    void listDrops(void);
+   void listItemAllocations(void);
    void listMapInfo(void);
    void listInterfaceInfo(void);
    void listGroup(void);
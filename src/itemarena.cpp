@@ -0,0 +1,167 @@
+/*
+ *  itemarena.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <new>
+
+#include <QTextStream>
+
+#include "itemarena.h"
+
+#pragma message("Once our minimum supported Qt version is greater than 5.14, this check can be removed and ENDL replaced with Qt::endl")
+#if (QT_VERSION >= QT_VERSION_CHECK(5,14,0))
+#define ENDL Qt::endl
+#else
+#define ENDL endl
+#endif
+
+// slots are kept aligned for anything the items may contain
+static const size_t slotAlignment = 16;
+
+//----------------------------------------------------------------------
+// ItemArena
+ItemArena::ItemArena(const char* name, size_t objectSize, int slotsPerBlock)
+  : m_name(name),
+    m_objectSize(objectSize),
+    m_slotsPerBlock(slotsPerBlock),
+    m_curBlock(-1),
+    m_nextSlot(slotsPerBlock),
+    m_free(NULL),
+    m_allocations(0),
+    m_releases(0),
+    m_reused(0),
+    m_passedThrough(0),
+    m_blockAllocations(0),
+    m_resets(0),
+    m_live(0),
+    m_peakLive(0)
+{
+  size_t size = objectSize;
+  if (size < sizeof(FreeSlot))
+    size = sizeof(FreeSlot);
+
+  m_slotSize = (size + slotAlignment - 1) & ~(slotAlignment - 1);
+}
+
+ItemArena::~ItemArena()
+{
+  // objects still alive at exit keep their memory
+  if (m_live == 0)
+  {
+    m_curBlock = -1;
+    trim();
+  }
+}
+
+void* ItemArena::allocate(size_t size)
+{
+  if (size != m_objectSize)
+  {
+    m_passedThrough++;
+    return ::operator new(size);
+  }
+
+  m_allocations++;
+  if (++m_live > m_peakLive)
+    m_peakLive = m_live;
+
+  // reuse a released slot if there is one
+  if (m_free)
+  {
+    FreeSlot* slot = m_free;
+    m_free = slot->next;
+    m_reused++;
+    return (void*)slot;
+  }
+
+  // otherwise carve a new one, moving on to the next block if necessary
+  if (m_nextSlot == m_slotsPerBlock)
+  {
+    m_curBlock++;
+    if (m_curBlock == m_blocks.size())
+    {
+      m_blocks.append((char*)::operator new(m_slotSize * m_slotsPerBlock));
+      m_blockAllocations++;
+    }
+    m_nextSlot = 0;
+  }
+
+  return (void*)(m_blocks[m_curBlock] + (m_slotSize * m_nextSlot++));
+}
+
+void ItemArena::release(void* p, size_t size)
+{
+  if (p == NULL)
+    return;
+
+  if (size != m_objectSize)
+  {
+    ::operator delete(p);
+    return;
+  }
+
+  m_releases++;
+  m_live--;
+
+  FreeSlot* slot = (FreeSlot*)p;
+  slot->next = m_free;
+  m_free = slot;
+}
+
+bool ItemArena::reset(void)
+{
+  if (m_live != 0)
+    return false;
+
+  // all the slots are free, start carving from the first block again
+  m_free = NULL;
+  m_curBlock = -1;
+  m_nextSlot = m_slotsPerBlock;
+  m_resets++;
+
+  return true;
+}
+
+void ItemArena::trim(void)
+{
+  // everything past the current block has never been handed out since the
+  // last reset, and there are no free list entries pointing into it
+  for (int i = m_curBlock + 1; i < m_blocks.size(); i++)
+    ::operator delete(m_blocks[i]);
+
+  m_blocks.resize(m_curBlock + 1);
+}
+
+void ItemArena::dumpInfo(QTextStream& out) const
+{
+  out << "[" << m_name << "]" << ENDL;
+  out << "SlotSize: " << m_slotSize << ENDL;
+  out << "Blocks: " << m_blocks.size() << " ("
+      << (m_blocks.size() * m_slotsPerBlock * m_slotSize) << " bytes)" << ENDL;
+  out << "BlockAllocations: " << m_blockAllocations << ENDL;
+  out << "Live: " << m_live << ENDL;
+  out << "PeakLive: " << m_peakLive << ENDL;
+  out << "Allocations: " << m_allocations << ENDL;
+  out << "Reused: " << m_reused << ENDL;
+  out << "Releases: " << m_releases << ENDL;
+  out << "PassedThrough: " << m_passedThrough << ENDL;
+  out << "Resets: " << m_resets << ENDL;
+}
@@ -0,0 +1,108 @@
+/*
+ *  itemarena.h
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Zone lifetime slot allocator for the Item subclasses.  SpawnShell creates
+// and destroys thousands of Spawn/Drop/Door objects per zone, each of which
+// used to be a separate trip through the heap.  Each class gets an arena of
+// fixed size slots carved out of large blocks; released slots go on a free
+// list so spawn churn reuses them, and once a zone is cleared the arena is
+// rewound in one step so the next zone's items are packed from the start of
+// the blocks again without the blocks ever going back to the heap.
+
+#ifndef _ITEMARENA_H_
+#define _ITEMARENA_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <cstdint>
+#endif
+#include <cstddef>
+
+#include <QVector>
+
+//----------------------------------------------------------------------
+// forward declarations
+class QTextStream;
+
+//----------------------------------------------------------------------
+// ItemArena
+class ItemArena
+{
+ public:
+  ItemArena(const char* name, size_t objectSize, int slotsPerBlock = 256);
+  ~ItemArena();
+
+  // allocate/release an object, anything not of the arena's object size
+  // (ie. a subclass) is passed through to the global heap
+  void* allocate(size_t size);
+  void release(void* p, size_t size);
+
+  // forget all the slots, keeping the blocks for reuse.  Only does anything
+  // once every object allocated from the arena has been released.
+  bool reset(void);
+
+  // give the blocks that aren't in use back to the heap
+  void trim(void);
+
+  void dumpInfo(QTextStream& out) const;
+
+  // counters
+  const char* name() const { return m_name; }
+  uint64_t allocations() const { return m_allocations; }
+  uint64_t releases() const { return m_releases; }
+  uint64_t reused() const { return m_reused; }
+  uint64_t passedThrough() const { return m_passedThrough; }
+  uint64_t blockAllocations() const { return m_blockAllocations; }
+  uint32_t resets() const { return m_resets; }
+  int live() const { return m_live; }
+  int peakLive() const { return m_peakLive; }
+  int blocks() const { return m_blocks.size(); }
+  size_t slotSize() const { return m_slotSize; }
+
+ protected:
+  struct FreeSlot
+  {
+    FreeSlot* next;
+  };
+
+  const char* m_name;
+  size_t m_objectSize;
+  size_t m_slotSize;
+  int m_slotsPerBlock;
+
+  QVector<char*> m_blocks;
+  int m_curBlock;  // block slots are currently being carved from
+  int m_nextSlot;  // next never used slot in the current block
+  FreeSlot* m_free;
+
+  uint64_t m_allocations;
+  uint64_t m_releases;
+  uint64_t m_reused;
+  uint64_t m_passedThrough;
+  uint64_t m_blockAllocations;
+  uint32_t m_resets;
+  int m_live;
+  int m_peakLive;
+};
+
+#endif // _ITEMARENA_H_
@@ -0,0 +1,312 @@
+/*
+ *  itempositions.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cmath>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "itempositions.h"
+#include "spawn.h"
+
+//----------------------------------------------------------------------
+// batch distance kernels
+void calcDistancesScalar(const int16_t* x, const int16_t* y, const int16_t* z,
+			 size_t count,
+			 int16_t px, int16_t py, int16_t pz,
+			 float* dist2D, float* dist3D)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    float dx = float(int32_t(x[i]) - int32_t(px));
+    float dy = float(int32_t(y[i]) - int32_t(py));
+    float d2 = (dx * dx) + (dy * dy);
+
+    if (dist2D)
+      dist2D[i] = sqrtf(d2);
+
+    if (dist3D)
+    {
+      float dz = float(int32_t(z[i]) - int32_t(pz));
+      dist3D[i] = sqrtf(d2 + (dz * dz));
+    }
+  }
+}
+
+#if defined(__AVX2__)
+// 8 items per iteration, int16 coordinates widened to int32 before the
+// subtraction so that opposite ends of the zone don't overflow
+static inline __m256 lane8Diff(const int16_t* v, __m256i p)
+{
+  __m128i raw = _mm_loadu_si128((const __m128i*)v);
+  return _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_cvtepi16_epi32(raw), p));
+}
+
+void calcDistances(const int16_t* x, const int16_t* y, const int16_t* z,
+		   size_t count,
+		   int16_t px, int16_t py, int16_t pz,
+		   float* dist2D, float* dist3D)
+{
+  const __m256i vpx = _mm256_set1_epi32(px);
+  const __m256i vpy = _mm256_set1_epi32(py);
+  const __m256i vpz = _mm256_set1_epi32(pz);
+  size_t i = 0;
+
+  for (; (i + 8) <= count; i += 8)
+  {
+    __m256 dx = lane8Diff(x + i, vpx);
+    __m256 dy = lane8Diff(y + i, vpy);
+    __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+    if (dist2D)
+      _mm256_storeu_ps(dist2D + i, _mm256_sqrt_ps(d2));
+
+    if (dist3D)
+    {
+      __m256 dz = lane8Diff(z + i, vpz);
+      _mm256_storeu_ps(dist3D + i,
+		       _mm256_sqrt_ps(_mm256_add_ps(d2,
+						    _mm256_mul_ps(dz, dz))));
+    }
+  }
+
+  // finish off the remainder
+  calcDistancesScalar(x + i, y + i, z + i, count - i, px, py, pz,
+		      dist2D ? dist2D + i : NULL,
+		      dist3D ? dist3D + i : NULL);
+}
+
+const char* distanceKernelName()
+{
+  return "AVX2";
+}
+
+#elif defined(__SSE2__)
+// sign extend the low/high 4 int16 lanes to int32 and subtract p
+static inline __m128 lane4DiffLo(__m128i v, __m128i p)
+{
+  return _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srai_epi32(_mm_unpacklo_epi16(v, v),
+						      16), p));
+}
+
+static inline __m128 lane4DiffHi(__m128i v, __m128i p)
+{
+  return _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srai_epi32(_mm_unpackhi_epi16(v, v),
+						      16), p));
+}
+
+// 8 items per iteration, processed as two sets of 4 float lanes
+void calcDistances(const int16_t* x, const int16_t* y, const int16_t* z,
+		   size_t count,
+		   int16_t px, int16_t py, int16_t pz,
+		   float* dist2D, float* dist3D)
+{
+  const __m128i vpx = _mm_set1_epi32(px);
+  const __m128i vpy = _mm_set1_epi32(py);
+  const __m128i vpz = _mm_set1_epi32(pz);
+  size_t i = 0;
+
+  for (; (i + 8) <= count; i += 8)
+  {
+    __m128i vx = _mm_loadu_si128((const __m128i*)(x + i));
+    __m128i vy = _mm_loadu_si128((const __m128i*)(y + i));
+
+    __m128 dxLo = lane4DiffLo(vx, vpx);
+    __m128 dxHi = lane4DiffHi(vx, vpx);
+    __m128 dyLo = lane4DiffLo(vy, vpy);
+    __m128 dyHi = lane4DiffHi(vy, vpy);
+    __m128 d2Lo = _mm_add_ps(_mm_mul_ps(dxLo, dxLo), _mm_mul_ps(dyLo, dyLo));
+    __m128 d2Hi = _mm_add_ps(_mm_mul_ps(dxHi, dxHi), _mm_mul_ps(dyHi, dyHi));
+
+    if (dist2D)
+    {
+      _mm_storeu_ps(dist2D + i, _mm_sqrt_ps(d2Lo));
+      _mm_storeu_ps(dist2D + i + 4, _mm_sqrt_ps(d2Hi));
+    }
+
+    if (dist3D)
+    {
+      __m128i vz = _mm_loadu_si128((const __m128i*)(z + i));
+      __m128 dzLo = lane4DiffLo(vz, vpz);
+      __m128 dzHi = lane4DiffHi(vz, vpz);
+      _mm_storeu_ps(dist3D + i,
+		    _mm_sqrt_ps(_mm_add_ps(d2Lo, _mm_mul_ps(dzLo, dzLo))));
+      _mm_storeu_ps(dist3D + i + 4,
+		    _mm_sqrt_ps(_mm_add_ps(d2Hi, _mm_mul_ps(dzHi, dzHi))));
+    }
+  }
+
+  // finish off the remainder
+  calcDistancesScalar(x + i, y + i, z + i, count - i, px, py, pz,
+		      dist2D ? dist2D + i : NULL,
+		      dist3D ? dist3D + i : NULL);
+}
+
+const char* distanceKernelName()
+{
+  return "SSE2";
+}
+
+#else
+void calcDistances(const int16_t* x, const int16_t* y, const int16_t* z,
+		   size_t count,
+		   int16_t px, int16_t py, int16_t pz,
+		   float* dist2D, float* dist3D)
+{
+  calcDistancesScalar(x, y, z, count, px, py, pz, dist2D, dist3D);
+}
+
+const char* distanceKernelName()
+{
+  return "scalar";
+}
+#endif
+
+//----------------------------------------------------------------------
+// ItemPositions
+ItemPositions::ItemPositions()
+{
+}
+
+ItemPositions::~ItemPositions()
+{
+  clear();
+}
+
+void ItemPositions::add(Item* item)
+{
+  // already tracked, just refresh its position
+  if (item->positionIndex() >= 0)
+  {
+    update(item);
+    return;
+  }
+
+  item->setPositionIndex(m_items.count());
+  m_items.append(item);
+  m_x.append(item->x());
+  m_y.append(item->y());
+  m_z.append(item->z());
+  m_dist2D.append(0.0f);
+  m_dist3D.append(0.0f);
+}
+
+void ItemPositions::remove(Item* item)
+{
+  int index = item->positionIndex();
+  if ((index < 0) || (index >= m_items.count()) || (m_items[index] != item))
+    return;
+
+  // move the last entry into the vacated slot to keep the arrays dense
+  int last = m_items.count() - 1;
+  if (index != last)
+  {
+    m_items[index] = m_items[last];
+    m_x[index] = m_x[last];
+    m_y[index] = m_y[last];
+    m_z[index] = m_z[last];
+    m_dist2D[index] = m_dist2D[last];
+    m_dist3D[index] = m_dist3D[last];
+    m_items[index]->setPositionIndex(index);
+  }
+
+  m_items.resize(last);
+  m_x.resize(last);
+  m_y.resize(last);
+  m_z.resize(last);
+  m_dist2D.resize(last);
+  m_dist3D.resize(last);
+
+  item->setPositionIndex(-1);
+}
+
+void ItemPositions::update(const Item* item)
+{
+  int index = item->positionIndex();
+  if ((index < 0) || (index >= m_items.count()))
+    return;
+
+  m_x[index] = item->x();
+  m_y[index] = item->y();
+  m_z[index] = item->z();
+}
+
+void ItemPositions::clear()
+{
+  for (int i = 0; i < m_items.count(); i++)
+    m_items[i]->setPositionIndex(-1);
+
+  m_items.clear();
+  m_x.clear();
+  m_y.clear();
+  m_z.clear();
+  m_dist2D.clear();
+  m_dist3D.clear();
+}
+
+void ItemPositions::calcDistances(int16_t px, int16_t py, int16_t pz,
+				  bool setItemDistances, bool fastMachine)
+{
+  int count = m_items.count();
+  if (!count)
+    return;
+
+  ::calcDistances(m_x.constData(), m_y.constData(), m_z.constData(), count,
+		  px, py, pz, m_dist2D.data(), m_dist3D.data());
+
+  if (!setItemDistances)
+    return;
+
+  // push the results back out to the items for the lists and filters
+  Item* const* items = m_items.constData();
+  if (fastMachine)
+  {
+    const float* dist = m_dist3D.constData();
+    for (int i = 0; i < count; i++)
+      items[i]->setDistanceToPlayer(double(dist[i]));
+  }
+  else
+  {
+    const float* dist = m_dist2D.constData();
+    for (int i = 0; i < count; i++)
+      items[i]->setDistanceToPlayer(uint32_t(dist[i]));
+  }
+}
+
+float ItemPositions::dist2D(const Item* item) const
+{
+  int index = item->positionIndex();
+  if ((index < 0) || (index >= m_items.count()))
+    return 0.0f;
+
+  return m_dist2D[index];
+}
+
+float ItemPositions::dist3D(const Item* item) const
+{
+  int index = item->positionIndex();
+  if ((index < 0) || (index >= m_items.count()))
+    return 0.0f;
+
+  return m_dist3D[index];
+}
@@ -0,0 +1,105 @@
+/*
+ *  itempositions.h
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Contiguous (structure of arrays) copy of the positions of all the items
+// SpawnShell knows about, so that the distance of every item to the player
+// can be recalculated in a single vectorized pass whenever the player moves
+// instead of walking the item maps and calculating distances one at a time.
+
+#ifndef _ITEMPOSITIONS_H_
+#define _ITEMPOSITIONS_H_
+
+#ifdef __FreeBSD__
+#include <sys/types.h>
+#else
+#include <cstdint>
+#endif
+#include <cstddef>
+
+#include <QVector>
+
+//----------------------------------------------------------------------
+// forward declarations
+class Item;
+
+//----------------------------------------------------------------------
+// batch distance kernel
+//
+// Calculates the 2D (ignoring z) and 3D distance from (px, py, pz) to each
+// of the count points in the x/y/z arrays, storing the results in dist2D
+// and dist3D.  Either output array may be NULL if it isn't wanted.
+// Uses AVX2 or SSE2 when the compiler targets them, scalar code otherwise.
+void calcDistances(const int16_t* x, const int16_t* y, const int16_t* z,
+		   size_t count,
+		   int16_t px, int16_t py, int16_t pz,
+		   float* dist2D, float* dist3D);
+
+// scalar reference implementation of calcDistances()
+void calcDistancesScalar(const int16_t* x, const int16_t* y, const int16_t* z,
+			 size_t count,
+			 int16_t px, int16_t py, int16_t pz,
+			 float* dist2D, float* dist3D);
+
+// name of the instruction set calcDistances() was compiled for
+const char* distanceKernelName();
+
+//----------------------------------------------------------------------
+// ItemPositions
+class ItemPositions
+{
+ public:
+  ItemPositions();
+  ~ItemPositions();
+
+  // add/remove an item, the item records its slot in the arrays
+  void add(Item* item);
+  void remove(Item* item);
+
+  // copy the items current position into the arrays
+  void update(const Item* item);
+
+  // forget all items
+  void clear();
+
+  // recalculate all distances to the specified point, and if
+  // setItemDistances is true, push the results back to the items
+  // (3D distance if fastMachine, otherwise truncated 2D distance)
+  void calcDistances(int16_t px, int16_t py, int16_t pz,
+		     bool setItemDistances, bool fastMachine);
+
+  int count() const { return m_items.count(); }
+  const Item* item(int index) const { return m_items[index]; }
+  float dist2D(int index) const { return m_dist2D[index]; }
+  float dist3D(int index) const { return m_dist3D[index]; }
+  float dist2D(const Item* item) const;
+  float dist3D(const Item* item) const;
+
+ protected:
+  QVector<Item*> m_items;
+  QVector<int16_t> m_x;
+  QVector<int16_t> m_y;
+  QVector<int16_t> m_z;
+  QVector<float> m_dist2D;
+  QVector<float> m_dist3D;
+};
+
+#endif // _ITEMPOSITIONS_H_
@@ -78,6 +78,9 @@
 #include <QPaintEvent>
 #include <QVBoxLayout>
 #include <QPolygon>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMetaObject>
 #include <QFrame>
 #include <QResizeEvent>
 #include <QLabel>
@@ -105,6 +108,9 @@
 // constants
 const int panAmmt = 8;
 
+// how often to repaint spawn points as they age when nothing else changes
+const int agingRefreshInterval = 1000;
+
 //----------------------------------------------------------------------
 // CLineDlg
 CLineDlg::CLineDlg(QWidget *parent, QString name, MapMgr *mapMgr) 
@@ -266,6 +272,98 @@ void MapLabel::mousePressEvent(QMouseEvent*)
   hide();
 }
 
+//----------------------------------------------------------------------
+// MapLoadJob
+//
+// A zone's map being loaded into a MapData of its own on MapMgr's map
+// load pool, which is handed back to MapMgr::mapLoadFinished() on the GUI
+// thread to be put in place or kept for later.
+class MapLoadJob
+{
+ public:
+  QString shortZoneName;
+  bool prefetch; // only touched on the GUI thread
+  QStringList files;
+  MapData* mapData;
+};
+
+// the map files of a zone, the base map followed by any extra layers
+static QStringList findZoneMapFiles(const DataLocationMgr* dataLocMgr,
+				    const QString& shortZoneName)
+{
+  QString extension = "";
+
+  QStringList mapFiles;
+
+  // find maps
+  QFileInfo mapFileInfo = dataLocMgr->findExistingFile("maps",
+          shortZoneName + ".map");
+
+  QFileInfo txtFileInfo = dataLocMgr->findExistingFile("maps",
+          shortZoneName + ".txt");
+
+  if (mapFileInfo.exists())
+  {
+      extension = ".map";
+      mapFiles.append(mapFileInfo.absoluteFilePath());
+
+  } else if (txtFileInfo.exists())
+  {
+      extension = ".txt";
+      mapFiles.append(txtFileInfo.absoluteFilePath());
+  }
+  else
+    return mapFiles;
+
+  // add other layers
+  QFileInfo fileInfo;
+  for (int i = 1; i < 10; ++i)
+  {
+      fileInfo = dataLocMgr->findExistingFile("maps",
+              shortZoneName + "_" + QString::number(i) + extension);
+
+      if (fileInfo.exists())
+          mapFiles.append(fileInfo.absoluteFilePath());
+  }
+
+  return mapFiles;
+}
+
+//----------------------------------------------------------------------
+// MapLoadTask
+class MapLoadTask : public QRunnable
+{
+ public:
+  MapLoadTask(MapMgr* mapMgr, const DataLocationMgr* dataLocMgr,
+	      MapLoadJob* job)
+    : m_mapMgr(mapMgr), m_dataLocMgr(dataLocMgr), m_job(job) {}
+  void run();
+
+ protected:
+  MapMgr* m_mapMgr;
+  const DataLocationMgr* m_dataLocMgr;
+  MapLoadJob* m_job;
+};
+
+void MapLoadTask::run()
+{
+  m_job->files = findZoneMapFiles(m_dataLocMgr, m_job->shortZoneName);
+
+  // load the first one, then import the rest as layers
+  for (int i = 0; i < m_job->files.size(); ++i)
+  {
+    const QString& fileName = m_job->files[i];
+    if (!fileName.endsWith(".txt"))
+      m_job->mapData->loadMap(fileName, i != 0);
+    else
+      m_job->mapData->loadSOEMap(fileName, i != 0);
+  }
+
+  QMetaObject::invokeMethod(m_mapMgr, "mapLoadFinished",
+			    Qt::QueuedConnection,
+			    Q_ARG(void*, m_job));
+}
+
 //----------------------------------------------------------------------
 // MapMgr
 MapMgr::MapMgr(const DataLocationMgr* dataLocMgr, 
@@ -275,10 +373,19 @@ MapMgr::MapMgr(const DataLocationMgr* dataLocMgr,
     m_dataLocMgr(dataLocMgr),
     m_spawnShell(spawnShell),
     m_player(player),
-    m_dialogParent(dialogParent)
+    m_zoneMgr(zoneMgr),
+    m_dialogParent(dialogParent),
+    m_tileStore(m_mapData),
+    m_positionTick(0)
 {
   setObjectName(name);
   m_dlgLineProps = NULL;
+
+  // a single loader, so the current zone's map never waits on more than
+  // the one prefetch already being loaded
+  m_mapLoadPool = new QThreadPool(this);
+  m_mapLoadPool->setMaxThreadCount(1);
+  m_zoneMaps.setMaxCost(pSEQPrefs->getPrefInt("PrefetchMaps", "MapMgr", 4));
   
   // get the preferences
   m_curLineColor = pSEQPrefs->getPrefString("DefaultLineColor", "MapMgr", "gray");
@@ -286,6 +393,10 @@ MapMgr::MapMgr(const DataLocationMgr* dataLocMgr,
   m_curLocationColor = pSEQPrefs->getPrefString("DefaultLocationColor", "MapMgr", 
                         "white");
 
+  // keep compiled copies of the maps, so they load without parsing
+  if (pSEQPrefs->getPrefBool("CompiledMaps", "MapMgr", true))
+    m_mapData.setCompiledDir(m_dataLocMgr->userDataDir("mapcache").absolutePath());
+
   // supply the MapMgr slots with signals from SpawnShell
   connect (m_spawnShell, SIGNAL(addItem(const Item*)),
        this, SLOT(addItem(const Item*)));
@@ -305,6 +416,8 @@ MapMgr::MapMgr(const DataLocationMgr* dataLocMgr,
       this, SLOT(zoneChanged(const QString&)));
   connect(zoneMgr, SIGNAL(zoneEnd(const QString&, const QString&)),
       this, SLOT(zoneEnd(const QString&, const QString&)));
+  connect(zoneMgr, SIGNAL(zonePointsChanged()),
+      this, SLOT(prefetchZoneMaps()));
 
   // if there is a short zone name already, try to load its map
   QString shortZoneName = zoneMgr->shortZoneName();
@@ -314,6 +427,12 @@ MapMgr::MapMgr(const DataLocationMgr* dataLocMgr,
 
 MapMgr::~MapMgr()
 {
+  // let any load in progress finish before its MapData goes away
+  m_mapLoadPool->waitForDone();
+  for (int i = 0; i < m_mapLoadJobs.size(); i++)
+    delete m_mapLoadJobs[i]->mapData;
+  qDeleteAll(m_mapLoadJobs);
+  m_mapLoadJobs.clear();
 }
 
 uint16_t MapMgr::spawnAggroRange(const Spawn* spawn)
@@ -322,6 +441,40 @@ uint16_t MapMgr::spawnAggroRange(const Spawn* spawn)
   return range;
 }
 
+// maps painting within this many milliseconds of each other share the
+// same spawn positions
+static const int positionTickMS = 25;
+
+bool MapMgr::spawnPosition(const Spawn* spawn, bool animate,
+			   const QTime& drawTime, EQPoint& location)
+{
+  // start a new tick once the paint time has moved on far enough
+  if (!m_positionTime.isValid() ||
+      (qAbs(m_positionTime.msecsTo(drawTime)) >= positionTickMS))
+  {
+    m_positionTime = drawTime;
+    m_positionTick++;
+  }
+
+  // one slot per possible spawn id
+  if (m_spawnPositions.isEmpty())
+    m_spawnPositions.resize(UINT16_MAX + 1);
+
+  MapSpawnPosition& pos = m_spawnPositions[spawn->id()];
+  if ((pos.tick != m_positionTick) || (pos.spawn != spawn) ||
+      (pos.animate != animate))
+  {
+    pos.spawn = spawn;
+    pos.tick = m_positionTick;
+    pos.animate = animate;
+    pos.up2date = spawn->approximatePosition(animate, drawTime,
+					     pos.location);
+  }
+
+  location = pos.location;
+  return pos.up2date;
+}
+
 void MapMgr::zoneBegin(const QString& shortZoneName)
 {
 #ifdef DEBUGMAP
@@ -329,8 +482,8 @@ void MapMgr::zoneBegin(const QString& shortZoneName)
      shortZoneName);
 #endif /* DEBUGMAP */
   
-  // clear the map data
-  m_mapData.clear();
+  // put the current map aside, in case the player comes right back
+  unloadZoneMap();
   
   // signal that the map has been unloaded
   emit mapUnloaded();
@@ -346,8 +499,8 @@ void MapMgr::zoneChanged(const QString& shortZoneName)
      (const char*)shortZoneName);
 #endif /* DEBUGMAP */
 
-  // clear the map data
-  m_mapData.clear();
+  // put the current map aside, in case the player comes right back
+  unloadZoneMap();
   
   // signal that the map has been unloaded
   emit mapUnloaded();
@@ -369,58 +522,128 @@ void MapMgr::zoneEnd(const QString& shortZoneName, const QString& longZoneName)
 
 void MapMgr::loadZoneMap(const QString& shortZoneName)
 {
+  m_wantedZone = shortZoneName;
 
-  bool found = false;
-  QString extension = "";
+  // nothing to do if it's already up
+  if (m_mapZone == shortZoneName)
+    return;
 
-  QStringList mapFiles;
+  // use it if it was loaded ahead of time, or on an earlier visit
+  MapData* mapData = m_zoneMaps.take(shortZoneName);
+  if (mapData)
+  {
+    m_mapData.clear();
+    m_mapData.swap(*mapData);
+    delete mapData;
+    m_mapZone = shortZoneName;
 
-  // find maps
-  QFileInfo mapFileInfo = m_dataLocMgr->findExistingFile("maps",
-          shortZoneName + ".map");
+    seqInfo("Using preloaded map for zone '%s'",
+        shortZoneName.toLatin1().data());
 
-  QFileInfo txtFileInfo = m_dataLocMgr->findExistingFile("maps",
-          shortZoneName + ".txt");
+    mapLoadedIn();
+    return;
+  }
 
-  if (mapFileInfo.exists())
+  // if it's already being loaded ahead of time, it's wanted now instead
+  for (int i = 0; i < m_mapLoadJobs.size(); ++i)
   {
-      found = true;
-      extension = ".map";
-      mapFiles.append(mapFileInfo.absoluteFilePath());
+    if (m_mapLoadJobs[i]->shortZoneName == shortZoneName)
+    {
+      m_mapLoadJobs[i]->prefetch = false;
+      return;
+    }
+  }
 
-  } else if (txtFileInfo.exists())
+  startMapLoad(shortZoneName, false);
+}
+
+void MapMgr::startMapLoad(const QString& shortZoneName, bool prefetch)
+{
+  MapLoadJob* job = new MapLoadJob;
+  job->shortZoneName = shortZoneName;
+  job->prefetch = prefetch;
+  job->mapData = new MapData;
+  job->mapData->setCompiledDir(m_mapData.compiledDir());
+  job->mapData->loadSOEColors();
+  m_mapLoadJobs.append(job);
+
+  // the current zone's map goes ahead of any queued prefetches
+  m_mapLoadPool->start(new MapLoadTask(this, m_dataLocMgr, job),
+      prefetch ? 0 : 1);
+}
+
+void MapMgr::mapLoadFinished(void* data)
+{
+  MapLoadJob* job = (MapLoadJob*)data;
+  m_mapLoadJobs.removeAll(job);
+
+  if (job->files.isEmpty())
   {
-      found = true;
-      extension = ".txt";
-      mapFiles.append(txtFileInfo.absoluteFilePath());
-  }
+    if (!job->prefetch)
+    {
+      QByteArray zone = job->shortZoneName.toLatin1();
+      seqInfo("No Map found for zone '%s'!", zone.data());
+      seqInfo("    Checked for all variants of '%s.map', '%s.txt', and '%s_1.txt'",
+          zone.data(), zone.data(), zone.data());
+      seqInfo("    in directories '%s' and '%s'!",
+          m_dataLocMgr->userDataDir("maps").absolutePath().toLatin1().data(),
+          m_dataLocMgr->pkgDataDir("maps").absolutePath().toLatin1().data());
+    }
 
-  if (!found)
+    delete job->mapData;
+  }
+  else if (!job->prefetch && (job->shortZoneName == m_wantedZone))
   {
-    seqInfo("No Map found for zone '%s'!", shortZoneName.toLatin1().data());
-    seqInfo("    Checked for all variants of '%s.map', '%s.txt', and '%s_1.txt'",
-        shortZoneName.toLatin1().data(),
-        shortZoneName.toLatin1().data(),
-        shortZoneName.toLatin1().data());
-    seqInfo("    in directories '%s' and '%s'!",
-        m_dataLocMgr->userDataDir("maps").absolutePath().toLatin1().data(),
-        m_dataLocMgr->pkgDataDir("maps").absolutePath().toLatin1().data());
+    // put it in place of whatever is showing
+    m_mapData.clear();
+    m_mapData.swap(*job->mapData);
+    delete job->mapData;
+    m_mapZone = job->shortZoneName;
 
-    return;
+    mapLoadedIn();
+  }
+  else
+  {
+    // keep it for when the player gets there
+    m_zoneMaps.insert(job->shortZoneName, job->mapData);
   }
 
-  // add other layers
-  QFileInfo fileInfo;
-  for (int i = 1; i < 10; ++i)
+  delete job;
+}
+
+void MapMgr::prefetchZoneMaps()
+{
+  // load the maps of the zones the zone points lead to, as many as there
+  // is room to keep
+  QStringList zones = m_zoneMgr->zonePointZoneNames();
+  for (int i = 0; (i < zones.size()) && (i < m_zoneMaps.maxCost()); ++i)
   {
-      fileInfo = m_dataLocMgr->findExistingFile("maps",
-              shortZoneName + "_" + QString::number(i) + extension);
+    const QString& zone = zones[i];
+    if ((zone == m_mapZone) || (zone == m_wantedZone) ||
+        m_zoneMaps.contains(zone))
+      continue;
 
-      if (fileInfo.exists())
-          mapFiles.append(fileInfo.absoluteFilePath());
+    bool loading = false;
+    for (int j = 0; j < m_mapLoadJobs.size(); ++j)
+      if (m_mapLoadJobs[j]->shortZoneName == zone)
+        loading = true;
+
+    if (!loading)
+      startMapLoad(zone, true);
   }
+}
 
-  loadFileMap(mapFiles);
+void MapMgr::unloadZoneMap()
+{
+  if (!m_mapZone.isEmpty() && m_mapData.numLayers())
+  {
+    MapData* mapData = new MapData;
+    mapData->swap(m_mapData);
+    m_zoneMaps.insert(m_mapZone, mapData);
+  }
+
+  m_mapData.clear();
+  m_mapZone = QString();
 }
 
 void MapMgr::loadMap ()
@@ -506,12 +729,25 @@ void MapMgr::loadFileMap (const QString& fileName, bool import, bool force)
   }
 
 
+  // a map loaded by hand replaces the zone's map, and one imported goes on
+  // top of whatever is showing, so any zone map still being loaded is kept
+  // for later instead of replacing either
+  m_wantedZone = QString();
+  if (!import)
+    m_mapZone = QString();
+
   // load the specified map
   if (!fileName.endsWith(".txt"))
     m_mapData.loadMap(fileName, import);
   else
     m_mapData.loadSOEMap(fileName, import);
 
+  mapLoadedIn();
+} // END loadFileMap
+
+
+void MapMgr::mapLoadedIn()
+{
   const ItemMap& itemMap = m_spawnShell->spawns();
   ItemConstIterator it(itemMap);
   const Item* item;
@@ -545,10 +781,10 @@ void MapMgr::loadFileMap (const QString& fileName, bool import, bool force)
   // signal that the map has been loaded
   // note, the layers are populated in order, so the highest layer
   // number (0-indexed) will be the one we just loaded
-  if (m_mapData.mapLayer(m_mapData.numLayers()-1)->mapLoaded())
+  if (m_mapData.numLayers() &&
+      m_mapData.mapLayer(m_mapData.numLayers()-1)->mapLoaded())
     emit mapLoaded();
-} // END loadFileMap
-
+}
 
 void MapMgr::loadFileMap (const QStringList& files, bool import, bool force)
 {
@@ -1657,7 +1893,7 @@ Map::Map(MapMgr* mapMgr,
     m_preferenceName(preferenceName),
     m_param(mapMgr->mapData()),
     m_mapMgr(mapMgr),
-    m_mapCache(mapMgr->mapData()),
+    m_mapCache(mapMgr->tileStore()),
     m_menu(NULL),
     m_mapIcons(0),
     m_mapIconDialog(0),
@@ -1834,6 +2070,11 @@ Map::Map(MapMgr* mapMgr,
   tmpPrefString = "CacheAlwaysRepaint";
   m_mapCache.setAlwaysRepaint(pSEQPrefs->getPrefBool(tmpPrefString, prefString, false));
 
+  // memory budget for the cached map tiles, in kilobytes
+  tmpPrefString = "TileCacheSize";
+  m_mapCache.setTileBudget(pSEQPrefs->getPrefInt(tmpPrefString, prefString,
+						 32 * 1024));
+
   tmpPrefString = "PvP";
   m_pvp = pSEQPrefs->getPrefBool(tmpPrefString, prefString, false);
 
@@ -1898,6 +2139,14 @@ Map::Map(MapMgr* mapMgr,
   
   m_selectedItem = NULL;
 
+  m_damaged = true;
+  m_animating = false;
+  m_flashing = false;
+  m_aging = false;
+  m_framesPainted = 0;
+  m_framesSkipped = 0;
+  m_renderTime = 0;
+
   setMinimumSize(100, 100);
 
 #ifdef DEBUG
@@ -1921,9 +2170,13 @@ Map::Map(MapMgr* mapMgr,
 
   setMouseTracking(true);
   
+  // frames are only scheduled when something visible changed
   m_timer = new QTimer(this);
+  m_timer->setSingleShot(true);
   connect(m_timer, SIGNAL(timeout()), 
-      this, SLOT(refreshMap()));
+      this, SLOT(frameTick()));
+  connect(m_mapIcons, SIGNAL(flashed()),
+      this, SLOT(flashed()));
   
   // supply the Map slots with signals from MapMgr
   connect(m_mapMgr, SIGNAL(mapLoaded()),
@@ -1934,14 +2187,26 @@ Map::Map(MapMgr* mapMgr,
       this, SLOT(mapUpdated()));
 
   // supply the Map slots with signals from SpawnShell
+  connect(m_spawnShell, SIGNAL(addItem(const Item*)),
+      this, SLOT(addItem(const Item*)));
   connect(m_spawnShell, SIGNAL(delItem(const Item*)),
       this, SLOT(delItem(const Item*)));
   connect(m_spawnShell, SIGNAL(clearItems()),
       this, SLOT(clearItems()));
   connect (m_spawnShell,SIGNAL(changeItem(const Item*, uint32_t)),
        this, SLOT(changeItem(const Item*, uint32_t)));
+  connect (m_spawnShell,SIGNAL(changeItems(const ItemList&, uint32_t)),
+       this, SLOT(changeItems(const ItemList&, uint32_t)));
+
+  // spawn points are painted on the map too
+  connect(m_spawnMonitor, SIGNAL(newSpawnPoint(const SpawnPoint*)),
+      this, SLOT(scheduleRefresh()));
+  connect(m_spawnMonitor, SIGNAL(clearSpawnPoints()),
+      this, SLOT(scheduleRefresh()));
+  connect(m_spawnMonitor, SIGNAL(selectionChanged(const SpawnPoint*)),
+      this, SLOT(scheduleRefresh()));
 
-  m_timer->start(1000/m_frameRate);
+  scheduleRefresh();
 
 #ifdef DEBUG
   if (m_showDebugInfo)
@@ -2079,8 +2344,7 @@ void Map::mousePressEvent(QMouseEvent* me)
       reAdjust();
 
       // repaint if necessary
-      if(!m_cacheChanges)
-        refreshMap ();
+      requestRefresh();
     }
   }
 }
@@ -2129,8 +2393,7 @@ void Map::zoomIn()
        // requires ReAdjust
        reAdjust();
 
-       if (!m_cacheChanges)
-         refreshMap ();
+       requestRefresh();
      }
    }
 }
@@ -2150,8 +2413,7 @@ void Map::zoomOut()
        // requires ReAdjust
        reAdjust();
 
-       if(!m_cacheChanges)
-         refreshMap ();
+       requestRefresh();
      }
    }    
 }
@@ -2167,8 +2429,7 @@ void Map::panRight()
    
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::panLeft()
@@ -2182,8 +2443,7 @@ void Map::panLeft()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 
@@ -2198,8 +2458,7 @@ void Map::panDown()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 
@@ -2214,8 +2473,7 @@ void Map::panUp()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::panUpRight()
@@ -2230,8 +2488,7 @@ void Map::panUpRight()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::panUpLeft()
@@ -2246,8 +2503,7 @@ void Map::panUpLeft()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::panDownRight()
@@ -2262,8 +2518,7 @@ void Map::panDownRight()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::panDownLeft()
@@ -2278,24 +2533,21 @@ void Map::panDownLeft()
 
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::increaseGridResolution (void)
 {
   m_param.increaseGridResolution();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::decreaseGridResolution (void)
 {
   m_param.decreaseGridResolution();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::viewTarget()
@@ -2324,8 +2576,7 @@ void Map::viewTarget()
   
   reAdjust();
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::viewLock()
@@ -2404,8 +2655,7 @@ void Map::viewLock()
   // this requires a reAdjust
    reAdjust();
 
-   if(!m_cacheChanges)
-     refreshMap ();
+   requestRefresh();
 }
 
 void Map::setFollowMode(FollowMode mode) 
@@ -2470,8 +2720,7 @@ void Map::setFollowMode(FollowMode mode)
   // this requires a reAdjust
   reAdjust();
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 //
@@ -2486,8 +2735,7 @@ Map::setShowFiltered(bool bView)
 
   pSEQPrefs->setPrefBool("ShowFiltered", preferenceName(), m_showFiltered);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setFrameRate(int val) 
@@ -2502,8 +2750,7 @@ void Map::setFrameRate(int val)
 
     emit frameRateChanged(m_frameRate);
 
-    if (m_timer->isActive())
-      m_timer->setInterval(1000/m_frameRate);
+    // the next frame gets scheduled at the new rate
   }
 }
 
@@ -2541,8 +2788,7 @@ void Map::setShowMapLines(bool val)
 { 
   m_showMapLines = val; 
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowPlayer(bool val) 
@@ -2552,8 +2798,7 @@ void Map::setShowPlayer(bool val)
   QString tmpPrefString = "ShowPlayer";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showPlayer);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowPlayerBackground(bool val) 
@@ -2563,8 +2808,7 @@ void Map::setShowPlayerBackground(bool val)
   QString tmpPrefString = "ShowPlayerBackground";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showPlayerBackground);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowPlayerView(bool val) 
@@ -2574,16 +2818,14 @@ void Map::setShowPlayerView(bool val)
   QString tmpPrefString = "ShowPlayerView";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showPlayerView);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowHeading(bool val) 
 { 
   m_showHeading = val; 
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowSpawns(bool val) 
@@ -2593,8 +2835,7 @@ void Map::setShowSpawns(bool val)
   QString tmpPrefString = "ShowSpawns";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showSpawns);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowSpawnPoints(bool val) 
@@ -2604,8 +2845,7 @@ void Map::setShowSpawnPoints(bool val)
   QString tmpPrefString = "ShowSpawnPoints";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showSpawnPoints);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowUnknownSpawns(bool val) 
@@ -2615,8 +2855,7 @@ void Map::setShowUnknownSpawns(bool val)
   QString tmpPrefString = "ShowUnknownSpawns";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showUnknownSpawns);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowDrops(bool val) 
@@ -2626,8 +2865,7 @@ void Map::setShowDrops(bool val)
   QString tmpPrefString = "ShowDroppedItems";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showDrops);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowDoors(bool val) 
@@ -2637,8 +2875,7 @@ void Map::setShowDoors(bool val)
   QString tmpPrefString = "ShowDoors";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showDoors);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowVelocityLines(bool val) 
@@ -2648,8 +2885,7 @@ void Map::setShowVelocityLines(bool val)
   QString tmpPrefString = "VelocityLines";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showVelocityLines);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowDebugInfo(bool val) 
@@ -2660,8 +2896,7 @@ void Map::setShowDebugInfo(bool val)
   QString tmpPrefString = "ShowDebugInfo";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showDebugInfo);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 #endif
 }
 
@@ -2675,8 +2910,7 @@ void Map::setAnimate(bool val)
   // this requires a reAdjust
   reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setCacheChanges(bool val) 
@@ -2686,8 +2920,7 @@ void Map::setCacheChanges(bool val)
   QString tmpPrefString = "CacheChanges";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_cacheChanges);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setSpawnDepthFilter(bool val)
@@ -2697,8 +2930,7 @@ void Map::setSpawnDepthFilter(bool val)
   QString tmpPrefString = "SpawnDepthFilter";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_spawnDepthFilter);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setHighlightConsideredSpawns(bool val) 
@@ -2708,8 +2940,7 @@ void Map::setHighlightConsideredSpawns(bool val)
   QString tmpPrefString = "HighlightConsideredSpawns";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_highlightConsideredSpawns);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowTooltips(bool val) 
@@ -2731,8 +2962,7 @@ void Map::setWalkPathShowSelect(bool val)
   QString tmpPrefString = "WalkPathShowSelect";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_walkpathshowselect);
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setPvP(bool val) 
@@ -2753,8 +2983,7 @@ void Map::setPvP(bool val)
     pSEQPrefs->setPrefBool("RacePvP", preferenceName(), m_racePvP);
   }
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setDeityPvP(bool val) 
@@ -2775,8 +3004,7 @@ void Map::setDeityPvP(bool val)
     pSEQPrefs->setPrefBool("RacePvP", preferenceName(), m_racePvP);
   }
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setRacePvP(bool val) 
@@ -2796,8 +3024,7 @@ void Map::setRacePvP(bool val)
     pSEQPrefs->setPrefBool("DeityPvP", preferenceName(), m_deityPvP);
   }
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setMapLineStyle(MapLineStyle style) 
@@ -2807,8 +3034,7 @@ void Map::setMapLineStyle(MapLineStyle style)
   QString tmpPrefString = "MapLineStyle";
   pSEQPrefs->setPrefInt(tmpPrefString, preferenceName(), m_param.mapLineStyle());
   
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setZoom(int val) 
@@ -2822,8 +3048,7 @@ void Map::setZoom(int val)
       // requires reAdjust
       reAdjust();
       
-      if (!m_cacheChanges)
-        refreshMap ();
+      requestRefresh();
     }
   }
 }
@@ -2849,8 +3074,7 @@ void Map::setPanOffsetX(int val)
   // this requires a reAdjust
   reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setPanOffsetY(int val) 
@@ -2860,8 +3084,7 @@ void Map::setPanOffsetY(int val)
   // this requires a reAdjust
   reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setGridResolution(int val) 
@@ -2873,8 +3096,7 @@ void Map::setGridResolution(int val)
 
   reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setGridTickColor(const QColor& color) 
@@ -2884,8 +3106,7 @@ void Map::setGridTickColor(const QColor& color)
   // set color preference
   pSEQPrefs->setPrefColor("GridTickColor", preferenceName(), m_param.gridTickColor());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setGridLineColor(const QColor& color) 
@@ -2895,8 +3116,7 @@ void Map::setGridLineColor(const QColor& color)
   // set color preference
   pSEQPrefs->setPrefColor("GridLineColor", preferenceName(), m_param.gridLineColor());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setBackgroundColor(const QColor& color) 
@@ -2906,8 +3126,7 @@ void Map::setBackgroundColor(const QColor& color)
   // set color preference
   pSEQPrefs->setPrefColor("BackgroundColor", preferenceName(), m_param.backgroundColor());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setFont(const QFont& font) 
@@ -2917,8 +3136,7 @@ void Map::setFont(const QFont& font)
   QString tmpPrefString = "Font";
   pSEQPrefs->setPrefFont(tmpPrefString, preferenceName(), m_param.font());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setHeadRoom(int val) 
@@ -2932,8 +3150,7 @@ void Map::setHeadRoom(int val)
 
   reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setFloorRoom(int val) 
@@ -2947,8 +3164,7 @@ void Map::setFloorRoom(int val)
 
   reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowBackgroundImage(bool val) 
@@ -2958,8 +3174,7 @@ void Map::setShowBackgroundImage(bool val)
   QString tmpPrefString = "ShowBackgroundImage";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_param.showBackgroundImage());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowLocations(bool val) 
@@ -2969,8 +3184,7 @@ void Map::setShowLocations(bool val)
   QString tmpPrefString = "ShowMapPoints";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_param.showLocations());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowLines(bool val) 
@@ -2980,8 +3194,7 @@ void Map::setShowLines(bool val)
   QString tmpPrefString = "ShowMapLines";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_param.showLines());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowGridLines(bool val) 
@@ -2991,8 +3204,7 @@ void Map::setShowGridLines(bool val)
   QString tmpPrefString = "ShowGridLines";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_param.showGridLines());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowGridTicks(bool val) 
@@ -3002,8 +3214,7 @@ void Map::setShowGridTicks(bool val)
   QString tmpPrefString = "ShowGridTicks";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_param.showGridTicks());
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setCacheAlwaysRepaint(bool val) 
@@ -3018,8 +3229,7 @@ void Map::setShowZoneSafePoint(bool val)
 {
   m_showZoneSafePoint = val;
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::setShowInstanceLocationMarker(bool val)
@@ -3029,8 +3239,7 @@ void Map::setShowInstanceLocationMarker(bool val)
   QString tmpPrefString = "ShowInstanceLocationMarker";
   pSEQPrefs->setPrefBool(tmpPrefString, preferenceName(), m_showInstanceLocationMarker);
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::toggleMapLayerVisibility(QAction* layer)
@@ -3048,8 +3257,7 @@ void Map::toggleMapLayerVisibility(QAction* layer)
       mask &= ~(1 << layerNum);
   pSEQPrefs->setPrefInt(tmpPrefString, preferenceName(), mask);
 
-  if(!m_cacheChanges)
-    refreshMap();
+  requestRefresh();
 }
 
 void Map::dumpInfo(QTextStream& out)
@@ -3126,6 +3334,11 @@ void Map::dumpInfo(QTextStream& out)
   out << "DeityPvP: " << m_deityPvP << ENDL;
   out << "RacePvP: " << m_racePvP << ENDL;
   out << "CacheAlwaysRepaint: " << m_mapCache.alwaysRepaint() << ENDL;
+  out << "Frames: " << m_framesPainted << " painted, " << m_framesSkipped
+      << " skipped, last took " << m_renderTime << "ms" << ENDL;
+  out << "TileCache: " << m_mapCache.tileCount() << " tiles, budget "
+      << m_mapCache.tileBudget() << "KB, " << m_mapCache.tilesPainted()
+      << " painted, " << m_mapCache.tilesReused() << " reused" << ENDL;
   out << ENDL;
 
 #ifdef DEBUG
@@ -3200,6 +3413,57 @@ void Map::refreshMap(void)
    repaint(mapRect());
 }
 
+void Map::requestRefresh(void)
+{
+  // repaint right away, unless changes are being collected for the next
+  // frame
+  if (!m_cacheChanges)
+    refreshMap();
+  else
+    scheduleRefresh();
+}
+
+void Map::scheduleRefresh(void)
+{
+  m_damaged = true;
+
+  // already waiting on a frame
+  if (m_timer->isActive())
+    return;
+
+  // frames are spaced out to at most the frame rate
+  int interval = 1000 / m_frameRate;
+  int wait = 0;
+  if (m_lastFrame.isValid())
+    wait = qMax(0, interval - int(m_lastFrame.elapsed()));
+
+  m_timer->start(wait);
+}
+
+void Map::frameTick(void)
+{
+  // paint if anything visible changed, or is moving or aging
+  if (m_damaged || m_animating || m_aging)
+    repaint(mapRect());
+}
+
+void Map::flashed(void)
+{
+  // only matters if anything that flashes is on the map
+  if (m_flashing)
+    scheduleRefresh();
+}
+
+bool Map::inView(const Item* item) const
+{
+  // allow for the item having moved in from, or out to, just off screen
+  const QRect& bounds = m_param.screenBounds();
+  int margin = qMax(bounds.width(), bounds.height()) / 4;
+
+  return bounds.adjusted(-margin, -margin, margin, margin)
+    .contains(item->x(), item->y());
+}
+
 void Map::reAdjust()
 {
   switch (m_followMode)
@@ -3396,6 +3660,25 @@ void Map::paintMap (QPainter * p)
   // get the current time
   drawTime.start();
 
+  // count the frames that would have been painted at the frame rate, but
+  // weren't because nothing changed
+  if (m_lastFrame.isValid())
+  {
+    int frames = int((m_lastFrame.elapsed() * m_frameRate) / 1000);
+    if (frames > 1)
+      m_framesSkipped += frames - 1;
+  }
+  m_lastFrame.start();
+  m_framesPainted++;
+
+  // this frame takes care of any outstanding changes, and figures out if
+  // anything in it moves or flashes
+  m_damaged = false;
+  m_animating = false;
+  m_flashing = false;
+  m_aging = false;
+  m_mapIcons->resetFlashPainted();
+
   EQPoint playerPos;
 
   // retrieve the approximate current player position, and set the 
@@ -3450,8 +3733,15 @@ void Map::paintMap (QPainter * p)
       paintPlayer(m_param, tmp);
   }
 
+  // the icon images of each pass are queued and drawn in one go at the
+  // end of it, with its names and highlights on top, before the next pass
+  m_mapIcons->flushIcons(tmp);
+
   if (m_showDrops)
+  {
     paintDrops(m_param, tmp);
+    m_mapIcons->flushIcons(tmp);
+  }
 
   if (m_showZoneSafePoint)
   {
@@ -3461,16 +3751,26 @@ void Map::paintMap (QPainter * p)
               safePoint, QString("Safe Point"),
               QPoint(m_param.calcXOffsetI(safePoint.x()),
                  m_param.calcYOffsetI(safePoint.y())));
+    m_mapIcons->flushIcons(tmp);
   }
 
   if (m_showDoors)
+  {
     paintDoors(m_param, tmp);
+    m_mapIcons->flushIcons(tmp);
+  }
 
   if (m_showSpawnPoints)
+  {
     paintSpawnPoints(m_param, tmp);
+    m_mapIcons->flushIcons(tmp);
+  }
 
   if (m_showSpawns)
+  {
     paintSpawns(m_param, tmp, drawTime);
+    m_mapIcons->flushIcons(tmp);
+  }
 
   if(m_showInstanceLocationMarker && m_zoneMgr->dzID())
   {
@@ -3478,17 +3778,40 @@ void Map::paintMap (QPainter * p)
      m_mapIcons->paintIcon(m_param, tmp, m_mapIcons->icon(tIconTypeDynamicZoneLocation),
                            instancePoint, m_zoneMgr->dzLongName(), QPoint(m_param.calcXOffsetI(instancePoint.x()),
                                  m_param.calcYOffsetI(instancePoint.y())));
+     m_mapIcons->flushIcons(tmp);
   }
 
+  // the selection goes over everything else
   paintSelectedSpawnSpecials(m_param, tmp, drawTime);
   paintSelectedSpawnPointSpecials(m_param, tmp, drawTime);
+  m_mapIcons->flushIcons(tmp);
+
+  m_flashing = m_mapIcons->flashPainted();
+
+  // the player is always on the map
+  if (m_animate && (m_player->deltaX() || m_player->deltaY() ||
+		    m_player->deltaZ()))
+    m_animating = true;
+
+  // keep the frames coming at the frame rate while anything on the map is
+  // moving, now and then while spawn points are aging, and otherwise sit
+  // idle until something changes
+  if (!m_timer->isActive())
+  {
+    if (m_animating)
+      m_timer->start(1000 / m_frameRate);
+    else if (m_aging)
+      m_timer->start(qMax(1000 / m_frameRate, agingRefreshInterval));
+  }
+
+  m_renderTime = drawTime.elapsed();
 
 #ifdef DEBUG
   // increment paint count
   m_paintCount++;
 
   // get paint time
-  int paintTime = drawTime.elapsed();
+  int paintTime = m_renderTime;
   
   // add paint time to sum
   m_paintTimeSum += paintTime;
@@ -3936,11 +4259,16 @@ void Map::paintSpawns(MapParameters& param,
       continue;
  
     // get the approximate position of the spawn
-    up2date = spawn->approximatePosition(m_animate, drawTime, location);
+    up2date = m_mapMgr->spawnPosition(spawn, m_animate, drawTime, location);
     
     // check that the spawn is within the screen bounds
     if (!inRect(screenBounds, location.x(), location.y()))
       continue; // not in bounds, next...
+
+    // moving spawns need a new frame for every step of the animation
+    if (m_animate && up2date &&
+        (spawn->deltaX() || spawn->deltaY() || spawn->deltaZ()))
+      m_animating = true;
     
     // calculate the spawn's offset location
     spawnOffsetXPos = m_param.calcXOffsetI(location.x());
@@ -4183,9 +4511,8 @@ void Map::paintSelectedSpawnSpecials(MapParameters& param, QPainter& p,
 
   if (m_selectedItem->type() == tSpawn)
   {
-    ((const Spawn*)m_selectedItem)->approximatePosition(m_animate, 
-                            drawTime, 
-                            location);
+    m_mapMgr->spawnPosition((const Spawn*)m_selectedItem, m_animate,
+                            drawTime, location);
     m_mapIcons->paintSpawnIcon(param, p, m_mapIcons->icon(tIconTypeItemSelected), 
                   (Spawn*)m_selectedItem, location, 
                   QPoint(m_param.calcXOffsetI(location.x()), 
@@ -4236,7 +4563,7 @@ void Map::paintSpawnPoints( MapParameters& param, QPainter& p )
     return;
   
   // get an iterator over the list of spawn points
-  QHashIterator<QString, SpawnPoint*> it(m_spawnMonitor->spawnPoints());
+  SpawnPointIterator it(m_spawnMonitor->spawnPoints());
   const SpawnPoint* sp;
 
   const MapIcon& mapIcon = m_mapIcons->icon(tIconTypeSpawnPoint);
@@ -4254,6 +4581,10 @@ void Map::paintSpawnPoints( MapParameters& param, QPainter& p )
           (sp->z() < m_param.playerFloorRoom()))))
       continue;
 
+    // spawn points with a known respawn time change color as they age
+    if (sp->diffTime() && sp->deathTime())
+      m_aging = true;
+
     m_mapIcons->paintSpawnPointIcon(m_param, p, mapIcon, sp,
                    QPoint(param.calcXOffsetI(sp->x()),
                       param.calcYOffsetI(sp->y())));
@@ -4301,6 +4632,35 @@ void Map::paintDebugInfo(MapParameters& param,
   ts.sprintf( "%2.0ffps/%dms", fps, drawTime);
 #endif
   p.drawText( this->width() - 60, 8, ts );
+
+  // and how many frames the repaint scheduler didn't need to paint
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  ts = QString::asprintf( "%u painted/%u skipped",
+          m_framesPainted, m_framesSkipped);
+#else
+  ts.sprintf( "%u painted/%u skipped", m_framesPainted, m_framesSkipped);
+#endif
+  p.drawText( this->width() - 150, 22, ts );
+
+  // show how much of the static map the spatial index and z bands let
+  // us skip, and how many line draw calls it took
+  const MapPaintStats& stats = m_mapMgr->mapData().paintStats();
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  ts = QString::asprintf( "lines %d/%d culled, bands %d/%d culled, "
+          "%d draws, locs %d/%d culled",
+          stats.linesCulled, stats.linesDrawn + stats.linesCulled,
+          stats.bandsCulled, stats.bandsDrawn + stats.bandsCulled,
+          stats.lineDrawCalls, stats.locationsCulled,
+          stats.locationsDrawn + stats.locationsCulled);
+#else
+  ts.sprintf( "lines %d/%d culled, bands %d/%d culled, "
+          "%d draws, locs %d/%d culled",
+          stats.linesCulled, stats.linesDrawn + stats.linesCulled,
+          stats.bandsCulled, stats.bandsDrawn + stats.bandsCulled,
+          stats.lineDrawCalls, stats.locationsCulled,
+          stats.locationsDrawn + stats.locationsCulled);
+#endif
+  p.drawText( 10, height() - 14, ts );
 }
 
 void Map::paintEvent (QPaintEvent * e)
@@ -4342,8 +4702,7 @@ void Map::mouseMoveEvent( QMouseEvent* event )
     
     reAdjust();
 
-    if(!m_cacheChanges)
-      refreshMap();
+    requestRefresh();
   }
   
   emit mouseLocation(m_param.invertXOffset(event->x()),
@@ -4581,8 +4940,17 @@ void Map::selectSpawn(const Item* item)
   if (m_followMode == tFollowSpawn)
     reAdjust();
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
+}
+
+void Map::addItem(const Item* item)
+{
+  if (item == NULL)
+    return;
+
+  // only matters if it shows up on the map
+  if (inView(item))
+    requestRefresh();
 }
 
 void Map::delItem(const Item* item)
@@ -4599,9 +4967,10 @@ void Map::delItem(const Item* item)
     if (m_followMode == tFollowSpawn)
       reAdjust();
   }
+  else if (!inView(item))
+    return;
 
-  if(!m_cacheChanges)
-    refreshMap ();
+  requestRefresh();
 }
 
 void Map::clearItems()
@@ -4623,7 +4992,7 @@ void Map::changeItem(const Item* item, uint32_t changeType)
   if (item == NULL)
     return;
 
-  // only need to deal with position changes
+  // position changes of whatever the map follows move the map
   if (changeType & tSpawnChangedPosition)
   {
     if (m_followMode == tFollowSpawn) 
@@ -4641,6 +5010,27 @@ void Map::changeItem(const Item* item, uint32_t changeType)
         reAdjust();
     }
   }
+
+  // the next frame needs to show it if it's on the map, or it's one of the
+  // things the map is drawn around
+  if ((item == m_selectedItem) || (item == (const Item*)m_player) ||
+      inView(item))
+    scheduleRefresh();
+}
+
+void Map::changeItems(const ItemList& items, uint32_t changeType)
+{
+  // a batch of changes, repaint once if any of them are on the map
+  QListIterator<const Item*> it(items);
+  while (it.hasNext())
+  {
+    const Item* item = it.next();
+    if ((item == m_selectedItem) || inView(item))
+    {
+      scheduleRefresh();
+      return;
+    }
+  }
 }
 
 const Item* Map::closestSpawnToPoint(const QPoint& pt, 
@@ -4719,7 +5109,7 @@ const SpawnPoint* Map::closestSpawnPointToPoint(const QPoint& pt,
   uint32_t distance;
   EQPoint testPoint;
 
-  QHashIterator<QString, SpawnPoint*> it(m_spawnMonitor->spawnPoints());
+  SpawnPointIterator it(m_spawnMonitor->spawnPoints());
   SpawnPoint* sp;
 
   while (it.hasNext())
@@ -4783,12 +5173,10 @@ void Map::mapLoaded(void)
 
   reAdjust();
   
-  if (!m_cacheChanges)
-    refreshMap();
+  requestRefresh();
 
-  // start the map update timer if necessary
-  if (!m_timer->isActive())
-    m_timer->start(1000/m_frameRate);
+  // make sure the new map gets painted
+  scheduleRefresh();
 
 #ifdef DEBUG
   if (m_showDebugInfo)
@@ -4800,8 +5188,7 @@ void Map::mapUpdated(void)
 {
   reAdjust();
   
-  if(!m_cacheChanges)
-    refreshMap();
+  requestRefresh();
 }
 
 
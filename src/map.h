@@ -42,6 +42,7 @@
 #include <QHash>
 #include <QTextStream>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QPen>
 #include <QBrush>
 #include <QPushButton>
@@ -53,6 +54,9 @@
 #include <QLayout>
 #include <QSpinBox>
 #include <QList>
+#include <QCache>
+#include <QVector>
+#include <QTime>
 
 #include <QResizeEvent>
 #include <QMouseEvent>
@@ -69,6 +73,7 @@
 #include "mapcore.h"
 #include "seqwindow.h"
 #include "spawn.h"
+#include "spawnshell.h"
 #include "mapicon.h"
 #include "mapcolors.h"
 
@@ -90,6 +95,8 @@ class MapFilterLineEdit;
 class MapFrame;
 class MapIconDialog;
 class DataLocationMgr;
+class MapLoadJob;
+class QThreadPool;
 
 //----------------------------------------------------------------------
 // enumerated types
@@ -143,6 +150,21 @@ class MapLabel: public QLabel
   Map*	m_Map;
 };
 
+//----------------------------------------------------------------------
+// MapSpawnPosition
+//
+// Where a spawn was for one paint tick, shared by all the maps.
+struct MapSpawnPosition
+{
+  MapSpawnPosition() : spawn(NULL), tick(0), animate(false), up2date(false) {}
+
+  const Spawn* spawn;
+  uint32_t tick;
+  bool animate;
+  bool up2date;
+  EQPoint location;
+};
+
 //----------------------------------------------------------------------
 // MapMgr
 class MapMgr : public QObject
@@ -158,6 +180,12 @@ class MapMgr : public QObject
    
    uint16_t spawnAggroRange(const Spawn* spawn);
    const MapData& mapData() { return  m_mapData; }
+   MapTileStore& tileStore() { return m_tileStore; }
+
+   // approximate position of the spawn for the current paint tick, each
+   // spawn's is only worked out once per tick for all of the maps
+   bool spawnPosition(const Spawn* spawn, bool animate,
+		      const QTime& drawTime, EQPoint& location);
 
   const QString& curLineColor() { return m_curLineColor; }
   const QString& curLineName() { return m_curLineName; }
@@ -217,15 +245,38 @@ class MapMgr : public QObject
   void mapUpdated(void);
   void editLayerChanged(void);
 
+ private slots:
+  void mapLoadFinished(void* job);
+  void prefetchZoneMaps(void);
+
  private:
+  void startMapLoad(const QString& shortZoneName, bool prefetch);
+  void unloadZoneMap(void);
+  void mapLoadedIn(void);
+
   const DataLocationMgr* m_dataLocMgr;
   SpawnShell* m_spawnShell;
   Player* m_player;
+  ZoneMgr* m_zoneMgr;
   QWidget* m_dialogParent;
   CLineDlg *m_dlgLineProps;
   MapData m_mapData;
+  MapTileStore m_tileStore;
   QHash<int, uint16_t> m_spawnAggroRange;
 
+  // spawn positions for the current paint tick, indexed by spawn id
+  QVector<MapSpawnPosition> m_spawnPositions;
+  QTime m_positionTime;
+  uint32_t m_positionTick;
+
+  // zone maps are loaded in the background, and the maps of the zones
+  // next to the current one are kept loaded ahead of time
+  QThreadPool* m_mapLoadPool;
+  QList<MapLoadJob*> m_mapLoadJobs;
+  QCache<QString, MapData> m_zoneMaps;
+  QString m_mapZone;
+  QString m_wantedZone;
+
   QString m_curLineColor;
   QString m_curLineName;
   QString m_curLocationColor;
@@ -463,8 +514,10 @@ class Map :public QWidget
   void selectSpawn(const Item* item);
 
   // SpawnShell handling
+  void addItem(const Item* item);
   void delItem(const Item* item);
   void changeItem(const Item* item, uint32_t changeType);
+  void changeItems(const ItemList& items, uint32_t changeType);
   void clearItems(void);
   
   // MapMgr handling
@@ -504,6 +557,7 @@ class Map :public QWidget
   void reAdjustAndRefreshMap(void);
   void reAdjust (void);
   void refreshMap(void);
+  void scheduleRefresh(void);
   
   // set methods
   void setFollowMode(FollowMode mode);
@@ -585,6 +639,8 @@ protected:
    void wheelEvent( QWheelEvent *);
    void resizeEvent (QResizeEvent *);
 
+   void requestRefresh(void);
+   bool inView(const Item* item) const;
    void paintMap (QPainter *);
    void paintPlayerBackground(MapParameters& param, QPainter& p);
    void paintPlayerView(MapParameters& param, QPainter& p);
@@ -606,6 +662,10 @@ protected:
 		       int drawTime);
    QRect mapRect () const;
 
+protected slots:
+   void frameTick(void);
+   void flashed(void);
+
 private:   
    QString m_preferenceName;
    MapParameters m_param;
@@ -618,6 +678,16 @@ private:
    uint32_t m_runtimeFilterFlagMask;
    QTimer* m_timer;
 
+   // repaint scheduling state
+   QElapsedTimer m_lastFrame;
+   bool m_damaged;
+   bool m_animating;
+   bool m_flashing;
+   bool m_aging;
+   uint32_t m_framesPainted;
+   uint32_t m_framesSkipped;
+   int m_renderTime;
+
 #ifdef DEBUG
    // debug timing info
    QTime m_time;
@@ -0,0 +1,174 @@
+/*
+ *  mapbench.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <QApplication>
+#include <QString>
+#include <QImage>
+#include <QPainter>
+#include <QElapsedTimer>
+
+#include "mapcore.h"
+#include "xmlpreferences.h"
+#include "benchutil.h"
+
+// only used when loading SOE format maps, which this doesn't do
+XMLPreferences* pSEQPrefs = NULL;
+
+static const char* colors[] =
+{
+  "gray", "darkgray", "white", "red", "darkred", "green", "darkgreen",
+  "blue", "darkblue", "cyan", "magenta", "yellow", "orange", "brown",
+};
+
+// a zone of random walks, spread over a few floors, shaped a bit like
+// the wall outlines of a large dungeon
+static void makeZone(MapData& mapData, int numLines)
+{
+  mapData.createNewLayer();
+
+  int i, j;
+  for (i = 0; i < numLines; i++)
+  {
+    int16_t x = int16_t((rand() % 8000) - 4000);
+    int16_t y = int16_t((rand() % 8000) - 4000);
+    int16_t z = int16_t(((rand() % 6) * 60) - 150);
+    mapData.startLine(QString("line%1").arg(i), RANDOM(colors),
+		      MapPoint(x, y, z));
+    mapData.quickCheckPos(x, y);
+
+    int points = 2 + (rand() % 30);
+    for (j = 1; j < points; j++)
+    {
+      x = int16_t(x + (rand() % 80) - 40);
+      y = int16_t(y + (rand() % 80) - 40);
+      if ((rand() % 8) == 0)
+	z = int16_t(z + (rand() % 30) - 15);
+      mapData.addLinePoint(MapPoint(x, y, z));
+      mapData.quickCheckPos(x, y);
+    }
+  }
+
+  mapData.updateBounds();
+}
+
+static void paint(const MapData& mapData, MapParameters& param, QPainter& p)
+{
+  switch (param.mapLineStyle())
+  {
+  case tMap_Normal:
+    mapData.paintLines(param, p);
+    break;
+  case tMap_DepthFiltered:
+    mapData.paintDepthFilteredLines(param, p);
+    break;
+  case tMap_FadedFloors:
+    mapData.paintFadedFloorsLines(param, p);
+    break;
+  default:
+    break;
+  }
+}
+
+// Renders the lines of a large zone offscreen, with the segments submitted
+// one at a time and batched by pen, in each of the map line styles.
+// usage: mapbench [lines] [iterations] [size] [zone.map]
+// (pass -platform offscreen to run without a display)
+int main (int argc, char *argv[])
+{
+  QApplication app(argc, argv);
+  QStringList args = app.arguments();
+
+  int numLines = (args.size() > 1) ? args[1].toInt() : 20000;
+  int iterations = (args.size() > 2) ? args[2].toInt() : 10;
+  int size = (args.size() > 3) ? args[3].toInt() : 1024;
+
+  srand(BENCH_SEED);
+
+  MapData mapData;
+  if (args.size() > 4)
+    mapData.loadMap(args[4]);
+  else
+    makeZone(mapData, numLines);
+
+  int lines = 0;
+  for (int i = 0; i < mapData.numLayers(); i++)
+    lines += mapData.mapLayer(i)->lLines().size() +
+      mapData.mapLayer(i)->mLines().size();
+
+  printf("layers: %d, lines: %d, size: %dx%d, iterations: %d\n",
+	 mapData.numLayers(), lines, size, size, iterations);
+
+  QImage image(size, size, QImage::Format_RGB32);
+
+  // the whole zone, with the player on the middle floor
+  MapParameters param(mapData);
+  param.setScreenSize(QSize(size, size));
+  param.setScreenBounds(mapData.boundingRect());
+  param.setPlayer(MapPoint(0, 0, 0));
+
+  static const MapLineStyle styles[] =
+    { tMap_Normal, tMap_DepthFiltered, tMap_FadedFloors };
+  static const char* styleNames[] =
+    { "normal", "depth filtered", "faded floors" };
+
+  QElapsedTimer timer;
+  for (int s = 0; s < 3; s++)
+  {
+    param.setMapLineStyle(styles[s]);
+
+    qint64 elapsed[2];
+    int drawCalls[2];
+    for (int batched = 0; batched < 2; batched++)
+    {
+      mapData.setBatchLines(batched != 0);
+
+      QPainter p(&image);
+
+      // the first paint also breaks the layers up into segments
+      image.fill(0);
+      paint(mapData, param, p);
+
+      timer.start();
+      for (int j = 0; j < iterations; j++)
+      {
+	mapData.resetPaintStats();
+	paint(mapData, param, p);
+      }
+      elapsed[batched] = timer.nsecsElapsed();
+      drawCalls[batched] = mapData.paintStats().lineDrawCalls;
+
+      p.end();
+    }
+
+    printf("%-15s per-segment: %8.2f ms/frame (%d draws), "
+	   "batched: %8.2f ms/frame (%d draws, %.2fx)\n",
+	   styleNames[s],
+	   double(elapsed[0]) / iterations / 1000000.0, drawCalls[0],
+	   double(elapsed[1]) / iterations / 1000000.0, drawCalls[1],
+	   elapsed[1] ? double(elapsed[0]) / double(elapsed[1]) : 0.0);
+  }
+
+  return 0;
+}
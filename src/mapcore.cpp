@@ -36,17 +36,25 @@
 #include "diagnosticmessages.h"
 
 #include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
 
 #include <QDateTime>
 #include <QPainter>
+#include <QFontMetrics>
 #include <QString>
 #include <QStringList>
 #include <QFileInfo>
 #include <QFile>
+#include <QTemporaryFile>
 #include <QRegExp>
 #include <QPolygon>
 #include <QByteArray>
 #include <QPixmap>
+#include <QHash>
+#include <QCryptographicHash>
 #include "xmlpreferences.h"
 
 extern XMLPreferences* pSEQPrefs;
@@ -415,6 +423,442 @@ MapAggro::~MapAggro()
 {
 }
 
+//----------------------------------------------------------------------
+// MapLayerIndex
+
+// smallest bucket size in map units, and most buckets along either axis
+static const int minIndexCellSize = 64;
+static const int maxIndexCells = 128;
+
+MapLayerIndex::MapLayerIndex()
+  : m_stamp(0)
+{
+  clear();
+}
+
+void MapLayerIndex::clear()
+{
+  m_bounds = QRect();
+  m_cellSize = minIndexCellSize;
+  m_columns = 0;
+  m_rows = 0;
+  m_maxLocationNameLength = 0;
+
+  for (int k = 0; k < tNumKinds; k++)
+  {
+    m_cells[k].clear();
+    m_seen[k].clear();
+  }
+}
+
+void MapLayerIndex::build(MapLayer& layer)
+{
+  clear();
+
+  const QList<MapLineL*>& lLines = layer.lLines();
+  const QList<MapLineM*>& mLines = layer.mLines();
+  const QList<MapLocation*>& locations = layer.locations();
+  int i;
+
+  // find the extent of everything on the layer
+  for (i = 0; i < lLines.size(); i++)
+    m_bounds |= lLines[i]->boundingRect();
+  for (i = 0; i < mLines.size(); i++)
+    m_bounds |= mLines[i]->boundingRect();
+  for (i = 0; i < locations.size(); i++)
+  {
+    m_bounds |= QRect(locations[i]->x(), locations[i]->y(), 1, 1);
+    if (locations[i]->name().length() > m_maxLocationNameLength)
+      m_maxLocationNameLength = locations[i]->name().length();
+  }
+
+  if (!m_bounds.isValid())
+    return;
+
+  // aim for about as many buckets as there are items, within limits
+  int count = lLines.size() + mLines.size() + locations.size();
+  int cellsPerSide = qBound(1, int(sqrt(double(count))), maxIndexCells);
+  int extent = qMax(m_bounds.width(), m_bounds.height());
+  m_cellSize = qMax(minIndexCellSize,
+		    (extent + cellsPerSide - 1) / cellsPerSide);
+  m_columns = (m_bounds.width() + m_cellSize - 1) / m_cellSize;
+  m_rows = (m_bounds.height() + m_cellSize - 1) / m_cellSize;
+
+  for (int k = 0; k < tNumKinds; k++)
+    m_cells[k].resize(m_columns * m_rows);
+  m_seen[tLLines].resize(lLines.size());
+  m_seen[tMLines].resize(mLines.size());
+  m_seen[tLocations].resize(locations.size());
+
+  for (i = 0; i < lLines.size(); i++)
+    insert(tLLines, i, lLines[i]->boundingRect());
+  for (i = 0; i < mLines.size(); i++)
+    insert(tMLines, i, mLines[i]->boundingRect());
+  for (i = 0; i < locations.size(); i++)
+    insert(tLocations, i, QRect(locations[i]->x(), locations[i]->y(), 1, 1));
+}
+
+void MapLayerIndex::insert(Kind kind, int index, const QRect& bounds)
+{
+  // nothing to paint for an empty line, it never intersects the screen
+  if (!bounds.isValid())
+    return;
+
+  int x1 = (bounds.left() - m_bounds.left()) / m_cellSize;
+  int x2 = (bounds.right() - m_bounds.left()) / m_cellSize;
+  int y1 = (bounds.top() - m_bounds.top()) / m_cellSize;
+  int y2 = (bounds.bottom() - m_bounds.top()) / m_cellSize;
+
+  for (int y = y1; y <= y2; y++)
+    for (int x = x1; x <= x2; x++)
+      m_cells[kind][(y * m_columns) + x].append(index);
+}
+
+void MapLayerIndex::query(Kind kind, const QRect& rect,
+			  QVector<int>& result) const
+{
+  result.clear();
+
+  QRect area = rect & m_bounds;
+  if (area.isEmpty())
+    return;
+
+  int x1 = (area.left() - m_bounds.left()) / m_cellSize;
+  int x2 = (area.right() - m_bounds.left()) / m_cellSize;
+  int y1 = (area.top() - m_bounds.top()) / m_cellSize;
+  int y2 = (area.bottom() - m_bounds.top()) / m_cellSize;
+
+  // new stamp for this query, starting the marks over when it wraps
+  if (++m_stamp == 0)
+  {
+    for (int k = 0; k < tNumKinds; k++)
+      m_seen[k].fill(0);
+    m_stamp = 1;
+  }
+
+  QVector<uint32_t>& seen = m_seen[kind];
+  for (int y = y1; y <= y2; y++)
+  {
+    for (int x = x1; x <= x2; x++)
+    {
+      const QVector<int>& cell = m_cells[kind][(y * m_columns) + x];
+      for (int i = 0; i < cell.size(); i++)
+      {
+	int index = cell[i];
+	if (seen[index] != m_stamp)
+	{
+	  seen[index] = m_stamp;
+	  result.append(index);
+	}
+      }
+    }
+  }
+
+  // keep the original drawing order, later items paint over earlier ones
+  std::sort(result.begin(), result.end());
+}
+
+//----------------------------------------------------------------------
+// MapLineSegments
+MapLineSegments::MapLineSegments()
+  : m_maxBandSpan(0),
+    m_grayBase(0)
+{
+  m_flatBand.band = 0;
+  m_flatBand.firstRun = 0;
+  m_flatBand.numRuns = 0;
+}
+
+void MapLineSegments::clear()
+{
+  m_segments.clear();
+  m_lRuns.clear();
+  m_mRuns.clear();
+  m_bandSegments.clear();
+  m_bandRuns.clear();
+  m_bands.clear();
+  m_flatBand.bounds = QRect();
+  m_flatBand.firstRun = 0;
+  m_flatBand.numRuns = 0;
+  m_maxBandSpan = 0;
+  m_pens.clear();
+  m_grayBase = 0;
+}
+
+void MapLineSegments::build(MapLayer& layer)
+{
+  clear();
+
+  const QList<MapLineL*>& lLines = layer.lLines();
+  const QList<MapLineM*>& mLines = layer.mLines();
+  QHash<QRgb, int> penIndex;
+  QVector<int> penSegments;
+  int i, j;
+
+  m_lRuns.resize(lLines.size());
+  m_mRuns.resize(mLines.size());
+
+  // find the distinct line colors, and how many segments use each
+  for (i = 0; i < lLines.size() + mLines.size(); i++)
+  {
+    MapLineL* lineL = (i < lLines.size()) ? lLines[i] : 0;
+    MapLineM* lineM = lineL ? 0 : mLines[i - lLines.size()];
+    QRgb rgb = lineL ? lineL->color().rgba() : lineM->color().rgba();
+    int size = lineL ? lineL->size() : lineM->size();
+
+    QHash<QRgb, int>::const_iterator it = penIndex.constFind(rgb);
+    int pen;
+    if (it == penIndex.constEnd())
+    {
+      pen = m_pens.size();
+      penIndex.insert(rgb, pen);
+      m_pens.append(lineL ? lineL->color() : lineM->color());
+      penSegments.append(0);
+    }
+    else
+      pen = *it;
+
+    MapSegmentRun& run = lineL ? m_lRuns[i] : m_mRuns[i - lLines.size()];
+    run.pen = pen;
+    run.count = (size > 1) ? (size - 1) : 0;
+    penSegments[pen] += run.count;
+  }
+
+  // lay the pens out one after the other
+  QVector<int> penStart(m_pens.size());
+  int total = 0;
+  for (i = 0; i < m_pens.size(); i++)
+  {
+    penStart[i] = total;
+    total += penSegments[i];
+  }
+  m_segments.resize(total);
+
+  // then copy each line's segments into its pen's run
+  for (i = 0; i < lLines.size(); i++)
+  {
+    MapSegmentRun& run = m_lRuns[i];
+    run.first = penStart[run.pen];
+    penStart[run.pen] += run.count;
+
+    const QPoint* lData = lLines[i]->constData();
+    MapSegment* seg = m_segments.data() + run.first;
+    for (j = 0; j < run.count; j++, seg++)
+    {
+      seg->x1 = lData[j].x();
+      seg->y1 = lData[j].y();
+      seg->x2 = lData[j + 1].x();
+      seg->y2 = lData[j + 1].y();
+    }
+  }
+
+  for (i = 0; i < mLines.size(); i++)
+  {
+    MapSegmentRun& run = m_mRuns[i];
+    run.first = penStart[run.pen];
+    penStart[run.pen] += run.count;
+
+    const MapPoint* mData = mLines[i]->data();
+    MapSegment* seg = m_segments.data() + run.first;
+    for (j = 0; j < run.count; j++, seg++)
+    {
+      seg->x1 = mData[j].x();
+      seg->y1 = mData[j].y();
+      seg->x2 = mData[j + 1].x();
+      seg->y2 = mData[j + 1].y();
+    }
+  }
+
+  // the shades of gray used by faded floors come after the line colors
+  m_grayBase = m_pens.size();
+  for (i = 0; i < 256; i++)
+    m_pens.append(QColor(i, i, i));
+
+  buildBands(layer);
+}
+
+// a segment waiting to be sorted into its band
+struct MapBandEntry
+{
+  bool flat;
+  int band;
+  int pen;
+  MapBandSegment seg;
+};
+
+// L lines without a height first, then by band, then by pen
+static bool bandEntryLess(const MapBandEntry& a, const MapBandEntry& b)
+{
+  if (a.flat != b.flat)
+    return a.flat;
+  if (a.band != b.band)
+    return a.band < b.band;
+  return a.pen < b.pen;
+}
+
+void MapLineSegments::buildBands(MapLayer& layer)
+{
+  const QList<MapLineL*>& lLines = layer.lLines();
+  const QList<MapLineM*>& mLines = layer.mLines();
+  QVector<MapBandEntry> entries;
+  MapBandEntry entry;
+  int i, j;
+
+  entries.reserve(m_segments.size());
+
+  // L lines are all in one band, or in none if they don't have a height
+  for (i = 0; i < lLines.size(); i++)
+  {
+    const MapLineL* line = lLines[i];
+    const MapSegmentRun& run = m_lRuns[i];
+    const MapSegment* seg = m_segments.constData() + run.first;
+
+    entry.flat = !line->heightSet();
+    entry.band = entry.flat ? 0 : zBand(line->z());
+    entry.pen = run.pen;
+    for (j = 0; j < run.count; j++, seg++)
+    {
+      entry.seg.x1 = seg->x1;
+      entry.seg.y1 = seg->y1;
+      entry.seg.band1 = entry.band;
+      entry.seg.x2 = seg->x2;
+      entry.seg.y2 = seg->y2;
+      entry.seg.band2 = entry.band;
+      entries.append(entry);
+    }
+  }
+
+  // M line segments go in the band of their lower end
+  entry.flat = false;
+  for (i = 0; i < mLines.size(); i++)
+  {
+    const MapPoint* mData = mLines[i]->data();
+    const MapSegmentRun& run = m_mRuns[i];
+    const MapSegment* seg = m_segments.constData() + run.first;
+
+    entry.pen = run.pen;
+    for (j = 0; j < run.count; j++, seg++)
+    {
+      entry.seg.x1 = seg->x1;
+      entry.seg.y1 = seg->y1;
+      entry.seg.band1 = zBand(mData[j].z());
+      entry.seg.x2 = seg->x2;
+      entry.seg.y2 = seg->y2;
+      entry.seg.band2 = zBand(mData[j + 1].z());
+      entry.band = std::min(entry.seg.band1, entry.seg.band2);
+      m_maxBandSpan = std::max(m_maxBandSpan,
+			       std::abs(entry.seg.band1 - entry.seg.band2));
+      entries.append(entry);
+    }
+  }
+
+  // keeping the segments of each line in order within their band and pen
+  std::stable_sort(entries.begin(), entries.end(), bandEntryLess);
+
+  m_bandSegments.resize(entries.size());
+  for (i = 0; i < entries.size(); i++)
+    m_bandSegments[i] = entries[i].seg;
+
+  // then split them into bands, and the bands into runs of a pen
+  MapBand band;
+  for (i = 0; i < entries.size(); i = j)
+  {
+    band.band = entries[i].band;
+    band.bounds = QRect();
+    band.firstRun = m_bandRuns.size();
+
+    for (j = i; (j < entries.size()) &&
+	   (entries[j].flat == entries[i].flat) &&
+	   (entries[j].band == entries[i].band); j++)
+    {
+      const MapBandSegment& seg = entries[j].seg;
+      band.bounds |= QRect(QPoint(std::min(seg.x1, seg.x2),
+				  std::min(seg.y1, seg.y2)),
+			   QPoint(std::max(seg.x1, seg.x2),
+				  std::max(seg.y1, seg.y2)));
+
+      if ((j == i) || (entries[j].pen != entries[j - 1].pen))
+      {
+	MapSegmentRun run;
+	run.first = j;
+	run.count = 0;
+	run.pen = entries[j].pen;
+	m_bandRuns.append(run);
+      }
+      m_bandRuns.last().count++;
+    }
+
+    band.numRuns = m_bandRuns.size() - band.firstRun;
+    if (entries[i].flat)
+      m_flatBand = band;
+    else
+      m_bands.append(band);
+  }
+}
+
+int MapLineSegments::firstBand(int band) const
+{
+  // segments are filed under the band of their lower end, so start low
+  // enough to find the ones that reach up into the band
+  band -= m_maxBandSpan;
+
+  int lo = 0;
+  int hi = m_bands.size();
+  while (lo < hi)
+  {
+    int mid = (lo + hi) / 2;
+    if (m_bands[mid].band < band)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+//----------------------------------------------------------------------
+// MapLineBatch
+MapLineBatch::MapLineBatch()
+  : m_painter(0),
+    m_pens(0),
+    m_lastPen(-1),
+    m_drawCalls(0),
+    m_batched(true)
+{
+}
+
+void MapLineBatch::begin(QPainter& p, const QVector<QColor>& pens)
+{
+  m_painter = &p;
+  m_pens = &pens;
+  m_lastPen = -1;
+  m_drawCalls = 0;
+
+  if (m_lines.size() < pens.size())
+    m_lines.resize(pens.size());
+}
+
+int MapLineBatch::end()
+{
+  // one draw call per pen, in the order the pens were first used
+  for (int i = 0; i < m_used.size(); i++)
+  {
+    QVector<QLine>& lines = m_lines[m_used[i]];
+    m_painter->setPen((*m_pens)[m_used[i]]);
+    m_painter->drawLines(lines.constData(), lines.size());
+    m_drawCalls++;
+
+    // keep the storage around for the next paint
+    lines.resize(0);
+  }
+  m_used.resize(0);
+
+  m_painter = 0;
+  m_pens = 0;
+
+  return m_drawCalls;
+}
+
 //----------------------------------------------------------------------
 // MapLayer
 MapLayer::MapLayer()
@@ -441,12 +885,18 @@ void MapLayer::clear()
 
   qDeleteAll(m_locations);
   m_locations.clear();
+
+  m_index.clear();
+  m_indexValid = false;
+  m_segments.clear();
+  m_segmentsValid = false;
 }
 
 
 //----------------------------------------------------------------------
 // MapData
 MapData::MapData()
+  : m_generation(0)
 {
   // clear the structure
   clear();
@@ -485,6 +935,54 @@ void MapData::clear()
   m_zoneZEM = 75;
 
   m_editLayer = 0;
+
+  resetPaintStats();
+  m_generation++;
+}
+
+void MapData::swap(MapData& other)
+{
+  std::swap(m_minX, other.m_minX);
+  std::swap(m_minY, other.m_minY);
+  std::swap(m_maxX, other.m_maxX);
+  std::swap(m_maxY, other.m_maxY);
+  std::swap(m_boundingRect, other.m_boundingRect);
+  std::swap(m_size, other.m_size);
+  std::swap(m_zoneLongName, other.m_zoneLongName);
+  std::swap(m_zoneShortName, other.m_zoneShortName);
+  std::swap(m_mapLayers, other.m_mapLayers);
+  std::swap(m_editLineM, other.m_editLineM);
+  std::swap(m_editLocation, other.m_editLocation);
+  std::swap(m_aggros, other.m_aggros);
+  std::swap(m_zoneZEM, other.m_zoneZEM);
+  std::swap(m_image, other.m_image);
+  std::swap(m_imageLoaded, other.m_imageLoaded);
+  std::swap(m_editLayer, other.m_editLayer);
+
+  // anything cached from either one is stale now
+  resetPaintStats();
+  other.resetPaintStats();
+  m_generation++;
+  other.m_generation++;
+}
+
+void MapData::layerChanged(uint8_t layerNum)
+{
+  if (layerNum < m_mapLayers.count())
+    m_mapLayers[layerNum]->invalidateIndex();
+
+  m_generation++;
+}
+
+void MapData::resetPaintStats() const
+{
+  m_paintStats.linesDrawn = 0;
+  m_paintStats.linesCulled = 0;
+  m_paintStats.bandsDrawn = 0;
+  m_paintStats.bandsCulled = 0;
+  m_paintStats.locationsDrawn = 0;
+  m_paintStats.locationsCulled = 0;
+  m_paintStats.lineDrawCalls = 0;
 }
 
 MapLayer* MapData::mapLayer(uint8_t layerNum)
@@ -510,11 +1008,15 @@ void MapData::loadMap(const QString& fileName, bool import)
   MapLineL* currentLineL = NULL;
   MapLineM* currentLineM = NULL;
   MapLayer* layer = NULL;
+  bool zemSet = false;
 
   // clear any existing map data (if not importing)
   if (!import)
     clear();
 
+  // the aggros are shared by all the layers, so note where this file's begin
+  int firstAggro = m_aggros.count();
+
   /* Kind of stupid to try a non-existant map, don't you think? */
   if (fileName.contains("/.map") != 0)
     return;
@@ -533,6 +1035,14 @@ void MapData::loadMap(const QString& fileName, bool import)
 
   // note the file name
   layer->setFileName(fileName);
+
+  // use the compiled copy of the map if it's up to date
+  if (loadCompiledMap(fileName, false, layer))
+  {
+    layerLoaded(layer, fileName);
+    seqInfo("Loaded compiled map: '%s'", fileName.toLatin1().data());
+    return;
+  }
     
   // allocate memory in a QByteArray to hold the entire file contents
   QByteArray textData(mapFile.size() + 1, '\0');
@@ -902,6 +1412,7 @@ void MapData::loadMap(const QString& fileName, bool import)
 	}
 	
 	m_zoneZEM = (*fit++).toUShort(&ok);
+	zemSet = true;
 	if (!ok) 
         {
 	  seqWarn("Line %d in map '%s' has an Z marker with invalid ZEM!", 
@@ -917,24 +1428,37 @@ void MapData::loadMap(const QString& fileName, bool import)
     }
   }
 
-  // calculate the bounding rect
-  updateBounds();
+  // save a compiled copy so it doesn't have to be parsed next time
+  saveCompiledMap(fileName, false, layer, firstAggro, zemSet);
 
-  m_mapLayers.append(layer);
-  layer->setMapLoaded(true);
+  layerLoaded(layer, fileName);
 
-  m_imageLoaded = false;
-  QString imageFileName = fileName;
-  imageFileName.truncate(imageFileName.lastIndexOf('.'));
-  imageFileName += ".pgm";
+  seqInfo("Loaded map: '%s'", fileName.toLatin1().data());
+}
 
-  if (m_image.load(imageFileName))
+// the color the user has chosen for one of the SOE map colors
+QColor MapData::soeMapColor(uint8_t r, uint8_t g, uint8_t b) const
+{
+  unsigned short map_color_index = getMapConvertColorIndex(r, g, b);
+  if (map_color_index < m_soeColors.size())
+    return m_soeColors[map_color_index];
+
+  return QColor(pSEQPrefs->getPrefString("MapColor" + QString::number(map_color_index),
+          "MapColors", getMapConvertColor(r, g, b)));
+}
+
+void MapData::loadSOEColors()
+{
+  m_soeColors.resize(64);
+  for (int i = 0; i < m_soeColors.size(); i++)
   {
-    m_imageLoaded = true;
-    seqInfo("Loaded map image: '%s'", imageFileName.toLatin1().data());
+    // any r, g, b that maps to the index gives its default
+    uint8_t r = (i % 4) * 80;
+    uint8_t g = ((i / 4) % 4) * 80;
+    uint8_t b = (i / 16) * 80;
+    m_soeColors[i] = QColor(pSEQPrefs->getPrefString("MapColor" + QString::number(i),
+            "MapColors", getMapConvertColor(r, g, b)));
   }
-
-  seqInfo("Loaded map: '%s'", fileName.toLatin1().data());
 }
 
 void MapData::loadSOEMap(const QString& fileName, bool import)
@@ -981,6 +1505,14 @@ void MapData::loadSOEMap(const QString& fileName, bool import)
   // note the file name 
   layer->setFileName(fileName);
 
+  // use the compiled copy of the map if it's up to date
+  if (loadCompiledMap(fileName, true, layer))
+  {
+    layerLoaded(layer, fileName);
+    seqInfo("Loaded compiled SOE map: '%s'", fileName.toLatin1().data());
+    return;
+  }
+
   // allocate memory in a QByteArray to hold the entire file contents
   QByteArray textData(mapFile.size() + 1, '\0');
 
@@ -1083,9 +1615,7 @@ void MapData::loadSOEMap(const QString& fileName, bool import)
 
 	  // create an M line (start with 2 points because of SOE's lame
 	  // format).
-      unsigned short map_color_index = getMapConvertColorIndex(r, g, b);
-      QColor lineColor = pSEQPrefs->getPrefString("MapColor" + QString::number(map_color_index),
-              "MapColors", getMapConvertColor(r, g, b));
+      QColor lineColor = soeMapColor(r, g, b);
 	  currentLineM = new MapLineM("soe", lineColor, 2);
       currentLineM->setOrigColor(QColor(r, g, b));
 
@@ -1148,9 +1678,7 @@ void MapData::loadSOEMap(const QString& fileName, bool import)
 	name.replace("_", " ");
 
 	// add it to the list of locations
-    unsigned short map_color_index = getMapConvertColorIndex(r, g, b);
-    QColor lineColor = pSEQPrefs->getPrefString("MapColor" + QString::number(map_color_index),
-            "MapColors", getMapConvertColor(r, g, b));
+    QColor lineColor = soeMapColor(r, g, b);
     MapLocation* loc = new MapLocation(name, lineColor, x1, y1, z1);
     loc->setOrigColor(QColor(r, g, b));
 	layer->locations().append(loc);
@@ -1163,24 +1691,513 @@ void MapData::loadSOEMap(const QString& fileName, bool import)
     }
   }
 
+  // save a compiled copy so it doesn't have to be parsed next time
+  saveCompiledMap(fileName, true, layer, m_aggros.count(), false);
+
+  layerLoaded(layer, fileName);
+
+  seqInfo("Loaded SOE map: '%s'", fileName.toLatin1().data());
+}
+
+void MapData::layerLoaded(MapLayer* layer, const QString& fileName)
+{
   // calculate the bounding rect
   updateBounds();
 
   m_mapLayers.append(layer);
   layer->setMapLoaded(true);
 
-  m_imageLoaded = false;
-  QString imageFileName = fileName;
-  imageFileName.truncate(imageFileName.lastIndexOf('.'));
-  imageFileName += ".pgm";
+  // bucket the lines and locations and group their segments up front,
+  // instead of on the first paint
+  layer->invalidateIndex();
+  layer->index();
+  layer->segments();
+  m_generation++;
+
+  m_imageLoaded = false;
+  QString imageFileName = fileName;
+  imageFileName.truncate(imageFileName.lastIndexOf('.'));
+  imageFileName += ".pgm";
+
+  if (m_image.load(imageFileName))
+  {
+    m_imageLoaded = true;
+    seqInfo("Loaded map image: '%s'", imageFileName.toLatin1().data());
+  }
+}
+
+//----------------------------------------------------------------------
+// Compiled maps
+//
+// A copy of a loaded map file in a flat binary form that can be mapped
+// straight into memory, kept in the user's map cache directory under a
+// name derived from the source file's path.  The header records the size
+// and modification time of the source it was made from, and a compiled
+// map that doesn't match its source any more is just ignored and written
+// again after the source is parsed.  Everything is in native byte order,
+// since the files never leave the machine they were made on.
+//
+// The layout is the header followed by the string table, the L lines, the
+// M lines, the locations, the aggros, the points and the string characters.
+// SOE map colors are stored as the original color, and looked up in the
+// map color preferences when loaded, like the source would be.
+
+static const char compiledMagic[8] = { 'S', 'E', 'Q', 'M', 'A', 'P', 'C', 0 };
+static const uint32_t compiledVersion = 1;
+static const uint32_t compiledNoString = 0xffffffff;
+
+enum
+{
+  tCompiledSOE = 0x01,
+  tCompiledZEM = 0x02,
+  tCompiledBounds = 0x04,
+};
+
+enum
+{
+  tCompiledHeightSet = 0x01,
+  tCompiledOrigColor = 0x02,
+};
+
+struct MapCompiledHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  qint64 sourceSize;
+  qint64 sourceModified;
+  uint32_t zoneLongName;
+  uint32_t zoneShortName;
+  uint32_t numStrings;
+  uint32_t numLLines;
+  uint32_t numMLines;
+  uint32_t numLocations;
+  uint32_t numAggros;
+  uint32_t numPoints;
+  uint32_t numChars;
+  int16_t minX, minY, maxX, maxY;
+  uint8_t zoneZEM;
+  uint8_t pad[3];
+};
+
+struct MapCompiledString
+{
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct MapCompiledLine
+{
+  uint32_t name;
+  uint32_t color;
+  uint32_t firstPoint;
+  uint32_t numPoints;
+  QRgb origColor;
+  int16_t z;
+  uint8_t flags;
+  uint8_t pad;
+};
+
+struct MapCompiledLocation
+{
+  uint32_t name;
+  uint32_t color;
+  QRgb origColor;
+  int16_t x, y, z;
+  uint8_t flags;
+  uint8_t pad;
+};
+
+struct MapCompiledAggro
+{
+  uint32_t name;
+  uint16_t range;
+  uint16_t pad;
+};
+
+struct MapCompiledPoint
+{
+  int16_t x, y, z;
+};
+
+// the strings of a compiled map, each distinct one stored once
+class MapCompiledStrings
+{
+ public:
+  uint32_t add(const QString& str)
+  {
+    QHash<QString, uint32_t>::const_iterator it = m_index.constFind(str);
+    if (it != m_index.constEnd())
+      return *it;
+
+    MapCompiledString entry;
+    entry.offset = m_chars.size();
+    entry.length = str.length();
+    m_chars.append(str);
+    m_strings.append(entry);
+    m_index.insert(str, m_strings.size() - 1);
+    return m_strings.size() - 1;
+  }
+
+  QVector<MapCompiledString> m_strings;
+  QString m_chars;
+  QHash<QString, uint32_t> m_index;
+};
+
+QString MapData::compiledFileName(const QString& fileName) const
+{
+  QFileInfo fileInfo(fileName);
+
+  // the base name keeps the cache browsable, the hash keeps maps with the
+  // same name in different directories apart
+  QByteArray hash =
+    QCryptographicHash::hash(fileInfo.absoluteFilePath().toUtf8(),
+			     QCryptographicHash::Md5).toHex();
+
+  return m_compiledDir + "/" + fileInfo.fileName() + "." +
+    QString::fromLatin1(hash.left(16)) + ".mapc";
+}
+
+bool MapData::loadCompiledMap(const QString& fileName, bool soe,
+			      MapLayer* layer)
+{
+  if (m_compiledDir.isEmpty())
+    return false;
+
+  QFileInfo source(fileName);
+  QFile file(compiledFileName(fileName));
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  qint64 size = file.size();
+  if (size < qint64(sizeof(MapCompiledHeader)))
+    return false;
+
+  const uchar* data = file.map(0, size);
+  if (!data)
+    return false;
+
+  // make sure it's a compiled copy of the map as it is now
+  const MapCompiledHeader* header = (const MapCompiledHeader*)data;
+  if ((memcmp(header->magic, compiledMagic, sizeof(compiledMagic)) != 0) ||
+      (header->version != compiledVersion) ||
+      (((header->flags & tCompiledSOE) != 0) != soe) ||
+      (header->sourceSize != source.size()) ||
+      (header->sourceModified != source.lastModified().toMSecsSinceEpoch()))
+  {
+    file.unmap((uchar*)data);
+    return false;
+  }
+
+  // find the sections, and make sure they're all there
+  const MapCompiledString* strings =
+    (const MapCompiledString*)(header + 1);
+  const MapCompiledLine* lLines =
+    (const MapCompiledLine*)(strings + header->numStrings);
+  const MapCompiledLine* mLines = lLines + header->numLLines;
+  const MapCompiledLocation* locations =
+    (const MapCompiledLocation*)(mLines + header->numMLines);
+  const MapCompiledAggro* aggros =
+    (const MapCompiledAggro*)(locations + header->numLocations);
+  const MapCompiledPoint* points =
+    (const MapCompiledPoint*)(aggros + header->numAggros);
+  const ushort* chars = (const ushort*)(points + header->numPoints);
+
+  if (((const uchar*)(chars + header->numChars) - data) != size)
+  {
+    seqWarn("Compiled map for '%s' is damaged, ignoring it",
+	    fileName.toLatin1().data());
+    file.unmap((uchar*)data);
+    return false;
+  }
+
+  uint32_t i, j;
+  for (i = 0; i < header->numStrings; i++)
+    if ((strings[i].offset > header->numChars) ||
+	(strings[i].length > header->numChars - strings[i].offset))
+    {
+      file.unmap((uchar*)data);
+      return false;
+    }
+
+  for (i = 0; i < header->numLLines + header->numMLines; i++)
+    if ((lLines[i].firstPoint > header->numPoints) ||
+	(lLines[i].numPoints > header->numPoints - lLines[i].firstPoint))
+    {
+      file.unmap((uchar*)data);
+      return false;
+    }
+
+#define COMPILED_STRING(index) \
+  (((index) < header->numStrings) ? \
+   QString((const QChar*)(chars + strings[index].offset), \
+	   strings[index].length) : QString())
+
+  QString name;
+  QString color;
+  const MapCompiledPoint* point;
+
+  for (i = 0; i < header->numLLines; i++)
+  {
+    const MapCompiledLine& line = lLines[i];
+    name = COMPILED_STRING(line.name);
+    color = COMPILED_STRING(line.color);
+
+    MapLineL* lineL;
+    if (line.flags & tCompiledHeightSet)
+      lineL = new MapLineL(name, color, line.numPoints, line.z);
+    else
+      lineL = new MapLineL(name, color, line.numPoints);
+
+    point = points + line.firstPoint;
+    for (j = 0; j < line.numPoints; j++, point++)
+      lineL->setPoint(j, point->x, point->y);
+
+    lineL->calcBounds();
+    layer->lLines().append(lineL);
+  }
+
+  for (i = 0; i < header->numMLines; i++)
+  {
+    const MapCompiledLine& line = mLines[i];
+    name = COMPILED_STRING(line.name);
+
+    MapLineM* lineM;
+    if (line.color != compiledNoString)
+      lineM = new MapLineM(name, COMPILED_STRING(line.color), line.numPoints);
+    else
+      lineM = new MapLineM(name,
+			   soeMapColor(qRed(line.origColor),
+				       qGreen(line.origColor),
+				       qBlue(line.origColor)),
+			   line.numPoints);
+    if (line.flags & tCompiledOrigColor)
+      lineM->setOrigColor(QColor(line.origColor));
+
+    point = points + line.firstPoint;
+    for (j = 0; j < line.numPoints; j++, point++)
+      lineM->setPoint(j, point->x, point->y, point->z);
+
+    lineM->calcBounds();
+    layer->mLines().append(lineM);
+  }
+
+  for (i = 0; i < header->numLocations; i++)
+  {
+    const MapCompiledLocation& loc = locations[i];
+    name = COMPILED_STRING(loc.name);
+
+    MapLocation* location;
+    if (loc.color == compiledNoString)
+      location = new MapLocation(name,
+				 soeMapColor(qRed(loc.origColor),
+					     qGreen(loc.origColor),
+					     qBlue(loc.origColor)),
+				 loc.x, loc.y, loc.z);
+    else if (loc.flags & tCompiledHeightSet)
+      location = new MapLocation(name, COMPILED_STRING(loc.color),
+				 loc.x, loc.y, loc.z);
+    else
+      location = new MapLocation(name, COMPILED_STRING(loc.color),
+				 loc.x, loc.y);
+    if (loc.flags & tCompiledOrigColor)
+      location->setOrigColor(QColor(loc.origColor));
+
+    layer->locations().append(location);
+  }
+
+  for (i = 0; i < header->numAggros; i++)
+    m_aggros.append(new MapAggro(COMPILED_STRING(aggros[i].name),
+				 aggros[i].range));
+
+  m_zoneLongName = COMPILED_STRING(header->zoneLongName);
+  m_zoneShortName = COMPILED_STRING(header->zoneShortName);
+  if (header->flags & tCompiledZEM)
+    m_zoneZEM = header->zoneZEM;
+
+  // adjust map boundaries
+  if (header->flags & tCompiledBounds)
+  {
+    quickCheckPos(header->minX, header->minY);
+    quickCheckPos(header->maxX, header->maxY);
+  }
+
+#undef COMPILED_STRING
+
+  file.unmap((uchar*)data);
+
+  return true;
+}
+
+void MapData::saveCompiledMap(const QString& fileName, bool soe,
+			      MapLayer* layer, int firstAggro,
+			      bool zemSet) const
+{
+  if (m_compiledDir.isEmpty())
+    return;
+
+  QFileInfo source(fileName);
+  MapCompiledStrings strings;
+  QVector<MapCompiledLine> lines;
+  QVector<MapCompiledLocation> locations;
+  QVector<MapCompiledAggro> aggros;
+  QVector<MapCompiledPoint> points;
+  QRect bounds;
+  int i, j;
+
+  MapCompiledHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, compiledMagic, sizeof(compiledMagic));
+  header.version = compiledVersion;
+  header.flags = (soe ? tCompiledSOE : 0) | (zemSet ? tCompiledZEM : 0);
+  header.sourceSize = source.size();
+  header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+  header.zoneLongName = strings.add(m_zoneLongName);
+  header.zoneShortName = strings.add(m_zoneShortName);
+  header.zoneZEM = m_zoneZEM;
+
+  const QList<MapLineL*>& lLines = layer->lLines();
+  for (i = 0; i < lLines.size(); i++)
+  {
+    const MapLineL* lineL = lLines[i];
+    MapCompiledLine line;
+    memset(&line, 0, sizeof(line));
+    line.name = strings.add(lineL->name());
+    line.color = strings.add(lineL->colorName());
+    line.firstPoint = points.size();
+    line.numPoints = lineL->size();
+    line.z = lineL->z();
+    line.flags = lineL->heightSet() ? tCompiledHeightSet : 0;
+    lines.append(line);
+
+    for (j = 0; j < lineL->size(); j++)
+    {
+      MapCompiledPoint point = { int16_t(lineL->at(j).x()),
+				 int16_t(lineL->at(j).y()), 0 };
+      points.append(point);
+    }
+    bounds |= lineL->boundingRect();
+  }
+
+  const QList<MapLineM*>& mLines = layer->mLines();
+  for (i = 0; i < mLines.size(); i++)
+  {
+    const MapLineM* lineM = mLines[i];
+    MapCompiledLine line;
+    memset(&line, 0, sizeof(line));
+    line.name = strings.add(lineM->name());
+    line.color = soe ? compiledNoString : strings.add(lineM->colorName());
+    line.firstPoint = points.size();
+    line.numPoints = lineM->size();
+    if (lineM->origColor().isValid())
+    {
+      line.origColor = lineM->origColor().rgb();
+      line.flags |= tCompiledOrigColor;
+    }
+    lines.append(line);
+
+    const MapPoint* data = lineM->data();
+    for (j = 0; j < int(lineM->size()); j++)
+    {
+      MapCompiledPoint point = { data[j].x(), data[j].y(), data[j].z() };
+      points.append(point);
+    }
+    bounds |= lineM->boundingRect();
+  }
+
+  const QList<MapLocation*>& locs = layer->locations();
+  for (i = 0; i < locs.size(); i++)
+  {
+    const MapLocation* location = locs[i];
+    MapCompiledLocation loc;
+    memset(&loc, 0, sizeof(loc));
+    loc.name = strings.add(location->name());
+    loc.color = soe ? compiledNoString : strings.add(location->colorName());
+    loc.x = location->x();
+    loc.y = location->y();
+    loc.z = location->z();
+    loc.flags = location->heightSet() ? tCompiledHeightSet : 0;
+    if (location->origColor().isValid())
+    {
+      loc.origColor = location->origColor().rgb();
+      loc.flags |= tCompiledOrigColor;
+    }
+    locations.append(loc);
+    bounds |= QRect(location->x(), location->y(), 1, 1);
+  }
+
+  for (i = firstAggro; i < m_aggros.size(); i++)
+  {
+    MapCompiledAggro aggro;
+    memset(&aggro, 0, sizeof(aggro));
+    aggro.name = strings.add(m_aggros[i]->name());
+    aggro.range = m_aggros[i]->range();
+    aggros.append(aggro);
+  }
+
+  if (bounds.isValid())
+  {
+    header.flags |= tCompiledBounds;
+    header.minX = bounds.left();
+    header.minY = bounds.top();
+    header.maxX = bounds.right();
+    header.maxY = bounds.bottom();
+  }
 
-  if (m_image.load(imageFileName))
+  header.numStrings = strings.m_strings.size();
+  header.numLLines = lLines.size();
+  header.numMLines = mLines.size();
+  header.numLocations = locations.size();
+  header.numAggros = aggros.size();
+  header.numPoints = points.size();
+  header.numChars = strings.m_chars.size();
+
+  // write it under a temporary name of its own, so a half written file is
+  // never used, and the GUI thread and the map loader can write the same
+  // map at once
+  QString compiledName = compiledFileName(fileName);
+  QTemporaryFile file(compiledName + ".XXXXXX");
+  file.setAutoRemove(false);
+  if (!file.open())
   {
-    m_imageLoaded = true;
-    seqInfo("Loaded map image: '%s'", imageFileName.toLatin1().data());
+    seqWarn("Unable to write compiled map '%s'",
+	    compiledName.toLatin1().data());
+    return;
   }
 
-  seqInfo("Loaded SOE map: '%s'", fileName.toLatin1().data());
+  bool ok =
+    (file.write((const char*)&header, sizeof(header)) == sizeof(header)) &&
+    (file.write((const char*)strings.m_strings.constData(),
+		strings.m_strings.size() * sizeof(MapCompiledString)) ==
+     qint64(strings.m_strings.size() * sizeof(MapCompiledString))) &&
+    (file.write((const char*)lines.constData(),
+		lines.size() * sizeof(MapCompiledLine)) ==
+     qint64(lines.size() * sizeof(MapCompiledLine))) &&
+    (file.write((const char*)locations.constData(),
+		locations.size() * sizeof(MapCompiledLocation)) ==
+     qint64(locations.size() * sizeof(MapCompiledLocation))) &&
+    (file.write((const char*)aggros.constData(),
+		aggros.size() * sizeof(MapCompiledAggro)) ==
+     qint64(aggros.size() * sizeof(MapCompiledAggro))) &&
+    (file.write((const char*)points.constData(),
+		points.size() * sizeof(MapCompiledPoint)) ==
+     qint64(points.size() * sizeof(MapCompiledPoint))) &&
+    (file.write((const char*)strings.m_chars.constData(),
+		strings.m_chars.size() * sizeof(QChar)) ==
+     qint64(strings.m_chars.size() * sizeof(QChar)));
+  file.close();
+
+  if (!ok)
+  {
+    seqWarn("Error writing compiled map '%s'",
+	    file.fileName().toLatin1().data());
+    file.remove();
+    return;
+  }
+
+  QFile::remove(compiledName);
+  if (!file.rename(compiledName))
+    file.remove();
 }
 
 void MapData::saveMap(const QString& fileName, const uint8_t layerNum) const
@@ -1453,6 +2470,7 @@ void MapData::createNewLayer()
     layer->setFileName(fileName);
     m_mapLayers.append(layer);
     layer->setMapLoaded(true);
+    m_generation++;
     seqInfo("Create layer: '%s'", fileName.toLatin1().data());
 }
 
@@ -1487,6 +2505,7 @@ void MapData::addLocation(const QString& name,
   
   // add it to the list of locations
   m_mapLayers[m_editLayer]->locations().append(m_editLocation);
+  layerChanged(m_editLayer);
 }
 
 void MapData::setLocationName(const QString& name)
@@ -1497,6 +2516,10 @@ void MapData::setLocationName(const QString& name)
 
   // set the location name
   m_editLocation->setName(name);
+
+  // the label size is part of the index
+  if (m_editLayer < m_mapLayers.count())
+    layerChanged(m_editLayer);
 }
 
 void MapData::setLocationColor(const QString& color)
@@ -1507,6 +2530,8 @@ void MapData::setLocationColor(const QString& color)
 
   // set the location color
   m_editLocation->setColor(color);
+
+  m_generation++;
 }
 
 void MapData::startLine(const QString& name, 
@@ -1525,6 +2550,7 @@ void MapData::startLine(const QString& name,
 
   // add line to the line list
   m_mapLayers[m_editLayer]->mLines().append(m_editLineM);
+  layerChanged(m_editLayer);
 }
 
 void MapData::addLinePoint(const MapPoint& point)
@@ -1543,6 +2569,9 @@ void MapData::addLinePoint(const MapPoint& point)
 
   // calculate the XY bounds of the line
   m_editLineM->calcBounds();
+
+  if (m_editLayer < m_mapLayers.count())
+    layerChanged(m_editLayer);
 }
 
 void MapData::delLinePoint(void)
@@ -1571,6 +2600,8 @@ void MapData::delLinePoint(void)
     // calculate the XY bounds of the line
     m_editLineM->calcBounds();
   }
+
+  layerChanged(m_editLayer);
 }
 
 void MapData::setLineName(const QString& name)
@@ -1591,6 +2622,9 @@ void MapData::setLineColor(const QString& color)
 
   // set the line color
   m_editLineM->setColor(color);
+
+  // the line's segments move to the new color's pen
+  layerChanged(m_editLayer);
 }
 
 void MapData::scaleDownZ(int16_t factor)
@@ -1626,6 +2660,8 @@ void MapData::scaleDownZ(int16_t factor)
     for (i = 0; i < numPoints; i++)
       mData[i].setZPos(mData[i].z() / factor);
   }
+
+  layerChanged(m_editLayer);
 }
 
 void MapData::scaleUpZ(int16_t factor)
@@ -1661,6 +2697,8 @@ void MapData::scaleUpZ(int16_t factor)
     for (i = 0; i < numPoints; i++)
       mData[i].setZPos(mData[i].z() * factor);
   }
+
+  layerChanged(m_editLayer);
 }
 
 void MapData::paintGrid(MapParameters& param, QPainter& p) const
@@ -1682,6 +2720,15 @@ void MapData::paintGrid(MapParameters& param, QPainter& p) const
   const QRect& screenBounds = param.screenBounds();
   int lastGrid = (maxX() / gridres) + 1;
 
+  // extent of the grid lines, covering the bounds even when only part of
+  // the view is being painted (ie. a cache tile)
+  int gridTop = qMin(0, param.calcYOffsetI(screenBounds.bottom()));
+  int gridBottom = qMax(param.screenLengthY(),
+			param.calcYOffsetI(screenBounds.top()));
+  int gridLeft = qMin(0, param.calcXOffsetI(screenBounds.right()));
+  int gridRight = qMax(param.screenLengthX(),
+		       param.calcXOffsetI(screenBounds.left()));
+
   // start from the minimum position and increment to the last grid position
   for (int gx = (minX() / gridres) - 1; 
        gx <= lastGrid; 
@@ -1705,8 +2752,8 @@ void MapData::paintGrid(MapParameters& param, QPainter& p) const
     if (param.showGridLines())
     {
       p.setPen(param.gridLineColor());
-      p.drawLine(offsetPos, 0,
-		   offsetPos, param.screenLengthY());
+      p.drawLine(offsetPos, gridTop,
+		   offsetPos, gridBottom);
     }
     
     // if grid ticks are shown, draw them
@@ -1741,8 +2788,8 @@ void MapData::paintGrid(MapParameters& param, QPainter& p) const
     if (param.showGridLines())
     {
       p.setPen(param.gridLineColor());
-      p.drawLine(0, offsetPos,
-		   param.screenLengthX(), offsetPos);
+      p.drawLine(gridLeft, offsetPos,
+		   gridRight, offsetPos);
     }
     
     // if grid ticks are shown, draw thm
@@ -1755,6 +2802,20 @@ void MapData::paintGrid(MapParameters& param, QPainter& p) const
   }  
 }
 
+// add the segments of a run that cross the visible region to the batch
+static inline void batchSegments(MapParameters& param, MapLineBatch& batch,
+				 const QRect& screenBounds, int pen,
+				 const MapSegment* seg, int count)
+{
+  for (const MapSegment* end = seg + count; seg != end; ++seg)
+  {
+    if (crossesRect(screenBounds, seg->x1, seg->y1, seg->x2, seg->y2))
+      batch.add(pen,
+		param.calcXOffsetI(seg->x1), param.calcYOffsetI(seg->y1),
+		param.calcXOffsetI(seg->x2), param.calcYOffsetI(seg->y2));
+  }
+}
+
 void MapData::paintLines(MapParameters& param, QPainter& p) const
 {
   //----------------------------------------------------------------------
@@ -1765,136 +2826,83 @@ void MapData::paintLines(MapParameters& param, QPainter& p) const
   // Note: none of the map loops below check for zero length lines,
   // because all line manipulation code makes sure that they don't occur
 
-  // stuff used no matter how the map is drawn
-  MapLineL* currentLineL;
-  MapLineM* currentLineM;
-
   // set the brush
   p.setBrush(QColor (80, 80, 80));
 
   const QRect& screenBounds = param.screenBounds();
 
-  // determine which painting method is to be used.
   // no depth filtering, cool, let's make this quick and easy
-  bool lastInBounds;
-  bool curInBounds;
-  int16_t curX_1, curY_1;
-  int16_t curX_2, curY_2;
-  int cur2DX_1, cur2DY_1;
-  int cur2DX_2, cur2DY_2;
-  uint numPoints;
-  QPoint* lData;
-  MapPoint* mData;
-
-
   for (int i = 0; i < m_mapLayers.count(); ++i)
   {
     MapLayer* layer = m_mapLayers[i];
     if (!param.isLayerVisible(i))
         continue;
 
-    // first paint the L lines
-    QList<MapLineL*>::const_iterator mlit = layer->lLines().begin();
-    for (; mlit != layer->lLines().end(); ++mlit)
+    // only visit the lines in the buckets overlapping the screen
+    const MapLayerIndex& index = layer->index();
+
+    // the layer's segments, grouped by color
+    const MapLineSegments& segments = layer->segments();
+    const MapSegment* segData = segments.segments();
+    m_lineBatch.begin(p, segments.pens());
+
+    // first the L lines
+    const QList<MapLineL*>& lLines = layer->lLines();
+    index.lLinesIn(screenBounds, m_visible);
+    m_paintStats.linesCulled += lLines.size() - m_visible.size();
+    for (int j = 0; j < m_visible.size(); ++j)
     {
-        currentLineL = *mlit;
         // if line is outside the currently visible region, skip it.
-        if (!currentLineL->boundingRect().intersects(screenBounds))
+        if (!lLines[m_visible[j]]->boundingRect().intersects(screenBounds))
+        {
+        m_paintStats.linesCulled++;
         continue;
+        }
 
-        // get the number of points in the line
-        numPoints = currentLineL->size();
-
-        // get the underlying array
-        lData = currentLineL->data();
-
-        // set pen color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '%s'", (char *) currentLineL->color());
-    #endif
-        p.setPen(currentLineL->color());
-
-        cur2DX_1 = lData[0].x();
-        cur2DY_1 = lData[0].y();
-
-        // see if the starting position is in bounds
-        lastInBounds = inRect(screenBounds, cur2DX_1, cur2DY_1);
+        m_paintStats.linesDrawn++;
 
-        // iterate over all the points in the line
-        for (uint32_t i = 1; i < numPoints; i++)
-        {
-        cur2DX_2 = lData[i].x();
-        cur2DY_2 = lData[i].y();
-
-        // determine if the current position is in bounds
-        curInBounds = inRect(screenBounds, cur2DX_2, cur2DY_2);
-
-        // draw the line segment if either end is in bounds
-        if (lastInBounds || curInBounds)
-            p.drawLine(param.calcXOffsetI(cur2DX_1),
-                        param.calcYOffsetI(cur2DY_1),
-                        param.calcXOffsetI(cur2DX_2),
-                        param.calcYOffsetI(cur2DY_2));
-
-        // current becomes the last
-        lastInBounds = curInBounds;
-        cur2DX_1 = cur2DX_2;
-        cur2DY_1 = cur2DY_2;
-        }
+        const MapSegmentRun& run = segments.lRun(m_visible[j]);
+        batchSegments(param, m_lineBatch, screenBounds, run.pen,
+                      segData + run.first, run.count);
     }
 
-    // then paint the M lines
-    QList<MapLineM*>::const_iterator mmit = layer->mLines().begin();
-    for (; mmit != layer->mLines().end(); ++mmit)
+    // then the M lines
+    const QList<MapLineM*>& mLines = layer->mLines();
+    index.mLinesIn(screenBounds, m_visible);
+    m_paintStats.linesCulled += mLines.size() - m_visible.size();
+    for (int j = 0; j < m_visible.size(); ++j)
     {
-        currentLineM = *mmit;
         // if line is outside the currently visible region, skip it.
-        if (!currentLineM->boundingRect().intersects(screenBounds))
+        if (!mLines[m_visible[j]]->boundingRect().intersects(screenBounds))
+        {
+        m_paintStats.linesCulled++;
         continue;
+        }
 
-        // get the number of points in the line
-        numPoints = currentLineM->size();
-
-        // get the underlying array
-        mData = currentLineM->data();
-
-        // set pen color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '%s'", (char *) currentLineM->color());
-    #endif
-        p.setPen(currentLineM->color());
-
-        curX_1 = mData[0].x();
-        curY_1 = mData[0].y();
-
-        // see if the starting position is in bounds
-        lastInBounds = inRect(screenBounds, curX_1, curY_1);
+        m_paintStats.linesDrawn++;
 
-        // iterate over all the points in the line
-        for (uint32_t i = 1; i < numPoints; i++)
-        {
-        curX_2 = mData[i].x();
-        curY_2 = mData[i].y();
-
-        // determine if the current position is in bounds
-        curInBounds = inRect(screenBounds, curX_2, curY_2);
-
-        // draw the line segment if either end is in bounds
-        if (lastInBounds || curInBounds)
-            p.drawLine(param.calcXOffsetI(curX_1),
-                        param.calcYOffsetI(curY_1),
-                        param.calcXOffsetI(curX_2),
-                        param.calcYOffsetI(curY_2));
-
-        // current becomes the last
-        lastInBounds = curInBounds;
-        curX_1 = curX_2;
-        curY_1 = curY_2;
-        }
+        const MapSegmentRun& run = segments.mRun(m_visible[j]);
+        batchSegments(param, m_lineBatch, screenBounds, run.pen,
+                      segData + run.first, run.count);
     }
+
+    // and draw them
+    m_paintStats.lineDrawCalls += m_lineBatch.end();
   }
 }
 
+// the z bands within the head and floor room of the player, measured from
+// the middle of the player's band, so what's painted only changes when
+// the player crosses into another band
+static void playerBands(MapParameters& param, int& playerZ,
+			int& loBand, int& hiBand)
+{
+  playerZ = MapLineSegments::zBandCenter(
+    MapLineSegments::zBand(param.player().z()));
+  loBand = MapLineSegments::zBand(playerZ - param.floorRoom());
+  hiBand = MapLineSegments::zBand(playerZ + param.headRoom());
+}
+
 void MapData::paintDepthFilteredLines(MapParameters& param, QPainter& p) const
 {
   //----------------------------------------------------------------------
@@ -1905,28 +2913,14 @@ void MapData::paintDepthFilteredLines(MapParameters& param, QPainter& p) const
   // Note: none of the map loops below check for zero length lines,
   // because all line manipulation code makes sure that they don't occur
 
-  // stuff used no matter how the map is drawn
-  MapLineL* currentLineL;
-  MapLineM* currentLineM;
-
   // set the brush
   p.setBrush(QColor (80, 80, 80));
 
   const QRect& screenBounds = param.screenBounds();
 
   // map depth filtering, without faded floors
-  bool lastInBounds;
-  bool curInBounds;
-  int16_t curX_1, curY_1, curZ_1;
-  int16_t curX_2, curY_2, curZ_2;
-  int cur2DX_1, cur2DY_1;
-  int cur2DX_2, cur2DY_2;
-  uint32_t numPoints;
-  QPoint* lData;
-  MapPoint* mData;
-
-  // get the players position for it's Z information
-  MapPoint playerPos = param.player();
+  int playerZ, loBand, hiBand;
+  playerBands(param, playerZ, loBand, hiBand);
 
   for (int i = 0; i < m_mapLayers.count(); ++i)
   {
@@ -1934,122 +2928,70 @@ void MapData::paintDepthFilteredLines(MapParameters& param, QPainter& p) const
     if (!param.isLayerVisible(i))
         continue;
 
-    // first paint the L lines
-    QList<MapLineL*>::const_iterator mlit = layer->lLines().begin();
-    for (; mlit != layer->lLines().end(); ++mlit)
-    {
-        currentLineL = *mlit;
-        // if line is outside the currently visible region, skip it.
-        if (!currentLineL->boundingRect().intersects(screenBounds))
-        continue;
-
-        // since it's an L type line, check for the depth is easy
-        // just check if height is set, and if so, check if it's within range
-        if (currentLineL->heightSet() && 
-        !inRoom(param.playerHeadRoom(), param.playerFloorRoom(), 
-            currentLineL->z()))
-        continue;  // outside of range, continue to the next line
-
-        // get the number of points in the line
-        numPoints = currentLineL->size();
-
-        // get the underlying array
-        lData = currentLineL->data();
-
-        // set the line color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '%s'", (char *) currentLineL->color());
-    #endif
-        p.setPen(currentLineL->color());
-
-        cur2DX_1 = lData[0].x();
-        cur2DY_1 = lData[0].y();
-
-        // see if the starting position is in bounds
-        lastInBounds = inRect(screenBounds, cur2DX_1, cur2DY_1);
+    // the layer's segments, sorted into z bands
+    const MapLineSegments& segments = layer->segments();
+    const MapBandSegment* segData = segments.bandSegments();
+    m_lineBatch.begin(p, segments.pens());
 
-        // iterate over all the points in the line
-        for (uint32_t i = 1; i < numPoints; i++)
+    // L lines without a height are always shown
+    const MapBand& flat = segments.flatBand();
+    if (flat.bounds.intersects(screenBounds))
+    {
+      for (int r = flat.firstRun; r < flat.firstRun + flat.numRuns; ++r)
+      {
+        const MapSegmentRun& run = segments.bandRun(r);
+        const MapBandSegment* seg = segData + run.first;
+        const MapBandSegment* end = seg + run.count;
+        for (; seg != end; ++seg)
         {
-        cur2DX_2 = lData[i].x();
-        cur2DY_2 = lData[i].y();
-
-        // determine if the current position is in bounds
-        curInBounds = inRect(screenBounds, cur2DX_2, cur2DY_2);
-
-        // draw the line segment if either end is in bounds
-        if (lastInBounds || curInBounds)
-            p.drawLine(param.calcXOffsetI(cur2DX_1),
-                        param.calcYOffsetI(cur2DY_1),
-                        param.calcXOffsetI(cur2DX_2),
-                        param.calcYOffsetI(cur2DY_2));
-
-        // current becomes the last
-        lastInBounds = curInBounds;
-        cur2DX_1 = cur2DX_2;
-        cur2DY_1 = cur2DY_2;
+          if (crossesRect(screenBounds, seg->x1, seg->y1, seg->x2, seg->y2))
+            m_lineBatch.add(run.pen,
+                            param.calcXOffsetI(seg->x1),
+                            param.calcYOffsetI(seg->y1),
+                            param.calcXOffsetI(seg->x2),
+                            param.calcYOffsetI(seg->y2));
         }
+      }
     }
 
-    // then paint the M lines
-    QList<MapLineM*>::const_iterator mmit = layer->mLines().begin();
-    for (; mmit != layer->mLines().end(); ++mmit)
+    // then the bands within range
+    for (int b = segments.firstBand(loBand); b < segments.numBands(); ++b)
     {
-        currentLineM = *mmit;
-        // if line is outside the currently visible region, skip it.
-        if (!currentLineM->boundingRect().intersects(screenBounds))
-        continue;
-
-        // get the number of points in the line
-        numPoints = currentLineM->size();
-
-        // get the underlying array
-        mData = currentLineM->data();
-
-        // set the line color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '%s'", (char *) currentLineM->color());
-    #endif
-        p.setPen(currentLineM->color());
+      const MapBand& band = segments.band(b);
+      if (band.band > hiBand)
+        break;
 
-        // get current coordinates
-        curX_1 = mData[0].x();
-        curY_1 = mData[0].y();
-        curZ_1 = mData[0].z();
+      if (!band.bounds.intersects(screenBounds))
+      {
+        m_paintStats.bandsCulled++;
+        continue;
+      }
 
-        // see if the starting position is in bounds
-        lastInBounds = (inRect(screenBounds, curX_1, curY_1) &&
-                inRoom(param.playerHeadRoom(), param.playerFloorRoom(), curZ_1));
+      m_paintStats.bandsDrawn++;
 
-    #ifdef DEBUGMAP
-        seqDebug("Line has %i points:", currentLineM->size());
-    #endif
+      for (int r = band.firstRun; r < band.firstRun + band.numRuns; ++r)
+      {
+        const MapSegmentRun& run = segments.bandRun(r);
+        const MapBandSegment* seg = segData + run.first;
+        const MapBandSegment* end = seg + run.count;
 
-        // iterate over all the points in the line
-        for (uint32_t i = 1; i < numPoints; i++)
+        // draw the segments that cross the bounds with an end within range
+        for (; seg != end; ++seg)
         {
-        // get current coordinates
-        curX_2 = mData[i].x();
-        curY_2 = mData[i].y();
-        curZ_2 = mData[i].z();
-
-        // determine if the current position is in bounds
-        curInBounds = (inRect(screenBounds, curX_2, curY_2) &&
-                inRoom(param.playerHeadRoom(), param.playerFloorRoom(), curZ_2));
-
-        // draw the line segment if either end is in bounds
-        if (lastInBounds || curInBounds)
-            p.drawLine(param.calcXOffsetI(curX_1),
-                        param.calcYOffsetI(curY_1),
-                        param.calcXOffsetI(curX_2),
-                        param.calcYOffsetI(curY_2));
-
-        // current becomes the last
-        lastInBounds = curInBounds;
-        curX_1 = curX_2;
-        curY_1 = curY_2;
+          if ((((seg->band1 >= loBand) && (seg->band1 <= hiBand)) ||
+               ((seg->band2 >= loBand) && (seg->band2 <= hiBand))) &&
+              crossesRect(screenBounds, seg->x1, seg->y1, seg->x2, seg->y2))
+            m_lineBatch.add(run.pen,
+                            param.calcXOffsetI(seg->x1),
+                            param.calcYOffsetI(seg->y1),
+                            param.calcXOffsetI(seg->x2),
+                            param.calcYOffsetI(seg->y2));
         }
+      }
     }
+
+    // and draw them
+    m_paintStats.lineDrawCalls += m_lineBatch.end();
   }
 }
 
@@ -2063,34 +3005,39 @@ void MapData::paintFadedFloorsLines(MapParameters& param, QPainter& p) const
   // Note: none of the map loops below check for zero length lines,
   // because all line manipulation code makes sure that they don't occur
 
-  // stuff used no matter how the map is drawn
-  MapLineL* currentLineL;
-  MapLineM* currentLineM;
-
   // set the brush
   p.setBrush(QColor (80, 80, 80));
 
   const QRect& screenBounds = param.screenBounds();
 
-  // depth filtering with faded floors
-  int oldColor, newColor, useColor;
-  bool lastInBounds;
-  bool curInBounds;
-  int16_t curX_1, curY_1, curZ_1;
-  int16_t curX_2, curY_2, curZ_2;
-  int cur2DX_1, cur2DY_1, cur2DZ_1;
-  int cur2DX_2, cur2DY_2;
-  uint32_t numPoints;
-  QPoint* lData;
-  MapPoint* mData;
-
-  // get the players position for it's Z information
-  MapPoint playerPos = param.player();
+  // depth filtering with faded floors, which fade out to black at the
+  // edges of the head and floor room
+  int playerZ, loBand, hiBand;
+  playerBands(param, playerZ, loBand, hiBand);
 
   double topm = 0 - 255.0 / (double)param.headRoom();
   double botm = 255.0 / (double)param.floorRoom();
-  double topb = 255 - (topm * playerPos.z());
-  double botb = 255 - (botm * playerPos.z());
+  double topb = 255 - (topm * playerZ);
+  double botb = 255 - (botm * playerZ);
+
+  // the shade of each band within range, everything else being black
+  int numShades = hiBand - loBand + 1;
+  if (m_bandShades.size() < numShades)
+    m_bandShades.resize(numShades);
+  int* shades = m_bandShades.data();
+  for (int b = 0; b < numShades; ++b)
+  {
+    int z = MapLineSegments::zBandCenter(loBand + b);
+    int useColor;
+    if (z > playerZ)
+      useColor = (int)((z * topm) + topb);
+    else
+      useColor = (int)((z * botm) + botb);
+
+    if (useColor > 255) useColor = 255;
+    if (useColor < 0) useColor = 0;
+    shades[b] = useColor;
+  }
 
   for (int i = 0; i < m_mapLayers.count(); ++i)
   {
@@ -2098,160 +3045,77 @@ void MapData::paintFadedFloorsLines(MapParameters& param, QPainter& p) const
     if (!param.isLayerVisible(i))
         continue;
 
-    // first paint the L lines
-    QList<MapLineL*>::const_iterator mlit = layer->lLines().begin();
-    for (; mlit != layer->lLines().end(); ++mlit)
-    {
-        currentLineL = *mlit;
-        // if line is outside the currently visible region, skip it.
-        if (!currentLineL->boundingRect().intersects(screenBounds))
-        continue;
-
-        // get the number of points in the line
-        numPoints = currentLineL->size();
-
-        // get the underlying array
-        lData = currentLineL->data();
-
-        // get first point coordinates
-        cur2DX_1 = lData[0].x();
-        cur2DY_1 = lData[0].y();
-        cur2DZ_1 = currentLineL->z();
-
-        // color determination is different depending on if a height was set
-        if (!currentLineL->heightSet())
-        {
-        // set the line color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '%s'", (char *) currentLineL->color());
-    #endif
-        p.setPen(currentLineL->color());
-        }
-        else
-        {
-        // calculate color to use for the line (since L type, only do this once)
-        if (currentLineL->z() > playerPos.z())
-        useColor = (int)((cur2DZ_1 * topm) + topb);
-        else 
-        useColor = (int)((cur2DZ_1 * botm) + botb);
-
-        if (useColor > 255) useColor = 255;
-        if (useColor < 0) useColor = 0;
-
-        // set the line color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '#%2x%2x%2x'", useColor, useColor, useColor);
-    #endif
-        p.setPen(QColor(useColor, useColor, useColor));
-        }
-
-        // see if the starting position is in bounds
-        lastInBounds = inRect(screenBounds, cur2DX_1, cur2DY_1);
+    // the layer's segments, sorted into z bands, with the shades of gray
+    // as extra pens
+    const MapLineSegments& segments = layer->segments();
+    const MapBandSegment* segData = segments.bandSegments();
+    m_lineBatch.begin(p, segments.pens());
 
-        // iterate over all the points in the line
-        for (uint32_t i = 1; i < numPoints; i++)
+    // L lines without a height keep their own color
+    const MapBand& flat = segments.flatBand();
+    if (flat.bounds.intersects(screenBounds))
+    {
+      for (int r = flat.firstRun; r < flat.firstRun + flat.numRuns; ++r)
+      {
+        const MapSegmentRun& run = segments.bandRun(r);
+        const MapBandSegment* seg = segData + run.first;
+        const MapBandSegment* end = seg + run.count;
+        for (; seg != end; ++seg)
         {
-        // get coordinates
-        cur2DX_2 = lData[i].x();
-        cur2DY_2 = lData[i].y();
-
-        // determine if the current position is in bounds
-        curInBounds = inRect(screenBounds, cur2DX_2, cur2DY_2);
-
-        // draw the line segment if either end is in bounds
-        if (lastInBounds || curInBounds)
-            p.drawLine(param.calcXOffsetI(cur2DX_1),
-                        param.calcYOffsetI(cur2DY_1),
-                        param.calcXOffsetI(cur2DX_2),
-                        param.calcYOffsetI(cur2DY_2));
-
-        // current becomes the last
-        lastInBounds = curInBounds;
-        cur2DX_1 = cur2DX_2;
-        cur2DY_1 = cur2DY_2;
+          if (crossesRect(screenBounds, seg->x1, seg->y1, seg->x2, seg->y2))
+            m_lineBatch.add(run.pen,
+                            param.calcXOffsetI(seg->x1),
+                            param.calcYOffsetI(seg->y1),
+                            param.calcXOffsetI(seg->x2),
+                            param.calcYOffsetI(seg->y2));
         }
+      }
     }
 
-    // then paint the M lines
-    QList<MapLineM*>::const_iterator mmit = layer->mLines().begin();
-    for (; mmit != layer->mLines().end(); ++mmit)
+    // then the bands within range, shaded by the bands of their ends
+    for (int b = segments.firstBand(loBand); b < segments.numBands(); ++b)
     {
-        currentLineM = *mmit;
-        // if line is outside the currently visible region, skip it.
-        if (!currentLineM->boundingRect().intersects(screenBounds))
-        continue;
-
-        // get the number of points in the line
-        numPoints = currentLineM->size();
-
-        // get the underlying array
-        mData = currentLineM->data();
-
-        // set the line color
-    #ifdef DEBUGMAP
-        seqDebug("lineColor = '%s'", (char *) currentLineM->color());
-    #endif
-        p.setPen(currentLineM->color());
+      const MapBand& band = segments.band(b);
+      if (band.band > hiBand)
+        break;
 
-        // get starting point coordinates
-        curX_1 = mData[0].x();
-        curY_1 = mData[0].y();
-        curZ_1 = mData[0].z();
-
-        // see if the starting position is in bounds
-        lastInBounds = inRect(screenBounds, curX_1, curY_1);
-
-    #ifdef DEBUGMAP
-        seqDebug("Line has %i points:", currentLineM->size());
-    #endif
-
-        // calculate starting color info for the line
-        if (curZ_1 > playerPos.z()) 
-        oldColor = (int)((curZ_1 * topm) + topb);
-        else 
-        oldColor = (int)((curZ_1 * botm) + botb);
+      if (!band.bounds.intersects(screenBounds))
+      {
+        m_paintStats.bandsCulled++;
+        continue;
+      }
 
-        if (oldColor > 255) oldColor = 255;
-        if (oldColor < 0) oldColor = 0;
+      m_paintStats.bandsDrawn++;
 
-        // iterate over all the points in the line
-        for (uint i = 1; i < numPoints; i++)
-        {
-        curX_2 = mData[i].x();
-        curY_2 = mData[i].y();
-        curZ_2 = mData[i].z();
-
-        // calculate the new color
-        if (curZ_2 > playerPos.z()) 
-        newColor = (int)((curZ_2 * topm) + topb);
-        else 
-        newColor = (int)((curZ_2 * botm) + botb);
-        if (newColor > 255) newColor = 255;
-        if (newColor < 0) newColor = 0;
-
-        // determine if the current position is in bounds
-        curInBounds = inRect(screenBounds, curX_2, curY_2);
-
-        // the use color is the average of the two colors
-        useColor = (newColor + oldColor) >> 1;
-
-        // draw the line segment if either end is in bounds
-        if ((lastInBounds || curInBounds) && (useColor != 0))
+      for (int r = band.firstRun; r < band.firstRun + band.numRuns; ++r)
+      {
+        const MapSegmentRun& run = segments.bandRun(r);
+        const MapBandSegment* seg = segData + run.first;
+        const MapBandSegment* end = seg + run.count;
+        for (; seg != end; ++seg)
         {
-            p.setPen(QColor(useColor, useColor, useColor));
-            p.drawLine(param.calcXOffsetI(curX_1),
-                        param.calcYOffsetI(curY_1),
-                        param.calcXOffsetI(curX_2),
-                        param.calcYOffsetI(curY_2));
-        }
-
-        // current becomes the last/old
-        lastInBounds = curInBounds;
-        oldColor = newColor;
-        curX_1 = curX_2;
-        curY_1 = curY_2;
+          // the use color is the average of the two ends' colors
+          int b1 = seg->band1 - loBand;
+          int b2 = seg->band2 - loBand;
+          int useColor =
+            (((b1 >= 0) && (b1 < numShades)) ? shades[b1] : 0) +
+            (((b2 >= 0) && (b2 < numShades)) ? shades[b2] : 0);
+          useColor >>= 1;
+
+          // draw the line segment if it crosses the bounds
+          if ((useColor != 0) &&
+              crossesRect(screenBounds, seg->x1, seg->y1, seg->x2, seg->y2))
+            m_lineBatch.add(segments.grayPen(useColor),
+                            param.calcXOffsetI(seg->x1),
+                            param.calcYOffsetI(seg->y1),
+                            param.calcXOffsetI(seg->x2),
+                            param.calcYOffsetI(seg->y2));
         }
+      }
     }
+
+    // and draw them
+    m_paintStats.lineDrawCalls += m_lineBatch.end();
   }
 }
 
@@ -2267,6 +3131,7 @@ void MapData::paintLocations(MapParameters& param, QPainter& p) const
 
   // set the font
   p.setFont(param.font());
+  QFontMetrics fm(param.font());
 
   for (int i = 0; i < m_mapLayers.count(); ++i)
   {
@@ -2274,11 +3139,22 @@ void MapData::paintLocations(MapParameters& param, QPainter& p) const
     if (!param.isLayerVisible(i))
         continue;
 
-    // iterate over all the map locations
-    QList<MapLocation*>::const_iterator lit = layer->locations().begin();
-    for (; lit != layer->locations().end(); ++lit)
+    // only visit the locations in the buckets overlapping the screen,
+    // widened by the largest label so partially visible labels still draw
+    const MapLayerIndex& index = layer->index();
+    const QList<MapLocation*>& locations = layer->locations();
+    int marginX = int(((fm.maxWidth() * index.maxLocationNameLength()) + 2) *
+                      param.ratio());
+    int marginY = int((fm.height() + 2) * param.ratio());
+    index.locationsIn(param.screenBounds().adjusted(-marginX, -marginY,
+                                                    marginX, marginY),
+                      m_visible);
+    m_paintStats.locationsCulled += locations.size() - m_visible.size();
+
+    // iterate over the map locations
+    for (int j = 0; j < m_visible.size(); ++j)
     {
-        MapLocation* currentLoc = *lit;
+        MapLocation* currentLoc = locations[m_visible[j]];
 
         if (param.mapLineStyle() == tMap_DepthFiltered && currentLoc->heightSet() &&
                 !inRoom(param.playerHeadRoom(), param.playerFloorRoom(), currentLoc->z()))
@@ -2298,6 +3174,8 @@ void MapData::paintLocations(MapParameters& param, QPainter& p) const
         p.drawText(param.calcXOffsetI(currentLoc->x()) - 2,
             param.calcYOffsetI(currentLoc->y()) - 2, 
             currentLoc->name());
+
+        m_paintStats.locationsDrawn++;
     }
   }
 }
@@ -2319,17 +3197,113 @@ bool MapData::paintMapImage(MapParameters& param, QPainter& p) const
   int x = param.calcXOffset(m_maxX);
   int y = param.calcYOffset(m_maxY);
 
-  p.drawPixmap(x, y, m_image);
+  p.drawImage(x, y, m_image);
   p.restore();
 
   return true;
 }
 
 //----------------------------------------------------------------------
-// MapCache
-MapCache::MapCache(const MapData& mapData)
+// MapTileStore
+
+// default memory budget for the tiles, in kilobytes
+static const int defaultTileBudget = 32 * 1024;
+
+// what a tile costs against the budget, in kilobytes
+static const int tileCost = (MapCache::tileSize * MapCache::tileSize * 4) / 1024;
+
+// integer division rounding towards negative infinity
+static inline int floorDiv(int a, int b)
+{
+  return (a >= 0) ? (a / b) : -((-a + b - 1) / b);
+}
+
+MapTileStore::MapTileStore(const MapData& mapData)
   : m_mapData(mapData),
-    m_lastParam(mapData)
+    m_generation(mapData.generation()),
+    m_tiles(defaultTileBudget)
+{
+}
+
+MapTileStore::~MapTileStore()
+{
+}
+
+bool MapTileStore::sameStyle(const MapParameters& a,
+			     const MapParameters& b) const
+{
+  if ((a.mapLineStyle() != b.mapLineStyle()) ||
+      (a.showLocations() != b.showLocations()) ||
+      (a.showLines() != b.showLines()) ||
+      (a.showGridLines() != b.showGridLines()) ||
+      (a.gridResolution() != b.gridResolution()) ||
+      (a.showBackgroundImage() != b.showBackgroundImage()) ||
+      (a.gridLineColor() != b.gridLineColor()) ||
+      (a.backgroundColor() != b.backgroundColor()) ||
+      (a.font() != b.font()))
+    return false;
+
+  // the depth styles paint relative to the player's room
+  if ((a.fadeFloors() || a.depthFiltering()) &&
+      ((a.headRoom() != b.headRoom()) || (a.floorRoom() != b.floorRoom())))
+    return false;
+
+  // the background image is stretched to the view, not to the map scale
+  if (a.showBackgroundImage() && m_mapData.imageLoaded() &&
+      ((a.screenLength() != b.screenLength()) || (a.zoom() != b.zoom())))
+    return false;
+
+  for (int i = 0; i < m_mapData.numLayers(); ++i)
+  {
+    if (a.isLayerVisible(i) != b.isLayerVisible(i))
+      return false;
+  }
+
+  return true;
+}
+
+int MapTileStore::styleId(const MapParameters& param)
+{
+  // a new or reloaded map makes all of the tiles useless
+  if (m_generation != m_mapData.generation())
+  {
+    m_tiles.clear();
+    m_styles.clear();
+    m_generation = m_mapData.generation();
+  }
+
+  for (int i = 0; i < m_styles.size(); ++i)
+  {
+    if (sameStyle(m_styles[i], param))
+      return i;
+  }
+
+  // too many settings have come and gone, start over
+  if (m_styles.size() >= maxStyles)
+  {
+    m_tiles.clear();
+    m_styles.clear();
+  }
+
+  m_styles.append(param);
+
+  return m_styles.size() - 1;
+}
+
+void MapTileStore::insert(const MapTileKey& key, QPixmap* tile)
+{
+  m_tiles.insert(key, tile, tileCost);
+}
+
+//----------------------------------------------------------------------
+// MapCache
+MapCache::MapCache(MapTileStore& store)
+  : m_store(store),
+    m_mapData(store.mapData()),
+    m_lastParam(store.mapData()),
+    m_lastGeneration(0),
+    m_tilesPainted(0),
+    m_tilesReused(0)
 {
 #ifdef DEBUG
   m_paintCount = 0;
@@ -2342,29 +3316,29 @@ MapCache::~MapCache()
 {
 }
 
-bool MapCache::needRepaint(MapParameters& param)
+void MapCache::setTileBudget(int kilobytes)
 {
-  // if any of these conditions are true, then a repaint is needed
-  // NOTE: May need to add more conditions
-  if (!m_painted || m_alwaysRepaint ||
-      (m_lastParam.screenCenter() != param.screenCenter()) ||
+  // the tiles are shared, so they get the biggest budget any map asks for
+  if (kilobytes > m_store.budget())
+    m_store.setBudget(kilobytes);
+}
+
+bool MapCache::settingsChanged(MapParameters& param)
+{
+  // if any of these conditions are true, none of the tiles can be reused
+  if ((m_lastGeneration != m_mapData.generation()) ||
       (m_lastParam.screenLength() != param.screenLength()) ||
-      (m_lastParam.ratio() != param.ratio()) ||
       (m_lastParam.zoomMapLength() != param.zoomMapLength()) ||
-      (m_lastParam.screenBounds() != param.screenBounds() ) ||
-      ((param.mapLineStyle() == tMap_FadedFloors) && 
-       (m_lastParam.player().z() != param.player().z())) ||
-      ((param.mapLineStyle() == tMap_DepthFiltered) &&
-       ((m_lastParam.playerHeadRoom() != param.playerHeadRoom()) ||
-	(m_lastParam.playerFloorRoom() != param.playerFloorRoom()))) ||
+      ((param.fadeFloors() || param.depthFiltering()) &&
+       ((m_lastParam.headRoom() != param.headRoom()) ||
+	(m_lastParam.floorRoom() != param.floorRoom()))) ||
       (m_lastParam.mapLineStyle() != param.mapLineStyle()) ||
       (m_lastParam.showLocations() != param.showLocations()) ||
       (m_lastParam.showLines() != param.showLines()) ||
       (m_lastParam.showGridLines() != param.showGridLines()) ||
-      (m_lastParam.showGridTicks() != param.showGridTicks()) || 
+      (m_lastParam.gridResolution() != param.gridResolution()) ||
       (m_lastParam.showBackgroundImage() != param.showBackgroundImage()) ||
       (m_lastParam.gridLineColor() != param.gridLineColor()) ||
-      (m_lastParam.gridTickColor() != param.gridTickColor()) || 
       (m_lastParam.backgroundColor() != param.backgroundColor()) || 
       (m_lastParam.font() != param.font()))
     return true;
@@ -2375,6 +3349,33 @@ bool MapCache::needRepaint(MapParameters& param)
           return true;
   }
 
+  return false;
+}
+
+int MapCache::tileZ(MapParameters& param) const
+{
+  // only the depth dependent line styles need tiles per player depth,
+  // and those only change when the player moves to another z band
+  if (param.fadeFloors() || param.depthFiltering())
+    return MapLineSegments::zBand(param.player().z());
+
+  return 0;
+}
+
+bool MapCache::needRepaint(MapParameters& param)
+{
+  // if any of these conditions are true, then a repaint is needed
+  // NOTE: May need to add more conditions
+  if (!m_painted || m_alwaysRepaint ||
+      (m_lastParam.screenCenter() != param.screenCenter()) ||
+      (m_lastParam.ratio() != param.ratio()) ||
+      (m_lastParam.screenBounds() != param.screenBounds()) ||
+      (tileZ(m_lastParam) != tileZ(param)) ||
+      (m_lastParam.showGridTicks() != param.showGridTicks()) ||
+      (m_lastParam.gridTickColor() != param.gridTickColor()) ||
+      settingsChanged(param))
+    return true;
+
   // if none of the above conditions is true, no need to repaint.
   return false;
 }
@@ -2391,29 +3392,136 @@ const QPixmap& MapCache::getMapImage(MapParameters& param)
 #endif
 
   // make sure the map is the correct size
-  m_mapImage = QPixmap(param.screenLength());
+  if (m_mapImage.size() != param.screenLength())
+    m_mapImage = QPixmap(param.screenLength());
+
+  // count what gets drawn/culled in this paint
+  m_mapData.resetPaintStats();
+
+  // the grid ticks run along the edges of the view, so they're painted
+  // over the composited tiles instead of into them
+  MapParameters staticParam(param);
+  staticParam.setShowGridTicks(false);
 
   QPainter tmp;
 
   // Begin Painting
   tmp.begin (&m_mapImage);
-  tmp.setPen (Qt::NoPen);
-  tmp.setFont (param.font());
 
-  // load the background image or paint the background
-  if (!m_mapData.imageLoaded() || 
-      !param.showBackgroundImage() ||
-      !m_mapData.paintMapImage(param, tmp))
+  if (m_alwaysRepaint)
+  {
+    // paint the whole view directly
+    paintStatic(staticParam, tmp, m_mapImage.rect());
+  }
+  else
+  {
+    // the tile grid at this scale has map position 0,0 at its origin,
+    // which is at the screen center position on the screen
+    int centerX = param.screenCenterX();
+    int centerY = param.screenCenterY();
+    int firstX = floorDiv(-centerX, tileSize);
+    int lastX = floorDiv(param.screenLengthX() - 1 - centerX, tileSize);
+    int firstY = floorDiv(-centerY, tileSize);
+    int lastY = floorDiv(param.screenLengthY() - 1 - centerY, tileSize);
+
+    MapTileKey key;
+    key.style = m_store.styleId(staticParam);
+    key.ratio = param.ratioIFixPt();
+    key.z = tileZ(param);
+
+    for (key.y = firstY; key.y <= lastY; key.y++)
+    {
+      for (key.x = firstX; key.x <= lastX; key.x++)
+      {
+	QPixmap* tile = m_store.tile(key);
+	if (tile)
+	{
+	  m_tilesReused++;
+	  tmp.drawPixmap(centerX + (key.x * tileSize),
+			 centerY + (key.y * tileSize), *tile);
+	  continue;
+	}
+
+	// paint the newly exposed tile, and keep it for later
+	tile = paintTile(staticParam, key);
+	tmp.drawPixmap(centerX + (key.x * tileSize),
+		       centerY + (key.y * tileSize), *tile);
+	m_store.insert(key, tile);
+      }
+    }
+  }
+
+  if (param.showGridTicks())
   {
-    // paint the map backdrop with the users background color for all 
-    // map line styles except faded floor, which only really works with
-    // a black background
-    if (param.mapLineStyle() != tMap_FadedFloors)
-      tmp.fillRect(m_mapImage.rect(), param.backgroundColor());
-    else 
-      tmp.fillRect(m_mapImage.rect(), Qt::black);
+    MapParameters tickParam(param);
+    tickParam.setShowGridLines(false);
+    tmp.setFont(param.font());
+    m_mapData.paintGrid(tickParam, tmp);
   }
 
+  // finished painting
+  tmp.end();
+
+  // note that painting has been done
+  m_painted = true;
+
+  // note parameters used to paint, for later comparison
+  m_lastParam = param;
+  m_lastGeneration = m_mapData.generation();
+
+  // return the map image
+  return m_mapImage;
+}
+
+QPixmap* MapCache::paintTile(MapParameters& param, const MapTileKey& key)
+{
+  QPixmap* tile = new QPixmap(tileSize, tileSize);
+
+  // where the tile currently is on the screen
+  int originX = param.screenCenterX() + (key.x * tileSize);
+  int originY = param.screenCenterY() + (key.y * tileSize);
+
+  // restrict painting to the part of the map under the tile, with a
+  // little slack for rounding
+  MapParameters tileParam(param);
+  int slack = int(param.ratio()) + 2;
+  QRect bounds(QPoint(param.invertXOffset(originX + tileSize),
+		      param.invertYOffset(originY + tileSize)),
+	       QPoint(param.invertXOffset(originX),
+		      param.invertYOffset(originY)));
+  tileParam.setScreenBounds(bounds.normalized().adjusted(-slack, -slack,
+							 slack, slack));
+
+  // paint it in screen coordinates, shifted onto the tile
+  QPainter tmp;
+  tmp.begin(tile);
+  tmp.translate(-originX, -originY);
+  paintStatic(tileParam, tmp, QRect(originX, originY, tileSize, tileSize));
+  tmp.end();
+
+  m_tilesPainted++;
+
+  return tile;
+}
+
+void MapCache::paintStatic(MapParameters& param, QPainter& tmp,
+			   const QRect& area)
+{
+  tmp.setPen (Qt::NoPen);
+  tmp.setFont (param.font());
+
+  // paint the map backdrop with the users background color for all
+  // map line styles except faded floor, which only really works with
+  // a black background
+  if (param.mapLineStyle() != tMap_FadedFloors)
+    tmp.fillRect(area, param.backgroundColor());
+  else
+    tmp.fillRect(area, Qt::black);
+
+  // then the background image, if there is one
+  if (m_mapData.imageLoaded() && param.showBackgroundImage())
+    m_mapData.paintMapImage(param, tmp);
+
   tmp.setPen (QColor (80, 80, 80));
   tmp.setBrush (QColor (80, 80, 80));
 
@@ -2449,16 +3557,4 @@ const QPixmap& MapCache::getMapImage(MapParameters& param)
   /* Paint the locations */
   if (param.showLocations())
     m_mapData.paintLocations(param, tmp);
-
-  // finished painting
-  tmp.end();
-
-  // note that painting has been done
-  m_painted = true;
-
-  // note parameters used to paint, for later comparison
-  m_lastParam = param;
-
-  // return the map image
-  return m_mapImage;
 }
@@ -45,8 +45,13 @@
 #include <QColor>
 #include <QFont>
 #include <QPixmap>
+#include <QImage>
 #include <QList>
+#include <QVector>
+#include <QCache>
 #include <QPolygon>
+#include <QLine>
+#include <QPainter>
 
 #include "mapcolors.h"
 #include "point.h"
@@ -175,6 +180,9 @@ class MapParameters
   void setHeadRoom(int16_t headRoom);
   void setFloorRoom(int16_t floorRoom);
   void setLayerVisibility(uint8_t layerNum, bool isVisible);
+
+  // restrict painting to part of the view, eg. for a cache tile
+  void setScreenBounds(const QRect& bounds) { m_screenBounds = bounds; }
   
   void reAdjust(MapPoint* targetPoint);
   void reAdjust();
@@ -514,6 +522,188 @@ class MapAggro
   uint16_t m_range;
 };
 
+//----------------------------------------------------------------------
+// MapLayerIndex
+//
+// Uniform grid of buckets holding the indexes of a layer's lines and
+// locations, so that painting only visits what overlaps the visible part
+// of the map instead of testing every line of the zone.
+class MapLayerIndex
+{
+ public:
+  MapLayerIndex();
+
+  void build(MapLayer& layer);
+  void clear();
+
+  // indexes, in list order, of the items whose bounds may intersect rect
+  void lLinesIn(const QRect& rect, QVector<int>& result) const
+    { query(tLLines, rect, result); }
+  void mLinesIn(const QRect& rect, QVector<int>& result) const
+    { query(tMLines, rect, result); }
+  void locationsIn(const QRect& rect, QVector<int>& result) const
+    { query(tLocations, rect, result); }
+
+  int maxLocationNameLength() const { return m_maxLocationNameLength; }
+
+ protected:
+  enum Kind { tLLines = 0, tMLines, tLocations, tNumKinds };
+
+  void insert(Kind kind, int index, const QRect& bounds);
+  void query(Kind kind, const QRect& rect, QVector<int>& result) const;
+
+  QRect m_bounds;
+  int m_cellSize;
+  int m_columns;
+  int m_rows;
+  QVector<QVector<int> > m_cells[tNumKinds];
+
+  // used to drop duplicates of items that span several buckets
+  mutable QVector<uint32_t> m_seen[tNumKinds];
+  mutable uint32_t m_stamp;
+
+  int m_maxLocationNameLength;
+};
+
+//----------------------------------------------------------------------
+// MapLineSegments
+//
+// A layer's lines broken up into segments when the layer is loaded, with
+// the segments of each pen color stored together.  Each line's segments
+// are a contiguous run, so the spatial index can still pick out the lines
+// to paint, and painting can submit the segments a pen at a time.
+//
+// The depth dependent line styles use a second copy of the segments,
+// sorted into bands of zBandHeight by the z of their lower end, so that
+// painting can binary search for the bands around the player and work out
+// the faded floor shades once per band instead of once per segment.
+struct MapSegment
+{
+  int16_t x1, y1;
+  int16_t x2, y2;
+};
+
+struct MapBandSegment
+{
+  int16_t x1, y1, band1;
+  int16_t x2, y2, band2;
+};
+
+struct MapSegmentRun
+{
+  int first;
+  int count;
+  int pen;
+};
+
+struct MapBand
+{
+  int band;
+  QRect bounds;
+  int firstRun;
+  int numRuns;
+};
+
+class MapLineSegments
+{
+ public:
+  MapLineSegments();
+
+  void build(MapLayer& layer);
+  void clear();
+
+  const MapSegment* segments() const { return m_segments.constData(); }
+  int numSegments() const { return m_segments.size(); }
+  const MapSegmentRun& lRun(int line) const { return m_lRuns[line]; }
+  const MapSegmentRun& mRun(int line) const { return m_mRuns[line]; }
+
+  // the segments by z band, the bands in increasing order
+  const MapBandSegment* bandSegments() const
+    { return m_bandSegments.constData(); }
+  const MapSegmentRun& bandRun(int run) const { return m_bandRuns[run]; }
+  int numBands() const { return m_bands.size(); }
+  const MapBand& band(int i) const { return m_bands[i]; }
+  int firstBand(int band) const;
+
+  // the segments of L lines that don't have a height
+  const MapBand& flatBand() const { return m_flatBand; }
+
+  enum { zBandHeight = 10 };
+  static int zBand(int z)
+    { return (z >= 0) ? (z / zBandHeight) :
+	-((-z + zBandHeight - 1) / zBandHeight); }
+  static int zBandCenter(int band)
+    { return (band * zBandHeight) + (zBandHeight / 2); }
+
+  // the layer's line colors, followed by the shades of gray used by
+  // faded floors
+  const QVector<QColor>& pens() const { return m_pens; }
+  int grayPen(int shade) const { return m_grayBase + shade; }
+
+ protected:
+  void buildBands(MapLayer& layer);
+
+  QVector<MapSegment> m_segments;
+  QVector<MapSegmentRun> m_lRuns;
+  QVector<MapSegmentRun> m_mRuns;
+  QVector<MapBandSegment> m_bandSegments;
+  QVector<MapSegmentRun> m_bandRuns;
+  QVector<MapBand> m_bands;
+  MapBand m_flatBand;
+  int m_maxBandSpan;
+  QVector<QColor> m_pens;
+  int m_grayBase;
+};
+
+//----------------------------------------------------------------------
+// MapLineBatch
+//
+// Collects the screen space segments of one paint by pen, then draws
+// each pen's segments with a single drawLines().  When not batched the
+// segments are drawn as they come, the way the map used to be painted,
+// which is only kept around for comparison.
+class MapLineBatch
+{
+ public:
+  MapLineBatch();
+
+  bool batched() const { return m_batched; }
+  void setBatched(bool val) { m_batched = val; }
+
+  void begin(QPainter& p, const QVector<QColor>& pens);
+  void add(int pen, int x1, int y1, int x2, int y2);
+  int end();
+
+ protected:
+  QVector<QVector<QLine> > m_lines;
+  QVector<int> m_used;
+  QPainter* m_painter;
+  const QVector<QColor>* m_pens;
+  int m_lastPen;
+  int m_drawCalls;
+  bool m_batched;
+};
+
+inline void MapLineBatch::add(int pen, int x1, int y1, int x2, int y2)
+{
+  if (m_batched)
+  {
+    QVector<QLine>& lines = m_lines[pen];
+    if (lines.isEmpty())
+      m_used.append(pen);
+    lines.append(QLine(x1, y1, x2, y2));
+    return;
+  }
+
+  if (pen != m_lastPen)
+  {
+    m_painter->setPen((*m_pens)[pen]);
+    m_lastPen = pen;
+  }
+  m_painter->drawLine(x1, y1, x2, y2);
+  m_drawCalls++;
+}
+
 //----------------------------------------------------------------------
 // MapLayer
 class MapLayer
@@ -525,6 +715,9 @@ class MapLayer
     QList<MapLineL*>& lLines() { return m_lLines; }
     QList<MapLineM*>& mLines() { return m_mLines; }
     QList<MapLocation*>& locations() { return m_locations; }
+    const MapLayerIndex& index();
+    const MapLineSegments& segments();
+    void invalidateIndex() { m_indexValid = false; m_segmentsValid = false; }
     void setFileName(QString fileName) { m_fileName = fileName; }
     QString fileName() const { return m_fileName; }
     bool mapLoaded() const { return m_mapLoaded; }
@@ -536,9 +729,53 @@ class MapLayer
     QList<MapLocation*> m_locations;
     QString m_fileName;
     bool m_mapLoaded;
+    MapLayerIndex m_index;
+    bool m_indexValid;
+    MapLineSegments m_segments;
+    bool m_segmentsValid;
 
 };
 
+inline const MapLayerIndex& MapLayer::index()
+{
+  // (re)build the index the first time it's needed after a change
+  if (!m_indexValid)
+  {
+    m_index.build(*this);
+    m_indexValid = true;
+  }
+
+  return m_index;
+}
+
+inline const MapLineSegments& MapLayer::segments()
+{
+  // regroup the segments the first time they're needed after a change
+  if (!m_segmentsValid)
+  {
+    m_segments.build(*this);
+    m_segmentsValid = true;
+  }
+
+  return m_segments;
+}
+
+//----------------------------------------------------------------------
+// MapPaintStats
+//
+// What the last paint of the static map layer drew versus what the
+// spatial index and z bands let it skip, for the debug overlay
+struct MapPaintStats
+{
+  int linesDrawn;
+  int linesCulled;
+  int bandsDrawn;
+  int bandsCulled;
+  int locationsDrawn;
+  int locationsCulled;
+  int lineDrawCalls;
+};
+
 //----------------------------------------------------------------------
 // MapData
 class MapData
@@ -556,6 +793,18 @@ class MapData
   void saveSOEMap(const QString& fileName, const uint8_t layerNum) const;
   void createNewLayer();
 
+  // directory to keep compiled copies of loaded maps in, none if empty
+  const QString& compiledDir() const { return m_compiledDir; }
+  void setCompiledDir(const QString& dir) { m_compiledDir = dir; }
+
+  // exchange everything loaded with another MapData, so a map loaded in
+  // the background can be put in place in one step
+  void swap(MapData& other);
+
+  // take a copy of the SOE map color preferences, so SOE maps can then be
+  // loaded off the GUI thread
+  void loadSOEColors();
+
   // accessors
   const QString& zoneShortName() const { return m_zoneShortName; }
   const QString& zoneLongName() const { return m_zoneLongName; }
@@ -569,9 +818,18 @@ class MapData
   MapLayer* mapLayer(uint8_t layerNum);
   uint8_t numLayers() const { return m_mapLayers.count(); }
   QList<MapAggro*>& aggros() { return m_aggros; }
-  const QPixmap& image() const { return m_image; }
+  const QImage& image() const { return m_image; }
   bool imageLoaded() const { return m_imageLoaded; }
   bool isAggro(const QString& name, uint16_t* range) const;
+  const MapPaintStats& paintStats() const { return m_paintStats; }
+
+  // changes whenever anything that affects the painted map changes
+  uint32_t generation() const { return m_generation; }
+  void resetPaintStats() const;
+
+  // submit line segments a pen at a time (the default), or one at a time
+  bool batchLines() const { return m_lineBatch.batched(); }
+  void setBatchLines(bool val) { m_lineBatch.setBatched(val); }
 
   // make sure map is big enough, returns true if size modified
   bool checkPos(int16_t x, int16_t y);
@@ -593,6 +851,7 @@ class MapData
   void scaleDownZ(int16_t factor);
   void scaleUpZ(int16_t factor);
   void setEditLayer(uint8_t layerNum) { m_editLayer = layerNum; }
+  void layerChanged(uint8_t layerNum);
   uint8_t editLayer() const { return m_editLayer; }
 
   // map painting
@@ -604,6 +863,13 @@ class MapData
   bool paintMapImage(MapParameters& param, QPainter& p) const;
 
  private:
+  void layerLoaded(MapLayer* layer, const QString& fileName);
+  QColor soeMapColor(uint8_t r, uint8_t g, uint8_t b) const;
+  QString compiledFileName(const QString& fileName) const;
+  bool loadCompiledMap(const QString& fileName, bool soe, MapLayer* layer);
+  void saveCompiledMap(const QString& fileName, bool soe, MapLayer* layer,
+		       int firstAggro, bool zemSet) const;
+
   int16_t m_minX;
   int16_t m_minY;
   int16_t m_maxX;
@@ -617,9 +883,16 @@ class MapData
   MapLocation* m_editLocation;
   QList<MapAggro*> m_aggros;
   uint8_t m_zoneZEM;
-  QPixmap m_image;
+  QImage m_image;
   bool m_imageLoaded;
   uint8_t m_editLayer;
+  uint32_t m_generation;
+  QString m_compiledDir;
+  QVector<QColor> m_soeColors;
+  mutable MapPaintStats m_paintStats;
+  mutable QVector<int> m_visible;
+  mutable QVector<int> m_bandShades;
+  mutable MapLineBatch m_lineBatch;
 };
 
 inline
@@ -681,14 +954,86 @@ void MapData::updateBounds()
   m_boundingRect =  QRect(QPoint(m_minX, m_minY), QPoint(m_maxX, m_maxY));
   m_size.setWidth(m_boundingRect.width());
   m_size.setHeight(m_boundingRect.height());
+  m_generation++;
+}
+
+//----------------------------------------------------------------------
+// MapTileKey
+//
+// Identifies one tile of the static map layer: the display settings
+// (MapTileStore style) and scale it was painted with, its position on the
+// (unbounded) tile grid at that scale, and for the depth dependent line
+// styles, the player depth it was painted for.
+struct MapTileKey
+{
+  int style;
+  int ratio;
+  int x;
+  int y;
+  int z;
+
+  bool operator==(const MapTileKey& other) const
+  {
+    return ((style == other.style) && (ratio == other.ratio) &&
+	    (x == other.x) && (y == other.y) && (z == other.z));
+  }
+};
+
+inline uint qHash(const MapTileKey& key)
+{
+  return ((uint(key.style) * 7 + uint(key.ratio)) * 31 + uint(key.x)) * 1009 +
+    (uint(key.y) * 31) + uint(key.z);
 }
 
+//----------------------------------------------------------------------
+// MapTileStore
+//
+// The static layer tiles of a MapData, shared by all the maps showing it.
+// Maps that paint with the same display settings get the same style id,
+// so a tile painted for one of them is reused by the others.
+class MapTileStore
+{
+ public:
+  MapTileStore(const MapData& mapData);
+  ~MapTileStore();
+
+  const MapData& mapData() const { return m_mapData; }
+
+  // style id for the static settings in param, drops everything if the
+  // map has changed since the last call
+  int styleId(const MapParameters& param);
+
+  QPixmap* tile(const MapTileKey& key) { return m_tiles.object(key); }
+  void insert(const MapTileKey& key, QPixmap* tile);
+
+  int budget() const { return m_tiles.maxCost(); }
+  int count() const { return m_tiles.count(); }
+  void setBudget(int kilobytes) { m_tiles.setMaxCost(kilobytes); }
+
+  // most distinct settings kept before starting over
+  enum { maxStyles = 16 };
+
+ private:
+  bool sameStyle(const MapParameters& a, const MapParameters& b) const;
+
+  const MapData& m_mapData;
+  QList<MapParameters> m_styles;
+  uint32_t m_generation;
+  QCache<MapTileKey, QPixmap> m_tiles;
+};
+
 //----------------------------------------------------------------------
 // MapCache
+//
+// Composites the static layer of the map (background, grid, lines and
+// locations) for one view from fixed size tiles kept in the shared
+// MapTileStore, so that following the player or panning only paints the
+// newly exposed tiles, and other maps with the same settings don't
+// paint them again.
 class MapCache 
 {
  public:
-  MapCache(const MapData& data);
+  MapCache(MapTileStore& store);
   ~MapCache();
 
   const QPixmap& getMapImage(MapParameters& param);
@@ -696,18 +1041,35 @@ class MapCache
   // get methods
   bool needRepaint(MapParameters& param);
   bool alwaysRepaint() const { return m_alwaysRepaint; }
+  int tileBudget() const { return m_store.budget(); }
+  int tileCount() const { return m_store.count(); }
+  uint32_t tilesPainted() const { return m_tilesPainted; }
+  uint32_t tilesReused() const { return m_tilesReused; }
 #ifdef DEBUG
   uint32_t paintCount() const { return m_paintCount; }
 #endif
 
   // set methods
   void setAlwaysRepaint(bool val) { m_alwaysRepaint = val; }
+  void setTileBudget(int kilobytes);
   void forceRepaint() { m_painted = false; }
+
+  // size of a tile in pixels
+  enum { tileSize = 256 };
   
  private:
+  bool settingsChanged(MapParameters& param);
+  int tileZ(MapParameters& param) const;
+  QPixmap* paintTile(MapParameters& param, const MapTileKey& key);
+  void paintStatic(MapParameters& param, QPainter& p, const QRect& area);
+
+  MapTileStore& m_store;
   const MapData& m_mapData;
   QPixmap m_mapImage;
   MapParameters m_lastParam;
+  uint32_t m_lastGeneration;
+  uint32_t m_tilesPainted;
+  uint32_t m_tilesReused;
 #ifdef DEBUG
   uint32_t m_paintCount;
 #endif
@@ -725,6 +1087,16 @@ inline bool inRect(const QRect& rect,
 	  (rect.top() <= y) && (rect.bottom() >= y));
 }
 
+// does the bounding box of the segment overlap rect, catches segments
+// that cross rect without either end being inside it
+inline bool crossesRect(const QRect& rect,
+			int x1, int y1,
+			int x2, int y2)
+{
+  return ((qMin(x1, x2) <= rect.right()) && (qMax(x1, x2) >= rect.left()) &&
+	  (qMin(y1, y2) <= rect.bottom()) && (qMax(y1, y2) >= rect.top()));
+}
+
 inline bool inRoom(const int16_t& headRoom, 
 		   const int16_t& floorRoom, 
 		   const int16_t& z)
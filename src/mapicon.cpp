@@ -33,6 +33,8 @@
 #include <QTimer>
 #include <QTextStream>
 #include <QPolygon>
+#include <QFontMetrics>
+#include <QTransform>
 
 #pragma message("Once our minimum supported Qt version is greater than 5.14, this check can be removed and ENDL replaced with Qt::endl")
 #if (QT_VERSION >= QT_VERSION_CHECK(5,14,0))
@@ -583,7 +585,13 @@ MapIcons::MapIcons(Player* player, const QString& preferenceName,
   : QObject(parent),
     m_player(player),
     m_preferenceName(preferenceName),
-    m_flash(false)
+    m_flash(false),
+    m_flashPainted(false),
+    m_useAtlas(true),
+    m_atlasX(0),
+    m_atlasY(0),
+    m_atlasRowHeight(0),
+    m_labelYOffset(0)
 {
   setObjectName(name);
   // Setup the map icons with default icon type characteristics
@@ -777,6 +785,9 @@ MapIcons::MapIcons(Player* player, const QString& preferenceName,
   m_flashTimer = new QTimer(this);
   connect(m_flashTimer, SIGNAL(timeout()), this, SLOT(flashTick()));
   m_flashTimer->start(200);
+
+  // any change to the icons or their sizes invalidates the sprite atlas
+  connect(this, SIGNAL(changed()), this, SLOT(clearAtlas()));
 }
 
 MapIcons::~MapIcons()
@@ -796,6 +807,7 @@ void MapIcons::load()
 					    false);
   m_fovDistance = pSEQPrefs->getPrefInt("FOVDistance", preferenceName(), 
 					200);
+  m_useAtlas = pSEQPrefs->getPrefBool("IconAtlas", preferenceName(), true);
 
   int val = pSEQPrefs->getPrefInt("DrawSize", preferenceName(), 3);
 
@@ -818,6 +830,9 @@ void MapIcons::load()
   else
     m_markerNSize = 1;
   m_markerNSizeWH = m_markerNSize << 1; // 2 x size
+
+  // the icons may have changed underneath the atlas
+  clearAtlas();
 }
 
 void MapIcons::save()
@@ -974,25 +989,20 @@ void MapIcons::paintIcon(MapParameters& param,
 
   // Draw Item Name
   if (mapIcon.showName())
-  {
-    QFontMetrics fm(param.font());
-    int width = fm.width(itemName);
-    p.setPen(Qt::gray);
-    p.drawText(point.x() - (width / 2),
-	       point.y() + fm.height() + 1, itemName);
-  }
+    paintTextLabel(param, p, itemName, point);
+
+  // note anything that flashes, the map has to keep repainting for it
+  if ((mapIcon.image() && mapIcon.imageFlash()) ||
+      (mapIcon.highlight() && mapIcon.highlightFlash()))
+    m_flashPainted = true;
 
   // Draw Icon Image
   if (mapIcon.image() && 
       (!mapIcon.imageFlash() || m_flash) &&
       (mapIcon.imageStyle() != tIconStyleNone))
   {
-    p.setPen(mapIcon.imagePen());
-    p.setBrush(mapIcon.imageBrush());
-
-    mapIcon.paintIconImage(mapIcon.imageStyle(), p, point, 
-			   *m_mapIconSizes[mapIcon.imageSize()],
-			   *m_mapIconSizesWH[mapIcon.imageSize()]);
+    paintIconImage(p, mapIcon.imageStyle(), mapIcon.imageSize(),
+		   mapIcon.imagePen(), mapIcon.imageBrush(), point);
   }
 
   // Draw Highlight
@@ -1000,12 +1010,9 @@ void MapIcons::paintIcon(MapParameters& param,
       (!mapIcon.highlightFlash() || m_flash) &&
       (mapIcon.highlightStyle() != tIconStyleNone))
   {
-    p.setPen(mapIcon.highlightPen());
-    p.setBrush(mapIcon.highlightBrush());
-
-    mapIcon.paintIconImage(mapIcon.highlightStyle(), p, point, 
-			   *m_mapIconSizes[mapIcon.highlightSize()],
-			   *m_mapIconSizesWH[mapIcon.highlightSize()]);
+    paintIconImage(p, mapIcon.highlightStyle(), mapIcon.highlightSize(),
+		   mapIcon.highlightPen(), mapIcon.highlightBrush(), point,
+		   true);
   }
 }
 
@@ -1110,51 +1117,54 @@ void MapIcons::paintSpawnIcon(MapParameters& param,
   if (mapIcon.showName() || 
       (m_showSpawnNames && (distance < m_fovDistance)))
   {
-    QString spawnNameText;
+    checkLabelFont(param.font());
+
+    // only reformat the label if the spawn was renamed or leveled
+    QString name = spawn->name();
+    int level = spawn->level();
+    MapIconLabel& label = m_spawnLabels[spawn->id()];
+    if ((label.level != level) || (label.name != name))
+    {
+      QString spawnNameText;
 
 #if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-    spawnNameText = QString::asprintf("%2d: %s",
-            spawn->level(),
-            spawn->name().toLatin1().data());
+      spawnNameText = QString::asprintf("%2d: %s",
+              level,
+              name.toLatin1().data());
 #else
-    spawnNameText.sprintf("%2d: %s",
-            spawn->level(),
-            spawn->name().toLatin1().data());
+      spawnNameText.sprintf("%2d: %s",
+              level,
+              name.toLatin1().data());
 #endif
 
-    QFontMetrics fm(param.font());
-    int width = fm.width(spawnNameText);
-    p.setPen(Qt::gray);
-    p.drawText(point.x() - (width / 2),
-	       point.y() + fm.height() + 1, spawnNameText);
+      label.name = name;
+      label.level = level;
+      prepareLabel(label, spawnNameText);
+    }
+
+    paintLabel(p, label, point);
   }
   
+  // note anything that flashes, the map has to keep repainting for it
+  if ((mapIcon.image() && mapIcon.imageFlash()) ||
+      (mapIcon.highlight() && mapIcon.highlightFlash()))
+    m_flashPainted = true;
+
   // Draw the Icon
   if (mapIcon.image() && 
       (!mapIcon.imageFlash() || m_flash) &&
       (mapIcon.imageStyle() != tIconStyleNone))
   {
+    QPen pen = mapIcon.imagePen();
     if (mapIcon.imageUseSpawnColorPen())
-    {
-      QPen pen = mapIcon.imagePen();
       pen.setColor(pickSpawnColor(spawn));
-      p.setPen(pen);
-    }
-    else
-      p.setPen(mapIcon.imagePen());
 
+    QBrush brush = mapIcon.imageBrush();
     if (mapIcon.imageUseSpawnColorBrush())
-    {
-      QBrush brush = mapIcon.imageBrush();
       brush.setColor(pickSpawnColor(spawn));
-      p.setBrush(brush);
-    }
-    else
-      p.setBrush(mapIcon.imageBrush());
 
-    mapIcon.paintIconImage(mapIcon.imageStyle(), p, point, 
-			   *m_mapIconSizes[mapIcon.imageSize()],
-			   *m_mapIconSizesWH[mapIcon.imageSize()]);
+    paintIconImage(p, mapIcon.imageStyle(), mapIcon.imageSize(),
+		   pen, brush, point);
   }
 
   // Draw the highlight
@@ -1162,27 +1172,16 @@ void MapIcons::paintSpawnIcon(MapParameters& param,
       (!mapIcon.highlightFlash() || m_flash) &&
       (mapIcon.highlightStyle() != tIconStyleNone))
   {
+    QPen pen = mapIcon.highlightPen();
     if (mapIcon.highlightUseSpawnColorPen())
-    {
-      QPen pen = mapIcon.highlightPen();
       pen.setColor(pickSpawnColor(spawn));
-      p.setPen(pen);
-    }
-    else
-      p.setPen(mapIcon.highlightPen());
 
+    QBrush brush = mapIcon.highlightBrush();
     if (mapIcon.highlightUseSpawnColorBrush())
-    {
-      QBrush brush = mapIcon.highlightBrush();
       brush.setColor(pickSpawnColor(spawn));
-      p.setBrush(brush);
-    }
-    else
-      p.setBrush(mapIcon.highlightBrush());
 
-    mapIcon.paintIconImage(mapIcon.highlightStyle(), p, point, 
-			   *m_mapIconSizes[mapIcon.highlightSize()],
-			   *m_mapIconSizesWH[mapIcon.highlightSize()]);
+    paintIconImage(p, mapIcon.highlightStyle(), mapIcon.highlightSize(),
+		   pen, brush, point, true);
   }
 }
 
@@ -1244,39 +1243,29 @@ void MapIcons::paintSpawnPointIcon(MapParameters& param,
             sp->count());
 #endif
 
-    QFontMetrics fm(param.font());
-    int width = fm.width(spawnNameText);
-    p.setPen(Qt::gray);
-    p.drawText(point.x() - (width / 2),
-	       point.y() + fm.height() + 1, spawnNameText);
+    paintTextLabel(param, p, spawnNameText, point);
   }
   
+  // note anything that flashes, the map has to keep repainting for it
+  if ((mapIcon.image() && mapIcon.imageFlash()) ||
+      (mapIcon.highlight() && mapIcon.highlightFlash()))
+    m_flashPainted = true;
+
   // Draw the Icon
   if (mapIcon.image() && 
       (!mapIcon.imageFlash() || m_flash) &&
       (mapIcon.imageStyle() != tIconStyleNone))
   {
+    QPen pen = mapIcon.imagePen();
     if (mapIcon.imageUseSpawnColorPen())
-    {
-      QPen pen = mapIcon.imagePen();
       pen.setColor(pickSpawnPointColor(sp, pen.color()));
-      p.setPen(pen);
-    }
-    else
-      p.setPen(mapIcon.imagePen());
 
+    QBrush brush = mapIcon.imageBrush();
     if (mapIcon.imageUseSpawnColorBrush())
-    {
-      QBrush brush = mapIcon.imageBrush();
       brush.setColor(pickSpawnPointColor(sp, brush.color()));
-      p.setBrush(brush);
-    }
-    else
-      p.setBrush(mapIcon.imageBrush());
 
-    mapIcon.paintIconImage(mapIcon.imageStyle(), p, point, 
-			   *m_mapIconSizes[mapIcon.imageSize()],
-			   *m_mapIconSizesWH[mapIcon.imageSize()]);
+    paintIconImage(p, mapIcon.imageStyle(), mapIcon.imageSize(),
+		   pen, brush, point);
   }
 
   // Draw the highlight
@@ -1284,33 +1273,222 @@ void MapIcons::paintSpawnPointIcon(MapParameters& param,
       (!mapIcon.highlightFlash() || m_flash) &&
       (mapIcon.highlightStyle() != tIconStyleNone))
   {
+    QPen pen = mapIcon.highlightPen();
     if (mapIcon.highlightUseSpawnColorPen())
-    {
-      QPen pen = mapIcon.highlightPen();
       pen.setColor(pickSpawnPointColor(sp, pen.color()));
-      p.setPen(pen);
-    }
-    else
-      p.setPen(mapIcon.highlightPen());
 
+    QBrush brush = mapIcon.highlightBrush();
     if (mapIcon.highlightUseSpawnColorBrush())
-    {
-      QBrush brush = mapIcon.highlightBrush();
       brush.setColor(pickSpawnPointColor(sp, brush.color()));
-      p.setBrush(brush);
-    }
-    else
-      p.setBrush(mapIcon.highlightBrush());
 
-    mapIcon.paintIconImage(mapIcon.highlightStyle(), p, point, 
-			   *m_mapIconSizes[mapIcon.highlightSize()],
-			   *m_mapIconSizesWH[mapIcon.highlightSize()]);
+    paintIconImage(p, mapIcon.highlightStyle(), mapIcon.highlightSize(),
+		   pen, brush, point, true);
   }
 }
 
 void MapIcons::flashTick()
 {
   m_flash = !m_flash;
+
+  emit flashed();
+}
+
+void MapIcons::paintIconImage(QPainter& p,
+			      MapIconStyle style, MapIconSize size,
+			      const QPen& pen, const QBrush& brush,
+			      const QPoint& point, bool highlight)
+{
+  int iconSize = *m_mapIconSizes[size];
+  int iconSizeWH = *m_mapIconSizesWH[size];
+
+  // without the atlas, just draw the icon in place
+  if (!m_useAtlas)
+  {
+    p.setPen(pen);
+    p.setBrush(brush);
+    MapIcon::paintIconImage(style, p, point, iconSize, iconSizeWH);
+    return;
+  }
+
+  MapIconSpriteKey key;
+  key.style = style;
+  key.size = iconSize;
+  key.sizeWH = iconSizeWH;
+  key.penWidth = qMin(pen.width(), 255);
+  key.penStyle = pen.style();
+  key.brushStyle = brush.style();
+  key.penColor = pen.color().rgba();
+  key.brushColor = brush.color().rgba();
+
+  // find the sprite for this combination, rendering it if it's new
+  QHash<MapIconSpriteKey, QRect>::const_iterator it = m_sprites.constFind(key);
+  QRect source;
+  if (it != m_sprites.constEnd())
+    source = *it;
+  else
+    source = addSprite(p, key, style, iconSize, iconSizeWH, pen, brush);
+
+  // sprites are drawn centered on the icon position, highlights over the
+  // icon images
+  QVector<QPainter::PixmapFragment>& fragments =
+    highlight ? m_highlightFragments : m_fragments;
+  fragments.append(QPainter::PixmapFragment::create(
+		     QPointF(point.x() + 0.5, point.y() + 0.5),
+		     QRectF(source)));
+}
+
+QRect MapIcons::addSprite(QPainter& p, const MapIconSpriteKey& key,
+			  MapIconStyle style, int size, int sizeWH,
+			  const QPen& pen, const QBrush& brush)
+{
+  const int atlasSize = 512;
+
+  // an odd sized cell with the icon in the middle and room for the pen
+  int margin = qMax(pen.width(), 1) + 1;
+  int center = size + margin;
+  int dim = (center << 1) + 1;
+
+  if (m_atlas.isNull())
+  {
+    m_atlas = QPixmap(atlasSize, atlasSize);
+    m_atlas.fill(Qt::transparent);
+  }
+
+  // shelf packing, start a new row when this one is full
+  if ((m_atlasX + dim) > atlasSize)
+  {
+    m_atlasX = 0;
+    m_atlasY += m_atlasRowHeight;
+    m_atlasRowHeight = 0;
+  }
+
+  // when the atlas is full, draw what's queued and start over
+  if ((m_atlasY + dim) > atlasSize)
+  {
+    flushIcons(p);
+    clearAtlas();
+    m_atlas = QPixmap(atlasSize, atlasSize);
+    m_atlas.fill(Qt::transparent);
+  }
+
+  QRect rect(m_atlasX, m_atlasY, dim, dim);
+  m_atlasX += dim;
+  if (dim > m_atlasRowHeight)
+    m_atlasRowHeight = dim;
+
+  QPainter ap(&m_atlas);
+  ap.setClipRect(rect);
+  ap.setPen(pen);
+  ap.setBrush(brush);
+  ap.setBrushOrigin(rect.topLeft());
+  MapIcon::paintIconImage(style, ap,
+			  QPoint(rect.x() + center, rect.y() + center),
+			  size, sizeWH);
+  ap.end();
+
+  m_sprites.insert(key, rect);
+
+  return rect;
+}
+
+void MapIcons::checkLabelFont(const QFont& font)
+{
+  if (font == m_labelFont)
+    return;
+
+  // everything was laid out for the old font
+  m_labelFont = font;
+  m_spawnLabels.clear();
+  m_textLabels.clear();
+
+  // drawText() positioned the baseline, static text is placed by its top
+  QFontMetrics fm(font);
+  m_labelYOffset = fm.height() + 1 - fm.ascent();
+}
+
+void MapIcons::prepareLabel(MapIconLabel& label, const QString& text)
+{
+  label.text.setText(text);
+  label.text.setTextFormat(Qt::PlainText);
+  label.text.prepare(QTransform(), m_labelFont);
+
+  QFontMetrics fm(m_labelFont);
+  label.xOffset = -(fm.width(text) / 2);
+}
+
+void MapIcons::paintLabel(QPainter& p, const MapIconLabel& label,
+			  const QPoint& point)
+{
+  QPoint pos(point.x() + label.xOffset, point.y() + m_labelYOffset);
+
+  // names go over the icon images, which are still queued
+  if (m_useAtlas)
+  {
+    MapIconQueuedLabel queued;
+    queued.text = label.text;
+    queued.point = pos;
+    m_queuedLabels.append(queued);
+    return;
+  }
+
+  p.setPen(Qt::gray);
+  p.drawStaticText(pos, label.text);
+}
+
+void MapIcons::paintTextLabel(MapParameters& param, QPainter& p,
+			      const QString& text, const QPoint& point)
+{
+  checkLabelFont(param.font());
+
+  QHash<QString, MapIconLabel>::iterator it = m_textLabels.find(text);
+  if (it == m_textLabels.end())
+  {
+    // spawn point labels carry counts, don't let stale ones pile up
+    if (m_textLabels.size() >= 4096)
+      m_textLabels.clear();
+
+    it = m_textLabels.insert(text, MapIconLabel());
+    prepareLabel(*it, text);
+  }
+
+  paintLabel(p, *it, point);
+}
+
+void MapIcons::flushIcons(QPainter& p)
+{
+  if (!m_fragments.isEmpty())
+  {
+    p.drawPixmapFragments(m_fragments.constData(), m_fragments.size(),
+			  m_atlas);
+    m_fragments.resize(0);
+  }
+
+  if (!m_highlightFragments.isEmpty())
+  {
+    p.drawPixmapFragments(m_highlightFragments.constData(),
+			  m_highlightFragments.size(), m_atlas);
+    m_highlightFragments.resize(0);
+  }
+
+  if (!m_queuedLabels.isEmpty())
+  {
+    p.setPen(Qt::gray);
+    for (int i = 0; i < m_queuedLabels.size(); i++)
+      p.drawStaticText(m_queuedLabels[i].point, m_queuedLabels[i].text);
+    m_queuedLabels.resize(0);
+  }
+}
+
+void MapIcons::clearAtlas()
+{
+  // anything still queued refers to the old atlas
+  m_fragments.clear();
+  m_highlightFragments.clear();
+  m_sprites.clear();
+  m_atlas = QPixmap();
+  m_atlasX = 0;
+  m_atlasY = 0;
+  m_atlasRowHeight = 0;
 }
 
 QColor MapIcons::pickSpawnPointColor(const SpawnPoint* sp, 
@@ -1330,6 +1508,7 @@ QColor MapIcons::pickSpawnPointColor(const SpawnPoint* sp,
 
   if ( age > 220 )
   {
+    m_flashPainted = true;
     if (m_flash)
       return Qt::red;
   }
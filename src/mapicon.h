@@ -42,10 +42,16 @@
 #include <QBrush>
 #include <QString>
 #include <QTextStream>
+#include <QPainter>
+#include <QPixmap>
+#include <QRect>
+#include <QHash>
+#include <QVector>
+#include <QFont>
+#include <QStaticText>
 
 //----------------------------------------------------------------------
 // forward declarations
-class QPainter;
 class QPoint;
 class QTimer;
 
@@ -284,6 +290,65 @@ inline void MapIcon::paintIconImage(MapIconStyle style, QPainter& p,
   (*s_iconImageFunctions[style])(p, point, size, sizeWH);
 }
 
+//----------------------------------------------------------------------
+// MapIconSpriteKey
+//
+// Identifies one pre-rendered icon image in the MapIcons sprite atlas:
+// the shape, its pixel size and the pen and brush it was drawn with.
+struct MapIconSpriteKey
+{
+  uint8_t style;
+  uint8_t size;
+  uint8_t sizeWH;
+  uint8_t penWidth;
+  uint8_t penStyle;
+  uint8_t brushStyle;
+  QRgb penColor;
+  QRgb brushColor;
+
+  bool operator==(const MapIconSpriteKey& other) const
+  {
+    return ((style == other.style) && (size == other.size) &&
+	    (sizeWH == other.sizeWH) && (penWidth == other.penWidth) &&
+	    (penStyle == other.penStyle) &&
+	    (brushStyle == other.brushStyle) &&
+	    (penColor == other.penColor) && (brushColor == other.brushColor));
+  }
+};
+
+inline uint qHash(const MapIconSpriteKey& key)
+{
+  return ((uint(key.style) << 24) ^ (uint(key.size) << 16) ^
+	  (uint(key.penWidth) << 8) ^ uint(key.penStyle) ^
+	  (uint(key.brushStyle) << 4)) +
+    key.penColor * 31 + key.brushColor * 1009;
+}
+
+//----------------------------------------------------------------------
+// MapIconLabel
+//
+// A name label laid out once for the map font, along with what it was
+// formatted from so it's only redone when the name or level changes.
+struct MapIconLabel
+{
+  MapIconLabel() : level(-1), xOffset(0) {}
+
+  QString name;
+  int level;
+  QStaticText text;
+  int xOffset; // -width / 2
+};
+
+//----------------------------------------------------------------------
+// MapIconQueuedLabel
+//
+// A label waiting for the icon images it goes on top of to be drawn.
+struct MapIconQueuedLabel
+{
+  QStaticText text;
+  QPoint point;
+};
+
 class MapIcons : public QObject
 {
   Q_OBJECT
@@ -304,10 +369,20 @@ class MapIcons : public QObject
   bool showSpawnNames() const { return m_showSpawnNames; }
   uint16_t fovDistance() const { return m_fovDistance; }
 
+  // was anything that flashes painted since the last reset
+  bool flashPainted() const { return m_flashPainted; }
+  void resetFlashPainted() { m_flashPainted = false; }
+
   const MapIcon& icon(int iconType);
 
   static const QString& iconTypeName(MapIconType type);
 
+  // icon images are queued as fragments of the sprite atlas while the
+  // map is painted, this draws them all with one call, then the
+  // highlights and names queued to go on top of them.  The map flushes
+  // after each of its icon passes, so the passes still stack in order.
+  void flushIcons(QPainter& p);
+
  public slots:
   // set accessors
   void setDrawSize(int val);
@@ -345,14 +420,28 @@ class MapIcons : public QObject
 
  signals:
   void changed(void);
+  void flashed(void);
 
  protected slots:
   void flashTick();
+  void clearAtlas();
 
  protected:
   QColor pickSpawnPointColor(const SpawnPoint* sp, 
 			     const QColor& defColor);
   QColor pickSpawnColor(const Spawn* spawn);
+  void paintIconImage(QPainter& p, MapIconStyle style, MapIconSize size,
+		      const QPen& pen, const QBrush& brush,
+		      const QPoint& point, bool highlight = false);
+  QRect addSprite(QPainter& p, const MapIconSpriteKey& key,
+		  MapIconStyle style, int size, int sizeWH,
+		  const QPen& pen, const QBrush& brush);
+  void checkLabelFont(const QFont& font);
+  void prepareLabel(MapIconLabel& label, const QString& text);
+  void paintLabel(QPainter& p, const MapIconLabel& label,
+		  const QPoint& point);
+  void paintTextLabel(MapParameters& param, QPainter& p,
+		      const QString& text, const QPoint& point);
   Player* m_player; 
   QString m_preferenceName;
   MapIcon m_mapIcons[tIconTypeMax+1];
@@ -375,9 +464,27 @@ class MapIcons : public QObject
 
   QTimer* m_flashTimer;
   bool m_flash;
+  bool m_flashPainted;
 
   bool m_showNPCWalkPaths;
   bool m_showSpawnNames;
+
+  // sprite atlas of every icon image/pen/brush combination drawn so far
+  bool m_useAtlas;
+  QPixmap m_atlas;
+  QHash<MapIconSpriteKey, QRect> m_sprites;
+  QVector<QPainter::PixmapFragment> m_fragments;
+  QVector<QPainter::PixmapFragment> m_highlightFragments;
+  int m_atlasX;
+  int m_atlasY;
+  int m_atlasRowHeight;
+
+  // name labels, per spawn id and for everything else by text
+  QFont m_labelFont;
+  int m_labelYOffset;
+  QHash<uint16_t, MapIconLabel> m_spawnLabels;
+  QHash<QString, MapIconLabel> m_textLabels;
+  QVector<MapIconQueuedLabel> m_queuedLabels;
 };
 
 inline const MapIcon& MapIcons::icon(int iconType)
@@ -22,6 +22,7 @@
  */
 
 #include "messagefilter.h"
+#include "messagefiltermatcher.h"
 
 #include "main.h"
 
@@ -57,7 +58,8 @@ MessageFilter::~MessageFilter()
 //----------------------------------------------------------------------
 // MessageFilters
 MessageFilters::MessageFilters(QObject* parent, const char* name)
-  : QObject(parent)
+  : QObject(parent),
+    m_matcher(new MessageFilterMatcher)
 {
   setObjectName(name);
   QString section("MessageFilters");
@@ -95,12 +97,16 @@ MessageFilters::MessageFilters(QObject* parent, const char* name)
     // ok, create the filter with the retrieved information
     m_filters[i] = new MessageFilter(filterName, types, regexp);
   }
+
+  compileFilters();
 }
 
 MessageFilters::~MessageFilters()
 {
   for (int i = 0; i < maxMessageFilters; i++)
     delete m_filters[i];
+
+  delete m_matcher;
 }
 
 uint8_t MessageFilters::addFilter(const MessageFilter& filter)
@@ -121,6 +127,8 @@ uint8_t MessageFilters::addFilter(const MessageFilter& filter)
       pSEQPrefs->setPrefString(number + "Pattern", section, 
 			       filter.regexp().pattern());
       pSEQPrefs->setPrefUInt64(number + "Types", section, filter.types());
+
+      compileFilters();
       
       // signal the addition of the new filter
       emit added(1 << i, i, *m_filters[i]);
@@ -166,6 +174,8 @@ bool MessageFilters::remFilter(uint8_t filter)
   pSEQPrefs->setPrefString(number + "Pattern", section, "");
   pSEQPrefs->setPrefUInt64(number + "Types", section, 0);
 
+  compileFilters();
+
   // signal the filters removal
   emit removed(1 << filter, filter);
   
@@ -189,14 +199,24 @@ bool MessageFilters::remFilter(const QString& name)
 uint32_t MessageFilters::filterMessage(uint64_t messageTypeMask, 
 				       const QString& message)
 {
-  // initialize to no matches (0)
-  uint32_t mask = 0;
+  // the filters interested in any of the message types
+  uint32_t filters = 0;
+  for (int type = 0; messageTypeMask; type++, messageTypeMask >>= 1)
+    if (messageTypeMask & 1)
+      filters |= m_typeFilters[type];
 
-  // iterate over the message fitlers
-  for (int i = 0; i < maxMessageFilters; i++)
+  if (!filters)
+    return 0;
+
+  // the compiled filters all at once
+  uint32_t mask = m_matcher->match(filters, message);
+
+  // and any others one at a time
+  filters &= ~m_matcher->compiled();
+  for (int i = 0; filters; i++, filters >>= 1)
   {
     // if a match is found, add it to the mask
-    if (m_filters[i] && m_filters[i]->isFiltered(messageTypeMask, message))
+    if ((filters & 1) && (m_filters[i]->regexp().indexIn(message) != -1))
       mask |= 1 << i;
   }
 
@@ -204,6 +224,25 @@ uint32_t MessageFilters::filterMessage(uint64_t messageTypeMask,
   return mask;
 }
 
+void MessageFilters::compileFilters()
+{
+  m_matcher->clear();
+  for (int type = 0; type < 64; type++)
+    m_typeFilters[type] = 0;
+
+  for (int i = 0; i < maxMessageFilters; i++)
+  {
+    if (!m_filters[i])
+      continue;
+
+    m_matcher->addFilter(i, m_filters[i]->regexp());
+
+    for (int type = 0; type < 64; type++)
+      if (m_filters[i]->types() & (uint64_t(1) << type))
+	m_typeFilters[type] |= 1 << i;
+  }
+}
+
 #ifndef QMAKEBUILD
 #include "messagefilter.moc"
 #endif
@@ -33,6 +33,10 @@
 #include <QString>
 #include <QRegExp>
 
+//----------------------------------------------------------------------
+// forward declarations
+class MessageFilterMatcher;
+
 //----------------------------------------------------------------------
 // constants
 const int maxMessageFilters = 32;
@@ -94,6 +98,10 @@ inline bool MessageFilter::operator==(const MessageFilter& filter) const
 
 //----------------------------------------------------------------------
 // MessageFilters
+//
+// The filters are also compiled together into a MessageFilterMatcher, so
+// a message is filtered in one pass over its text.  Only filters it
+// can't compile are run through their own QRegExp.
 class MessageFilters : public QObject
 {
   Q_OBJECT
@@ -116,7 +124,13 @@ class MessageFilters : public QObject
   void added(uint32_t mask, uint8_t filterid, const MessageFilter& filter);
 
  protected:
+  void compileFilters();
+
   MessageFilter* m_filters[maxMessageFilters];
+  MessageFilterMatcher* m_matcher;
+
+  // the filters interested in each message type
+  uint32_t m_typeFilters[64];
 };
 
 inline uint32_t MessageFilters::filterMessage(MessageEntry& message)
@@ -0,0 +1,225 @@
+/*
+ *  messagefilterbench.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QRegExp>
+#include <QElapsedTimer>
+
+#include "messagefiltermatcher.h"
+#include "benchutil.h"
+
+// the usual lines, and now and then one for the counted repeats and the
+// classes below to find
+static QString makeMessage(const BenchMessages& generator)
+{
+  if (rand() % 6)
+    return generator.message();
+
+  return QString("%1 says, 'xx%2y ]b [%3] %4'")
+    .arg(generator.name()).arg(QString(rand() % 4, 'x'))
+    .arg(QString(rand() % 4, 'e')).arg(QString(rand() % 3, 'q'));
+}
+
+// the edges of the syntax the matcher compiles, and some it leaves to
+// QRegExp, with the texts that tell them apart
+struct FilterPattern
+{
+  const char* pattern;
+  Qt::CaseSensitivity cs;
+  QRegExp::PatternSyntax syntax;
+};
+
+static const FilterPattern patterns[] =
+{
+  // case insensitive literals and classes
+  { "tells you", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "LOOTED a", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "[a-c]ONE", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "[G-H]nol", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "shouts", Qt::CaseSensitive, QRegExp::RegExp },
+  { "Guard Jenkins", Qt::CaseSensitive, QRegExp::FixedString },
+  // ']' first in a class, and negated classes
+  { "[]a]b", Qt::CaseSensitive, QRegExp::RegExp },
+  { "[^]a-z ]b", Qt::CaseSensitive, QRegExp::RegExp },
+  { "[^a-z ,']{3}", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\[[^]]*\\]", Qt::CaseSensitive, QRegExp::RegExp },
+  // word boundaries
+  { "\\bcorpse\\b", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\Bor", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\bVox\\b", Qt::CaseInsensitive, QRegExp::RegExp },
+  // counted repeats
+  { "x{2}y", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\[e{2,}\\]", Qt::CaseSensitive, QRegExp::RegExp },
+  { " q{,1}'", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\d{3}pp", Qt::CaseSensitive, QRegExp::RegExp },
+  // stars over groups that can be empty
+  { "((e*)*)*\\]", Qt::CaseSensitive, QRegExp::RegExp },
+  { "(|x)*y ", Qt::CaseSensitive, QRegExp::RegExp },
+  { "()*slain", Qt::CaseSensitive, QRegExp::RegExp },
+  // anchors inside alternations
+  { "^You|better\\.$", Qt::CaseSensitive, QRegExp::RegExp },
+  { "(^a|corpse\\.--$)", Qt::CaseSensitive, QRegExp::RegExp },
+  { "^(--You|Zo)", Qt::CaseSensitive, QRegExp::RegExp },
+  // non latin-1 text
+  { "\xc3\x9c" "ber", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\xc3\xbc" "BER gn\xc3\xb6", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "\xe6\x9d\xb1.", Qt::CaseSensitive, QRegExp::RegExp },
+  { "[\xc3\x84-\xc3\x96]", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\w+ \\w+ of", Qt::CaseSensitive, QRegExp::RegExp },
+  // left to QRegExp
+  { "(a)\\1", Qt::CaseSensitive, QRegExp::RegExp },
+  { "x(?=y)", Qt::CaseSensitive, QRegExp::RegExp },
+  { "*corpse*", Qt::CaseSensitive, QRegExp::Wildcard },
+  // a second matcher's worth
+  { "hits .* for [1-4]\\d\\d points", Qt::CaseSensitive, QRegExp::RegExp },
+  { "LFG \\d+ at 1?\\d:", Qt::CaseSensitive, QRegExp::RegExp },
+  { "Gnoll Fang|Bone Chips", Qt::CaseSensitive, QRegExp::RegExp },
+  { "(sword|dagger)\\.?'?$", Qt::CaseInsensitive, QRegExp::RegExp },
+  { "\\s\\S+\\s+got", Qt::CaseSensitive, QRegExp::RegExp },
+  { "\\.", Qt::CaseSensitive, QRegExp::RegExp },
+  { "", Qt::CaseSensitive, QRegExp::RegExp },
+};
+
+static const char* edges[] =
+{
+  "", "ab", "]b", "Ab", "ab]b", "xxy", "xy", "[ee]", "[e]", "x q'", "x qq'",
+  "You", "a corpse.--", "corpses", "for", "or", "vox", "VOX", "Voxa",
+  "\xc3\xbc" "ber gn\xc3\xb6ll", "\xc3\x9c" "BER GN\xc3\x96LL",
+};
+
+// Checks the filters compiled together against each filter's own
+// QRegExp, and compares the time the two take per message.
+// usage: messagefilterbench [messages] [iterations]
+int main (int argc, char *argv[])
+{
+  int numMessages = (argc > 1) ? atoi(argv[1]) : 2000;
+  int iterations = (argc > 2) ? atoi(argv[2]) : 20;
+  int numPatterns = sizeof(patterns) / sizeof(patterns[0]);
+  int i, j, k;
+
+  srand(BENCH_SEED);
+
+  // non latin-1 names and items, as UTF-8
+  BenchMessages generator;
+  generator.names << QString::fromUtf8("\xc3\x9c" "ber Gn\xc3\xb6ll")
+		  << QString::fromUtf8("\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2"
+				       "\xd0\xb5\xd1\x82")
+		  << QString::fromUtf8("\xe6\x9d\xb1\xe4\xba\xac")
+		  << QString::fromUtf8("Zo\xc3\xab");
+  generator.items << QString::fromUtf8("\xc3\x84xe of \xc3\x96rc Slaying");
+
+  QStringList messages;
+  for (i = 0; i < int(sizeof(edges) / sizeof(edges[0])); i++)
+    messages.append(QString::fromUtf8(edges[i]));
+  for (i = 0; i < numMessages; i++)
+    messages.append(makeMessage(generator));
+
+  // up to 32 filters per matcher, like MessageFilters
+  QList<QRegExp> regexps;
+  QList<MessageFilterMatcher*> matchers;
+  int compiled = 0;
+  for (k = 0; k < numPatterns; k++)
+  {
+    QRegExp regexp(QString::fromUtf8(patterns[k].pattern), patterns[k].cs,
+		   patterns[k].syntax);
+    regexps.append(regexp);
+
+    if ((k % 32) == 0)
+      matchers.append(new MessageFilterMatcher);
+    if (matchers.last()->addFilter(k % 32, regexp))
+      compiled++;
+  }
+
+  printf("patterns: %d, compiled: %d, messages: %d, iterations: %d\n",
+	 numPatterns, compiled, messages.size(), iterations);
+
+  // validate the matchers against the filters' own regexps
+  int mismatches = 0;
+  for (i = 0; i < messages.size(); i++)
+  {
+    for (j = 0; j < matchers.size(); j++)
+    {
+      MessageFilterMatcher* matcher = matchers[j];
+      uint32_t combined = matcher->match(0xffffffff, messages[i]);
+      for (k = j * 32; (k < numPatterns) && (k < (j + 1) * 32); k++)
+      {
+	uint32_t bit = uint32_t(1) << (k % 32);
+	if (!(matcher->compiled() & bit))
+	  continue;
+
+	bool expected = (regexps[k].indexIn(messages[i]) != -1);
+	if (expected != ((combined & bit) != 0))
+	{
+	  mismatches++;
+	  fprintf(stderr, "mismatch: '%s' %s '%s'\n", patterns[k].pattern,
+		  expected ? "matches" : "doesn't match",
+		  messages[i].toUtf8().data());
+	}
+      }
+    }
+  }
+
+  printf("mismatches: %d\n", mismatches);
+
+  // MessageFilters::filterMessage() before, every filter's regexp
+  QElapsedTimer timer;
+  uint32_t sum = 0;
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (i = 0; i < messages.size(); i++)
+      for (k = 0; k < numPatterns; k++)
+	if (regexps[k].indexIn(messages[i]) != -1)
+	  sum += k;
+  qint64 perFilter = timer.nsecsElapsed();
+
+  // and now, the matchers and then the filters they couldn't compile
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (i = 0; i < messages.size(); i++)
+      for (int m = 0; m < matchers.size(); m++)
+      {
+	uint32_t mask = matchers[m]->match(0xffffffff, messages[i]);
+	for (k = m * 32; (k < numPatterns) && (k < (m + 1) * 32); k++)
+	{
+	  uint32_t bit = uint32_t(1) << (k % 32);
+	  if ((mask & bit) ||
+	      (!(matchers[m]->compiled() & bit) &&
+	       (regexps[k].indexIn(messages[i]) != -1)))
+	    sum -= k;
+	}
+      }
+  qint64 combined = timer.nsecsElapsed();
+
+  benchReport("message", double(messages.size()) * iterations,
+	      "per-filter:", perFilter, "combined:", combined);
+
+  qDeleteAll(matchers);
+
+  return benchResult(mismatches, sum);
+}
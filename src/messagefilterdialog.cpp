@@ -22,6 +22,7 @@
 
 #include "messagefilterdialog.h"
 #include "messagefilter.h"
+#include "messages.h"
 #include "message.h"
 
 #include <cstdint>
@@ -39,6 +40,7 @@
 #include <QGridLayout>
 #include <QVBoxLayout>
 #include <QFormLayout>
+#include <QProgressBar>
 
 //----------------------------------------------------------------------
 // MessageFilterListBoxText
@@ -179,6 +181,26 @@ MessageFilterDialog::MessageFilterDialog(MessageFilters* filters,
 
   filterGBoxLayout->addLayout(newFilterLayout, 2);
 
+  // progress of running new filters over the messages already stored
+  QHBoxLayout* refilterLayout = new QHBoxLayout();
+  outerLayout->addLayout(refilterLayout);
+  m_refilterProgress = new QProgressBar(this);
+  m_refilterProgress->setFormat("Filtering stored messages %p%");
+  refilterLayout->addWidget(m_refilterProgress, 1);
+  m_stopRefilter = new QPushButton("&Stop", this);
+  refilterLayout->addWidget(m_stopRefilter);
+  m_refilterProgress->hide();
+  m_stopRefilter->hide();
+
+  Messages* messages = Messages::messages();
+  if (messages)
+  {
+    connect(messages, SIGNAL(refilterProgress(int, int)),
+	    this, SLOT(refilterProgress(int, int)));
+    connect(m_stopRefilter, SIGNAL(clicked()),
+	    messages, SLOT(cancelRefilters()));
+  }
+
   QPushButton* close = new QPushButton("&Close", this);
   outerLayout->addWidget(close, 1, Qt::AlignCenter);
   connect(close, SIGNAL(clicked()),
@@ -529,6 +551,20 @@ void MessageFilterDialog::checkState()
   m_delete->setEnabled(m_currentFilter != 0);
 }
 
+void MessageFilterDialog::refilterProgress(int done, int total)
+{
+  // only shown while there's something to stop
+  bool running = (total != 0);
+  m_refilterProgress->setVisible(running);
+  m_stopRefilter->setVisible(running);
+
+  if (running)
+  {
+    m_refilterProgress->setRange(0, total);
+    m_refilterProgress->setValue(done);
+  }
+}
+
 #ifndef QMAKEBUILD
 #include "messagefilterdialog.moc"
 #endif
@@ -41,6 +41,7 @@ class QListWidget;
 class QListWidgetItem;
 class QGroupBox;
 class QItemSelection;
+class QProgressBar;
 
 //----------------------------------------------------------------------
 // MessageFilterDialog
@@ -66,6 +67,7 @@ class MessageFilterDialog : public QDialog
            const QItemSelection& deselected);
    void removedFilter(uint32_t mask, uint8_t filter);
    void addedFilter(uint32_t mask, uint8_t filterid, const MessageFilter& filter);
+   void refilterProgress(int done, int total);
 
  protected:
    void clearFilter();
@@ -81,6 +83,8 @@ class MessageFilterDialog : public QDialog
   QPushButton* m_add;
   QPushButton* m_update;
   QPushButton* m_delete;
+  QProgressBar* m_refilterProgress;
+  QPushButton* m_stopRefilter;
   uint8_t m_currentFilterNum;
   const MessageFilter* m_currentFilter;
 };
@@ -0,0 +1,841 @@
+/*
+ *  messagefiltermatcher.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "messagefiltermatcher.h"
+
+#include <cstring>
+
+//----------------------------------------------------------------------
+// constants
+
+// state operations, the consuming ones first
+enum
+{
+  opChar,
+  opCharFold,
+  opAny,
+  opClass,
+  opEpsilon,
+  opSplit,
+  opBol,
+  opEol,
+  opWordBoundary,
+  opNotWordBoundary,
+  opMatch,
+};
+
+// class flags for the \d, \w and \s escapes
+enum
+{
+  classDigit = 0x01,
+  classNotDigit = 0x02,
+  classWord = 0x04,
+  classNotWord = 0x08,
+  classSpace = 0x10,
+  classNotSpace = 0x20,
+};
+
+// filters that would take more states than this are left to QRegExp
+static const int maxFilterStates = 4096;
+static const int maxRepeat = 1000;
+
+//----------------------------------------------------------------------
+// helpers
+static inline bool isWordChar(QChar c)
+{
+  return c.isLetterOrNumber() || c.isMark() || (c == QChar('_'));
+}
+
+static inline bool isWordBoundary(const QChar* text, int length, int pos)
+{
+  bool before = (pos > 0) && isWordChar(text[pos - 1]);
+  bool after = (pos < length) && isWordChar(text[pos]);
+  return before != after;
+}
+
+// the character an escape stands for, -1 if it isn't a plain character
+static int escapedChar(QChar c)
+{
+  switch (c.unicode())
+  {
+  case 'a':
+    return 0x07;
+  case 'f':
+    return 0x0c;
+  case 'n':
+    return 0x0a;
+  case 'r':
+    return 0x0d;
+  case 't':
+    return 0x09;
+  case 'v':
+    return 0x0b;
+  }
+
+  // escaped punctuation is itself, anything else is more than a character
+  return c.isLetterOrNumber() ? -1 : c.unicode();
+}
+
+// the class flag for a class escape, 0 if it isn't one
+static uint8_t classEscape(QChar c)
+{
+  switch (c.unicode())
+  {
+  case 'd':
+    return classDigit;
+  case 'D':
+    return classNotDigit;
+  case 'w':
+    return classWord;
+  case 'W':
+    return classNotWord;
+  case 's':
+    return classSpace;
+  case 'S':
+    return classNotSpace;
+  }
+
+  return 0;
+}
+
+//----------------------------------------------------------------------
+// MessageFilterMatcher
+MessageFilterMatcher::MessageFilterMatcher()
+{
+  clear();
+}
+
+void MessageFilterMatcher::clear()
+{
+  m_states.clear();
+  m_classes.clear();
+  for (int i = 0; i < 32; i++)
+    m_starts[i] = -1;
+  m_compiled = 0;
+  memset(m_firstChars, 0, sizeof(m_firstChars));
+  m_firstWide = 0;
+  m_marks.clear();
+  m_generation = 0;
+}
+
+bool MessageFilterMatcher::addFilter(int filter, const QRegExp& regexp)
+{
+  // invalid patterns are left to QRegExp, which never matches them
+  if (!regexp.isValid())
+    return false;
+
+  int states = m_states.size();
+  int classes = m_classes.size();
+
+  m_pattern = regexp.pattern();
+  m_pos = 0;
+  m_filter = filter;
+  m_filterStates = states;
+  m_fold = (regexp.caseSensitivity() == Qt::CaseInsensitive);
+  m_failed = false;
+
+  Fragment body = { -1, -1 };
+  switch (regexp.patternSyntax())
+  {
+  case QRegExp::RegExp:
+  case QRegExp::RegExp2:
+    body = parseAlternation();
+
+    // only an unbalanced ')' stops the parse early
+    if (m_pos < m_pattern.length())
+      fail();
+    break;
+
+  case QRegExp::FixedString:
+    body = fragment(opEpsilon);
+    for (; m_pos < m_pattern.length(); m_pos++)
+      body = concat(body, literal(m_pattern[m_pos]));
+    break;
+
+  default:
+    fail();
+    break;
+  }
+
+  if (m_failed)
+  {
+    m_states.resize(states);
+    m_classes.resize(classes);
+    return false;
+  }
+
+  int match = addState(opMatch);
+  m_states[body.exit].out = match;
+  m_starts[filter] = body.start;
+  m_compiled |= uint32_t(1) << filter;
+
+  m_marks.fill(0, m_states.size());
+  m_generation = 0;
+
+  addFirstChars(filter);
+
+  return true;
+}
+
+uint32_t MessageFilterMatcher::match(uint32_t filters, const QString& text)
+{
+  uint32_t found = 0;
+  filters &= m_compiled;
+  if (!filters)
+    return found;
+
+  const QChar* s = text.unicode();
+  int length = text.length();
+
+  if (++m_generation == 0)
+  {
+    m_marks.fill(0);
+    m_generation = 1;
+  }
+  m_current.clear();
+
+  for (int i = 0; ; i++)
+  {
+    uint32_t active = filters & ~found;
+    if (!active)
+      break;
+
+    // start the filters that could match from here, anything can match
+    // at the ends and in between only the ones that start with this
+    // character can
+    uint32_t starting = active;
+    if ((i > 0) && (i < length))
+    {
+      ushort c = s[i].unicode();
+      starting &= (c < 256) ? m_firstChars[c] : m_firstWide;
+    }
+    for (int filter = 0; starting; filter++, starting >>= 1)
+      if (starting & 1)
+	follow(m_current, m_starts[filter], s, length, i, found);
+
+    if (i == length)
+      break;
+
+    // and move every state that takes this character along
+    if (++m_generation == 0)
+    {
+      m_marks.fill(0);
+      m_generation = 1;
+    }
+    m_next.clear();
+
+    active = filters & ~found;
+    QVector<int>::const_iterator it;
+    for (it = m_current.begin(); it != m_current.end(); ++it)
+    {
+      const MessageFilterState& state = m_states[*it];
+      if ((active & (uint32_t(1) << state.filter)) && consumes(state, s[i]))
+	follow(m_next, state.out, s, length, i + 1, found);
+    }
+
+    qSwap(m_current, m_next);
+  }
+
+  return found;
+}
+
+int MessageFilterMatcher::addState(uint8_t op, int out, int out1)
+{
+  MessageFilterState state;
+  state.op = op;
+  state.filter = uint8_t(m_filter);
+  state.ch = 0;
+  state.cls = -1;
+  state.out = out;
+  state.out1 = out1;
+  m_states.append(state);
+
+  // runaway repeats give up as soon as they pass the limit
+  if (m_states.size() - m_filterStates > maxFilterStates)
+    fail();
+
+  return m_states.size() - 1;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::fragment(uint8_t op)
+{
+  // the exit of a fragment is the state whose out is still to be set
+  Fragment f;
+  f.start = f.exit = addState(op);
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::literal(QChar c)
+{
+  Fragment f = fragment(m_fold ? opCharFold : opChar);
+  m_states[f.start].ch = m_fold ? c.toLower().unicode() : c.unicode();
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::concat(const Fragment& a,
+							    const Fragment& b)
+{
+  m_states[a.exit].out = b.start;
+
+  Fragment f;
+  f.start = a.start;
+  f.exit = b.exit;
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::alternate(const Fragment& a,
+							       const Fragment& b)
+{
+  Fragment f;
+  f.exit = addState(opEpsilon);
+  f.start = addState(opSplit, a.start, b.start);
+  m_states[a.exit].out = f.exit;
+  m_states[b.exit].out = f.exit;
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::star(const Fragment& a)
+{
+  Fragment f;
+  f.start = f.exit = addState(opSplit, -1, a.start);
+  m_states[a.exit].out = f.start;
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::plus(const Fragment& a)
+{
+  Fragment f;
+  f.start = a.start;
+  f.exit = addState(opSplit, -1, a.start);
+  m_states[a.exit].out = f.exit;
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::optional(const Fragment& a)
+{
+  Fragment f;
+  f.exit = addState(opEpsilon);
+  f.start = addState(opSplit, f.exit, a.start);
+  m_states[a.exit].out = f.exit;
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::parseAlternation()
+{
+  Fragment f = parseSequence();
+  while (!m_failed && (m_pos < m_pattern.length()) &&
+	 (m_pattern[m_pos] == QChar('|')))
+  {
+    m_pos++;
+    f = alternate(f, parseSequence());
+  }
+
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::parseSequence()
+{
+  Fragment f = fragment(opEpsilon);
+  while (!m_failed && (m_pos < m_pattern.length()) &&
+	 (m_pattern[m_pos] != QChar('|')) && (m_pattern[m_pos] != QChar(')')))
+    f = concat(f, parseQuantified());
+
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::parseQuantified()
+{
+  int atom = m_pos;
+  Fragment f = parseAtom();
+  bool repeated = false;
+
+  while (!m_failed && (m_pos < m_pattern.length()))
+  {
+    QChar c = m_pattern[m_pos];
+    if (c == QChar('*'))
+      f = star(f);
+    else if (c == QChar('+'))
+      f = plus(f);
+    else if (c == QChar('?'))
+      f = optional(f);
+    else if ((c == QChar('{')) && !repeated)
+    {
+      // counted repeats are copies of the atom, so they can't be stacked
+      int min = 0;
+      int max;
+      m_pos++;
+      parseNumber(min);
+      if ((m_pos < m_pattern.length()) && (m_pattern[m_pos] == QChar(',')))
+      {
+	m_pos++;
+	if (!parseNumber(max))
+	  max = -1;
+      }
+      else
+	max = min;
+
+      if ((m_pos >= m_pattern.length()) || (m_pattern[m_pos] != QChar('}')) ||
+	  (min > maxRepeat) || (max > maxRepeat) ||
+	  ((max != -1) && (max < min)))
+      {
+	fail();
+	break;
+      }
+
+      f = repeat(f, atom, min, max);
+    }
+    else if (c == QChar('{'))
+    {
+      fail();
+      break;
+    }
+    else
+      break;
+
+    repeated = true;
+    m_pos++;
+  }
+
+  return f;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::repeat(const Fragment& first,
+							    int atom,
+							    int min, int max)
+{
+  // every copy after the first is parsed again from the atom
+  int end = m_pos;
+  bool used = false;
+  Fragment f = fragment(opEpsilon);
+
+  for (int i = 0; !m_failed && ((i < min) || (i < max) || (max == -1)); i++)
+  {
+    Fragment copy = first;
+    if (used)
+    {
+      m_pos = atom;
+      copy = parseAtom();
+    }
+    used = true;
+
+    if (i < min)
+      f = concat(f, copy);
+    else if (max == -1)
+    {
+      f = concat(f, star(copy));
+      break;
+    }
+    else
+      f = concat(f, optional(copy));
+  }
+
+  m_pos = end;
+  return f;
+}
+
+bool MessageFilterMatcher::parseNumber(int& value)
+{
+  int start = m_pos;
+  value = 0;
+  while ((m_pos < m_pattern.length()) && m_pattern[m_pos].isDigit() &&
+	 (value <= maxRepeat))
+    value = value * 10 + m_pattern[m_pos++].digitValue();
+
+  return m_pos != start;
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::parseAtom()
+{
+  if (m_pos >= m_pattern.length())
+  {
+    fail();
+    return fragment(opEpsilon);
+  }
+
+  QChar c = m_pattern[m_pos++];
+  switch (c.unicode())
+  {
+  case '(':
+    {
+      // only plain and non capturing groups, no lookaheads
+      if ((m_pos < m_pattern.length()) && (m_pattern[m_pos] == QChar('?')))
+      {
+	if ((m_pos + 1 < m_pattern.length()) &&
+	    (m_pattern[m_pos + 1] == QChar(':')))
+	  m_pos += 2;
+	else
+	{
+	  fail();
+	  return fragment(opEpsilon);
+	}
+      }
+
+      Fragment f = parseAlternation();
+      if ((m_pos < m_pattern.length()) && (m_pattern[m_pos] == QChar(')')))
+	m_pos++;
+      else
+	fail();
+      return f;
+    }
+
+  case '[':
+    return parseClass();
+
+  case '.':
+    return fragment(opAny);
+
+  case '^':
+    return fragment(opBol);
+
+  case '$':
+    return fragment(opEol);
+
+  case '\\':
+    return parseEscape();
+
+  case '*':
+  case '+':
+  case '?':
+  case '{':
+  case '}':
+  case ']':
+  case ')':
+  case '|':
+    fail();
+    return fragment(opEpsilon);
+  }
+
+  return literal(c);
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::parseEscape()
+{
+  if (m_pos >= m_pattern.length())
+  {
+    fail();
+    return fragment(opEpsilon);
+  }
+
+  QChar c = m_pattern[m_pos++];
+
+  if (c == QChar('b'))
+    return fragment(opWordBoundary);
+  if (c == QChar('B'))
+    return fragment(opNotWordBoundary);
+
+  uint8_t flags = classEscape(c);
+  if (flags)
+  {
+    MessageFilterClass cls;
+    cls.negated = false;
+    cls.fold = false;
+    cls.flags = flags;
+    m_classes.append(cls);
+
+    Fragment f = fragment(opClass);
+    m_states[f.start].cls = m_classes.size() - 1;
+    return f;
+  }
+
+  // back references, octal and hex codes aren't compiled
+  int ch = escapedChar(c);
+  if (ch == -1)
+  {
+    fail();
+    return fragment(opEpsilon);
+  }
+
+  return literal(QChar(ushort(ch)));
+}
+
+MessageFilterMatcher::Fragment MessageFilterMatcher::parseClass()
+{
+  MessageFilterClass cls;
+  cls.negated = false;
+  cls.fold = m_fold;
+  cls.flags = 0;
+
+  if ((m_pos < m_pattern.length()) && (m_pattern[m_pos] == QChar('^')))
+  {
+    cls.negated = true;
+    m_pos++;
+  }
+
+  // a ']' straight after the '[' is part of the class
+  bool first = true;
+  for (;;)
+  {
+    if (m_pos >= m_pattern.length())
+    {
+      fail();
+      break;
+    }
+
+    QChar c = m_pattern[m_pos++];
+    if ((c == QChar(']')) && !first)
+      break;
+    first = false;
+
+    int lo = c.unicode();
+    if ((c == QChar('[')) && (m_pos < m_pattern.length()) &&
+	(m_pattern[m_pos] == QChar(':')))
+    {
+      fail();
+      break;
+    }
+    else if (c == QChar('\\'))
+    {
+      if (m_pos >= m_pattern.length())
+      {
+	fail();
+	break;
+      }
+
+      c = m_pattern[m_pos++];
+      uint8_t flags = classEscape(c);
+      if (flags)
+      {
+	cls.flags |= flags;
+	continue;
+      }
+
+      lo = escapedChar(c);
+      if (lo == -1)
+      {
+	fail();
+	break;
+      }
+    }
+
+    int hi = lo;
+    if ((m_pos + 1 < m_pattern.length()) &&
+	(m_pattern[m_pos] == QChar('-')) && (m_pattern[m_pos + 1] != QChar(']')))
+    {
+      m_pos++;
+      c = m_pattern[m_pos++];
+      hi = c.unicode();
+      if (c == QChar('\\'))
+      {
+	hi = (m_pos < m_pattern.length()) ?
+	  escapedChar(m_pattern[m_pos++]) : -1;
+	if (hi == -1)
+	{
+	  fail();
+	  break;
+	}
+      }
+
+      if (hi < lo)
+      {
+	fail();
+	break;
+      }
+    }
+
+    cls.ranges.append(ushort(lo));
+    cls.ranges.append(ushort(hi));
+  }
+
+  m_classes.append(cls);
+
+  Fragment f = fragment(opClass);
+  m_states[f.start].cls = m_classes.size() - 1;
+  return f;
+}
+
+bool MessageFilterMatcher::fail()
+{
+  m_failed = true;
+  return false;
+}
+
+bool MessageFilterMatcher::classMatches(const MessageFilterClass& cls,
+					QChar c) const
+{
+  bool matched = false;
+
+  for (int i = 0; !matched && (i < cls.ranges.size()); i += 2)
+  {
+    ushort lo = cls.ranges[i];
+    ushort hi = cls.ranges[i + 1];
+    ushort u = c.unicode();
+    matched = (u >= lo) && (u <= hi);
+    if (!matched && cls.fold)
+    {
+      u = c.toLower().unicode();
+      matched = (u >= lo) && (u <= hi);
+      u = c.toUpper().unicode();
+      matched = matched || ((u >= lo) && (u <= hi));
+    }
+  }
+
+  if (!matched && cls.flags)
+  {
+    uint8_t flags = cls.flags;
+    matched = ((flags & classDigit) && c.isDigit()) ||
+      ((flags & classNotDigit) && !c.isDigit()) ||
+      ((flags & classWord) && isWordChar(c)) ||
+      ((flags & classNotWord) && !isWordChar(c)) ||
+      ((flags & classSpace) && c.isSpace()) ||
+      ((flags & classNotSpace) && !c.isSpace());
+  }
+
+  return matched != cls.negated;
+}
+
+bool MessageFilterMatcher::consumes(const MessageFilterState& state,
+				    QChar c) const
+{
+  switch (state.op)
+  {
+  case opChar:
+    return c.unicode() == state.ch;
+  case opCharFold:
+    return c.toLower().unicode() == state.ch;
+  case opAny:
+    return true;
+  case opClass:
+    return classMatches(m_classes[state.cls], c);
+  }
+
+  return false;
+}
+
+void MessageFilterMatcher::addFirstChars(int filter)
+{
+  uint32_t bit = uint32_t(1) << filter;
+  QVector<bool> seen(m_states.size(), false);
+  QVector<int> stack;
+  stack.append(m_starts[filter]);
+
+  while (!stack.isEmpty())
+  {
+    int s = stack.last();
+    stack.removeLast();
+    if ((s < 0) || seen[s])
+      continue;
+    seen[s] = true;
+
+    const MessageFilterState& state = m_states[s];
+    switch (state.op)
+    {
+    case opChar:
+      if (state.ch < 256)
+	m_firstChars[state.ch] |= bit;
+      else
+	m_firstWide |= bit;
+      break;
+
+    case opCharFold:
+    case opClass:
+      // characters above latin-1 may fold to anything, so always try
+      for (int c = 0; c < 256; c++)
+	if (consumes(state, QChar(ushort(c))))
+	  m_firstChars[c] |= bit;
+      m_firstWide |= bit;
+      break;
+
+    case opSplit:
+      stack.append(state.out1);
+      stack.append(state.out);
+      break;
+
+    case opEpsilon:
+    case opEol:
+    case opWordBoundary:
+    case opNotWordBoundary:
+      stack.append(state.out);
+      break;
+
+    case opBol:
+      // only ever starts at the beginning
+      break;
+
+    case opAny:
+    case opMatch:
+      for (int c = 0; c < 256; c++)
+	m_firstChars[c] |= bit;
+      m_firstWide |= bit;
+      break;
+    }
+  }
+}
+
+void MessageFilterMatcher::follow(QVector<int>& list, int state,
+				  const QChar* text, int length, int pos,
+				  uint32_t& found)
+{
+  // add the state, and everything it leads to without taking a
+  // character, to the list of states at pos
+  m_stack.clear();
+  m_stack.append(state);
+
+  while (!m_stack.isEmpty())
+  {
+    int s = m_stack.last();
+    m_stack.removeLast();
+    if ((s < 0) || (m_marks[s] == m_generation))
+      continue;
+    m_marks[s] = m_generation;
+
+    const MessageFilterState& st = m_states[s];
+    switch (st.op)
+    {
+    case opEpsilon:
+      m_stack.append(st.out);
+      break;
+
+    case opSplit:
+      m_stack.append(st.out1);
+      m_stack.append(st.out);
+      break;
+
+    case opBol:
+      if (pos == 0)
+	m_stack.append(st.out);
+      break;
+
+    case opEol:
+      if (pos == length)
+	m_stack.append(st.out);
+      break;
+
+    case opWordBoundary:
+      if (isWordBoundary(text, length, pos))
+	m_stack.append(st.out);
+      break;
+
+    case opNotWordBoundary:
+      if (!isWordBoundary(text, length, pos))
+	m_stack.append(st.out);
+      break;
+
+    case opMatch:
+      found |= uint32_t(1) << st.filter;
+      break;
+
+    default:
+      list.append(s);
+      break;
+    }
+  }
+}
@@ -0,0 +1,144 @@
+/*
+ *  messagefiltermatcher.h
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// The message filters compiled together into one NFA, which is run over
+// a message in a single pass giving the mask of every filter that
+// matches it.  The states of all the filters are followed side by side,
+// and a table of the characters each filter can start with keeps filters
+// from being started where they can't match.
+//
+// Patterns are compiled from QRegExp's syntax: literals, escapes, '.',
+// classes, groups, alternation, the '*', '+', '?' and '{n,m}' quantifiers
+// and the '^', '$', '\b' and '\B' assertions.  Only whether a filter
+// matches is needed, so greedy or minimal matching makes no difference.
+// Back references, lookaheads and the non regexp pattern syntaxes aren't
+// compiled, addFilter() fails and those filters are left to QRegExp.
+
+#ifndef _MESSAGEFILTERMATCHER_H_
+#define _MESSAGEFILTERMATCHER_H_
+
+#include <cstdint>
+
+#include <QString>
+#include <QChar>
+#include <QVector>
+#include <QRegExp>
+
+//----------------------------------------------------------------------
+// MessageFilterState
+struct MessageFilterState
+{
+  uint8_t op;
+  uint8_t filter;
+  ushort ch;
+  int cls;
+  int out;
+  int out1;
+};
+
+//----------------------------------------------------------------------
+// MessageFilterClass
+struct MessageFilterClass
+{
+  bool negated;
+  bool fold;
+  uint8_t flags;
+  QVector<ushort> ranges;
+};
+
+//----------------------------------------------------------------------
+// MessageFilterMatcher
+class MessageFilterMatcher
+{
+ public:
+  MessageFilterMatcher();
+
+  void clear();
+  bool addFilter(int filter, const QRegExp& regexp);
+  uint32_t compiled() const { return m_compiled; }
+
+  // the subset of filters that match the text, only compiled filters are
+  // tried so the others still need their QRegExp run
+  uint32_t match(uint32_t filters, const QString& text);
+
+ protected:
+  struct Fragment
+  {
+    int start;
+    int exit;
+  };
+
+  // building the NFA
+  int addState(uint8_t op, int out = -1, int out1 = -1);
+  Fragment fragment(uint8_t op);
+  Fragment literal(QChar c);
+  Fragment concat(const Fragment& a, const Fragment& b);
+  Fragment alternate(const Fragment& a, const Fragment& b);
+  Fragment star(const Fragment& a);
+  Fragment plus(const Fragment& a);
+  Fragment optional(const Fragment& a);
+  Fragment repeat(const Fragment& first, int atom, int min, int max);
+
+  // parsing the pattern
+  Fragment parseAlternation();
+  Fragment parseSequence();
+  Fragment parseQuantified();
+  Fragment parseAtom();
+  Fragment parseClass();
+  Fragment parseEscape();
+  bool parseNumber(int& value);
+  bool fail();
+
+  // running it
+  bool classMatches(const MessageFilterClass& cls, QChar c) const;
+  bool consumes(const MessageFilterState& state, QChar c) const;
+  void addFirstChars(int filter);
+  void follow(QVector<int>& list, int state, const QChar* text, int length,
+	      int pos, uint32_t& found);
+
+  QVector<MessageFilterState> m_states;
+  QVector<MessageFilterClass> m_classes;
+  int m_starts[32];
+  uint32_t m_compiled;
+
+  // filters that can start matching at each latin-1 character, and at
+  // any character above that
+  uint32_t m_firstChars[256];
+  uint32_t m_firstWide;
+
+  // the filter being compiled
+  QString m_pattern;
+  int m_pos;
+  int m_filter;
+  int m_filterStates;
+  bool m_fold;
+  bool m_failed;
+
+  // scratch for match()
+  QVector<int> m_current;
+  QVector<int> m_next;
+  QVector<int> m_stack;
+  QVector<uint32_t> m_marks;
+  uint32_t m_generation;
+};
+
+#endif // _MESSAGEFILTERMATCHER_H_
@@ -0,0 +1,251 @@
+/*
+ *  messageindex.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "messageindex.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------
+// trigramBits
+//
+// The two bits a trigram sets in a block
+static inline void trigramBits(const QChar* text, uint32_t& bit1,
+			       uint32_t& bit2)
+{
+  uint64_t hash = (uint64_t(text[0].unicode()) << 32) |
+    (uint64_t(text[1].unicode()) << 16) | uint64_t(text[2].unicode());
+  hash *= 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 29;
+
+  bit1 = uint32_t(hash) % MessageIndexBlockBits;
+  bit2 = uint32_t(hash >> 32) % MessageIndexBlockBits;
+}
+
+//----------------------------------------------------------------------
+// MessageIndexQuery
+MessageIndexQuery::MessageIndexQuery(const QRegExp& regexp)
+{
+  QStringList literals = requiredLiterals(regexp.pattern(),
+					  regexp.patternSyntax());
+
+  QStringList::const_iterator it;
+  for (it = literals.begin(); it != literals.end(); ++it)
+    addBits(m_bits, *it);
+
+  // no point testing the same bit twice
+  std::sort(m_bits.begin(), m_bits.end());
+  m_bits.erase(std::unique(m_bits.begin(), m_bits.end()), m_bits.end());
+}
+
+bool MessageIndexQuery::mayMatch(const uint64_t* block) const
+{
+  QVector<uint32_t>::const_iterator it;
+  for (it = m_bits.begin(); it != m_bits.end(); ++it)
+    if (!(block[*it >> 6] & (uint64_t(1) << (*it & 63))))
+      return false;
+
+  return true;
+}
+
+void MessageIndexQuery::addText(uint64_t* block, const QString& text)
+{
+  QString folded = text.toLower();
+  const QChar* data = folded.constData();
+  uint32_t bit1, bit2;
+
+  for (int i = 0; i + 3 <= folded.length(); i++)
+  {
+    trigramBits(data + i, bit1, bit2);
+    block[bit1 >> 6] |= uint64_t(1) << (bit1 & 63);
+    block[bit2 >> 6] |= uint64_t(1) << (bit2 & 63);
+  }
+}
+
+void MessageIndexQuery::addBits(QVector<uint32_t>& bits, const QString& text)
+{
+  QString folded = text.toLower();
+  const QChar* data = folded.constData();
+  uint32_t bit1, bit2;
+
+  for (int i = 0; i + 3 <= folded.length(); i++)
+  {
+    trigramBits(data + i, bit1, bit2);
+    bits.append(bit1);
+    bits.append(bit2);
+  }
+}
+
+QStringList MessageIndexQuery::requiredLiterals(const QString& pattern,
+						QRegExp::PatternSyntax syntax)
+{
+  QStringList literals;
+  QString current;
+  int length = pattern.length();
+
+  switch (syntax)
+  {
+  case QRegExp::FixedString:
+    literals.append(pattern);
+    return literals;
+
+  case QRegExp::Wildcard:
+  case QRegExp::WildcardUnix:
+    // text between the wildcards has to be there
+    for (int i = 0; i < length; i++)
+    {
+      QChar c = pattern[i];
+      if ((c == '\\') && (syntax == QRegExp::WildcardUnix) &&
+	  (i + 1 < length))
+	current += pattern[++i];
+      else if ((c == '*') || (c == '?'))
+      {
+	literals.append(current);
+	current.clear();
+      }
+      else if (c == '[')
+      {
+	literals.append(current);
+	current.clear();
+	while ((i < length) && (pattern[i] != ']'))
+	  i++;
+      }
+      else
+	current += c;
+    }
+    literals.append(current);
+    return literals;
+
+  case QRegExp::RegExp:
+  case QRegExp::RegExp2:
+    break;
+
+  default:
+    return literals;
+  }
+
+  // only a plain sequence of atoms is understood, anything inside groups
+  // or classes is skipped and an alternation means nothing is required
+  for (int i = 0; i < length; i++)
+  {
+    QChar c = pattern[i];
+
+    if (c == '|')
+      return QStringList();
+
+    if (c == '(')
+    {
+      // skip the group, a quantifier after it applies to nothing we kept
+      literals.append(current);
+      current.clear();
+      int depth = 1;
+      for (i++; (i < length) && depth; i++)
+      {
+	if (pattern[i] == '\\')
+	  i++;
+	else if (pattern[i] == '(')
+	  depth++;
+	else if (pattern[i] == ')')
+	  depth--;
+      }
+      i--;
+      continue;
+    }
+
+    if (c == '[')
+    {
+      literals.append(current);
+      current.clear();
+      i++;
+      if ((i < length) && (pattern[i] == '^'))
+	i++;
+      if ((i < length) && (pattern[i] == ']'))
+	i++;
+      for (; (i < length) && (pattern[i] != ']'); i++)
+	if (pattern[i] == '\\')
+	  i++;
+      continue;
+    }
+
+    if (c == '{')
+    {
+      // quantifier on a group or class
+      while ((i < length) && (pattern[i] != '}'))
+	i++;
+      continue;
+    }
+
+    if ((c == '.') || (c == '^') || (c == '$') || (c == ')') ||
+	(c == '*') || (c == '+') || (c == '?'))
+    {
+      literals.append(current);
+      current.clear();
+      continue;
+    }
+
+    if (c == '\\')
+    {
+      if (++i >= length)
+	break;
+
+      // character classes, anchors, control characters and back
+      // references just end the literal
+      c = pattern[i];
+      if (QString("dDwWsSbBnrtfva123456789").contains(c))
+      {
+	literals.append(current);
+	current.clear();
+	continue;
+      }
+
+      // hex, unicode and octal codes, or anything else not understood,
+      // leave nothing that is known to be required
+      if (c.isLetterOrNumber())
+	return QStringList();
+    }
+
+    // a literal character, unless what follows makes it optional
+    QChar next = (i + 1 < length) ? pattern[i + 1] : QChar();
+    if ((next == '*') || (next == '?') || (next == '{'))
+    {
+      literals.append(current);
+      current.clear();
+    }
+    else if (next == '+')
+    {
+      current += c;
+      literals.append(current);
+      current.clear();
+    }
+    else
+      current += c;
+  }
+  literals.append(current);
+
+  // only literals long enough to have a trigram narrow anything
+  QStringList required;
+  QStringList::const_iterator it;
+  for (it = literals.begin(); it != literals.end(); ++it)
+    if (it->length() >= 3)
+      required.append(*it);
+
+  return required;
+}
@@ -0,0 +1,73 @@
+/*
+ *  messageindex.h
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Trigram index over the stored messages.  Every block of
+// MessageIndexBlockSize consecutive messages gets a fixed size bit set
+// with two bits set for each (case folded) trigram of the messages text,
+// so the index costs the same per message however long the history is
+// and goes away with the segment it belongs to.  A search collects the
+// trigrams of the literal text a match has to contain, and only runs the
+// regexp over the blocks that have the bits of all of them set.
+
+#ifndef _MESSAGEINDEX_H_
+#define _MESSAGEINDEX_H_
+
+#include <cstdint>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QRegExp>
+
+//----------------------------------------------------------------------
+// constants
+const int MessageIndexBlockSize = 64;
+const int MessageIndexBlockWords = 128;
+const int MessageIndexBlockBits = MessageIndexBlockWords * 64;
+
+//----------------------------------------------------------------------
+// MessageIndexQuery
+class MessageIndexQuery
+{
+ public:
+  MessageIndexQuery(const QRegExp& regexp);
+
+  // can the index rule out any blocks for this search at all
+  bool narrows() const { return !m_bits.isEmpty(); }
+
+  // could the block of messages with these bits contain a match
+  bool mayMatch(const uint64_t* block) const;
+
+  // index the text of a message into the bits of its block
+  static void addText(uint64_t* block, const QString& text);
+
+  // the runs of literal text every match of the pattern must contain
+  static QStringList requiredLiterals(const QString& pattern,
+				      QRegExp::PatternSyntax syntax);
+
+ protected:
+  static void addBits(QVector<uint32_t>& bits, const QString& text);
+
+  QVector<uint32_t> m_bits;
+};
+
+#endif // _MESSAGEINDEX_H_
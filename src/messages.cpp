@@ -23,23 +23,185 @@
 
 #include "messages.h"
 #include "datetimemgr.h"
+#include "main.h"
+#include "xmlpreferences.h"
+
+#include <cstdio>
+
+#include <QMetaType>
+#include <QDir>
+#include <QDataStream>
+#include <QTemporaryFile>
+#include <QThreadPool>
+#include <QRunnable>
+
+//----------------------------------------------------------------------
+// constants
+
+// spilled segments that have been dropped are only cleared out of the
+// spill file once they are more than what's left, and at least this much
+static const qint64 spillCompactMin = 4 * 1024 * 1024;
+
+// how many segments a refilter hands to the worker at a time
+static const int refilterChunkSegments = 16;
+
+//----------------------------------------------------------------------
+// unpackSegment
+//
+// The messages of a spilled segment from its compressed data, usable from
+// any thread.
+static MessageList unpackSegment(const uchar* data, int length, int count)
+{
+  QByteArray packed = qUncompress(data, length);
+  QDataStream in(packed);
+  quint8 type;
+  QDateTime dateTime, eqDateTime;
+  QString text;
+  quint32 color;
+
+  MessageList entries;
+  entries.reserve(count);
+  for (int i = 0; i < count; i++)
+  {
+    in >> type >> dateTime >> eqDateTime >> text >> color;
+    entries.append(MessageEntry(MessageType(type), dateTime, eqDateTime,
+				text, color));
+  }
+
+  return entries;
+}
+
+//----------------------------------------------------------------------
+// MessageRefilter
+//
+// A filter that was added, still to be run over the messages that were
+// stored before it.  Messages from end on were filtered as they arrived.
+// The matches are collected until every chunk is done, and only then set
+// in the filter flags, so the flags never show a partial refilter.
+class MessageRefilter
+{
+ public:
+  MessageRefilter(uint32_t mask, const MessageFilter& filter)
+    : mask(mask), filter(filter), cancelled(false) {}
+
+  uint32_t mask;
+  MessageFilter filter;
+  uint64_t start;
+  uint64_t next;
+  uint64_t end;
+  QVector<uint64_t> matches;
+  bool cancelled;
+};
+
+//----------------------------------------------------------------------
+// MessageRefilterTask
+//
+// One chunk of a MessageRefilter, run on the worker.  It has its own copy
+// of the filter and a snapshot of the segments, the stored messages are
+// implicitly shared so the snapshot costs nothing and can't change under
+// it.  Segments that are spilled are copied still compressed.
+struct MessageRefilterSegment
+{
+  uint64_t first;
+  QVector<uint8_t> types;
+  MessageList entries;
+  QByteArray packed;
+};
+
+class MessageRefilterTask : public QRunnable
+{
+ public:
+  MessageRefilterTask(Messages* messages, MessageRefilter* refilter)
+    : m_messages(messages), refilter(refilter), filter(refilter->filter) {}
+  void run();
+
+ protected:
+  Messages* m_messages;
+
+ public:
+  MessageRefilter* refilter; // only touched on the GUI thread
+  MessageFilter filter;
+  QList<MessageRefilterSegment> segments;
+  uint64_t end;
+  QVector<uint64_t> matches;
+};
+
+void MessageRefilterTask::run()
+{
+  QList<MessageRefilterSegment>::const_iterator it;
+  for (it = segments.begin(); it != segments.end(); ++it)
+  {
+    const MessageRefilterSegment& segment = *it;
+    MessageList entries = segment.entries;
+    if (!segment.packed.isEmpty())
+      entries = unpackSegment((const uchar*)segment.packed.constData(),
+			      segment.packed.size(), segment.types.size());
+
+    // at(), the snapshot is shared with the GUI thread and mustn't detach
+    for (int i = 0; i < entries.size(); i++)
+      if (filter.isFiltered(MessageType(segment.types.at(i)),
+			    entries.at(i).text()))
+	matches.append(segment.first + i);
+  }
+
+  QMetaObject::invokeMethod(m_messages, "refilterChunkFinished",
+			    Qt::QueuedConnection,
+			    Q_ARG(void*, this));
+}
 
 //----------------------------------------------------------------------
 // initialize statics
 Messages* Messages::s_messages = 0;
 
+//----------------------------------------------------------------------
+// MessageSegment
+MessageSegment::MessageSegment(uint64_t first)
+  : m_first(first),
+    m_spillOffset(0),
+    m_spillLength(0)
+{
+  m_entries.reserve(MessageSegmentSize);
+  m_types.reserve(MessageSegmentSize);
+  m_filterFlags.reserve(MessageSegmentSize);
+  m_trigrams.fill(0, (MessageSegmentSize / MessageIndexBlockSize) *
+		  MessageIndexBlockWords);
+}
+
 //----------------------------------------------------------------------
 // Messages
 Messages::Messages(DateTimeMgr* dateTimeMgr, MessageFilters* messageFilters,
 		   QObject* parent, const char* name)
   : QObject(parent),
     m_dateTimeMgr(dateTimeMgr),
-    m_messageFilters(messageFilters)
+    m_messageFilters(messageFilters),
+    m_nextSerial(0),
+    m_spillFile(0),
+    m_spillLive(0),
+    m_spillDead(0),
+    m_spillFailed(false),
+    m_cachedSegment(0),
+    m_refilterTask(0)
 {
   setObjectName(name);
   if (!s_messages)
     s_messages = this;
 
+  // how many segments to keep in memory, and how many to keep at all
+  m_memorySegments = pSEQPrefs->getPrefInt("MemorySegments", "Messages", 16);
+  if (m_memorySegments < 1)
+    m_memorySegments = 1;
+  m_maxSegments = pSEQPrefs->getPrefInt("MaxSegments", "Messages", 1024);
+  if (m_maxSegments < m_memorySegments)
+    m_maxSegments = m_memorySegments;
+
+  // refilters run one chunk at a time, on a thread of their own
+  m_refilterPool = new QThreadPool(this);
+  m_refilterPool->setMaxThreadCount(1);
+
+  // so addMessage() can be queued from other threads
+  qRegisterMetaType<MessageType>("MessageType");
+  qRegisterMetaType<uint32_t>("uint32_t");
+
   connect(m_messageFilters, SIGNAL(removed(uint32_t, uint8_t)),
 	  this, SLOT(removedFilter(uint32_t, uint8_t)));
   connect(m_messageFilters, SIGNAL(added(uint32_t, uint8_t, 
@@ -49,6 +211,37 @@ Messages::Messages(DateTimeMgr* dateTimeMgr, MessageFilters* messageFilters,
 
 Messages::~Messages()
 {
+  // let the worker finish its chunk, its queued result goes away with us
+  m_refilterPool->waitForDone();
+  delete m_refilterTask;
+  qDeleteAll(m_refilters);
+
+  qDeleteAll(m_segments);
+  delete m_spillFile;
+}
+
+MessageEntry Messages::message(uint64_t serial)
+{
+  if (!contains(serial))
+    return MessageEntry();
+
+  MessageSegment* segment = m_segments[segmentIndex(serial)];
+  int i = int(serial - segment->first());
+  MessageEntry message = loadSegment(segment)[i];
+  message.setFilterFlags(segment->m_filterFlags[i]);
+  return message;
+}
+
+MessageList Messages::segmentMessages(int i)
+{
+  MessageSegment* segment = m_segments[i];
+  MessageList messages = loadSegment(segment);
+
+  // the flags in the segment are the current ones
+  for (int j = 0; j < messages.size(); j++)
+    messages[j].setFilterFlags(segment->m_filterFlags[j]);
+
+  return messages;
 }
 
 void Messages::addMessage(MessageType type, const QString& text, 
@@ -62,38 +255,499 @@ void Messages::addMessage(MessageType type, const QString& text,
 		       m_dateTimeMgr->updatedDateTime(),
 		       text, color, filterFlags);
 
-  // create the message and append it to the end of the list
-  m_messages.append(message);
+  // start a new segment when the last one is full, which may push an
+  // older one out of memory or out altogether
+  if (m_segments.isEmpty() ||
+      (m_segments.last()->size() == MessageSegmentSize))
+  {
+    m_segments.append(new MessageSegment(m_nextSerial));
+
+    int spill = m_segments.size() - m_memorySegments - 1;
+    if ((spill >= 0) && !m_segments[spill]->spilled())
+      spillSegment(m_segments[spill]);
+
+    while (m_segments.size() > m_maxSegments)
+      dropSegment();
+  }
+
+  // append the message to the end of the last segment
+  MessageSegment* segment = m_segments.last();
+  segment->m_entries.append(message);
+  segment->m_types.append(uint8_t(type));
+  segment->m_filterFlags.append(filterFlags);
+  MessageIndexQuery::addText(segment->m_trigrams.data() +
+			     (segment->size() - 1) / MessageIndexBlockSize *
+			     MessageIndexBlockWords, text);
+  m_nextSerial++;
 
   // signal that a new message exists
   emit newMessage(message);
 }
 
+bool Messages::find(const QRegExp& regexp, uint64_t from, bool backwards,
+		    uint64_t& found)
+{
+  if (m_segments.isEmpty())
+    return false;
+
+  if (from < firstSerial())
+  {
+    if (backwards)
+      return false;
+    from = firstSerial();
+  }
+  else if (from >= m_nextSerial)
+  {
+    if (!backwards)
+      return false;
+    from = m_nextSerial - 1;
+  }
+
+  MessageIndexQuery query(regexp);
+  int step = backwards ? -1 : 1;
+
+  for (int s = segmentIndex(from); (s >= 0) && (s < m_segments.size());
+       s += step)
+  {
+    MessageSegment* segment = m_segments[s];
+    const MessageList* messages = 0;
+    int i = (from >= segment->first()) &&
+      (from < segment->first() + segment->size()) ?
+      int(from - segment->first()) : (backwards ? segment->size() - 1 : 0);
+
+    for (; (i >= 0) && (i < segment->size()); i += step)
+    {
+      // skip over whole blocks that can't have a match
+      if (!query.mayMatch(segment->trigrams(i)))
+      {
+	int block = i / MessageIndexBlockSize;
+	i = backwards ? block * MessageIndexBlockSize :
+	  (block + 1) * MessageIndexBlockSize - 1;
+	continue;
+      }
+
+      if (!messages)
+	messages = &loadSegment(segment);
+
+      if (regexp.indexIn((*messages)[i].text()) != -1)
+      {
+	found = segment->first() + i;
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+QVector<uint64_t> Messages::findAll(const QRegExp& regexp, int limit,
+				    const QVector<uint64_t>* shown)
+{
+  QVector<uint64_t> matches;
+  MessageIndexQuery query(regexp);
+
+  // the shown serials are walked alongside the messages
+  QVector<uint64_t>::const_iterator next;
+  if (shown)
+    next = shown->begin();
+
+  QList<MessageSegment*>::iterator it;
+  for (it = m_segments.begin(); it != m_segments.end(); ++it)
+  {
+    MessageSegment* segment = *it;
+    const MessageList* messages = 0;
+
+    for (int i = 0; i < segment->size(); i += MessageIndexBlockSize)
+    {
+      int end = qMin(i + MessageIndexBlockSize, segment->size());
+
+      // skip blocks with nothing shown in them
+      if (shown)
+      {
+	while ((next != shown->end()) && (*next < segment->first() + i))
+	  ++next;
+	if (next == shown->end())
+	  return matches;
+	if (*next >= segment->first() + end)
+	  continue;
+      }
+
+      if (!query.mayMatch(segment->trigrams(i)))
+	continue;
+
+      if (!messages)
+	messages = &loadSegment(segment);
+
+      for (int j = i; j < end; j++)
+      {
+	if (shown)
+	{
+	  while ((next != shown->end()) && (*next < segment->first() + j))
+	    ++next;
+	  if ((next == shown->end()) || (*next != segment->first() + j))
+	    continue;
+	}
+
+	if (regexp.indexIn((*messages)[j].text()) == -1)
+	  continue;
+
+	matches.append(segment->first() + j);
+	if (matches.size() >= limit)
+	  return matches;
+      }
+    }
+  }
+
+  return matches;
+}
+
 void Messages::clear(void)
 {
+  // anything being refiltered is going away
+  cancelRefilters();
+
   // clear the messages
-  m_messages.clear();
+  qDeleteAll(m_segments);
+  m_segments.clear();
+  m_cachedSegment = 0;
+  m_cachedEntries.clear();
+
+  // and everything that was spilled
+  delete m_spillFile;
+  m_spillFile = 0;
+  m_spillLive = 0;
+  m_spillDead = 0;
 
   // signal that the messages have been cleared
   emit cleared();
 }
 
+const MessageList& Messages::loadSegment(MessageSegment* segment)
+{
+  if (!segment->spilled())
+    return segment->m_entries;
+
+  if (m_cachedSegment == segment)
+    return m_cachedEntries;
+
+  m_cachedSegment = segment;
+  m_cachedEntries.clear();
+
+  // read it back out of the spill file
+  uchar* data = m_spillFile->map(segment->m_spillOffset,
+				 segment->m_spillLength);
+  if (!data)
+  {
+    // keep the messages lined up with their types and flags
+    m_cachedEntries.resize(segment->size());
+    return m_cachedEntries;
+  }
+
+  m_cachedEntries = unpackSegment(data, segment->m_spillLength,
+				  segment->size());
+  m_spillFile->unmap(data);
+
+  return m_cachedEntries;
+}
+
+QByteArray Messages::spilledData(const MessageSegment* segment) const
+{
+  uchar* data = m_spillFile->map(segment->m_spillOffset,
+				 segment->m_spillLength);
+  if (!data)
+    return QByteArray();
+
+  QByteArray packed((const char*)data, segment->m_spillLength);
+  m_spillFile->unmap(data);
+  return packed;
+}
+
+void Messages::spillSegment(MessageSegment* segment)
+{
+  if (m_spillFailed)
+    return;
+
+  if (!m_spillFile)
+  {
+    m_spillFile =
+      new QTemporaryFile(QDir::tempPath() + "/showeq-messages-XXXXXX");
+    if (!m_spillFile->open())
+    {
+      // can't use seqWarn() from in here, it would come right back
+      fprintf(stderr, "Failed to create message spill file, keeping all "
+	      "messages in memory\n");
+      delete m_spillFile;
+      m_spillFile = 0;
+      m_spillFailed = true;
+      return;
+    }
+  }
+
+  // the types and flags stay with the segment, everything else goes
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  MessageList::const_iterator it;
+  for (it = segment->m_entries.begin(); it != segment->m_entries.end(); ++it)
+    out << quint8((*it).type()) << (*it).dateTime() << (*it).eqDateTime()
+	<< (*it).text() << quint32((*it).color());
+
+  QByteArray packed = qCompress(data);
+  qint64 offset = m_spillFile->size();
+  if (!m_spillFile->seek(offset) ||
+      (m_spillFile->write(packed) != packed.size()) ||
+      !m_spillFile->flush())
+  {
+    fprintf(stderr, "Failed to write message spill file, keeping all "
+	    "messages in memory\n");
+    m_spillFailed = true;
+    return;
+  }
+
+  segment->m_spillOffset = offset;
+  segment->m_spillLength = packed.size();
+  segment->m_entries = MessageList();
+  m_spillLive += packed.size();
+}
+
+void Messages::dropSegment()
+{
+  MessageSegment* segment = m_segments.takeFirst();
+
+  if (m_cachedSegment == segment)
+  {
+    m_cachedSegment = 0;
+    m_cachedEntries.clear();
+  }
+
+  if (segment->spilled())
+  {
+    m_spillLive -= segment->m_spillLength;
+    m_spillDead += segment->m_spillLength;
+  }
+
+  delete segment;
+
+  if ((m_spillDead > m_spillLive) && (m_spillDead >= spillCompactMin))
+    compactSpill();
+
+  emit dropped(firstSerial());
+}
+
+void Messages::compactSpill()
+{
+  // copy what's still used to a new spill file
+  QTemporaryFile* spillFile =
+    new QTemporaryFile(QDir::tempPath() + "/showeq-messages-XXXXXX");
+  if (!spillFile->open())
+  {
+    delete spillFile;
+    return;
+  }
+
+  QList<MessageSegment*>::iterator it;
+  QVector<qint64> offsets;
+  for (it = m_segments.begin(); it != m_segments.end(); ++it)
+  {
+    MessageSegment* segment = *it;
+    if (!segment->spilled())
+      continue;
+
+    uchar* data = m_spillFile->map(segment->m_spillOffset,
+				   segment->m_spillLength);
+    offsets.append(spillFile->pos());
+    bool written = data &&
+      (spillFile->write((const char*)data, segment->m_spillLength) ==
+       segment->m_spillLength);
+    if (data)
+      m_spillFile->unmap(data);
+
+    if (!written)
+    {
+      delete spillFile;
+      return;
+    }
+  }
+
+  if (!spillFile->flush())
+  {
+    delete spillFile;
+    return;
+  }
+
+  // everything made it, switch over
+  int i = 0;
+  for (it = m_segments.begin(); it != m_segments.end(); ++it)
+    if ((*it)->spilled())
+      (*it)->m_spillOffset = offsets[i++];
+
+  delete m_spillFile;
+  m_spillFile = spillFile;
+  m_spillDead = 0;
+}
+
 void Messages::removedFilter(uint32_t mask, uint8_t filter)
 {
+  // a refilter for it is pointless now
+  cancelRefilter(mask);
+
   // filter has been removed, remove its mask from all the messages
-  MessageList::iterator it;
-  for (it = m_messages.begin(); it != m_messages.end(); ++it)
-    (*it).setFilterFlags((*it).filterFlags() & ~mask);
+  QList<MessageSegment*>::iterator it;
+  for (it = m_segments.begin(); it != m_segments.end(); ++it)
+  {
+    QVector<uint32_t>& flags = (*it)->m_filterFlags;
+    for (int i = 0; i < flags.size(); i++)
+      flags[i] &= ~mask;
+  }
 }
 
 void Messages::addedFilter(uint32_t mask, uint8_t filterid, 
 			   const MessageFilter& filter)
 {
-  // filter has been added, filter all messages against it
-  MessageList::iterator it;
-  for (it = m_messages.begin(); it != m_messages.end(); ++it)
-    if (filter.isFiltered(*it))
-      (*it).setFilterFlags((*it).filterFlags() | mask);
+  // an older filter in the same slot is gone
+  cancelRefilter(mask);
+
+  // filter has been added, filter the stored messages against it in the
+  // background, new messages already are as they arrive
+  MessageRefilter* refilter = new MessageRefilter(mask, filter);
+  refilter->start = firstSerial();
+  refilter->next = refilter->start;
+  refilter->end = m_nextSerial;
+  m_refilters.append(refilter);
+
+  if (!m_refilterTask)
+    startRefilterChunk();
+}
+
+void Messages::cancelRefilters(void)
+{
+  QList<MessageRefilter*>::iterator it;
+  for (it = m_refilters.begin(); it != m_refilters.end(); ++it)
+    (*it)->cancelled = true;
+
+  if (!m_refilterTask)
+    startRefilterChunk();
+}
+
+void Messages::cancelRefilter(uint32_t mask)
+{
+  QList<MessageRefilter*>::iterator it;
+  for (it = m_refilters.begin(); it != m_refilters.end(); ++it)
+    if ((*it)->mask == mask)
+      (*it)->cancelled = true;
+}
+
+void Messages::startRefilterChunk()
+{
+  while (!m_refilters.isEmpty())
+  {
+    MessageRefilter* refilter = m_refilters.first();
+
+    // messages dropped in the meantime don't need doing
+    if (refilter->next < firstSerial())
+      refilter->next = firstSerial();
+
+    if (refilter->cancelled)
+    {
+      m_refilters.removeFirst();
+      delete refilter;
+      continue;
+    }
+
+    if (refilter->next >= refilter->end)
+    {
+      finishRefilter(refilter);
+      continue;
+    }
+
+    // snapshot the next few segments, skipping any that have no messages
+    // of the types the filter is for
+    MessageRefilterTask* task = new MessageRefilterTask(this, refilter);
+    task->setAutoDelete(false);
+
+    int i = segmentIndex(refilter->next);
+    int last = qMin(i + refilterChunkSegments, m_segments.size());
+    for (; i < last; i++)
+    {
+      const MessageSegment* segment = m_segments[i];
+      if (segment->first() >= refilter->end)
+	break;
+
+      bool wanted = false;
+      for (int j = 0; (j < segment->size()) && !wanted; j++)
+	wanted = (refilter->filter.types() &
+		  (uint64_t(1) << segment->m_types[j])) != 0;
+      if (!wanted)
+	continue;
+
+      MessageRefilterSegment snapshot;
+      snapshot.first = segment->first();
+      snapshot.types = segment->m_types;
+      if (segment->spilled())
+	snapshot.packed = spilledData(segment);
+      else
+	snapshot.entries = segment->m_entries;
+
+      // only the messages that were there when the filter was added
+      int count = int(qMin<uint64_t>(segment->size(),
+				     refilter->end - segment->first()));
+      snapshot.types.resize(count);
+      if (!segment->spilled())
+	snapshot.entries.resize(count);
+
+      task->segments.append(snapshot);
+    }
+
+    task->end = (i < m_segments.size()) ?
+      qMin(m_segments[i]->first(), refilter->end) : refilter->end;
+
+    emit refilterProgress(int(refilter->next - refilter->start),
+			  int(refilter->end - refilter->start));
+
+    m_refilterTask = task;
+    m_refilterPool->start(task);
+    return;
+  }
+
+  // nothing left to do
+  emit refilterProgress(0, 0);
+}
+
+void Messages::refilterChunkFinished(void* data)
+{
+  MessageRefilterTask* task = (MessageRefilterTask*)data;
+  m_refilterTask = 0;
+
+  MessageRefilter* refilter = task->refilter;
+  if (!refilter->cancelled)
+  {
+    refilter->matches += task->matches;
+    refilter->next = task->end;
+  }
+
+  delete task;
+
+  startRefilterChunk();
+}
+
+void Messages::finishRefilter(MessageRefilter* refilter)
+{
+  m_refilters.removeAll(refilter);
+
+  // publish all of the matches at once
+  QVector<uint64_t>::const_iterator it;
+  for (it = refilter->matches.begin(); it != refilter->matches.end(); ++it)
+  {
+    if (!contains(*it))
+      continue;
+
+    MessageSegment* segment = m_segments[segmentIndex(*it)];
+    segment->m_filterFlags[int(*it - segment->first())] |= refilter->mask;
+  }
+
+  uint32_t mask = refilter->mask;
+  delete refilter;
+
+  emit refiltered(mask);
 }
 
 #ifndef QMAKEBUILD
@@ -26,20 +26,66 @@
 
 #include "message.h"
 #include "messagefilter.h"
+#include "messageindex.h"
 
 #include <cstdint>
 
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QRegExp>
 
 //----------------------------------------------------------------------
 // forward declarations
 class DateTimeMgr;
+class MessageRefilter;
+class MessageRefilterTask;
+class QTemporaryFile;
+class QThreadPool;
+
+//----------------------------------------------------------------------
+// constants
+const int MessageSegmentSize = 1024;
 
 //----------------------------------------------------------------------
 // MessageList
-typedef QList<MessageEntry> MessageList;
+typedef QVector<MessageEntry> MessageList;
+
+//----------------------------------------------------------------------
+// MessageSegment
+//
+// A run of up to MessageSegmentSize consecutive messages.  The types and
+// filter flags stay in memory, the rest of the messages is either in
+// m_entries or spilled compressed to the temporary file of Messages.
+// The trigram bits of each block of messages (see messageindex.h) stay
+// in memory too, so searches only load the blocks that may match.
+class MessageSegment
+{
+ public:
+  MessageSegment(uint64_t first);
+
+  uint64_t first() const { return m_first; }
+  int size() const { return m_types.size(); }
+  bool spilled() const { return m_spillLength != 0; }
+  MessageType type(int i) const { return MessageType(m_types[i]); }
+  uint32_t filterFlags(int i) const { return m_filterFlags[i]; }
+  const uint64_t* trigrams(int i) const
+  { return m_trigrams.constData() +
+      (i / MessageIndexBlockSize) * MessageIndexBlockWords; }
+
+ protected:
+  friend class Messages;
+
+  uint64_t m_first;
+  MessageList m_entries;
+  QVector<uint8_t> m_types;
+  QVector<uint32_t> m_filterFlags;
+  QVector<uint64_t> m_trigrams;
+  qint64 m_spillOffset;
+  int m_spillLength;
+};
 
 //----------------------------------------------------------------------
 // Messages
@@ -53,32 +99,101 @@ class Messages : public QObject
   ~Messages();
 
   static Messages* messages() { return s_messages; }
-  const MessageList messageList() const;
+
+  // messages are numbered in the order they arrive, and kept in segments
+  // of MessageSegmentSize with the oldest segments dropped over the limit
+  uint64_t firstSerial() const;
+  uint64_t nextSerial() const { return m_nextSerial; }
+  uint64_t count() const { return m_nextSerial - firstSerial(); }
+  bool contains(uint64_t serial) const;
+  MessageEntry message(uint64_t serial);
+
+  int segmentCount() const { return m_segments.size(); }
+  const MessageSegment& segment(int i) const { return *m_segments[i]; }
+  MessageList segmentMessages(int i);
+
+  // search the message text for the regexp, starting at from and going
+  // either way, only the messages in blocks the index can't rule out are
+  // looked at.  findAll() returns the serials of up to limit matches,
+  // only counting those in shown (sorted) when it's given.
+  bool find(const QRegExp& regexp, uint64_t from, bool backwards,
+	    uint64_t& found);
+  QVector<uint64_t> findAll(const QRegExp& regexp, int limit,
+			    const QVector<uint64_t>* shown = 0);
+
+  bool refiltering() const { return !m_refilters.isEmpty(); }
 
  public slots:
   void addMessage(MessageType type, const QString& text, 
 		  uint32_t color = ME_InvalidColor);
   void clear(void);
+  void cancelRefilters(void);
 
  protected slots:
   void removedFilter(uint32_t mask, uint8_t filter);
   void addedFilter(uint32_t mask, uint8_t filterid, const MessageFilter& filter);
+
+ private slots:
+  void refilterChunkFinished(void* task);
    
  signals:
   void newMessage(const MessageEntry& message);
   void cleared(void);
+  void dropped(uint64_t firstSerial);
+
+  // progress of running new filters over the stored messages, done and
+  // total are both 0 once there's nothing left to do
+  void refilterProgress(int done, int total);
+  void refiltered(uint32_t mask);
 
  protected:
+  int segmentIndex(uint64_t serial) const;
+  const MessageList& loadSegment(MessageSegment* segment);
+  QByteArray spilledData(const MessageSegment* segment) const;
+  void cancelRefilter(uint32_t mask);
+  void startRefilterChunk();
+  void finishRefilter(MessageRefilter* refilter);
+  void spillSegment(MessageSegment* segment);
+  void dropSegment();
+  void compactSpill();
+
   DateTimeMgr* m_dateTimeMgr;
   MessageFilters* m_messageFilters;
-  MessageList m_messages;
+  QList<MessageSegment*> m_segments;
+  uint64_t m_nextSerial;
+  int m_memorySegments;
+  int m_maxSegments;
+
+  // spilled segments, and the last one read back
+  QTemporaryFile* m_spillFile;
+  qint64 m_spillLive;
+  qint64 m_spillDead;
+  bool m_spillFailed;
+  const MessageSegment* m_cachedSegment;
+  MessageList m_cachedEntries;
+
+  // new filters waiting to be or being run over the stored messages
+  QList<MessageRefilter*> m_refilters;
+  MessageRefilterTask* m_refilterTask;
+  QThreadPool* m_refilterPool;
 
   static Messages* s_messages;
 };
 
-inline const MessageList Messages::messageList() const
+inline uint64_t Messages::firstSerial() const
+{
+  return m_segments.isEmpty() ? m_nextSerial : m_segments.first()->first();
+}
+
+inline bool Messages::contains(uint64_t serial) const
+{
+  return (serial >= firstSerial()) && (serial < m_nextSerial);
+}
+
+inline int Messages::segmentIndex(uint64_t serial) const
 {
-  return m_messages;
+  // every segment but the last is full
+  return int((serial - firstSerial()) / MessageSegmentSize);
 }
 
 #endif // _MESSAGES_H_
@@ -36,6 +36,7 @@
 #include <QCheckBox>
 #include <QLabel>
 #include <QLineEdit>
+#include <QListWidget>
 #include <QGroupBox>
 #include <QFileDialog>
 #include <QFile>
@@ -47,6 +48,20 @@
 #include <QFrame>
 #include <QMouseEvent>
 #include <QEvent>
+#include <QScrollBar>
+#include <QApplication>
+#include <QClipboard>
+#include <QKeySequence>
+#include <QBrush>
+#include <QStringList>
+
+#include <algorithm>
+
+//----------------------------------------------------------------------
+// constants
+
+// most matches a find all lists
+static const int findAllLimit = 10000;
 
 #pragma message("Once our minimum supported Qt version is greater than 5.14, this check can be removed and ENDL replaced with Qt::endl")
 #if (QT_VERSION >= QT_VERSION_CHECK(5,14,0))
@@ -55,25 +70,204 @@
 #define ENDL endl
 #endif
 
+//----------------------------------------------------------------------
+// MessageModel
+MessageModel::MessageModel(Messages* messages, MessageWindow* window)
+  : QAbstractListModel(window),
+    m_messages(messages),
+    m_window(window)
+{
+}
+
+int MessageModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant MessageModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || (index.row() >= m_rows.size()))
+    return QVariant();
+
+  MessageEntry message = m_messages->message(m_rows[index.row()]);
+
+  if ((role == Qt::DisplayRole) || (role == Qt::ToolTipRole))
+    return m_window->messageText(message);
+
+  return m_window->messageStyle(message, role);
+}
+
+int MessageModel::row(uint64_t serial) const
+{
+  QVector<uint64_t>::const_iterator it =
+    std::lower_bound(m_rows.begin(), m_rows.end(), serial);
+  if ((it == m_rows.end()) || (*it != serial))
+    return -1;
+
+  return it - m_rows.begin();
+}
+
+MessageEntry MessageModel::message(int row) const
+{
+  return m_messages->message(m_rows[row]);
+}
+
+void MessageModel::rebuild()
+{
+  beginResetModel();
+
+  // only the types and flags are needed to pick the messages to show
+  m_rows.clear();
+  for (int i = 0; i < m_messages->segmentCount(); i++)
+  {
+    const MessageSegment& segment = m_messages->segment(i);
+    for (int j = 0; j < segment.size(); j++)
+      if (m_window->isShown(segment.type(j), segment.filterFlags(j)))
+	m_rows.append(segment.first() + j);
+  }
+
+  endResetModel();
+}
+
+void MessageModel::append(const MessageEntry& message)
+{
+  if (!m_window->isShown(message.type(), message.filterFlags()))
+    return;
+
+  // it's the message Messages just added
+  beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size());
+  m_rows.append(m_messages->nextSerial() - 1);
+  endInsertRows();
+}
+
+void MessageModel::drop(uint64_t firstSerial)
+{
+  int count = std::lower_bound(m_rows.begin(), m_rows.end(), firstSerial) -
+    m_rows.begin();
+  if (!count)
+    return;
+
+  beginRemoveRows(QModelIndex(), 0, count - 1);
+  m_rows.remove(0, count);
+  endRemoveRows();
+}
+
+void MessageModel::restyle()
+{
+  // the text and sizes of every row may have changed
+  emit layoutAboutToBeChanged();
+  emit layoutChanged();
+}
+
 //---------------------------------------------------------------------- 
 // MessageBrowser
 MessageBrowser::MessageBrowser(QWidget* parent, const char* name)
-  : QTextEdit(parent)
+  : QListView(parent)
 {
-    setObjectName(name);
+  setObjectName(name);
+  setSelectionMode(QAbstractItemView::ExtendedSelection);
+  setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+  // wrapped rows all need measuring, do it a bit at a time
+  setLayoutMode(QListView::Batched);
+  setBatchSize(256);
+
+  viewport()->installEventFilter(this);
 }
 
-bool MessageBrowser::eventFilter(QObject *o, QEvent *e)
+bool MessageBrowser::find(const QRegExp& regexp, bool backwards)
 {
-#if 0 // ZBTEMP
-  if (e->type() == QEvent::KeyPress)
+  MessageModel* messageModel = qobject_cast<MessageModel*>(model());
+  if (!messageModel || !messageModel->rowCount())
+    return false;
+
+  // search from the message after (or before) the current row
+  Messages* messages = messageModel->messages();
+  uint64_t from;
+  if (!currentIndex().isValid())
+    from = backwards ? messages->nextSerial() : 0;
+  else if (!backwards)
+    from = messageModel->serial(currentIndex().row()) + 1;
+  else if (messageModel->serial(currentIndex().row()) > 0)
+    from = messageModel->serial(currentIndex().row()) - 1;
+  else
+    return false;
+
+  // skip over matches this browser doesn't show
+  uint64_t found;
+  while (messages->find(regexp, from, backwards, found))
   {
-    QKeyEvent* k = (QKeyEvent*)e;
-    fprintf(stderr, "MessageBrowser::eventFilter(KeyEvent, %x)\n", k->key());
+    if (showMessage(found))
+      return true;
+
+    if (!backwards)
+      from = found + 1;
+    else if (found > 0)
+      from = found - 1;
+    else
+      break;
   }
-#endif // ZBTEPM
+
+  return false;
+}
+
+QVector<uint64_t> MessageBrowser::findAll(const QRegExp& regexp, int limit)
+{
+  MessageModel* messageModel = qobject_cast<MessageModel*>(model());
+  if (!messageModel)
+    return QVector<uint64_t>();
+
+  // only the rows shown count towards the limit
+  return messageModel->messages()->findAll(regexp, limit,
+					   &messageModel->serials());
+}
+
+QModelIndex MessageBrowser::messageIndex(uint64_t serial) const
+{
+  MessageModel* messageModel = qobject_cast<MessageModel*>(model());
+  if (!messageModel)
+    return QModelIndex();
+
+  int row = messageModel->row(serial);
+  if (row == -1)
+    return QModelIndex();
+
+  return messageModel->index(row, 0);
+}
+
+bool MessageBrowser::showMessage(uint64_t serial)
+{
+  QModelIndex index = messageIndex(serial);
+  if (!index.isValid())
+    return false;
+
+  setCurrentIndex(index);
+  scrollTo(index);
+  return true;
+}
+
+QString MessageBrowser::selectedText() const
+{
+  QModelIndexList indexes = selectionModel()->selectedRows();
+  std::sort(indexes.begin(), indexes.end());
+
+  QStringList lines;
+  QModelIndexList::const_iterator it;
+  for (it = indexes.begin(); it != indexes.end(); ++it)
+    lines.append(model()->data(*it).toString());
+
+  return lines.join("\n");
+}
+
+void MessageBrowser::scrollToEnd()
+{
+  scrollToBottom();
+}
+
+bool MessageBrowser::eventFilter(QObject *o, QEvent *e)
+{
   if (e->type() != QEvent::MouseButtonPress)
-    return QTextEdit::eventFilter(o, e);
+    return QListView::eventFilter(o, e);
 
   QMouseEvent* m = (QMouseEvent*)e;
 
@@ -84,12 +278,18 @@ bool MessageBrowser::eventFilter(QObject *o, QEvent *e)
     return true;
   }
 
-  return QTextEdit::eventFilter(o, e);
+  return QListView::eventFilter(o, e);
 }
 
 void MessageBrowser::keyPressEvent(QKeyEvent* e)
 {
   //fprintf(stderr, "MessageBrowser::keyPressEvent(%x)\n", e->key());
+  if (e->matches(QKeySequence::Copy))
+  {
+    QApplication::clipboard()->setText(selectedText());
+    return;
+  }
+
   switch (e->key())
   {
   case Qt::Key_R:
@@ -112,7 +312,7 @@ void MessageBrowser::keyPressEvent(QKeyEvent* e)
     }
   };
 
-  QTextEdit::keyPressEvent(e);
+  QListView::keyPressEvent(e);
 }
 
 //----------------------------------------------------------------------
@@ -121,9 +321,7 @@ MessageFindDialog::MessageFindDialog(MessageBrowser* messageWindow,
 				     const QString& caption,
 				     QWidget* parent, const char* name)
   : QDialog(parent),
-    m_messageWindow(messageWindow),
-    m_lastParagraph(0),
-    m_lastIndex(0)
+    m_messageWindow(messageWindow)
 {
   setObjectName(name);
   setWindowTitle(caption);
@@ -146,31 +344,108 @@ MessageFindDialog::MessageFindDialog(MessageBrowser* messageWindow,
   grid->addWidget(m_matchCase, 1, 1);
   m_wholeWords = new QCheckBox("&Whole Words", this);
   grid->addWidget(m_wholeWords, 2, 1);
+  m_regexp = new QCheckBox("Regular E&xpression", this);
+  grid->addWidget(m_regexp, 3, 1);
   m_findBackwards = new QCheckBox("Find &Backwards", this);
-  grid->addWidget(m_findBackwards, 3, 1);
+  grid->addWidget(m_findBackwards, 4, 1);
 
 
   m_find = new QPushButton("&Find", this);
-  grid->addWidget(m_find, 4, 1);
+  grid->addWidget(m_find, 5, 1);
   m_find->setEnabled(false);
   connect(m_find, SIGNAL(clicked()), this, SLOT(find()));
+  m_findAll = new QPushButton("Find &All", this);
+  grid->addWidget(m_findAll, 5, 2);
+  m_findAll->setEnabled(false);
+  connect(m_findAll, SIGNAL(clicked()), this, SLOT(findAll()));
   QPushButton* close = new QPushButton("&Close", this);
-  grid->addWidget(close, 4, 3);
+  grid->addWidget(close, 5, 3);
   connect(close, SIGNAL(clicked()), this, SLOT(close()));
 
+  m_status = new QLabel(this);
+  grid->addWidget(m_status, 6, 0, 1, 4);
+
+  // find all results, picking one shows it in the message window
+  m_results = new QListWidget(this);
+  m_results->hide();
+  grid->addWidget(m_results, 7, 0, 1, 4);
+  connect(m_results, SIGNAL(itemClicked(QListWidgetItem*)),
+	  this, SLOT(showResult(QListWidgetItem*)));
+  connect(m_results, SIGNAL(itemActivated(QListWidgetItem*)),
+	  this, SLOT(showResult(QListWidgetItem*)));
+
   // turn off resizing
   setSizeGripEnabled(false);
 }
 
+bool MessageFindDialog::searchRegExp(QRegExp& regexp)
+{
+  QString pattern = m_findText->text();
+  if (!m_regexp->isChecked())
+    pattern = QRegExp::escape(pattern);
+  if (m_wholeWords->isChecked())
+    pattern = m_regexp->isChecked() ?
+      ("\\b(?:" + pattern + ")\\b") : ("\\b" + pattern + "\\b");
+
+  regexp = QRegExp(pattern, m_matchCase->isChecked() ?
+		   Qt::CaseSensitive : Qt::CaseInsensitive);
+  if (!regexp.isValid())
+  {
+    m_status->setText("Invalid expression: " + regexp.errorString());
+    return false;
+  }
+
+  return true;
+}
+
 void MessageFindDialog::find()
 {
   // perform a find in the message window, starting at the current position
   // using the settings from the checkboxes.
-  QTextDocument::FindFlags options;
-  if (m_matchCase->isChecked()) options |= QTextDocument::FindCaseSensitively;
-  if (m_wholeWords->isChecked()) options |= QTextDocument::FindWholeWords;
-  if (m_findBackwards->isChecked()) options |= QTextDocument::FindBackward;
-  m_messageWindow->find(m_findText->text(), options);
+  QRegExp regexp;
+  if (!searchRegExp(regexp))
+    return;
+
+  if (m_messageWindow->find(regexp, m_findBackwards->isChecked()))
+    m_status->clear();
+  else
+    m_status->setText("Not found");
+}
+
+void MessageFindDialog::findAll()
+{
+  QRegExp regexp;
+  if (!searchRegExp(regexp))
+    return;
+
+  // list every match, the text being what the message window shows.  One
+  // more than the limit is asked for to tell if the list was cut short.
+  QVector<uint64_t> matches = m_messageWindow->findAll(regexp,
+						       findAllLimit + 1);
+  bool more = (matches.size() > findAllLimit);
+  if (more)
+    matches.resize(findAllLimit);
+
+  m_results->clear();
+  QVector<uint64_t>::const_iterator it;
+  for (it = matches.begin(); it != matches.end(); ++it)
+  {
+    QString text = m_messageWindow->messageIndex(*it).data().toString();
+    QListWidgetItem* item = new QListWidgetItem(text, m_results);
+    item->setData(Qt::UserRole, QVariant(qulonglong(*it)));
+  }
+  m_results->show();
+
+  if (more)
+    m_status->setText(QString("First %1 matches").arg(matches.size()));
+  else
+    m_status->setText(QString("%1 matches").arg(matches.size()));
+}
+
+void MessageFindDialog::showResult(QListWidgetItem* item)
+{
+  if (!m_messageWindow->showMessage(item->data(Qt::UserRole).toULongLong()))
+    m_status->setText("Message is no longer shown");
 }
 
 void MessageFindDialog::close()
@@ -183,6 +458,7 @@ void MessageFindDialog::textChanged(const QString& newText)
 {
   // enable the find button iff there is text to search with
   m_find->setEnabled(!newText.isEmpty());
+  m_findAll->setEnabled(!newText.isEmpty());
 }
 
 //----------------------------------------------------------------------
@@ -461,6 +737,7 @@ MessageWindow::MessageWindow(Messages* messages, MessageFilters* filters,
   : SEQWindow(prefName, caption, parent, name),
     m_messages(messages),
     m_messageFilters(filters),
+    m_model(0),
     m_messageWindow(0),
     m_menu(0),
     m_typeFilterMenu(0),
@@ -517,8 +794,12 @@ MessageWindow::MessageWindow(Messages* messages, MessageFilters* filters,
   // allocate the array of type styles
   m_typeStyles = new MessageTypeStyle[MT_Max+1];
 
+  // the messages shown, formatted as the view asks for them
+  m_model = new MessageModel(m_messages, this);
+
   // create the window for text display
   m_messageWindow = new MessageBrowser(this, "messageText");
+  m_messageWindow->setModel(m_model);
 
   // make the message window the main widget of the SEQWindow
   setWidget(m_messageWindow);
@@ -527,7 +808,7 @@ MessageWindow::MessageWindow(Messages* messages, MessageFilters* filters,
   m_messageWindow->setFrameStyle(QFrame::Panel | QFrame::Sunken);
 
   // set the current font
-  m_messageWindow->setCurrentFont(font());
+  m_messageWindow->setFont(font());
 
   // set the colors
   QPalette p = m_messageWindow->palette();
@@ -535,24 +816,20 @@ MessageWindow::MessageWindow(Messages* messages, MessageFilters* filters,
   p.setColor(QPalette::Text, m_defaultColor);
   m_messageWindow->setPalette(p);
 
-  // make sure history isn't kept
-  m_messageWindow->setUndoRedoEnabled(false);
-
-  // set it to read only
-  m_messageWindow->setReadOnly(true);
-
-  // set the word wrap
-  m_messageWindow->setLineWrapMode(m_wrapText ?
-          QTextEdit::WidgetWidth : QTextEdit::NoWrap);
-
-  // set the wrap policy to break at space
-  m_messageWindow->setWordWrapMode(QTextOption::WordWrap);
+  // set the word wrap, rows that don't wrap are all the same height, so
+  // the view never has to measure them
+  m_messageWindow->setWordWrap(m_wrapText);
+  m_messageWindow->setUniformItemSizes(!m_wrapText);
 
   // connect to the Messages signal(s)
   connect(m_messages, SIGNAL(newMessage(const MessageEntry&)),
 	  this, SLOT(newMessage(const MessageEntry&)));
   connect(m_messages, SIGNAL(cleared(void)),
 	  this, SLOT(refreshMessages(void)));
+  connect(m_messages, SIGNAL(dropped(uint64_t)),
+	  this, SLOT(droppedMessages(uint64_t)));
+  connect(m_messages, SIGNAL(refiltered(uint32_t)),
+	  this, SLOT(refilteredMessages(uint32_t)));
 
   // connect to the message filters signals
   connect(m_messageFilters, SIGNAL(removed(uint32_t, uint8_t)),
@@ -718,16 +995,15 @@ QMenu* MessageWindow::menu()
   return m_menu;
 }
 
-void MessageWindow::addMessage(const MessageEntry& message)
+bool MessageWindow::isShown(MessageType type, uint32_t filterFlags) const
 {
-  MessageType type = message.type();
+  return ((((m_enabledTypes & (uint64_t(1) << type)) != 0) ||
+	   ((m_enabledShowUserFilters & filterFlags) != 0)) &&
+	  ((m_enabledHideUserFilters & filterFlags) == 0));
+}
 
-  // if the message type isn't enabled, nothing to do
-  if ((((m_enabledTypes & ( uint64_t(1) << type)) == 0) &&
-       ((m_enabledShowUserFilters & message.filterFlags()) == 0)) ||
-      ((m_enabledHideUserFilters & message.filterFlags()) != 0))
-    return;
-  
+QString MessageWindow::messageText(const MessageEntry& message) const
+{
   QString text;
 
   // if displaying the type, add it
@@ -747,71 +1023,40 @@ void MessageWindow::addMessage(const MessageEntry& message)
 
   text.replace(m_itemPattern, "\\2 (#\\1)");
 
-  // now append the message text to the buffer
-  m_messageWindow->append(text);
+  return text;
 }
 
-void MessageWindow::addColorMessage(const MessageEntry& message)
+QVariant MessageWindow::messageStyle(const MessageEntry& message,
+				     int role) const
 {
-  MessageType type = message.type();
-
-  // if the message type isn't enabled, nothing to do
-  if ((((m_enabledTypes & ( uint64_t(1) << type)) == 0) &&
-       ((m_enabledShowUserFilters & message.filterFlags()) == 0)) ||
-      ((m_enabledHideUserFilters & message.filterFlags()) != 0))
-    return;
-
-  // if the message has a specific color, then use it
-  if (message.color() != ME_InvalidColor)
-    m_messageWindow->setTextColor(QColor(message.color()));
-  else if (m_typeStyles[type].color().isValid()) // or use the types color
-    m_messageWindow->setTextColor(m_typeStyles[type].color());
-  else // otherwise use the default color
-    m_messageWindow->setTextColor(m_defaultColor);
-
-  if (m_typeStyles[type].useDefaultFont())
-    m_messageWindow->setCurrentFont(font());
-  else
-    m_messageWindow->setCurrentFont(m_typeStyles[type].font());
-
-  QString text;
-
-  // if displaying the type, add it
-  if (m_displayType)
-    text = MessageEntry::messageTypeString(type) + ": ";
-    
-  // if displaying the message date/time append it
-  if (m_displayDateTime)
-    text += message.dateTime().toString(m_dateTimeFormat) + " - ";
-
-  // if displaying the messages eq date/time, append it
-  if (m_displayEQDateTime && (message.eqDateTime().isValid()))
-    text += message.eqDateTime().toString(m_eqDateTimeFormat) + " - ";
+  // without type styles everything is in the default font and colors
+  if (!m_useTypeStyles)
+    return QVariant();
 
-  // append the actual message text
-  text += message.text();
+  const MessageTypeStyle& style = m_typeStyles[message.type()];
 
-  text.replace(m_itemPattern, "\\2 (#\\1)");
-
-  //Set the fg/bg colors
-  if (m_typeStyles[type].bgColor().isValid() &&
-          m_typeStyles[type].color().isValid())
+  switch (role)
   {
-      QTextCharFormat format = m_messageWindow->currentCharFormat();
-      format.setForeground(m_typeStyles[type].color());
-      format.setBackground(m_typeStyles[type].bgColor());
-      m_messageWindow->setCurrentCharFormat(format);
+  case Qt::ForegroundRole:
+    // if the message has a specific color, then use it
+    if (message.color() != ME_InvalidColor)
+      return QBrush(QColor(message.color()));
+    else if (style.color().isValid()) // or use the types color
+      return QBrush(style.color());
+    break;
+
+  case Qt::BackgroundRole:
+    if (style.bgColor().isValid() && style.color().isValid())
+      return QBrush(style.bgColor());
+    break;
+
+  case Qt::FontRole:
+    if (!style.useDefaultFont())
+      return style.font();
+    break;
   }
 
-  // now append the message text to the buffer
-  m_messageWindow->append(text);
-
-  //Reset the fg/bg colors
-  QTextCharFormat format = m_messageWindow->currentCharFormat();
-  format.setForeground(m_defaultColor);
-  format.setBackground(m_defaultBGColor);
-  m_messageWindow->setCurrentCharFormat(format);
-
+  return QVariant();
 }
 
 void MessageWindow::newMessage(const MessageEntry& message)
@@ -820,62 +1065,42 @@ void MessageWindow::newMessage(const MessageEntry& message)
   if (m_lockedText)
     return;
 
-  if (m_useTypeStyles)
-    addColorMessage(message);
-  else
-    addMessage(message);
+  // follow new messages only if already showing the last ones
+  QScrollBar* scrollBar = m_messageWindow->verticalScrollBar();
+  bool atEnd = (scrollBar->value() == scrollBar->maximum());
+
+  m_model->append(message);
+
+  if (atEnd)
+    m_messageWindow->scrollToEnd();
 }
 
 void MessageWindow::refreshMessages(void)
 {
-  // get the list of messages
-  const MessageList& messages = m_messages->messageList();
- 
-  // set the IBeam Cursor for easier text selection
-  setCursor(Qt::WaitCursor);
-  m_messageWindow->setCursor(Qt::WaitCursor);
-
-  // clear the document
-  m_messageWindow->clear();
-
-  // turn off updates while doing this mass update
-  m_messageWindow->setUpdatesEnabled(false);
-  setUpdatesEnabled(false);
-
-  m_messageWindow->append(" ");
-
-  // set the cursor to the beginning of the document
-  m_messageWindow->moveCursor(QTextCursor::Start, QTextCursor::MoveAnchor);
-
-  // move the cursor to the end of the document
-  m_messageWindow->moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
-
-  // iterate over the message list and add the messages
-  MessageList::const_iterator it;
-  int i;
-  if (m_useTypeStyles)
-    for (i = 0, it = messages.begin(); it != messages.end(); ++it, ++i)
-      addColorMessage(*it); // append the message with color
-  else 
-    for (i = 0, it = messages.begin(); it != messages.end(); ++it, ++i)
-      addMessage(*it); // append the message plain
-    
-  // turn updates back on 
-  m_messageWindow->setUpdatesEnabled(true);
-  setUpdatesEnabled(true);
+  // rebuilding the index doesn't need the messages themselves
+  m_model->rebuild();
 
-  // repain window now that updates have been re-enabled
-  repaint();
+  // show the newest messages
+  m_messageWindow->scrollToEnd();
+}
 
-  // set the IBeam Cursor for easier text selection
-  unsetCursor();
-  m_messageWindow->unsetCursor();
+void MessageWindow::droppedMessages(uint64_t firstSerial)
+{
+  m_model->drop(firstSerial);
+}
 
-  // move the cursor to the end of the document
-  m_messageWindow->moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
+void MessageWindow::refilteredMessages(uint32_t mask)
+{
+  // only matters if the filter decides what's shown here
+  if ((mask & (m_enabledShowUserFilters | m_enabledHideUserFilters)) != 0)
+    refilter();
+}
 
-  // move the cursor to the end of the document
-  m_messageWindow->ensureCursorVisible();
+void MessageWindow::refilter()
+{
+  // locked text stays as it is until it's unlocked
+  if (!m_lockedText)
+    m_model->rebuild();
 }
 
 void MessageWindow::findDialog(void)
@@ -914,7 +1139,8 @@ void MessageWindow::saveText(void)
   {
     QTextStream stream( &file );
 
-    stream << m_messageWindow->toPlainText() << ENDL;
+    for (int i = 0; i < m_model->rowCount(); i++)
+      stream << messageText(m_model->message(i)) << ENDL;
   }
 }
 
@@ -938,6 +1164,7 @@ void MessageWindow::toggleTypeFilter(QAction* action)
   // save the new setting
   pSEQPrefs->setPrefUInt64("EnabledTypes", preferenceName(), m_enabledTypes);
 
+  refilter();
 }
 
 void MessageWindow::disableAllTypeFilters()
@@ -945,7 +1172,7 @@ void MessageWindow::disableAllTypeFilters()
   // set and save all message types disabled
   m_enabledTypes = 0;
   pSEQPrefs->setPrefUInt64("EnabledTypes", preferenceName(), m_enabledTypes);
-
+  refilter();
 
   // uncheck all the menu items
   foreach (QAction* action, m_typeFilterMenu->actions())
@@ -964,7 +1191,7 @@ void MessageWindow::enableAllTypeFilters()
   // set and save all message types enabled
   m_enabledTypes = 0xFFFFFFFFFFFFFFFFULL;
   pSEQPrefs->setPrefUInt64("EnabledTypes", preferenceName(), m_enabledTypes);
-
+  refilter();
 
   // check all the menu items
   foreach (QAction* action, m_typeFilterMenu->actions())
@@ -998,6 +1225,8 @@ void MessageWindow::toggleShowUserFilter(QAction* action)
   pSEQPrefs->setPrefUInt("EnabledShowUserFilters", preferenceName(),
           m_enabledShowUserFilters);
 
+  refilter();
+
 }
 
 void MessageWindow::disableAllShowUserFilters()
@@ -1006,6 +1235,7 @@ void MessageWindow::disableAllShowUserFilters()
   m_enabledShowUserFilters = 0;
   pSEQPrefs->setPrefUInt("EnabledShowUserFilters", preferenceName(),
           m_enabledShowUserFilters);
+  refilter();
 
   // uncheck all the menu items
   foreach (QAction* action, m_showUserFilterMenu->actions())
@@ -1025,6 +1255,7 @@ void MessageWindow::enableAllShowUserFilters()
   m_enabledShowUserFilters = 0xFFFFFFFF;
   pSEQPrefs->setPrefUInt("EnabledShowUserFilters", preferenceName(),
           m_enabledShowUserFilters);
+  refilter();
 
   // check all the menu items
   foreach (QAction* action, m_showUserFilterMenu->actions())
@@ -1057,6 +1288,8 @@ void MessageWindow::toggleHideUserFilter(QAction* action)
   // save the new setting
   pSEQPrefs->setPrefUInt("EnabledHideUserFilters", preferenceName(),
           m_enabledHideUserFilters);
+
+  refilter();
 }
 
 void MessageWindow::disableAllHideUserFilters()
@@ -1065,6 +1298,7 @@ void MessageWindow::disableAllHideUserFilters()
   m_enabledHideUserFilters = 0;
   pSEQPrefs->setPrefUInt("EnabledHideUserFilters", preferenceName(),
           m_enabledHideUserFilters);
+  refilter();
 
   // uncheck all the menu items
   foreach (QAction* action, m_hideUserFilterMenu->actions())
@@ -1084,6 +1318,7 @@ void MessageWindow::enableAllHideUserFilters()
   m_enabledHideUserFilters = 0xFFFFFFFF;
   pSEQPrefs->setPrefUInt("EnabledHideUserFilters", preferenceName(),
           m_enabledHideUserFilters);
+  refilter();
 
   // check all the menu items
   foreach (QAction* action, m_hideUserFilterMenu->actions())
@@ -1112,6 +1347,8 @@ void MessageWindow::toggleDisplayType(bool enable)
   m_displayType = enable;
 
   pSEQPrefs->setPrefBool("DisplayType", preferenceName(), m_displayType);
+
+  m_model->restyle();
 }
 
 void MessageWindow::toggleDisplayTime(bool enable)
@@ -1120,6 +1357,8 @@ void MessageWindow::toggleDisplayTime(bool enable)
 
   pSEQPrefs->setPrefBool("DisplayDateTime", preferenceName(),
           m_displayDateTime);
+
+  m_model->restyle();
 }
 
 void MessageWindow::toggleEQDisplayTime(bool enable)
@@ -1128,6 +1367,8 @@ void MessageWindow::toggleEQDisplayTime(bool enable)
 
   pSEQPrefs->setPrefBool("DisplayEQDateTime", preferenceName(),
           m_displayEQDateTime);
+
+  m_model->restyle();
 }
 
 void MessageWindow::toggleUseTypeStyles(bool enable)
@@ -1135,6 +1376,8 @@ void MessageWindow::toggleUseTypeStyles(bool enable)
   m_useTypeStyles = enable;
 
   pSEQPrefs->setPrefBool("UseTypeStyles", preferenceName(), m_useTypeStyles);
+
+  m_model->restyle();
 }
 
 void MessageWindow::toggleWrapText(bool enable)
@@ -1144,8 +1387,8 @@ void MessageWindow::toggleWrapText(bool enable)
   pSEQPrefs->setPrefBool("WrapText", preferenceName(), m_wrapText);
 
   // set the wrap policy according to the setting
-  m_messageWindow->setLineWrapMode(m_wrapText ?
-          QTextEdit::WidgetWidth : QTextEdit::NoWrap);
+  m_messageWindow->setWordWrap(m_wrapText);
+  m_messageWindow->setUniformItemSizes(!m_wrapText);
 }
 
 void MessageWindow::setTypeStyle(QAction* action)
@@ -1172,6 +1415,8 @@ void MessageWindow::setTypeStyle(QAction* action)
 
     // save the updates
     m_typeStyles[id].save(preferenceName(), typeName);
+
+    m_model->restyle();
   }
 }
 
@@ -1186,6 +1431,9 @@ void MessageWindow::setColor()
   if (color.isValid())
   {
     m_defaultColor = color;
+    QPalette p = m_messageWindow->palette();
+    p.setColor(QPalette::Text, m_defaultColor);
+    m_messageWindow->setPalette(p);
 
     pSEQPrefs->setPrefColor("DefaultColor", preferenceName(), 
 			    m_defaultColor);
@@ -1218,7 +1466,7 @@ void MessageWindow::setFont()
   bool ok = false;
 
   // get a new font
-  newFont = QFontDialog::getFont(&ok, m_messageWindow->currentFont(),
+  newFont = QFontDialog::getFont(&ok, m_messageWindow->font(),
           this, windowTitle() + " Font");
 
 
@@ -1249,7 +1497,10 @@ void MessageWindow::restoreFont()
   
   // set the message windows font to match
   if (m_messageWindow)
-    m_messageWindow->setCurrentFont(font());
+  {
+    m_messageWindow->setFont(font());
+    m_model->restyle();
+  }
 }
 
 void MessageWindow::removedFilter(uint32_t mask, uint8_t filter)
@@ -24,10 +24,13 @@
 #define _MESSAGEWINDOW_H_
 
 #include "seqwindow.h"
+#include "message.h"
 
 #include <cstdint>
 
-#include <QTextEdit>
+#include <QListView>
+#include <QAbstractListModel>
+#include <QVector>
 #include <QRegExp>
 #include <QDialog>
 #include <QLabel>
@@ -43,20 +46,67 @@ class MessageFilter;
 class MessageFilters;
 class Messages;
 class MessageFilterDialog;
+class MessageWindow;
 
 class QMenu;
 class QLineEdit;
 class QCheckBox;
 class QLabel;
+class QListWidget;
+class QListWidgetItem;
+
+//----------------------------------------------------------------------
+// MessageModel
+//
+// The messages a MessageWindow shows, as an index of message serial
+// numbers into Messages.  Only the index is kept, the text is formatted
+// by the window when the view asks for a row.  Refiltering rebuilds the
+// index from the types and filter flags Messages keeps for every message,
+// without touching the messages themselves.
+class MessageModel : public QAbstractListModel
+{
+  Q_OBJECT
+ public:
+  MessageModel(Messages* messages, MessageWindow* window);
+
+  virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+  virtual QVariant data(const QModelIndex& index,
+			int role = Qt::DisplayRole) const;
+
+  Messages* messages() const { return m_messages; }
+  uint64_t serial(int row) const { return m_rows[row]; }
+  const QVector<uint64_t>& serials() const { return m_rows; }
+  int row(uint64_t serial) const;
+  MessageEntry message(int row) const;
+
+  void rebuild();
+  void append(const MessageEntry& message);
+  void drop(uint64_t firstSerial);
+  void restyle();
+
+ protected:
+  Messages* m_messages;
+  MessageWindow* m_window;
+  QVector<uint64_t> m_rows;
+};
 
 //----------------------------------------------------------------------
 // MessageBrowser
-class MessageBrowser : public QTextEdit
+class MessageBrowser : public QListView
 {
   Q_OBJECT
  public:
   MessageBrowser(QWidget* parent = 0, const char* name = 0);
 
+  // searches go through the index Messages keeps, only messages this
+  // browser shows are found
+  bool find(const QRegExp& regexp, bool backwards);
+  QVector<uint64_t> findAll(const QRegExp& regexp, int limit);
+  QModelIndex messageIndex(uint64_t serial) const;
+  bool showMessage(uint64_t serial);
+  QString selectedText() const;
+  void scrollToEnd();
+
  signals:
   void rightClickedMouse(QMouseEvent* e);
   void refreshRequest();
@@ -79,20 +129,26 @@ class MessageFindDialog : public QDialog
 
  public slots:
   void find();
+  void findAll();
   void close();
 
  protected slots:
   void textChanged(const QString& newText);
+  void showResult(QListWidgetItem* item);
 
  protected:
+  bool searchRegExp(QRegExp& regexp);
+
   MessageBrowser* m_messageWindow;
   QLineEdit* m_findText;
   QCheckBox* m_matchCase;
   QCheckBox* m_wholeWords;
+  QCheckBox* m_regexp;
   QCheckBox* m_findBackwards;
   QPushButton* m_find;
-  int m_lastParagraph;
-  int m_lastIndex;
+  QPushButton* m_findAll;
+  QLabel* m_status;
+  QListWidget* m_results;
 };
 
 //----------------------------------------------------------------------
@@ -169,6 +225,11 @@ class MessageWindow : public SEQWindow
   ~MessageWindow();
 
   virtual QMenu* menu();
+
+  // how the messages are shown, for the model
+  bool isShown(MessageType type, uint32_t filterFlags) const;
+  QString messageText(const MessageEntry& message) const;
+  QVariant messageStyle(const MessageEntry& message, int role) const;
   
  public slots:
   void newMessage(const MessageEntry& message);
@@ -201,13 +262,15 @@ class MessageWindow : public SEQWindow
   virtual void restoreFont();
   void removedFilter(uint32_t mask, uint8_t filter);
   void addedFilter(uint32_t mask, uint8_t filterid, const MessageFilter& filter);
+  void droppedMessages(uint64_t firstSerial);
+  void refilteredMessages(uint32_t mask);
 
  protected:
-  void addMessage(const MessageEntry& message);
-  void addColorMessage(const MessageEntry& message);
+  void refilter();
 
   Messages* m_messages;
   MessageFilters* m_messageFilters;
+  MessageModel* m_model;
   MessageBrowser* m_messageWindow;
   QMenu* m_menu;
   QMenu* m_typeFilterMenu;
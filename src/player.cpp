@@ -1293,6 +1293,15 @@ uint8_t Player::classVal() const
 	  m_defaultClass : m_class);
 }
 
+QString Player::filterString() const
+{
+  // the player's fields are assigned directly and switch between the
+  // detected and default values, so don't trust the cached segments
+  filterFieldsChanged(tFilterSegIdentity | tFilterSegDetail);
+
+  return Spawn::filterString();
+}
+
 void Player::savePlayerState(void)
 {
   QFile keyFile(showeq_params->saveRestoreBaseFilename + "Player.dat");
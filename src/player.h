@@ -103,6 +103,7 @@ public:
    virtual uint16_t deity() const;
    virtual uint16_t race() const;
    virtual uint8_t classVal() const;
+   virtual QString filterString() const;
 
    bool useAutoDetectedSettings() const { return m_useAutoDetectedSettings; }
    QString defaultName() const { return m_defaultName; }
@@ -0,0 +1,176 @@
+/*
+ *  searchbench.cpp
+ *  Copyright 2026 by the respective ShowEQ Developers
+ *
+ *  This file is part of ShowEQ.
+ *  http://www.sourceforge.net/projects/seq
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cstdlib>
+#include <cstdio>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QRegExp>
+#include <QElapsedTimer>
+
+#include "messageindex.h"
+#include "benchutil.h"
+
+// patterns the literal extraction has to get right, the escapes with
+// codes in them must not require the digits of the code
+struct SearchPattern
+{
+  const char* pattern;
+  QRegExp::PatternSyntax syntax;
+  Qt::CaseSensitivity cs;
+  bool narrows;
+};
+
+static const SearchPattern patterns[] =
+{
+  { "tells you", QRegExp::FixedString, Qt::CaseInsensitive, true },
+  { "Gnoll Fang", QRegExp::RegExp, Qt::CaseSensitive, true },
+  { "\\bLady\\b", QRegExp::RegExp, Qt::CaseSensitive, true },
+  { "hits .* for 4\\d\\d points", QRegExp::RegExp, Qt::CaseSensitive, true },
+  { "loot(ed)? a", QRegExp::RegExp, Qt::CaseInsensitive, true },
+  { "Vox|Darkpaw", QRegExp::RegExp, Qt::CaseSensitive, false },
+  { "\\x41bc", QRegExp::RegExp, Qt::CaseSensitive, false },
+  { "\\x0041bcdef", QRegExp::RegExp, Qt::CaseSensitive, false },
+  { "\\0101bc", QRegExp::RegExp, Qt::CaseSensitive, false },
+  { "[\\x41]bc Token", QRegExp::RegExp, Qt::CaseSensitive, true },
+  { "Phin*gel", QRegExp::Wildcard, Qt::CaseSensitive, true },
+  { "LFG \\d+ at 1", QRegExp::RegExp, Qt::CaseSensitive, true },
+};
+
+// Checks that the trigram index never rules out a block of messages that
+// has a match, and compares searching through it with scanning them all.
+// usage: searchbench [messages] [iterations]
+int main (int argc, char *argv[])
+{
+  int numMessages = (argc > 1) ? atoi(argv[1]) : 65536;
+  int iterations = (argc > 2) ? atoi(argv[2]) : 5;
+  int numPatterns = sizeof(patterns) / sizeof(patterns[0]);
+  int numBlocks = (numMessages + MessageIndexBlockSize - 1) /
+    MessageIndexBlockSize;
+  int i, j, k;
+
+  srand(BENCH_SEED);
+
+  // a name and an item for the hex and octal escapes to find
+  BenchMessages generator;
+  generator.names << "Abcdef";
+  generator.items << "Abc Token";
+
+  // the messages, and the trigram bits of each block of them
+  QStringList messages;
+  QVector<uint64_t> trigrams(numBlocks * MessageIndexBlockWords, 0);
+  for (i = 0; i < numMessages; i++)
+  {
+    messages.append(generator.message());
+    MessageIndexQuery::addText(trigrams.data() + (i / MessageIndexBlockSize) *
+			       MessageIndexBlockWords, messages.last());
+  }
+
+  QVector<QRegExp> regexps;
+  for (k = 0; k < numPatterns; k++)
+    regexps.append(QRegExp(patterns[k].pattern, patterns[k].cs,
+			   patterns[k].syntax));
+
+  printf("messages: %d, blocks: %d, patterns: %d, iterations: %d\n",
+	 numMessages, numBlocks, numPatterns, iterations);
+
+  // validate the index against matching every message
+  int mismatches = 0;
+  for (k = 0; k < numPatterns; k++)
+  {
+    MessageIndexQuery query(regexps[k]);
+    if (query.narrows() != patterns[k].narrows)
+    {
+      mismatches++;
+      fprintf(stderr, "'%s' %s narrow the search\n", patterns[k].pattern,
+	      query.narrows() ? "should not" : "should");
+    }
+
+    int matches = 0;
+    int skipped = 0;
+    for (j = 0; j < numBlocks; j++)
+    {
+      bool mayMatch = query.mayMatch(trigrams.constData() +
+				     j * MessageIndexBlockWords);
+      if (!mayMatch)
+	skipped++;
+
+      int end = qMin((j + 1) * MessageIndexBlockSize, numMessages);
+      for (i = j * MessageIndexBlockSize; i < end; i++)
+      {
+	if (regexps[k].indexIn(messages[i]) == -1)
+	  continue;
+
+	matches++;
+	if (!mayMatch)
+	{
+	  mismatches++;
+	  fprintf(stderr, "'%s' skipped a match: %s\n", patterns[k].pattern,
+		  messages[i].toUtf8().data());
+	}
+      }
+    }
+
+    printf("%-24s matches: %6d, blocks skipped: %5d\n",
+	   patterns[k].pattern, matches, skipped);
+  }
+
+  printf("mismatches: %d\n", mismatches);
+
+  QElapsedTimer timer;
+  int found = 0;
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (k = 0; k < numPatterns; k++)
+      for (i = 0; i < numMessages; i++)
+	if (regexps[k].indexIn(messages[i]) != -1)
+	  found++;
+  qint64 scan = timer.nsecsElapsed();
+
+  timer.start();
+  for (j = 0; j < iterations; j++)
+    for (k = 0; k < numPatterns; k++)
+    {
+      MessageIndexQuery query(regexps[k]);
+      for (i = 0; i < numMessages; i += MessageIndexBlockSize)
+      {
+	if (!query.mayMatch(trigrams.constData() +
+			    (i / MessageIndexBlockSize) *
+			    MessageIndexBlockWords))
+	  continue;
+
+	int end = qMin(i + MessageIndexBlockSize, numMessages);
+	for (int m = i; m < end; m++)
+	  if (regexps[k].indexIn(messages[m]) != -1)
+	    found--;
+      }
+    }
+  qint64 indexed = timer.nsecsElapsed();
+
+  benchReport("search", double(numPatterns) * iterations,
+	      "scan:", scan, "indexed:", indexed);
+
+  return benchResult(mismatches, found);
+}
@@ -32,6 +32,174 @@
 #include "seqlistview.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// column preference handling shared by SEQListView and SEQTreeView
+static void saveColumnPrefs(QTreeView* view,
+                            const QString& preferenceName,
+                            const QStringList& columns,
+                            int sortColumn, bool sortIncreasing)
+{
+    int i;
+    int width;
+    QString columnName;
+    QString show = "Show";
+    QHeaderView* header = view->header();
+
+    // save the column width's/visibility
+    for (i = 0; i < columns.count(); i++)
+    {
+        columnName = columns[i];
+        width = view->columnWidth(i);
+        if (!header->isSectionHidden(i) && width != 0)
+        {
+            pSEQPrefs->setPrefInt(columnName + "Width", preferenceName, width);
+            pSEQPrefs->setPrefBool(show + columnName, preferenceName, true);
+        }
+        else
+            pSEQPrefs->setPrefBool(show + columnName, preferenceName, false);
+    }
+
+    // save the column order
+    QString tempStr, tempStr2;
+    if (header->count() > 0)
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+        tempStr = QString::asprintf("%d", header->logicalIndex(0));
+#else
+        tempStr.sprintf("%d", header->logicalIndex(0));
+#endif
+    for(i=1; i < header->count(); i++)
+    {
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+        tempStr2 = QString::asprintf(":%d", header->logicalIndex(i));
+#else
+        tempStr2.sprintf(":%d", header->logicalIndex(i));
+#endif
+        tempStr += tempStr2;
+    }
+    pSEQPrefs->setPrefString("ColumnOrder", preferenceName, tempStr);
+
+    // save the current sorting state
+    pSEQPrefs->setPrefInt("SortColumn", preferenceName, sortColumn);
+    pSEQPrefs->setPrefBool("SortIncreasing", preferenceName, sortIncreasing);
+}
+
+static void restoreColumnPrefs(QTreeView* view,
+                               const QString& preferenceName,
+                               const QStringList& columns)
+{
+    int i;
+    int width;
+    QString columnName;
+    QString show = "Show";
+    QHeaderView* hdr = view->header();
+
+    // restore the column width's/visibility
+    for (i = 0; i < columns.count(); i++)
+    {
+        columnName = columns[i];
+
+        // check if the column is visible
+        if (pSEQPrefs->getPrefBool(show + columnName, preferenceName, true))
+        {
+            // check if the column has a width specified
+            if (pSEQPrefs->isPreference(columnName + "Width", preferenceName))
+            {
+                // use the specified column width
+                width = pSEQPrefs->getPrefInt(columnName + "Width", preferenceName);
+            }
+            else
+            {
+                width = hdr->sectionSizeHint(i);
+            }
+
+#if QT_VERSION >= 0x050000
+            hdr->setSectionResizeMode(i, QHeaderView::Interactive);
+#else
+            hdr->setResizeMode(i, QHeaderView::Interactive);
+#endif
+            hdr->resizeSection(i, width);
+            view->setColumnWidth(i, width);
+            hdr->setSectionHidden(i, false);
+        }
+        else
+        {
+            // column is not visible, hide it.
+#if QT_VERSION >= 0x050000
+            hdr->setSectionResizeMode(i, QHeaderView::Interactive);
+#else
+            hdr->setResizeMode(i, QHeaderView::Interactive);
+#endif
+            hdr->resizeSection(i, 0);
+            view->setColumnWidth(i, 0);
+            hdr->setSectionHidden(i, true);
+        }
+    }
+
+    // restore the column order
+    QString tStr = pSEQPrefs->getPrefString("ColumnOrder", preferenceName, "N/A");
+
+    if (tStr != "N/A")
+    {
+        int i = 0;
+        while (!tStr.isEmpty())
+        {
+            int toIndex;
+            if (tStr.indexOf(':') != -1)
+            {
+                toIndex = tStr.left(tStr.indexOf(':')).toInt();
+                tStr = tStr.right(tStr.length() - tStr.indexOf(':') - 1);
+            }
+            else
+            {
+                toIndex = tStr.toInt();
+                tStr = "";
+            }
+            hdr->moveSection(hdr->visualIndex(toIndex), i++);
+        }
+    }
+}
+
+static void showColumn(QTreeView* view,
+                       const QString& preferenceName,
+                       const QString& columnName,
+                       int column, bool visible)
+{
+    // default width is 0
+    int width = 0;
+
+    // if column is to become visible, get it's width
+    if (visible)
+    {
+        // get the column width
+        width = pSEQPrefs->getPrefInt(columnName + "Width", preferenceName,
+                view->columnWidth(column));
+
+        // if it's zero, use default width of 40
+        if (width == 0)
+            width = 40;
+    }
+
+#if QT_VERSION >= 0x050000
+    view->header()->setSectionResizeMode(column, QHeaderView::Interactive);
+#else
+    view->header()->setResizeMode(column, QHeaderView::Interactive);
+#endif
+    view->header()->resizeSection(column, width);
+    view->setColumnWidth(column, width);
+
+    view->header()->setSectionHidden(column, !visible);
+
+
+    // set the the preferences as to if the column is shown
+    pSEQPrefs->setPrefBool(QString("Show") + columnName, preferenceName,
+            (width != 0));
+
+    // trigger an update, otherwise things may look messy
+    view->update();
+}
+
+//----------------------------------------------------------------------
+// SEQListView
 SEQListView::SEQListView(const QString prefName,
                          QWidget* parent,
                          const char* name,
@@ -133,179 +301,144 @@ void SEQListView::savePrefs()
 {
     // only save the preferences if visible
     if (isVisible())
-    {
-        int i;
-        int width;
-        QString columnName;
-        QString show = "Show";
+        saveColumnPrefs(this, preferenceName(), m_columns,
+                        m_sortColumn, m_sortIncreasing);
+}
 
-        // save the column width's/visibility
-        for (i = 0; i < columnCount(); i++)
-        {
-            columnName = columnPreferenceName(i);
-            width = columnWidth(i);
-            if (!header()->isSectionHidden(i) && width != 0)
-            {
-                pSEQPrefs->setPrefInt(columnName + "Width", preferenceName(), width);
-                pSEQPrefs->setPrefBool(show + columnName, preferenceName(), true);
-            }
-            else
-                pSEQPrefs->setPrefBool(show + columnName, preferenceName(), false);
-        }
+void SEQListView::restoreColumns()
+{
+    restoreColumnPrefs(this, preferenceName(), m_columns);
 
-        // save the column order
-        QString tempStr, tempStr2;
-        if (header()->count() > 0)
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-            tempStr = QString::asprintf("%d", header()->logicalIndex(0));
-#else
-            tempStr.sprintf("%d", header()->logicalIndex(0));
-#endif
-        for(i=1; i < header()->count(); i++)
-        {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-            tempStr2 = QString::asprintf(":%d", header()->logicalIndex(i));
-#else
-            tempStr2.sprintf(":%d", header()->logicalIndex(i));
-#endif
-            tempStr += tempStr2;
-        }
-        pSEQPrefs->setPrefString("ColumnOrder", preferenceName(), tempStr);
+    // restore sorting state
+    setSorting(pSEQPrefs->getPrefInt("SortColumn", preferenceName(),
+                m_sortColumn),
+            pSEQPrefs->getPrefBool("SortIncreasing", preferenceName(),
+                m_sortIncreasing));
+}
 
-        // save the current sorting state
-        pSEQPrefs->setPrefInt("SortColumn", preferenceName(), m_sortColumn);
-        pSEQPrefs->setPrefBool("SortIncreasing", preferenceName(),
-                m_sortIncreasing);
-    }
+void SEQListView::setColumnVisible(int column, bool visible)
+{
+    showColumn(this, preferenceName(), columnPreferenceName(column),
+               column, visible);
 }
 
-void SEQListView::restoreColumns()
+void SEQListView::mousePressEvent(QMouseEvent* event)
 {
-    int i;
-    int width;
-    QString columnName;
-    QString show = "Show";
+    if (event->button() == Qt::RightButton)
+        emit mouseRightButtonPressed(event);
 
-    // restore the column width's/visibility
-    for (i = 0; i < columnCount(); i++)
-    {
-        columnName = columnPreferenceName(i);
+    QTreeWidget::mousePressEvent(event);
+}
 
-        // check if the column is visible
-        if (pSEQPrefs->getPrefBool(show + columnName, preferenceName(), true))
-        {
-            // check if the column has a width specified
-            if (pSEQPrefs->isPreference(columnName + "Width", preferenceName()))
-            {
-                // use the specified column width
-                width = pSEQPrefs->getPrefInt(columnName + "Width", preferenceName());
-            }
-            else
-            {
-                width = header()->sectionSizeHint(i);
-            }
+//----------------------------------------------------------------------
+// SEQTreeView
+SEQTreeView::SEQTreeView(const QString prefName,
+                         QWidget* parent,
+                         const char* name,
+                         Qt::WindowFlags f)
+    : QTreeView(parent),
+    m_preferenceName(prefName),
+    m_sortColumn(0),
+    m_sortIncreasing(true)
+{
+    setObjectName(name);
+    setWindowFlags(f);
 
-#if QT_VERSION >= 0x050000
-            header()->setSectionResizeMode(i, QHeaderView::Interactive);
-#else
-            header()->setResizeMode(i, QHeaderView::Interactive);
-#endif
-            header()->resizeSection(i, width);
-            setColumnWidth(i, width);
-            header()->setSectionHidden(i, false);
-        }
-        else
-        {
-            // column is not visible, hide it.
-#if QT_VERSION >= 0x050000
-            header()->setSectionResizeMode(i, QHeaderView::Interactive);
-#else
-            header()->setResizeMode(i, QHeaderView::Interactive);
+    // same defaults as SEQListView, and all rows are one line of text
+    setSortingEnabled(true);
+    setRootIsDecorated(false);
+    setUniformRowHeights(true);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setSelectionBehavior(QAbstractItemView::SelectRows);
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5,11,0))
+    header()->setFirstSectionMovable(true);
 #endif
-            header()->resizeSection(i, 0);
-            setColumnWidth(i, 0);
-            header()->setSectionHidden(i, true);
-        }
-    }
+    connect(header(), SIGNAL(sortIndicatorChanged(int, Qt::SortOrder)),
+            this, SLOT(setSorting(int, Qt::SortOrder)));
+}
 
-    // restore the column order
-    QString tStr = pSEQPrefs->getPrefString("ColumnOrder", preferenceName(), "N/A");
+SEQTreeView::~SEQTreeView()
+{
+}
 
-    QHeaderView* hdr = header();
-    if (tStr != "N/A")
-    {
-        int i = 0;
-        while (!tStr.isEmpty())
-        {
-            int toIndex;
-            if (tStr.indexOf(':') != -1)
-            {
-                toIndex = tStr.left(tStr.indexOf(':')).toInt();
-                tStr = tStr.right(tStr.length() - tStr.indexOf(':') - 1);
-            }
-            else
-            {
-                toIndex = tStr.toInt();
-                tStr = "";
-            }
-            hdr->moveSection(hdr->visualIndex(toIndex), i++);
-        }
-    }
+const QString& SEQTreeView::columnPreferenceName(int column) const
+{
+    // return the base name of the preference for the requested column
+    return m_columns[column];
+}
 
-    // restore sorting state
-    setSorting(pSEQPrefs->getPrefInt("SortColumn", preferenceName(),
-                m_sortColumn),
-            pSEQPrefs->getPrefBool("SortIncreasing", preferenceName(),
-                m_sortIncreasing));
+QSizePolicy SEQTreeView::sizePolicy() const
+{
+    return QSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 }
 
-void SEQListView::setColumnVisible(int column, bool visible)
+int SEQTreeView::addColumn(const QString& preference)
 {
-    QString columnName = columnPreferenceName(column);
+    // the model supplies the header labels, only the preference is kept
+    m_columns.append(preference);
 
-    // default width is 0
-    int width = 0;
+    return m_columns.count() - 1;
+}
 
-    // if column is to become visible, get it's width
-    if (visible)
-    {
-        // get the column width
-        width = pSEQPrefs->getPrefInt(columnName + "Width", preferenceName(), 
-                columnWidth(column));
+void SEQTreeView::setSorting(int column, bool increasing)
+{
+    setSorting(column, increasing ? Qt::AscendingOrder : Qt::DescendingOrder);
+}
 
-        // if it's zero, use default width of 40
-        if (width == 0)
-            width = 40;
-    }
+void SEQTreeView::setSorting(int column, Qt::SortOrder order)
+{
+    m_sortColumn = column;
+    m_sortIncreasing = (order == Qt::AscendingOrder) ? true : false;
 
-#if QT_VERSION >= 0x050000
-    header()->setSectionResizeMode(column, QHeaderView::Interactive);
-#else
-    header()->setResizeMode(column, QHeaderView::Interactive);
-#endif
-    header()->resizeSection(column, width);
-    setColumnWidth(column, width);
+    // avoid recursing through the sort indicator
+    if ((header()->sortIndicatorSection() != column) ||
+        (header()->sortIndicatorOrder() != order))
+        sortByColumn(column, order);
+}
 
-    header()->setSectionHidden(column, !visible);
+void SEQTreeView::savePrefs()
+{
+    // only save the preferences if visible
+    if (isVisible())
+        saveColumnPrefs(this, preferenceName(), m_columns,
+                        m_sortColumn, m_sortIncreasing);
+}
 
+void SEQTreeView::restoreColumns()
+{
+    restoreColumnPrefs(this, preferenceName(), m_columns);
 
-    // set the the preferences as to if the column is shown
-    pSEQPrefs->setPrefBool(QString("Show") + columnName, preferenceName(),
-            (width != 0));
+    // restore sorting state
+    int column = pSEQPrefs->getPrefInt("SortColumn", preferenceName(),
+                                       m_sortColumn);
+    bool increasing = pSEQPrefs->getPrefBool("SortIncreasing",
+                                             preferenceName(),
+                                             m_sortIncreasing);
+    m_sortColumn = column;
+    m_sortIncreasing = increasing;
 
-    // trigger an update, otherwise things may look messy
-    update();
+    // the header only passes on changes, make sure the model is told
+    Qt::SortOrder order = increasing ? Qt::AscendingOrder : Qt::DescendingOrder;
+    header()->setSortIndicator(column, order);
+    if (model() != NULL)
+        model()->sort(column, order);
 }
 
-void SEQListView::mousePressEvent(QMouseEvent* event)
+void SEQTreeView::setColumnVisible(int column, bool visible)
+{
+    showColumn(this, preferenceName(), columnPreferenceName(column),
+               column, visible);
+}
+
+void SEQTreeView::mousePressEvent(QMouseEvent* event)
 {
     if (event->button() == Qt::RightButton)
         emit mouseRightButtonPressed(event);
 
-    QTreeWidget::mousePressEvent(event);
+    QTreeView::mousePressEvent(event);
 }
 
 #ifndef QMAKEBUILD
 #include "seqlistview.moc"
 #endif
-
@@ -30,6 +30,7 @@
 #define SEQLISTVIEW_H
 
 #include <QTreeWidget>
+#include <QTreeView>
 #include <QMouseEvent>
 #include <QString>
 #include <QStringList>
@@ -83,4 +84,46 @@ class SEQListView : public QTreeWidget
         bool m_sortIncreasing;
 };
 
+// the model/view counterpart of SEQListView, for lists too big to keep a
+// widget item per row.  The model provides the column headers, addColumn()
+// just names the column's preferences.
+class SEQTreeView : public QTreeView
+{
+    Q_OBJECT
+
+    public:
+        SEQTreeView(const QString prefName,
+                    QWidget* parent = 0,
+                    const char* name = 0,
+                    Qt::WindowFlags f = Qt::Widget);
+        ~SEQTreeView();
+
+        const QString& preferenceName() const { return m_preferenceName; }
+        const QString& columnPreferenceName(int column) const;
+
+        QSizePolicy sizePolicy() const;
+
+        int addColumn(const QString& preference);
+        bool columnVisible(int column) { return (columnWidth(column) != 0); }
+        void setSorting(int column, bool increasing);
+        int sortColumn() const { return m_sortColumn; }
+        bool sortIncreasing() const { return m_sortIncreasing; }
+
+    public slots:
+        virtual void restoreColumns(void);
+        virtual void savePrefs(void);
+        void setColumnVisible(int column, bool visible);
+        virtual void setSorting(int column, Qt::SortOrder order);
+        void mousePressEvent(QMouseEvent* event);
+
+    signals:
+        void mouseRightButtonPressed(QMouseEvent*);
+
+    private:
+        QString m_preferenceName;
+        QStringList m_columns;
+        int m_sortColumn;
+        bool m_sortIncreasing;
+};
+
 #endif // SEQLISTVIEW_H
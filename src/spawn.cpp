@@ -249,9 +249,15 @@ QString print_item (uint16_t item)
 Item::Item(spawnItemType t, uint16_t id)
   : m_filterFlags(0),
     m_runtimeFilterFlags(0),
+    m_positionIndex(-1),
+    m_filterDirty(tFilterSegAll),
+    m_filterStale(tFilterStaleAll),
+    m_filterSerial(0),
     m_ID(id),
     m_NPC(99), // random bogus value
-    m_type(t)
+    m_type(t),
+    m_fdist(0.0),
+    m_idist(0)
 {
   m_spawnTime.start();
   m_lastUpdate.start();
@@ -298,21 +304,56 @@ QString Item::info() const
 }
 
 QString Item::filterString() const
+{
+  // only regenerate the segments whose fields changed since the last call
+  if (m_filterDirty)
+  {
+    if (m_filterDirty & tFilterSegIdentity)
+      m_filterIdentity = formatFilterSegment(tFilterSegIdentity);
+    if (m_filterDirty & tFilterSegPosition)
+      m_filterPosition = formatFilterSegment(tFilterSegPosition);
+    if (m_filterDirty & tFilterSegDetail)
+      m_filterDetail = formatFilterSegment(tFilterSegDetail);
+
+    m_filterString = m_filterIdentity + m_filterPosition + m_filterDetail;
+    m_filterDirty = tFilterSegNone;
+  }
+
+  return m_filterString;
+}
+
+QString Item::formatFilterSegment(filterSegment segment) const
 {
   QString buff;
+
+  switch (segment)
+  {
+  case tFilterSegIdentity:
 #if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-  buff = QString::asprintf("Name:%s:Race:%s:Class:%s:NPC:%d:X:%d:Y:%d:Z:%d:",
+    buff = QString::asprintf("Name:%s:Race:%s:Class:%s:NPC:%d:",
           transformedName().toUtf8().data(),
           raceString().toUtf8().data(),
           classString().toUtf8().data(),
-          NPC(), x(), y(), z());
+          NPC());
 #else
-  buff.sprintf("Name:%s:Race:%s:Class:%s:NPC:%d:X:%d:Y:%d:Z:%d:",
+    buff.sprintf("Name:%s:Race:%s:Class:%s:NPC:%d:",
           transformedName().toUtf8().data(),
           raceString().toUtf8().data(),
           classString().toUtf8().data(),
-          NPC(), x(), y(), z());
+          NPC());
+#endif
+    break;
+  case tFilterSegPosition:
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+    buff = QString::asprintf("X:%d:Y:%d:Z:%d:", x(), y(), z());
+#else
+    buff.sprintf("X:%d:Y:%d:Z:%d:", x(), y(), z());
 #endif
+    break;
+  default:
+    break;
+  }
+
   return buff;
 }
 
@@ -325,17 +366,7 @@ void Item::setPos(int16_t x, int16_t y, int16_t z)
 {
   // set the item position
   setPoint(x, y, z);
-}
-
-void Item::setDistanceToPlayer(double dist)
-{
-    m_fdist = dist;
-    m_idist = (uint32_t)m_fdist;
-}
-
-void Item::setDistanceToPlayer(uint32_t dist)
-{
-    m_idist = dist;
+  filterFieldsChanged(tFilterSegPosition);
 }
 
 //----------------------------------------------------------------------
@@ -480,6 +511,12 @@ Spawn::~Spawn()
   m_spawnTrackList.clear();
 }
 
+ItemArena& Spawn::arena()
+{
+  static ItemArena spawnArena("Spawn", sizeof(Spawn));
+  return spawnArena;
+}
+
 void Spawn::update(const spawnStruct* s)
 {
   setName(s->name);
@@ -583,7 +620,7 @@ void Spawn::backfill(const spawnStruct* s)
   // if it's dead,  append the corpse designator and make sure it's not moving
   if (isCorpse())
   {
-    m_name += Spawn_Corpse_Designator;
+    setName(m_name + Spawn_Corpse_Designator);
     setDeltas(0, 0, 0);
     setHeading(0, 0);
   }
@@ -953,21 +990,33 @@ QString Spawn::typeString() const
     return QString::number(typeflag());
 }
 
-QString Spawn::filterString() const
+QString Spawn::formatFilterSegment(filterSegment segment) const
 {
-  QString name = transformedName();
-
   QString buff;
+
+  switch (segment)
+  {
+  case tFilterSegIdentity:
 #if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-  buff = QString::asprintf("Name:%s:Level:%d:Race:%s:Class:%s:NPC:%d:X:%d:Y:%d:Z:%d:"
-          "Light:%s:Deity:%s:RTeam:%d:DTeam:%d:Type:%s:LastName:%s:Guild:%s:Spawn:%s:"
-          "Info:%s:",
-          name.toUtf8().data(),
+    buff = QString::asprintf("Name:%s:Level:%d:Race:%s:Class:%s:NPC:%d:",
+          transformedName().toUtf8().data(),
           level(),
           raceString().toUtf8().data(),
           classString().toUtf8().data(),
-          ((NPC() == 10) ? 0 : NPC()),
-          x(), y(), z(),
+          ((NPC() == 10) ? 0 : NPC()));
+#else
+    buff.sprintf("Name:%s:Level:%d:Race:%s:Class:%s:NPC:%d:",
+          transformedName().toUtf8().data(),
+          level(),
+          raceString().toUtf8().data(),
+          classString().toUtf8().data(),
+          ((NPC() == 10) ? 0 : NPC()));
+#endif
+    break;
+  case tFilterSegDetail:
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+    buff = QString::asprintf("Light:%s:Deity:%s:RTeam:%d:DTeam:%d:Type:%s:LastName:%s:Guild:%s:Spawn:%s:"
+          "Info:%s:",
           lightName().toUtf8().data(),
           deityName().toUtf8().data(),
           raceTeam(),
@@ -979,15 +1028,8 @@ QString Spawn::filterString() const
           info().toUtf8().data()
           );
 #else
-  buff.sprintf("Name:%s:Level:%d:Race:%s:Class:%s:NPC:%d:X:%d:Y:%d:Z:%d:"
-          "Light:%s:Deity:%s:RTeam:%d:DTeam:%d:Type:%s:LastName:%s:Guild:%s:Spawn:%s:"
+    buff.sprintf("Light:%s:Deity:%s:RTeam:%d:DTeam:%d:Type:%s:LastName:%s:Guild:%s:Spawn:%s:"
           "Info:%s:",
-          name.toUtf8().data(),
-          level(),
-          raceString().toUtf8().data(),
-          classString().toUtf8().data(),
-          ((NPC() == 10) ? 0 : NPC()),
-          x(), y(), z(),
           lightName().toUtf8().data(),
           deityName().toUtf8().data(),
           raceTeam(),
@@ -1000,8 +1042,13 @@ QString Spawn::filterString() const
           );
 #endif
 
-  if (gm())
-    buff += QString("GM:") + QString::number(gm()) + ":";
+    if (gm())
+      buff += QString("GM:") + QString::number(gm()) + ":";
+    break;
+  default:
+    buff = Item::formatFilterSegment(segment);
+    break;
+  }
 
   return buff;
 }
@@ -1150,6 +1197,12 @@ Door::~Door()
 {
 }
 
+ItemArena& Door::arena()
+{
+  static ItemArena doorArena("Door", sizeof(Door));
+  return doorArena;
+}
+
 void Door::update(const doorStruct* d)
 {
   QString temp;
@@ -1158,10 +1211,11 @@ void Door::update(const doorStruct* d)
 	 (int16_t)(d->z * 10.0));
   setHeading((int8_t)lrintf(d->heading));
 #if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-  m_name = QString::asprintf("Door: %s (%d) ", d->name, d->doorId);
+  temp = QString::asprintf("Door: %s (%d) ", d->name, d->doorId);
 #else
-  m_name.sprintf("Door: %s (%d) ", d->name, d->doorId);
+  temp.sprintf("Door: %s (%d) ", d->name, d->doorId);
 #endif
+  setName(temp);
   setZonePoint(d->zonePoint);
   updateLast();
 }
@@ -1190,6 +1244,12 @@ Drop::~Drop()
 {
 }
 
+ItemArena& Drop::arena()
+{
+  static ItemArena dropArena("Drop", sizeof(Drop));
+  return dropArena;
+}
+
 void Drop::update(const makeDropStruct* d, const QString& name)
 {
   int itemId;
@@ -47,6 +47,7 @@
 
 #include "everquest.h"
 #include "point.h"
+#include "itemarena.h"
 
 //----------------------------------------------------------------------
 // forward declarations
@@ -108,6 +109,27 @@ enum changeType
   tSpawnChangedALL = 1023, // sum of all previous change types 
 };
 
+// segments of an items filter string, each is regenerated only when
+// one of the fields it contains changes
+enum filterSegment
+{
+  tFilterSegNone = 0,
+  tFilterSegIdentity = 1, // Name, Level, Race, Class, NPC
+  tFilterSegPosition = 2, // X, Y, Z
+  tFilterSegDetail = 4,   // Light, Deity, Teams, Type, LastName, Guild, ...
+  tFilterSegAll = 7,
+};
+
+// which filter flags need re-evaluating because a non-position field of
+// the filter string changed since they were last evaluated
+enum filterStaleFlags
+{
+  tFilterStaleNone = 0,
+  tFilterStaleFilter = 1,
+  tFilterStaleRuntime = 2,
+  tFilterStaleAll = 3,
+};
+
 
 //----------------------------------------------------------------------
 // type definitions
@@ -149,6 +171,7 @@ class Item : public EQPoint
   uint8_t NPC() const { return m_NPC; }
   double getFDistanceToPlayer() const { return m_fdist; }
   uint32_t getIDistanceToPlayer() const { return m_idist; }
+  int positionIndex() const { return m_positionIndex; }
 
   // virtual methods that provide reasonable default values/behaviour
   virtual QString name() const;
@@ -160,18 +183,28 @@ class Item : public EQPoint
   virtual QString info() const;
   virtual QString filterString() const;
   virtual QString dumpString() const;
+  bool filterStale(uint8_t which) const { return (m_filterStale & which); }
+  uint16_t filterSerial() const { return m_filterSerial; }
 
   // set methods
-  void setDistanceToPlayer(double);
-  void setDistanceToPlayer(uint32_t);
+  void setDistanceToPlayer(double dist)
+    { m_fdist = dist; m_idist = (uint32_t)dist; }
+  void setDistanceToPlayer(uint32_t dist) { m_idist = dist; }
+  void setPositionIndex(int index) { m_positionIndex = index; }
   void setPos(int16_t x, int16_t y, int16_t z);
   void setHeading(int8_t heading) { m_heading = heading; }
 
   void setName(const char *name)
-    { m_name = QString::fromUtf8(name); }
+    { setName(QString::fromUtf8(name)); }
 
   void setName(const QString& name)
-    { m_name = name; }
+    {
+      if (m_name != name)
+      {
+	m_name = name;
+	filterFieldsChanged(tFilterSegIdentity);
+      }
+    }
 
   void updateLast()
   {
@@ -185,14 +218,42 @@ class Item : public EQPoint
   void setFilterFlags(uint32_t filterFlags) { m_filterFlags = filterFlags; }
   void setRuntimeFilterFlags(uint32_t filterFlags) 
     { m_runtimeFilterFlags = filterFlags; }
+  void clearFilterStale(uint8_t which) { m_filterStale &= ~which; }
+
+  // mark filter string segments as needing to be regenerated
+  void filterFieldsChanged(uint8_t segments) const
+  {
+    m_filterDirty |= segments;
+
+    // position only changes don't warrant re-running the filters
+    if (segments & ~tFilterSegPosition)
+    {
+      m_filterStale = tFilterStaleAll;
+      m_filterSerial++;
+    }
+  }
 
  protected:
-  void setNPC(uint8_t NPC) { m_NPC = NPC; }
+  void setNPC(uint8_t NPC)
+    { if (m_NPC != NPC) { m_NPC = NPC; filterFieldsChanged(tFilterSegIdentity); } }
+
+  // format one segment of the filter string
+  virtual QString formatFilterSegment(filterSegment segment) const;
 
   // common item data
   QString m_name;
   uint32_t m_filterFlags;
   uint32_t m_runtimeFilterFlags;
+  int m_positionIndex; // slot in SpawnShell's ItemPositions, -1 if none
+
+  // cached filter string and its segments
+  mutable QString m_filterIdentity;
+  mutable QString m_filterPosition;
+  mutable QString m_filterDetail;
+  mutable QString m_filterString;
+  mutable uint8_t m_filterDirty;
+  mutable uint8_t m_filterStale;
+  mutable uint16_t m_filterSerial; // bumped whenever the filters go stale
 
   // persisted info below
   QTime m_lastUpdate; 
@@ -227,6 +288,12 @@ class Spawn : public Item
   Spawn(Spawn*, uint16_t id);
   virtual ~Spawn();
 
+  // allocated from a zone lifetime arena (see itemarena.h)
+  static void* operator new(size_t size) { return arena().allocate(size); }
+  static void operator delete(void* p, size_t size)
+    { arena().release(p, size); }
+  static ItemArena& arena();
+
   // save spawn to QDataStream
   void saveSpawn(QDataStream& d);
   
@@ -276,7 +343,6 @@ class Spawn : public Item
   virtual uint8_t classVal() const;
   virtual QString classString() const;
   virtual QString info() const;
-  virtual QString filterString() const;
   virtual QString dumpString() const;
 
   // convenience test methods
@@ -330,31 +396,60 @@ class Spawn : public Item
   void setDeltaHeading(int8_t deltaHeading) { m_deltaHeading = deltaHeading; }
   void setAnimation(uint8_t animation) { m_animation = animation; }
   void setPetOwnerID(uint16_t petOwnerID) { m_petOwnerID = petOwnerID; }
-  void setLight(uint8_t light) { m_light = light; }
+  void setLight(uint8_t light)
+    { if (m_light != light) { m_light = light; filterFieldsChanged(tFilterSegDetail); } }
   void setGender(uint8_t gender) { m_gender = gender; }
-  void setDeity(uint16_t deity) { m_deity = deity; calcDeityTeam(); }
+  void setDeity(uint16_t deity)
+  {
+    if (m_deity != deity)
+    {
+      m_deity = deity;
+      filterFieldsChanged(tFilterSegDetail);
+    }
+    calcDeityTeam();
+  }
   void setConsidered(bool considered) { m_considered = considered; }
-  void setRace(uint16_t race) { m_race = race; calcRaceTeam(); }
-  void setClassVal(uint8_t classVal) { m_class = classVal; }
+  void setRace(uint16_t race)
+  {
+    if (m_race != race)
+    {
+      m_race = race;
+      filterFieldsChanged(tFilterSegIdentity | tFilterSegDetail);
+    }
+    calcRaceTeam();
+  }
+  void setClassVal(uint8_t classVal)
+    { if (m_class != classVal) { m_class = classVal; filterFieldsChanged(tFilterSegIdentity); } }
   void setHP(int32_t HP) { m_curHP = HP; }
   void setMaxHP(int32_t maxHP) { m_maxHP = maxHP; }
   void setGuildID(uint16_t GuildID) { m_guildID = GuildID; }
   void setGuildServerID(uint16_t GuildServerID) { m_guildServerID = GuildServerID; }
-  void setGuildTag(QString GuildTag) { m_guildTag = GuildTag; }
-  void setLevel(int level) { m_level = level; }
+  void setGuildTag(QString GuildTag)
+    { if (m_guildTag != GuildTag) { m_guildTag = GuildTag; filterFieldsChanged(tFilterSegDetail); } }
+  void setLevel(int level)
+    { if (m_level != level) { m_level = level; filterFieldsChanged(tFilterSegIdentity); } }
   void setEquipment(uint8_t wearSlot, EquipStruct item)
-    { if (wearSlot < tNumWearSlots) { m_equipment[wearSlot] = item; } }
-  void setNPC(uint8_t NPC) { m_NPC = NPC; }
-  void setTypeflag(uint8_t typeflag) { m_typeflag = typeflag; }
-  void setGM(uint8_t gm) { m_gm = gm; }
+  {
+    if (wearSlot < tNumWearSlots)
+    {
+      if (m_equipment[wearSlot].itemId != item.itemId)
+	filterFieldsChanged(tFilterSegDetail);
+      m_equipment[wearSlot] = item;
+    }
+  }
+  void setNPC(uint8_t NPC) { Item::setNPC(NPC); }
+  void setTypeflag(uint8_t typeflag)
+    { if (m_typeflag != typeflag) { m_typeflag = typeflag; filterFieldsChanged(tFilterSegDetail); } }
+  void setGM(uint8_t gm)
+    { if (m_gm != gm) { m_gm = gm; filterFieldsChanged(tFilterSegDetail); } }
   void setIsMount(bool isMount) { m_isMount = isMount; }
   void setIsMercenary(uint8_t isMercenary) {m_isMercenary = (isMercenary != 0); }
   void setIsAura(unsigned aura) {m_isAura = (aura != 0); }
   void setID(uint16_t id) { m_ID = id; }
   void setLastName(const char * lastName)
-    { m_lastName = QString::fromUtf8(lastName); }
+    { setLastName(QString::fromUtf8(lastName)); }
   void setLastName(const QString& lastName)
-    { m_lastName = lastName; }
+    { if (m_lastName != lastName) { m_lastName = lastName; filterFieldsChanged(tFilterSegDetail); } }
   void setNotUpdated(bool notUpdated) { m_notUpdated = notUpdated; }
 
 
@@ -362,6 +457,7 @@ class Spawn : public Item
   void calcRaceTeam();
   void calcDeityTeam();
   bool calcIsMount(uint32_t, uint8_t);
+  virtual QString formatFilterSegment(filterSegment segment) const;
 
   // spawn specific data
   QString m_lastName;
@@ -409,6 +505,12 @@ class Door : public Item
   Door(const doorStruct* d);
   virtual ~Door();
 
+  // allocated from a zone lifetime arena (see itemarena.h)
+  static void* operator new(size_t size) { return arena().allocate(size); }
+  static void operator delete(void* p, size_t size)
+    { arena().release(p, size); }
+  static ItemArena& arena();
+
   // virtual get method overloads
   virtual QString raceString() const;
   virtual QString classString() const;
@@ -433,6 +535,12 @@ class Drop : public Item
   Drop(const makeDropStruct* d, const QString& name);
   virtual ~Drop();
 
+  // allocated from a zone lifetime arena (see itemarena.h)
+  static void* operator new(size_t size) { return arena().allocate(size); }
+  static void operator delete(void* p, size_t size)
+    { arena().release(p, size); }
+  static ItemArena& arena();
+
   // drop specific get methods
   uint32_t itemNr() const { return m_itemNr; }
   QString idFile() const { return m_idFile; }
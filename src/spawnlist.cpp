@@ -26,15 +26,6 @@
  * Date   - 3/16/00
  */
 
-/*
- * SpawnListItem
- *
- * SpawnListItem is class intended to store information about an EverQuest
- * Spawn.  It inherits from QListViewItem but overrides functionality to allow
- * paint styles such as color changes
- *
- */
-
 #include "spawnlist.h"
 #include "category.h"
 #include "spawnshell.h"
@@ -57,29 +48,23 @@ SpawnList::SpawnList(Player* player,
 		     SpawnShell* spawnShell,
 		     CategoryMgr* categoryMgr,
 		     QWidget *parent, const char* name)
-  : SEQListView("SpawnList", parent, name),
+  : SEQTreeView("SpawnList", parent, name),
     m_categoryMgr(categoryMgr),
     m_player(player),
     m_spawnShell(spawnShell),
+    m_model(new SpawnListModel(player, this)),
     m_menu(NULL)
 {
+   setModel(m_model);
    setRootIsDecorated(true);
 
    addColumn ("Name");
-   addColumn ("Lvl", "Level");
-   addColumn ("Hp", "HP");
+   addColumn ("Level");
+   addColumn ("HP");
    addColumn ("MaxHP");
-   if(showeq_params->retarded_coords) 
-   {
-     addColumn ("N/S", "Coord1");
-     addColumn ("E/W", "Coord2");
-   } 
-   else 
-   {
-     addColumn ("X", "Coord1");
-     addColumn ("Y", "Coord2");
-   }
-   addColumn ("Z", "Coord3");
+   addColumn ("Coord1");
+   addColumn ("Coord2");
+   addColumn ("Coord3");
    addColumn ("ID");
    addColumn ("Dist");
    addColumn ("Race");
@@ -87,24 +72,26 @@ SpawnList::SpawnList(Player* player,
    addColumn ("Info");
    addColumn ("SpawnTime");
    addColumn("Deity");
-   addColumn("Body Type", "BodyType");
-   addColumn("Guild Tag", "GuildTag");
+   addColumn("BodyType");
+   addColumn("GuildTag");
 
    // restore the columns settings from preferences
    restoreColumns();
 
-   // connect a QListView signal to ourselves
-   connect(this, SIGNAL(itemSelectionChanged()),
+   // connect the view's signals to ourselves
+   connect(selectionModel(),
+	   SIGNAL(selectionChanged(const QItemSelection&,
+				   const QItemSelection&)),
 	   this, SLOT(selChanged()));
 
-   connect (this, SIGNAL(itemPressed(QTreeWidgetItem*, int)),
-            this, SLOT(listItemPressed(QTreeWidgetItem*, int)));
+   connect (this, SIGNAL(pressed(const QModelIndex&)),
+            this, SLOT(listItemPressed(const QModelIndex&)));
 
    connect (this, SIGNAL(mouseRightButtonPressed(QMouseEvent*)),
             this, SLOT(listMouseRightButtonPressed(QMouseEvent*)));
 
-   connect (this, SIGNAL(itemDoubleClicked(QTreeWidgetItem*, int)),
-            this, SLOT(listItemDoubleClicked(QTreeWidgetItem*, int)));
+   connect (this, SIGNAL(doubleClicked(const QModelIndex&)),
+            this, SLOT(listItemDoubleClicked(const QModelIndex&)));
 
    // connect SpawnList slots to SpawnShell signals
    connect(m_spawnShell, SIGNAL(addItem(const Item *)),
@@ -113,6 +100,8 @@ SpawnList::SpawnList(Player* player,
 	   this, SLOT(delItem(const Item *)));
    connect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
 	   this, SLOT(changeItem(const Item *, uint32_t)));
+   connect(m_spawnShell, SIGNAL(changeItems(const ItemList&, uint32_t)),
+	   this, SLOT(changeItems(const ItemList&, uint32_t)));
    connect(m_spawnShell, SIGNAL(killSpawn(const Item *, const Item*, uint16_t)),
 	   this, SLOT(killSpawn(const Item *)));
    connect(m_spawnShell, SIGNAL(selectSpawn(const Item *)),
@@ -147,91 +136,50 @@ void SpawnList::setPlayer(int16_t x, int16_t y, int16_t z,
 			   int32_t degrees)
 {
 //   seqDebug("SpawnList::setPlayer()");
-   SEQListViewItemIterator it(this);
-   SpawnListItem* litem;
-   QString buff;
-
-   // is this a fast machine?
-   if (!showeq_params->fast_machine)
-   {
-     // no, cheat using integer distance calculation ignoring Z dimension
-     while (*it)
-     {
-       litem = (SpawnListItem*)*it;
-
-       if (litem->type() != tUnknown)
-       {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-           buff = QString::asprintf("%5d", litem->item()->calcDist2DInt(x, y));
-#else
-           buff.sprintf("%5d", litem->item()->calcDist2DInt(x, y));
-#endif
-           litem->setText(tSpawnColDist, buff);
-       }
-       ++it;
-     }
-   }
-   else
-   {
-     // fast machine so calculate the correct floating point 3D distance
-     while (*it)
-     {
-       litem = (SpawnListItem*)*it;
-       if (litem->type() != tUnknown)
-       {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-           buff = QString::asprintf("%5.1f", litem->item()->calcDist(x, y, z));
-#else
-           buff.sprintf("%5.1f", litem->item()->calcDist(x, y, z));
-#endif
-           litem->setText(tSpawnColDist, buff);
-       }
-       ++it;
-     }
-   }
+   // the distances were already recalculated in bulk by
+   // SpawnShell::playerMoved(), just have the visible rows redrawn
+   m_model->changeDistances();
 }
 
 void SpawnList::changeItem(const Item* item, uint32_t changeItem)
 {
-  if (item == NULL)
+  if ((item == NULL) || !m_model->contains(item))
     return;
 
-  SEQListViewItemIterator it(this);
-  SpawnListItem *i = Find(it, item);
-  while (i)
+  // reinsert only if level, NPC or filterFlags changes
+  if (!(changeItem & (tSpawnChangedLevel |
+		      tSpawnChangedNPC |
+		      tSpawnChangedFilter |
+		      tSpawnChangedRuntimeFilter)))
   {
-    // reinsert only if level, NPC or filterFlags changes
-    if (!(changeItem & (tSpawnChangedLevel |
-                    tSpawnChangedNPC |
-                    tSpawnChangedFilter |
-                    tSpawnChangedRuntimeFilter)))
-      i->update(m_player, changeItem);
-    else
-    {
-      bool select = false;
+    m_model->changeItem(item, changeItem);
+    return;
+  }
 
-      // check if this is the selected item.
-      if (Selected() == i)
-          select = true;
+  // check if this is the selected item.
+  bool select = (selected() == item);
 
-      // delete ALL SpawnListItems that relate to item
-      delItem(item);
+  // delete ALL the rows that relate to item
+  delItem(item);
 
-      // reinsert ALL the SpawnListItems that relate to item
-      addItem(item);
+  // reinsert ALL the rows that relate to item
+  addItem(item);
 
-      // reset the selected item, if it was this item.
-      if (select)
-          selectSpawn(item);
+  // reset the selected item, if it was this item.
+  if (select)
+    selectSpawn(item);
+}
 
-      // Delete item deleted everything, addItem re-inserted everything
-      // nothing more to be done.
-      break;
-    }
+void SpawnList::changeItems(const ItemList& items, uint32_t changeType)
+{
+  // don't repaint for every item in the batch
+  setUpdatesEnabled(false);
+
+  QListIterator<const Item*> it(items);
+  while (it.hasNext())
+    changeItem(it.next(), changeType);
 
-    // keep searching/updating...
-    i = Find(it, item);
-  } // while i
+  setUpdatesEnabled(true);
 }
 
 void SpawnList::killSpawn(const Item* item)
@@ -239,63 +187,27 @@ void SpawnList::killSpawn(const Item* item)
   if (item == NULL)
     return;
 
-   SEQListViewItemIterator it(this);
-   const SpawnListItem *i = Find(it, item);
    // was this spawn in the list
-   if (i)
+   if (m_model->contains(item))
    {
      // yes, remove and re-add it.
-     bool select = false;
-
      // check if this is the selected item.
-     if (Selected() == i)
-       select = true;
+     bool select = (selected() == item);
 
-     // delete ALL SpawnListItems that relate to item
+     // delete ALL the rows that relate to item
      delItem(item);
 
-     // reinsert ALL the SpawnListItems that relate to item
+     // reinsert ALL the rows that relate to item
      addItem(item);
 
      // reset the selected item, if it was this item.
      if (select)
        selectSpawn(item);
-
-     // Delete item deleted everything, addItem re-inserted everything
-     // nothing more to be done.
    }
    else // no, killed something not in list, just add it.
      addItem(item);
 }
 
-SpawnListItem* SpawnList::Find(SEQListViewItemIterator& it,
-                               const Item* item,
-                               bool first)
-{
-  if (first)
-    it = SEQListViewItemIterator(this); // reset iterator to the beginning
-  else
-    it++; // increment past the current item
-
-  SpawnListItem *i;
-  // while there are still items, increment forward
-  while(*it)
-  {
-    // get the current item
-    i = (SpawnListItem*)*it;
-
-    // is it the one we're looking for?
-    if (i->item() == item)
-      return i; // yes, return it
-
-    // keep iterating
-    ++it;
-  }
-
-  // not found, return NULL
-  return NULL;
-}
-
 // Slot coming from SpawnShell::addItem.  Called when any spawn is created
 void SpawnList::addItem(const Item* item)
 {
@@ -305,11 +217,6 @@ void SpawnList::addItem(const Item* item)
   // ZB: Need to figure out how to derive flags
   int flags = 0;
 
-  SEQListViewItemIterator it(this);
-  const Item* i;
-  SpawnListItem* j = NULL;
-
-  // if none found in list, add it
   const Spawn* spawn = NULL;
   if ((item->type() == tSpawn) || (item->type() == tPlayer))
     spawn = (const Spawn*)item;
@@ -319,68 +226,32 @@ void SpawnList::addItem(const Item* item)
   if (spawn != NULL)
     level = spawn->level();
 
-  // check if the ID is already in the list
-  j = Find(it, item);
-
-  if (j)
+  // check if the item is already in the list
+  if (m_model->contains(item))
   {
-    // yes, check if it's a major modification, or can get by with just
-    // an update
-    int l = j->text(tSpawnColLevel).toInt();
-
     // reinsert only if name, level, NPC, or filterFlags changes
-    if ((l == level) &&
-            (j->m_npc == item->NPC()) &&
-            (j->text(tSpawnColName) == item->name()))
+    if (m_model->sameListing(item))
     {
-      // it matches, just update all of it's instances
-
-      // loop through all instances relating to item
-      while (j != NULL)
-      {
-          // update the SpawnListItem
-          j->update(m_player, tSpawnChangedALL);
-
-          // find the next one
-          j = Find(it, item);
-      }
-
-      // return the first one so the caller has the option of selecting it
+      // it matches, just update all of it's rows
+      m_model->changeItem(item, tSpawnChangedALL);
       return;
     }
-    else
-    {
-      // major change, delete all instances relating to item
-      delItem(item);
-    }
+
+    // major change, delete all rows relating to item
+    delItem(item);
   }
 
   // if this is a pet, make it the child of the owner
   if ((spawn != NULL) && (spawn->petOwnerID()))
   {
-    // loop through all matches on owner and add as child
-    i = m_spawnShell->findID(tSpawn, spawn->petOwnerID());
-
     // can only do this if the pet owner's already been seen.
-    if (i)
+    const Item* owner = m_spawnShell->findID(tSpawn, spawn->petOwnerID());
+    if (owner)
     {
-      // start at the beginning
-      j = Find(it, i, true);
-
-      // loop until we run out of pets
-      while (j)
-      {
-          // create a new SpawnListItem
-          SpawnListItem *k = new SpawnListItem(j);
-
-          // set the item
-          k->setShellItem(item);
-          k->pickTextColor(item, m_player);
-          k->update(m_player, tSpawnChangedALL);
-
-          // find the next item
-          j = Find(it, i);
-      }
+      // add it under every row of the owner
+      QModelIndexList owners = m_model->indexes(owner);
+      for (int i = 0; i < owners.size(); i++)
+	m_model->addItem(item, owners[i]);
     }
   } // if petOwnerId
 
@@ -392,14 +263,13 @@ void SpawnList::addItem(const Item* item)
   {
     CategoryListIterator cit(m_categoryMgr->getCategories());
     const Category* cat;
-    SpawnListItem* catlitem;
 
     // iterate over all the categories
     while(cit.hasNext())
     {
-        cat = cit.next();
-        if (!cat)
-            break;
+      cat = cit.next();
+      if (!cat)
+	break;
 
       if ((item->filterFlags() & FILTER_FLAG_FILTERED) &&
               !cat->isFilteredFilter())
@@ -409,40 +279,21 @@ void SpawnList::addItem(const Item* item)
 
       if (cat->isFiltered(filterStr, level))
       {
-          // retrieve the list item associated with the category
-          catlitem = m_categoryListItems.value((void*)cat, nullptr);
-          if (!catlitem)
-              continue;
-
-          // We have a good category, add spawn as it's child
-          j = new SpawnListItem(catlitem);
-#if 0
-          seqDebug("`-- Adding to %s (%d)",
-                  (const char*)cat->name(), catlitem->childCount());
-#endif
-          j->setShellItem(item);
-          j->update(m_player, tSpawnChangedALL);
-
-          // color spawn
-          j->pickTextColor(item, m_player, cat->color());
+	// retrieve the row associated with the category
+	QModelIndex catIndex = m_model->categoryIndex(cat);
+	if (!catIndex.isValid())
+	  continue;
 
-          // update childcount in header
-          catlitem->updateTitle(cat->name());
+	// We have a good category, add spawn as it's child
+	m_model->addItem(item, catIndex);
       } // end if spawn should be in this category
     }
-   } // end if categories
-   else
-   {
-     // just create a new SpawnListItem
-     j = new SpawnListItem(this);
-     j->setShellItem(item);
-
-     // color spawn
-     j->pickTextColor(item, m_player);
-     j->update(m_player, tSpawnChangedALL);
-   } // else
-
-   return;
+  } // end if categories
+  else
+  {
+    // just add it at the top level
+    m_model->addItem(item);
+  } // else
 } // end addItem
 
 void SpawnList::delItem(const Item* item)
@@ -451,63 +302,8 @@ void SpawnList::delItem(const Item* item)
   if (item == NULL)
     return;
 
-   SpawnListItem *j = NULL;
-
-   // create a list of items to be deleted
-   QList<SEQListViewItem*> delList;
-
-   // create a list of categories to be updated
-   QList<const Category*> catUpdateList;
-
-   const Category* cat;
-
-   // start at the top of the list
-   SEQListViewItemIterator it(this);
-
-   do
-   {
-     // find the next item in the list
-     j = Find(it, item);
-
-     // if there was an item, delete it and all it's children
-     if (j)
-     {
-       if (j == currentItem())
-       {
-           selectionModel()->setCurrentIndex(QModelIndex(), QItemSelectionModel::Clear);
-           clearSelection();
-       }
-       delList += j->takeChildren();
-
-       // get the category that the item SpawnListItem belongs to
-       cat = getCategory(j);
-
-       // add to the list of items to delete
-       delList.append(j);
-
-       // if there's a category, add it to the list to be updated
-       if (cat != NULL)
-           catUpdateList.append(cat);
-     } // if j
-
-     // not done until out of items
-   } while (j);
-
-   // delete the list of items to be deleted
-   qDeleteAll(delList);
-   delList.clear();
-
-   // now iterate over the updated categories and update them
-   QList<const Category*>::iterator cit;
-   for (cit = catUpdateList.begin(); cit != catUpdateList.end() && *cit != NULL; ++cit)
-   {
-     cat = *cit;
-     // retrieve the category list item
-     SpawnListItem* catlitem = m_categoryListItems.value((void*)cat, nullptr);
-
-     // update the list items title
-     catlitem->updateTitle(cat->name());
-   }
+  // removes the item's rows, their children and updates the category counts
+  m_model->removeItem(item);
 }
 
 void SpawnList::selectSpawn(const Item *item)
@@ -519,255 +315,146 @@ void SpawnList::selectSpawn(const Item *item)
       return;
   }
 
-  // start iterator at the beginning of this QListView
-  SEQListViewItemIterator it(this);
-
-  SpawnListItem *j = NULL;
+  QModelIndexList indexes = m_model->indexes(item);
+  if (indexes.isEmpty())
+    return;
 
   // attempt to find a match on an item that is not collapsed (open)
-  do
+  for (int i = 0; i < indexes.size(); i++)
   {
-    // attempt to find the item
-    j = Find(it, item);
+    bool bOpen = true;
 
-    // if it's found, see if it's parent is open, and if so, select it
-    if (j)
+    // make sure the parent and all it's parents are open
+    for (QModelIndex parent = indexes[i].parent(); parent.isValid();
+	 parent = parent.parent())
     {
-      // get the parent
-      SEQListViewItem* litem = (SpawnListItem*) j->parent();
-      bool bOpen = true;
-
-      // make sure the parent and all it's parents are open
-      while (litem)
+      if (!isExpanded(parent))
       {
-          // is it open
-          if (!isItemExpanded(litem))
-          {
-              // nope, stop looking at the parents, next item
-              bOpen = false;
-              break;
-          }
-
-          // get this parents parent
-          litem = (SpawnListItem*) litem->parent();
+	bOpen = false;
+	break;
       }
-
-      // yes, this one should be opened, finished
-      if (bOpen)
-          break;
     }
 
-    // continue until out of items
-  } while (j);
+    // yes, this one is showing, select it
+    if (bOpen)
+    {
+      setSelectedQuiet(indexes[i]);
 
-  // if an item was found, select it
-  if (j)
-  {
-    // select the item
-    setSelectedQuiet(j, true);
+      // if configured to do so, make sure it's visible
+      if (showeq_params->keep_selected_visible)
+	scrollTo(indexes[i]);
 
-    // if configured to do so, make sure it's visible
-    if (showeq_params->keep_selected_visible)
-      scrollToItem(j);
+      return;
+    }
   }
-  else // try again forcing open
-  {
-    // find the first item in the QListView
-    j = Find(it, item, true);
 
-    // if it was found, open it
-    if (j)
-      selectAndOpen(j);
-  }
+  // try again forcing open
+  selectAndOpen(indexes.first());
 } // end selectSpawn
 
-SpawnListItem* SpawnList::Selected()
+const Item* SpawnList::selected()
 {
-   return ((SpawnListItem*) currentItem());
+   return m_model->item(currentIndex());
 }
 
 
-void SpawnList::selectAndOpen(SpawnListItem *i)
+void SpawnList::selectAndOpen(const QModelIndex& index)
 {
-  // get the item
-  SEQListViewItem* item = i;
-
   // loop over it's parents, opening all of them
-  while (item)
-  {
-    expandItem(item);
-    item = (SpawnListItem*) item->parent();
-  }
+  for (QModelIndex parent = index.parent(); parent.isValid();
+       parent = parent.parent())
+    expand(parent);
 
   // make sure the item is selected
-  setSelectedQuiet(i, true);
+  setSelectedQuiet(index);
 
   // if configured to do so, make sure it's visible
   if (showeq_params->keep_selected_visible)
-    scrollToItem(i);
+    scrollTo(index);
 }
 
-void SpawnList::setSelectedQuiet(SEQListViewItem* item, bool selected)
+void SpawnList::setSelectedQuiet(const QModelIndex& index)
 {
-  if ((item->isSelected() == selected ) ||
-          !(item->flags() & Qt::ItemIsSelectable))
-    return;
-
-  // get the old selection
-  SEQListViewItem *oldItem = currentItem();
-
-  if (!item)
+  if (!index.isValid())
   {
       clearSelection();
       return;
   }
 
-  // unselect the old selected item if any
-  if ((oldItem != item) && (oldItem != NULL) && (oldItem->isSelected()))
-    oldItem->setSelected(false);
-
-  // mark the new selected item
-  item->setSelected(selected);
-
-  // set the selected item to be the current item (should signal selection 
-  // notifications since the selection state is already changed).
-  setCurrentItem(item);
+  if (selectionModel()->isRowSelected(index.row(), index.parent()))
+    return;
 
-  update();
+  // make the row the current and only selected one (this signals the
+  // selection change)
+  selectionModel()->setCurrentIndex(index,
+				    QItemSelectionModel::ClearAndSelect |
+				    QItemSelectionModel::Rows);
 }
 
 // Select next item of the same type and id as currently selected item
 void SpawnList::selectNext(void)
 {
 //   seqDebug("SpawnList::selectNext()");
-  SpawnListItem *i;
-  const Item* item;
-
-  // retrieve the currently selected item
-  i = (SpawnListItem *) currentItem();
+  QModelIndex current = currentIndex();
+  const Item* item = m_model->item(current);
 
   // nothing selected, nothing to do
-  if (!i)
+  if (item == NULL)
     return;
 
-  // start the iterator at the current item
-  SEQListViewItemIterator it(i);
-
-  // get the Item from the SpawnListItem
-  item = i->item();
+  // find the current row amongst the item's rows, in display order
+  QModelIndexList indexes = m_model->indexes(item);
+  int i = indexes.indexOf(current.sibling(current.row(), 0));
 
-  //seqDebug("SelectNext(): Current selection '%s'", i->text(0).latin1());
-
-  // attempt to find another one
-  i = Find(it, item);
-
-  // there are no more with item, wrap around to beginning
-  if (!i)
-    i = Find(it, item, true);
-
-  // if it's found, select it, and make sure it's parents are open
-  if (i)
-  {
-    //seqDebug("SelectNext(): Next selection '%s'", i->text(0).latin1());
-    selectAndOpen(i);
-  }
+  // select the one after it, wrapping around to the beginning, and make
+  // sure it's parents are open
+  selectAndOpen(indexes[(i + 1) % indexes.size()]);
 } // end selectNext
 
 
 void SpawnList::selectPrev(void)
 {
 //   seqDebug("SpawnList::SelectPrev()");
-  SpawnListItem *i, *last, *cur;
-  const Item* item;
-
-  // start at the current item
-  i = cur = (SpawnListItem *) currentItem();
+  QModelIndex current = currentIndex();
+  const Item* item = m_model->item(current);
 
   // nothing selected, nothing to do
-  if (!i)
+  if (item == NULL)
     return;
 
-  // start the iterator at the current item
-  SEQListViewItemIterator it(i);
-
-  // get the SpawnShellitem from the SpawnListItem
-  item = i->item();
-
-  // no last item found
-  last = NULL;
-
-//seqDebug("SelectPrev(): Current selection '%s'", i->text(0).ascii());
-
-  // search backwards, wrapping around, until we hit the current item
-  do
-  {
-    // the current item becomes the last item
-    last = i;
-
-    // attempt to find the next item
-    i = Find(it, item);
-
-    // if no more found, then wrap to the beginning
-    if (!i)
-    {
-      // Start searching again from the beginning
-      i = Find(it, item, true);
-    }
-
-    // continue until it's back to the current item
-  } while (i != cur);
+  // find the current row amongst the item's rows, in display order
+  QModelIndexList indexes = m_model->indexes(item);
+  int i = indexes.indexOf(current.sibling(current.row(), 0));
+  if (i < 0)
+    i = 0;
 
-  // if there is a last item, select and open it.
-  if (last)
-  {
-    //seqDebug("SelectPrev(): Prev selection '%s'", i->text(0).ascii());
-    selectAndOpen(last);
-  }
+  // select the one before it, wrapping around to the end
+  selectAndOpen(indexes[(i + indexes.size() - 1) % indexes.size()]);
 } // end SelectPrev
 
 void SpawnList::clear(void)
 {
 //seqDebug("SpawnList::clear()");
-  SEQListView::clear();
-  m_categoryListItems.clear();
+  m_model->clear();
 
   // rebuild headers
   CategoryListIterator it(m_categoryMgr->getCategories());
-  SpawnListItem* litem;
   const Category* cat;
   while (it.hasNext())
   {
-      cat = it.next();
-      if (!cat)
-          break;
-
-    // create the spawn list item
-    litem = new SpawnListItem(this);
-
-    // insert the category and it's respective list item
-    m_categoryListItems.insert((void*)cat, litem);
-
-    // set color
-    litem->setTextColor(cat->color());
+    cat = it.next();
+    if (!cat)
+      break;
 
-    // update count
-    litem->updateTitle(cat->name());
+    // add the category's row
+    m_model->addCategory(cat);
   }
 } // end clear
 
 void SpawnList::addCategory(const Category* cat)
 {
-  // create a top level spawn list item for the category
-  SpawnListItem* litem = new SpawnListItem(this);
-
-  // associate the new spawn list item with the category
-  m_categoryListItems.insert((void*)cat, litem);
-
-  // set color
-  litem->setTextColor(cat->color());
-
-  // update count
-  litem->updateTitle(cat->name());
+  // create a top level row for the category
+  m_model->addCategory(cat);
 
   // populate the category
   populateCategory(cat);
@@ -775,31 +462,14 @@ void SpawnList::addCategory(const Category* cat)
 
 void SpawnList::delCategory(const Category* cat)
 {
-  // retrieve the list item associated with the category
-  SpawnListItem* litem = m_categoryListItems.value((void*)cat, nullptr);
-
-  // if there's a list item associated with this category, clean it out
-  if (litem != NULL)
-  {
-
-    // remove all children from list
-    QList<SEQListViewItem*> children = litem->takeChildren();
-    qDeleteAll(children);
-    children.clear();
-
-    // remove the item from the category list
-    delete m_categoryListItems.take((void*)cat);
-  }
+  // remove the category's row along with all of it's children
+  m_model->removeCategory(cat);
 }
 
 void SpawnList::clearedCategories(void)
 {
-  // clear out the list of category list items
-  qDeleteAll(m_categoryListItems);
-  m_categoryListItems.clear();
-
   // clear out the list
-  SEQListView::clear();
+  m_model->clear();
 }
 
 void SpawnList::loadedCategories(void)
@@ -836,46 +506,8 @@ void SpawnList::rebuildSpawnList()
 
 void SpawnList::playerLevelChanged(uint8_t)
 {
-  SEQListViewItemIterator it(this);
-  SpawnListItem* slitem = NULL;
-  const Category* cat = NULL;
-  const Item* item = NULL;
-
-  // iterate until we are out of items
-  while (*it)
-  {
-    // get the current SpawnListItem
-    slitem = (SpawnListItem*)*it;
-
-    // if this is a top level item, see if it's a category item, and if so
-    // get the category.
-    if (slitem->parent() == NULL)
-    {
-      cat = NULL;
-      QHash<void*, SpawnListItem*>::iterator it;
-
-      for (it = m_categoryListItems.begin();
-              it != m_categoryListItems.end() && *it != NULL; ++it)
-      {
-          if (slitem == *it)
-          {
-              cat = (const Category*)it.key();
-              break;
-          }
-      }
-    }
-
-    // get the item associated with the list item
-    item = slitem->item();
-
-    // set the color
-    if (cat != NULL)
-      slitem->pickTextColor(item, m_player, cat->color());
-    else
-      slitem->pickTextColor(item, m_player);
-
-    ++it;
-  }
+  // con colors are picked when the rows are drawn
+  m_model->changeColors();
 }
 
 void SpawnList::populateCategory(const Category* cat)
@@ -883,6 +515,10 @@ void SpawnList::populateCategory(const Category* cat)
   if (cat == NULL)
     return;
 
+  QModelIndex catIndex = m_model->categoryIndex(cat);
+  if (!catIndex.isValid())
+    return;
+
   // disable updates
   setUpdatesEnabled(false);
 
@@ -890,11 +526,7 @@ void SpawnList::populateCategory(const Category* cat)
   spawnItemType types[] = { tSpawn, tDrop, tDoors, tPlayer};
 
   int flags = 0;
-  const ItemMap& itemMap = m_spawnShell->spawns();
-  ItemConstIterator it(itemMap);
   const Item* item;
-  SpawnListItem* litem;
-  SpawnListItem* catlitem = m_categoryListItems.value((void*)cat, nullptr);
 
   // iterate over all spawn types
   for (uint8_t i = 0; i < (sizeof(types) / sizeof(spawnItemType)); i++)
@@ -922,25 +554,12 @@ void SpawnList::populateCategory(const Category* cat)
       if ((item->type() == tSpawn) || (item->type() == tPlayer))
           level = ((Spawn*)item)->level();
 
-      // does this spawn match the category
+      // does this spawn match the category, yes add it
       if (cat->isFiltered(filterString(item, flags), level))
-      {
-          // yes, add it
-          litem = new SpawnListItem(catlitem);
-
-          // set up the list item
-          litem->setShellItem(item);
-          litem->update(m_player, tSpawnChangedALL);
-
-          // color the spawn
-          litem->pickTextColor(item, m_player, cat->color());
-      }
+	m_model->addItem(item, catIndex);
     }
   }
 
-  // update child count in header
-  catlitem->updateTitle(cat->name());
-
   // re-enable updates and force a repaint
   setUpdatesEnabled(true);
   repaint();
@@ -953,14 +572,10 @@ void SpawnList::populateSpawns(void)
 
   int flags = 0;
   const Item* item;
-  SpawnListItem* litem;
-  SpawnListItem* catlitem;
 
   // only deal with categories if there are some to deal with
   if (m_categoryMgr->count() != 0)
   {
-    const ItemMap& itemMap = m_spawnShell->spawns();
-    ItemConstIterator it(itemMap);
     const Category* cat;
     QString filterStr;
     CategoryListIterator cit(m_categoryMgr->getCategories());
@@ -985,6 +600,7 @@ void SpawnList::populateSpawns(void)
         filterStr = filterString(item, flags);
 
         // iterate over all the categories
+        cit.toFront();
         while (cit.hasNext())
         {
             cat = cit.next();
@@ -1000,37 +616,12 @@ void SpawnList::populateSpawns(void)
             if ((item->type() == tSpawn) || (item->type() == tPlayer))
                 level = ((Spawn*)item)->level();
 
-            // does this spawn match the category
+            // does this spawn match the category, yes add it
             if (cat->isFiltered(filterStr, level))
-            {
-                // retrieve the category list item
-                catlitem = m_categoryListItems.value((void*)cat, nullptr);
-
-                // yes, add it
-                litem = new SpawnListItem(catlitem);
-
-                // set up the list item
-                litem->setShellItem(item);
-                litem->update(m_player, tSpawnChangedALL);
-
-                // color the spawn
-                litem->pickTextColor(item, m_player, cat->color());
-            }
+	      m_model->addItem(item, m_model->categoryIndex(cat));
         }
       }
     }
-
-    // done adding items, now iterate over all the categories and 
-    // update the counts
-    while (cit.hasNext())
-    {
-        cat = cit.next();
-        if (!cat)
-            break;
-
-        catlitem =  m_categoryListItems.value((void*)cat, nullptr);
-        catlitem->updateTitle(cat->name());
-    }
   }
   else
   {
@@ -1051,13 +642,8 @@ void SpawnList::populateSpawns(void)
         if (!item)
             break;
 
-        // just create a new SpawnListItem
-        litem = new SpawnListItem(this);
-        litem->setShellItem(item);
-
-        // color spawn
-        litem->pickTextColor(item, m_player);
-        litem->update(m_player, tSpawnChangedALL);
+        // just add it at the top level
+	m_model->addItem(item);
       }
     }
   }
@@ -1065,37 +651,24 @@ void SpawnList::populateSpawns(void)
 
 void SpawnList::selChanged()
 {
-  QList<QTreeWidgetItem*> selected = selectedItems();
+  QModelIndexList selected = selectionModel()->selectedRows();
   if (!selected.count()) return;
 
   // the list is limited to one selection at a time, so we can take the first
-  SEQListViewItem* litem = selected.first();
-  if (litem == NULL)
-  {
-	 clearSelection();
-	 return;
-  }
-
-  const Item* item = ((SpawnListItem*)litem)->item();
+  const Item* item = m_model->item(selected.first());
 
   // it might have been a category title selected, only select if it's an item
   if (item != NULL)
     emit spawnSelected(item);
 }
 
-void SpawnList::listItemPressed(QTreeWidgetItem* litem, int col)
+void SpawnList::listItemPressed(const QModelIndex& index)
 {
-  SEQListViewItem* lvitem = dynamic_cast<SEQListViewItem*>(litem);
-  if (!lvitem) return;
-
-  setCurrentItem(lvitem);
+  if (!index.isValid()) return;
 
-  SpawnListItem* slitem = (SpawnListItem*)lvitem;
-  const Item* item = NULL;
-  if (slitem != NULL)
-      item = slitem->item();
-  m_menu->setCurrentItem(item);
-  m_menu->setCurrentCategory(getCategory(slitem));
+  SpawnListMenu* spawnMenu = menu();
+  spawnMenu->setCurrentItem(m_model->item(index));
+  spawnMenu->setCurrentCategory(getCategory(index));
 }
 
 void SpawnList::listMouseRightButtonPressed(QMouseEvent* event)
@@ -1107,13 +680,10 @@ void SpawnList::listMouseRightButtonPressed(QMouseEvent* event)
     }
 }
 
-void SpawnList::listItemDoubleClicked(QTreeWidgetItem* litem, int col)
+void SpawnList::listItemDoubleClicked(const QModelIndex& index)
 {
-  SEQListViewItem* lvitem = dynamic_cast<SEQListViewItem*>(litem);
-  if (!lvitem) return;
-
    //print spawn info to console
-  const Item* item = ((SpawnListItem*)lvitem)->item();
+  const Item* item = m_model->item(index);
   if (item != NULL)
   {
     seqInfo("%s", item->filterString().toLatin1().data());
@@ -1122,25 +692,9 @@ void SpawnList::listItemDoubleClicked(QTreeWidgetItem* litem, int col)
 
 void SpawnList::styleChanged()
 {
-    QColor fg = qApp->palette().color(QPalette::WindowText);
-
-    SEQListViewItemIterator it(this);
-    while (*it)
-    {
-        SpawnListItem* litem = (SpawnListItem*)*it;
-        litem->pickTextColor(litem->item(), m_player, fg);
-        ++it;
-    }
-
-    //go back and do the categories, so we keep their configured colors
-    QHash<void*, SpawnListItem*>::iterator cit;
-    for (cit = m_categoryListItems.begin(); cit != m_categoryListItems.end(); ++cit)
-    {
-        Category* cat = (Category*)cit.key();
-        SpawnListItem* litem = (SpawnListItem*)cit.value();
-        fg = cat->color();
-        litem->pickTextColor(litem->item(), m_player, fg);
-    }
+  // the palette's text color is looked up when the rows are drawn,
+  // categories keep their configured colors
+  m_model->changeColors();
 }
 
 QString SpawnList::filterString(const Item* item, int flags)
@@ -1164,33 +718,10 @@ QString SpawnList::filterString(const Item* item, int flags)
 }
 
 
-const Category* SpawnList::getCategory(SpawnListItem *item)
+const Category* SpawnList::getCategory(const QModelIndex& index)
 {
-  if (item)
-  {
-    // find the topmost parent
-    SpawnListItem *j = item;
-    while (j)
-    {
-      if (j->parent() == NULL)
-          break;
-      j = (SpawnListItem *)j->parent();
-    }
-    // find that in m_categoryList
-    if (j)
-    {
-        QHash<void*, SpawnListItem*>::iterator it;
-
-      for (it = m_categoryListItems.begin();
-              it != m_categoryListItems.end() && *it != NULL; ++it)
-      {
-          if (j == *it)
-              return (const Category*)it.key();
-      }
-    }
-  }
-
-  return NULL;
+  // the category of the topmost parent
+  return m_model->category(index);
 }
 
 SpawnListMenu* SpawnList::menu()
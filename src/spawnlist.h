@@ -27,14 +27,11 @@
  */
 
 /* 
- * SpawnListItem 
+ * SpawnList
  *
- * SpawnListItem is a class intended to store information about an EverQuest
- * Spawn.  It inherits from QListViewItem but overrides functionality to allow
- * paint styles such as color changes
- *
- * currently it just provides a widget and maintains a QColor for the text
- * display of that widget
+ * SpawnList shows the spawns known to the SpawnShell, grouped by the
+ * categories they match, through a SpawnListModel so that only the rows
+ * on screen are ever formatted
  */
  
 #ifndef SPAWNLIST_H
@@ -59,6 +56,7 @@
 #include "seqlistview.h"
 #include "spawnlistcommon.h"
 #include "spawn.h"
+#include "spawnshell.h"
 
 //--------------------------------------------------
 // forward declarations
@@ -70,12 +68,12 @@ class SpawnShell;
 class FilterMgr;
 
 class SpawnList;
-class SpawnListItem;
 class SpawnListMenu;
+class SpawnListModel;
 
 //--------------------------------------------------
 // SpawnList
-class SpawnList : public SEQListView
+class SpawnList : public SEQTreeView
 {
    Q_OBJECT
 public:
@@ -84,12 +82,9 @@ public:
 	     CategoryMgr* categoryMgr,
 	     QWidget *parent = 0, const char * name = 0);
 
-   SpawnListItem* Selected();
-   SpawnListItem* Find(SEQListViewItemIterator& it, 
-		       const Item* item, 
-		       bool first = false);
+   const Item* selected();
 
-   const Category* getCategory(SpawnListItem *);
+   const Category* getCategory(const QModelIndex& index);
 
    SpawnListMenu* menu();
 
@@ -109,6 +104,7 @@ public slots:
    void addItem(const Item *);
    void delItem(const Item *);
    void changeItem(const Item *, uint32_t changeType);
+   void changeItems(const ItemList& items, uint32_t changeType);
    void killSpawn(const Item *);
    void selectSpawn(const Item *);
    void clear();
@@ -125,24 +121,23 @@ public slots:
 private slots:
    void selChanged();
 
-   void listItemPressed(QTreeWidgetItem* litem, int col);
+   void listItemPressed(const QModelIndex& index);
    void listMouseRightButtonPressed(QMouseEvent* event);
-   void listItemDoubleClicked(QTreeWidgetItem* litem, int col);
+   void listItemDoubleClicked(const QModelIndex& index);
 
 private:
-   void setSelectedQuiet(SEQListViewItem* item, bool selected);
+   void setSelectedQuiet(const QModelIndex& index);
    void populateSpawns(void);
    void populateCategory(const Category* cat);
    QString filterString(const Item *item, int flags = 0);
 
-   void selectAndOpen(SpawnListItem *);
+   void selectAndOpen(const QModelIndex& index);
    CategoryMgr* m_categoryMgr;
    Player *m_player;
    SpawnShell* m_spawnShell;
 
 private:
-   // category pointer used as keys to look up the associated SpawnListItem
-   QHash<void*, SpawnListItem*> m_categoryListItems;
+   SpawnListModel* m_model;
 
    SpawnListMenu* m_menu;
 
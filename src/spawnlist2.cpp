@@ -36,6 +36,7 @@
 #include <QMenu>
 #include <QVBoxLayout>
 #include <QHeaderView>
+#include <QElapsedTimer>
 
 SpawnListWindow2::SpawnListWindow2(Player* player, 
 				   SpawnShell* spawnShell,
@@ -48,12 +49,19 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
     m_currentCategory(NULL),
     m_selectedItem(NULL),
     m_menu(NULL),
-    m_spawnListItemDict(),
-    m_immediateUpdate(true)
+    m_immediateUpdate(true),
+    m_fullSortPending(false),
+    m_sortScheduled(false)
 {
   // get whether to keep the list sorted or not
   m_keepSorted = pSEQPrefs->getPrefBool("KeepSorted", preferenceName(), false);
 
+  // how long to spend moving changed rows back into order on each pass,
+  // and what share of the rows changing makes a full sort cheaper
+  m_sortBudget = pSEQPrefs->getPrefInt("SortBudget", preferenceName(), 10);
+  m_fullSortPercent = pSEQPrefs->getPrefInt("FullSortPercent",
+					    preferenceName(), 25);
+
   // get whether to make sure the selected item is visible
   m_keepSelectedVisible = 
     pSEQPrefs->getPrefBool("KeepSelectedVisible", preferenceName(), true);
@@ -107,25 +115,20 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
   m_fpmSpinBox->setEnabled(!m_immediateUpdate);
 
   // create the spawn listview
-  m_spawnList = new SEQListView(preferenceName(), 
+  m_model = new SpawnListModel(m_player, this);
+  m_model->setKeepSorted(false);
+  m_spawnList = new SEQTreeView(preferenceName(),
 				this, "spawnlist2view");
+  m_spawnList->setModel(m_model);
   vLayout->addWidget(m_spawnList);
 
   m_spawnList->addColumn ("Name");
-  m_spawnList->addColumn ("Lvl", "Level");
-  m_spawnList->addColumn ("Hp", "HP");
+  m_spawnList->addColumn ("Level");
+  m_spawnList->addColumn ("HP");
   m_spawnList->addColumn ("MaxHP");
-  if(showeq_params->retarded_coords) 
-  {
-    m_spawnList->addColumn ("N/S", "Coord1");
-    m_spawnList->addColumn ("E/W", "Coord2");
-  } 
-  else 
-  {
-    m_spawnList->addColumn ("X", "Coord1");
-    m_spawnList->addColumn ("Y", "Coord2");
-  }
-  m_spawnList->addColumn ("Z", "Coord3");
+  m_spawnList->addColumn ("Coord1");
+  m_spawnList->addColumn ("Coord2");
+  m_spawnList->addColumn ("Coord3");
   m_spawnList->addColumn ("ID");
   m_spawnList->addColumn ("Dist");
   m_spawnList->addColumn ("Race");
@@ -133,8 +136,8 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
   m_spawnList->addColumn ("Info");
   m_spawnList->addColumn ("SpawnTime");
   m_spawnList->addColumn("Deity");
-  m_spawnList->addColumn("Body Type", "BodyType");
-  m_spawnList->addColumn("Guild Tag", "GuildTag");
+  m_spawnList->addColumn("BodyType");
+  m_spawnList->addColumn("GuildTag");
   
   // restore the columns settings from preferences
   m_spawnList->restoreColumns();
@@ -143,15 +146,17 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
   m_timer = new QTimer(this);
   m_timer->setObjectName("spawnlist2timer");
 
-  // connect a QListView signal to ourselves
-  connect(m_spawnList, SIGNAL(itemSelectionChanged()),
+  // connect the view's signals to ourselves
+  connect(m_spawnList->selectionModel(),
+	  SIGNAL(selectionChanged(const QItemSelection&,
+				  const QItemSelection&)),
 	  this, SLOT(selChanged()));
-  connect (m_spawnList, SIGNAL(itemPressed(QTreeWidgetItem*, int)),
-	   this, SLOT(listItemPressed(QTreeWidgetItem*, int)));
+  connect (m_spawnList, SIGNAL(pressed(const QModelIndex&)),
+	   this, SLOT(listItemPressed(const QModelIndex&)));
   connect (m_spawnList, SIGNAL(mouseRightButtonPressed(QMouseEvent*)),
 	   this, SLOT(listMouseRightButtonPressed(QMouseEvent*)));
-  connect (m_spawnList, SIGNAL(itemDoubleClicked(QTreeWidgetItem*, int)),
-	   this, SLOT(listItemDoubleClicked(QTreeWidgetItem*, int)));
+  connect (m_spawnList, SIGNAL(doubleClicked(const QModelIndex&)),
+	   this, SLOT(listItemDoubleClicked(const QModelIndex&)));
 
   // connect SpawnList slots to SpawnShell signals
   connect(m_spawnShell, SIGNAL(addItem(const Item *)),
@@ -165,8 +170,12 @@ SpawnListWindow2::SpawnListWindow2(Player* player,
   connect(m_spawnShell, SIGNAL(clearItems()),
 	  this, SLOT(clear()));
   if (m_immediateUpdate)
+  {
     connect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
 	    this, SLOT(changeItem(const Item *, uint32_t)));
+    connect(m_spawnShell, SIGNAL(changeItems(const ItemList&, uint32_t)),
+	    this, SLOT(changeItems(const ItemList&, uint32_t)));
+  }
   
   // connect SpawnList slots to Player signals
   connect(m_player, SIGNAL(posChanged(int16_t,int16_t,int16_t,
@@ -204,14 +213,19 @@ SpawnListWindow2::~SpawnListWindow2()
 {
 }
 
-SpawnListItem* SpawnListWindow2::selected()
+const Item* SpawnListWindow2::selected()
 {
-  return ((SpawnListItem*) m_spawnList->currentItem());
+  return m_model->item(m_spawnList->currentIndex());
 }
 
-SpawnListItem* SpawnListWindow2::find(const Item* item)
+QModelIndex SpawnListWindow2::find(const Item* item)
 {
-  return m_spawnListItemDict.value((void*)item, nullptr);
+  // the list is flat, so there's at most one row for the item
+  QModelIndexList indexes = m_model->indexes(item);
+  if (indexes.isEmpty())
+    return QModelIndex();
+
+  return indexes.first();
 }
 
 QString SpawnListWindow2::filterString(const Item* item)
@@ -272,7 +286,7 @@ QMenu* SpawnListWindow2::menu()
 
 void SpawnListWindow2::updateCount()
 {
-  m_totalSpawns->setText(QString::number(m_spawnList->topLevelItemCount()));
+  m_totalSpawns->setText(QString::number(m_model->rowCount()));
 }
 
 void SpawnListWindow2::addItem(const Item* item)
@@ -286,21 +300,18 @@ void SpawnListWindow2::delItem(const Item* item)
   if (!item)
     return;
 
-  // find the list item
-  SpawnListItem* litem = find(item);
-
   if (item == m_selectedItem)
   {
       m_selectedItem = NULL;
       m_spawnList->selectionModel()->setCurrentIndex(QModelIndex(), QItemSelectionModel::Clear);
       m_spawnList->clearSelection();
-      m_spawnList->setCurrentItem(NULL);
   }
 
   // delete the list item
-  if (litem != NULL)
+  if (m_model->contains(item))
   {
-    delete m_spawnListItemDict.take((void*)item);
+    m_model->removeItem(item);
+    m_unsortedItems.remove(item);
 
     updateCount();
   }
@@ -312,10 +323,8 @@ void SpawnListWindow2::changeItem(const Item* item, uint32_t changeItem)
   if (!item)
     return;
 
-  SpawnListItem* litem = NULL;
-
   // see if the item is already in the list
-  litem = find(item);
+  bool listed = m_model->contains(item);
 
   // if nothing significant changed, just update it
   if (!(changeItem & (tSpawnChangedName | 
@@ -324,8 +333,11 @@ void SpawnListWindow2::changeItem(const Item* item, uint32_t changeItem)
 		      tSpawnChangedFilter | 
 		      tSpawnChangedRuntimeFilter)))
   {
-    if (litem != NULL)
-      litem->update(m_player, changeItem);
+    if (listed)
+    {
+      m_model->changeItem(item, changeItem);
+      markUnsorted(item, changeItem);
+    }
 
     return;
   }
@@ -348,9 +360,9 @@ void SpawnListWindow2::changeItem(const Item* item, uint32_t changeItem)
       !m_currentCategory->isFilteredFilter())
   {
     // delete the item (if it already existed)
-    if (litem != NULL)
+    if (listed)
     {
-      delete m_spawnListItemDict.take((void*)item);
+      m_model->removeItem(item);
 
       // update the displayed count
       updateCount();
@@ -364,9 +376,9 @@ void SpawnListWindow2::changeItem(const Item* item, uint32_t changeItem)
   if (!m_currentCategory->isFiltered(filterString(item), level))
   {
     // delete the item (if it already existed)
-    if (litem != NULL)
+    if (listed)
     {
-      delete m_spawnListItemDict.take((void*)item);
+      m_model->removeItem(item);
 
       // update the displayed count
       updateCount();
@@ -376,38 +388,33 @@ void SpawnListWindow2::changeItem(const Item* item, uint32_t changeItem)
     return;
   }
 
-  // if their is an item already, just update it
-  if (litem != NULL)
+  // if their is an item already, just update it, the color is picked when
+  // it's drawn
+  if (listed)
   {
-    // just update the item and recalc the color in case it was based on 
-    // something that we just changed.
-    litem->update(m_player, changeItem);
-    litem->pickTextColor(item, m_player, m_currentCategory->color());
-
-    // make sure it's sorted into the proper place
-    if (m_keepSorted)
-      m_spawnList->sortByColumn(m_spawnList->sortColumn(),
-              m_spawnList->header()->sortIndicatorOrder());
+    m_model->changeItem(item, changeItem);
+    markUnsorted(item, changeItem);
 
     // nothing more to do
     return;
   }
 
-  // add the new spawn list item
-  litem = new SpawnListItem(m_spawnList);
-
-  // insert it into the dictionary
-  m_spawnListItemDict.insert((void*)item, litem);
-
-  // setup the spawn list item
-  litem->setShellItem(item);
-  litem->update(m_player, tSpawnChangedALL);
-  litem->pickTextColor(item, m_player, m_currentCategory->color());
+  // add the new row
+  m_model->addItem(item);
+  markUnsorted(item, tSpawnChangedALL);
 
   // update the displayed count
   updateCount();
 }
 
+void SpawnListWindow2::changeItems(const ItemList& items, uint32_t changeType)
+{
+  // the rows are put back in order once the whole batch is in
+  QListIterator<const Item*> it(items);
+  while (it.hasNext())
+    changeItem(it.next(), changeType);
+}
+
 void SpawnListWindow2::killSpawn(const Item* item)
 {
   // just call change item (it will update/remove/add as appropriate)
@@ -421,37 +428,32 @@ void SpawnListWindow2::selectSpawn(const Item *item)
     m_selectedItem = NULL;
     m_spawnList->selectionModel()->setCurrentIndex(QModelIndex(), QItemSelectionModel::Clear);
     m_spawnList->clearSelection();
-    m_spawnList->setCurrentItem(NULL);
     return;
   }
 
   // cache the selected item
   m_selectedItem = item;
 
-  SpawnListItem* litem = NULL;
-
   // see if the item is in the list
-  litem = find(item);
+  QModelIndex index = find(item);
 
-  if (litem)
+  if (index.isValid())
   {
     // select the item
-    setSelectedQuiet(litem, true);
+    setSelectedQuiet(index);
 
     // make sure item is visible if configured to do so
     if (m_keepSelectedVisible)
-      m_spawnList->scrollToItem(litem);
+      m_spawnList->scrollTo(index);
   }
 }
 
 void SpawnListWindow2::clear(void)
 {
-  // clear out the spawn list item dictionary
-  qDeleteAll(m_spawnListItemDict);
-  m_spawnListItemDict.clear();
-
   // clear the spawn list contents
-  m_spawnList->clear();
+  m_model->clear();
+  m_unsortedItems.clear();
+  m_fullSortPending = false;
 }
 
 void SpawnListWindow2::addCategory(const Category* cat)
@@ -531,80 +533,24 @@ void SpawnListWindow2::loadedCategories(void)
 
 void SpawnListWindow2::playerLevelChanged(uint8_t)
 {
-  if (m_currentCategory == NULL)
-    return;
-
-  SEQListViewItemIterator it(m_spawnList);
-  SpawnListItem* slitem = NULL;
-  const Item* item;
-
-  // iterate until we are out of items
-  while (*it)
-  {
-    // get the current SpawnListItem
-    slitem = (SpawnListItem*)*it;
-
-    // get the item associated with the list item
-    item = slitem->item();
-
-    // set the color
-    slitem->pickTextColor(item, m_player, m_currentCategory->color());
-
-    ++it;
-  }
+  // con colors are picked when the rows are drawn
+  m_model->changeColors();
 }
 
 void SpawnListWindow2::setPlayer(int16_t x, int16_t y, int16_t z, 
 			   int16_t deltaX, int16_t deltaY, int16_t deltaZ, 
 			   int32_t degrees)
 {
-  SEQListViewItemIterator it(m_spawnList);
-  SpawnListItem* litem;
-  QString buff;
+  // the distances were already recalculated in bulk by
+  // SpawnShell::playerMoved(), just have the visible rows redrawn
+  m_model->changeDistances();
 
-  if (!showeq_params->fast_machine)
+  // every row's distance changed, so when sorted by it, sort it all
+  if (m_keepSorted && (m_model->sortColumn() == tSpawnColDist))
   {
-    // no, cheat using integer distance calculation ignoring Z dimension
-    while (*it)
-    {
-      // get the current item
-      litem = (SpawnListItem*)*it;
-
-      if (litem->type() != tUnknown) 
-       {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-           buff = QString::asprintf("%5d", litem->item()->calcDist2DInt(x, y));
-#else
-           buff.sprintf("%5d", litem->item()->calcDist2DInt(x, y));
-#endif
-           litem->setText(tSpawnColDist, buff);
-       }
-
-      // keep iterating
-      ++it;
-    }
-  }
-  else
-  {
-    // fast machine so calculate the correct floating point 3D distance
-    while (*it)
-    {
-      // get the current item
-     litem = (SpawnListItem*)*it;
-
-       if (litem->type() != tUnknown)
-       {
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-           buff = QString::asprintf("%5.1f", litem->item()->calcDist(x, y, z));
-#else
-           buff.sprintf("%5.1f", litem->item()->calcDist(x, y, z));
-#endif
-           litem->setText(tSpawnColDist, buff);
-       }
-
-      // keep iterating
-      ++it;
-    }
+    m_fullSortPending = true;
+    if (m_immediateUpdate)
+      scheduleSort();
   }
 }
 
@@ -641,7 +587,7 @@ void SpawnListWindow2::refresh(void)
 //  spawnItemType types[] = { tSpawn, tDrop, tPlayer };
 
   const Item* item;
-  SpawnListItem* litem;
+  bool listed;
 
   // iterate over all spawn types
   for (uint8_t i = 0; i < (sizeof(types) / sizeof(spawnItemType)) ; i++)
@@ -663,18 +609,16 @@ void SpawnListWindow2::refresh(void)
       if (item->lastChanged() <= m_lastUpdate)
 	continue;
 
-      // get the underlying listview item (if any)
-      litem = find(item);
+      // is the item already listed
+      listed = m_model->contains(item);
 
       // skip filtered spawns
       if ((item->filterFlags() & FILTER_FLAG_FILTERED) &&
 	  !m_currentCategory->isFilteredFilter())
       {
 	// delete the item (if it already existed)
-	if (litem != NULL)
-	{
-	  delete m_spawnListItemDict.take((void*)item);
-	}
+	if (listed)
+	  m_model->removeItem(item);
 
 	// nothing more to do for this item
 	continue;
@@ -689,36 +633,26 @@ void SpawnListWindow2::refresh(void)
       if (!m_currentCategory->isFiltered(filterString(item), 0))
       {
 	// delete the item (if it already existed)
-	if (litem != NULL)
-	{
-	  delete m_spawnListItemDict.take((void*)item);
-	}
+	if (listed)
+	  m_model->removeItem(item);
     
 	// nothing more to do for this item
 	continue;
       }
 
       // if their is an item already, just update it
-      if (litem != NULL)
+      if (listed)
       {
-	// just update the item
-	litem->update(m_player, tSpawnChangedALL);
-        litem->pickTextColor(item, m_player, m_currentCategory->color());
+	m_model->changeItem(item, tSpawnChangedALL);
+	markUnsorted(item, tSpawnChangedALL);
 	
 	// nothing more to do for this item
 	continue;
       }
 
-      // add the new spawn list item
-      litem = new SpawnListItem(m_spawnList);
-      
-      // insert it into the dictionary
-      m_spawnListItemDict.insert((void*)item, litem);
-      
-      // setup the spawn list item
-      litem->setShellItem(item);
-      litem->update(m_player, tSpawnChangedALL);
-      litem->pickTextColor(item, m_player, m_currentCategory->color());
+      // add the new row
+      m_model->addItem(item);
+      markUnsorted(item, tSpawnChangedALL);
     }
   }
 
@@ -729,10 +663,8 @@ void SpawnListWindow2::refresh(void)
   seqDebug("* elapsed (pre-sort): %d", test.elapsed());
 #endif 
 
-  // make sure the spawnlist is sorted
-  if (m_keepSorted)
-      m_spawnList->sortByColumn(m_spawnList->sortColumn(),
-              m_spawnList->header()->sortIndicatorOrder());
+  // put the rows that changed back in order
+  sortPending();
 
   // make sure the selected item is selected
   if (m_selectedItem)
@@ -769,7 +701,7 @@ void SpawnListWindow2::savePrefs(void)
   // save the underlying SEQWindows prefs
   SEQWindow::savePrefs();
 
-  // save the SEQListViews prefs
+  // save the SEQTreeViews prefs
   m_spawnList->savePrefs();
 }
 
@@ -786,6 +718,7 @@ void SpawnListWindow2::categorySelected(int index)
 
   // set the current category
   m_currentCategory = cat;
+  m_model->setItemColor(cat->color());
 
   // clear the spawn list contents
   clear();
@@ -796,21 +729,11 @@ void SpawnListWindow2::categorySelected(int index)
 
 void SpawnListWindow2::selChanged()
 {
-    QList<QTreeWidgetItem*> selected = m_spawnList->selectedItems();
+    QModelIndexList selected = m_spawnList->selectionModel()->selectedRows();
     if (!selected.count()) return;
 
     // the list is limited to one selection at a time, so we can take the first
-    SEQListViewItem* litem = selected.first();
-    if (litem == NULL)
-    {
-        m_selectedItem = NULL;
-        m_spawnList->selectionModel()->setCurrentIndex(QModelIndex(), QItemSelectionModel::Clear);
-        m_spawnList->clearSelection();
-        m_spawnList->setCurrentItem(NULL);
-        return;
-    }
-
-    m_selectedItem = ((SpawnListItem*)litem)->item();
+    m_selectedItem = m_model->item(selected.first());
 
     // it might have been a category title selected, only select if it's an item
     if (m_selectedItem != NULL)
@@ -826,26 +749,17 @@ void SpawnListWindow2::listMouseRightButtonPressed(QMouseEvent* event) {
 }
 
 
-void SpawnListWindow2::listItemPressed(QTreeWidgetItem* litem, int col)
+void SpawnListWindow2::listItemPressed(const QModelIndex& index)
 {
-    SEQListViewItem* lvitem = dynamic_cast<SEQListViewItem*>(litem);
-    if (!lvitem) return;
-
-    m_spawnList->setCurrentItem(lvitem);
-
-    const Item* item = ((SpawnListItem*)lvitem)->item();
-    if (item != NULL)
+    const Item* item = m_model->item(index);
+    if ((item != NULL) && (m_menu != NULL))
         m_menu->setCurrentItem(item);
 }
 
-void SpawnListWindow2::listItemDoubleClicked(QTreeWidgetItem* litem, int col)
+void SpawnListWindow2::listItemDoubleClicked(const QModelIndex& index)
 {
-
-    SEQListViewItem* lvitem = dynamic_cast<SEQListViewItem*>(litem);
-    if (!lvitem) return;
-
     //print spawn info to console
-    const Item* item = ((SpawnListItem*)lvitem)->item();
+    const Item* item = m_model->item(index);
     if (item != NULL)
         seqInfo("%s", filterString(item).toLatin1().data());
 }
@@ -876,11 +790,15 @@ void SpawnListWindow2::toggle_immediateUpdate(bool enable)
     m_timer->stop();
     connect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
             this, SLOT(changeItem(const Item *, uint32_t)));
+    connect(m_spawnShell, SIGNAL(changeItems(const ItemList&, uint32_t)),
+            this, SLOT(changeItems(const ItemList&, uint32_t)));
   }
   else
   {
     disconnect(m_spawnShell, SIGNAL(changeItem(const Item *, uint32_t)),
             this, SLOT(changeItem(const Item *, uint32_t)));
+    disconnect(m_spawnShell, SIGNAL(changeItems(const ItemList&, uint32_t)),
+            this, SLOT(changeItems(const ItemList&, uint32_t)));
     m_timer->start(m_delay);
   }
 
@@ -895,9 +813,10 @@ void SpawnListWindow2::toggle_keepSorted(bool enable)
   pSEQPrefs->setPrefBool("KeepSorted", preferenceName(),
           m_keepSorted);
   m_spawnList->setSortingEnabled(enable);
+  m_unsortedItems.clear();
+  m_fullSortPending = false;
   if (m_keepSorted)
-      m_spawnList->sortByColumn(m_spawnList->sortColumn(),
-              m_spawnList->header()->sortIndicatorOrder());
+    sortAll();
 }
 
 void SpawnListWindow2::toggle_keepSelectedVisible(bool enable)
@@ -908,36 +827,97 @@ void SpawnListWindow2::toggle_keepSelectedVisible(bool enable)
           m_keepSelectedVisible);
 }
 
-void SpawnListWindow2::setSelectedQuiet(SEQListViewItem* item, bool selected)
+void SpawnListWindow2::markUnsorted(const Item* item, uint32_t changeType)
 {
-  if (item->isSelected() == selected)
+  if (!m_keepSorted || !m_model->affectsSort(changeType))
     return;
 
-  // get the old selection
-  SEQListViewItem *oldItem = m_spawnList->currentItem();
+  if (!m_unsortedItems.contains(item))
+  {
+    m_unsortedItems.insert(item);
+    m_model->markUnsorted(item);
+  }
 
-  if (!item)
+  // immediate updates have no refresh to put it back in order
+  if (m_immediateUpdate)
+    scheduleSort();
+}
+
+void SpawnListWindow2::scheduleSort(void)
+{
+  // once the current burst of changes is done
+  if (!m_sortScheduled)
+  {
+    m_sortScheduled = true;
+    QTimer::singleShot(0, this, SLOT(sortPending()));
+  }
+}
+
+void SpawnListWindow2::sortPending(void)
+{
+  m_sortScheduled = false;
+
+  if (!m_keepSorted)
+  {
+    m_unsortedItems.clear();
+    m_fullSortPending = false;
+    return;
+  }
+
+  // past a point, placing the rows one at a time costs more than sorting
+  if (m_fullSortPending ||
+      ((m_unsortedItems.count() * 100) >
+       (m_model->rowCount() * m_fullSortPercent)))
+  {
+    sortAll();
+    return;
+  }
+
+  // move the changed rows back into place, anything that doesn't fit in
+  // the time budget waits for the next pass
+  QElapsedTimer timer;
+  timer.start();
+  QSet<const Item*>::iterator it = m_unsortedItems.begin();
+  while (it != m_unsortedItems.end())
+  {
+    m_model->resortItem(*it);
+    it = m_unsortedItems.erase(it);
+
+    if (timer.elapsed() >= m_sortBudget)
+      break;
+  }
+
+  if (!m_unsortedItems.isEmpty() && m_immediateUpdate)
+    scheduleSort();
+}
+
+void SpawnListWindow2::sortAll(void)
+{
+  m_model->sort(m_spawnList->sortColumn(),
+		m_spawnList->header()->sortIndicatorOrder());
+  m_unsortedItems.clear();
+  m_fullSortPending = false;
+}
+
+void SpawnListWindow2::setSelectedQuiet(const QModelIndex& index)
+{
+  if (!index.isValid())
   {
     m_selectedItem = NULL;
     m_spawnList->selectionModel()->setCurrentIndex(QModelIndex(), QItemSelectionModel::Clear);
     m_spawnList->clearSelection();
-    m_spawnList->setCurrentItem(NULL);
     return;
   }
 
-  // unselect the old selected item if any
-  if ((oldItem != item) && (oldItem != NULL) && (oldItem->isSelected()))
-    oldItem->setSelected(false);
-
-  // mark the new selected item
-  item->setSelected(selected);
-
-  // set the selected item to be the current item (should signal selection 
-  // notifications since the selection state is already changed).
-  m_spawnList->setCurrentItem(item);
+  if (m_spawnList->selectionModel()->isRowSelected(index.row(),
+						   index.parent()))
+    return;
 
-  //repaint
-  update();
+  // make the row the current and only selected one (this signals the
+  // selection change)
+  m_spawnList->selectionModel()->setCurrentIndex(index,
+				 QItemSelectionModel::ClearAndSelect |
+				 QItemSelectionModel::Rows);
 }
 
 void SpawnListWindow2::populateSpawns(void)
@@ -962,7 +942,6 @@ void SpawnListWindow2::populateSpawns(void)
 //  spawnItemType types[] = { tSpawn, tDrop, tPlayer };
 
   const Item* item;
-  SpawnListItem* litem;
 
   // iterate over all spawn types
   for (uint8_t i = 0; i < (sizeof(types) / sizeof(spawnItemType)); i++)
@@ -989,22 +968,9 @@ void SpawnListWindow2::populateSpawns(void)
       if ((item->type() == tSpawn) || (item->type() == tPlayer))
 	level = ((Spawn*)item)->level();
 
-      // does this spawn match the category
+      // does this spawn match the category, yes add it
       if (m_currentCategory->isFiltered(filterString(item), level))
-      {
-	// yes, add it
-	litem = new SpawnListItem(m_spawnList);
-
-	// insert it into the dictionary
-	m_spawnListItemDict.insert((void*)item, litem);
-
-	// set up the list item
-	litem->setShellItem(item);
-	litem->update(m_player, tSpawnChangedALL);
-
-	// color the spawn
-	litem->pickTextColor(item, m_player, m_currentCategory->color());
-      }
+	m_model->addItem(item);
     }
   }
 
@@ -1015,10 +981,9 @@ void SpawnListWindow2::populateSpawns(void)
   seqDebug("* elapsed (pre-sort): %d", test.elapsed());
 #endif 
 
-  // make sure the spawnlist is sorted
+  // everything is new, so sort it all
   if (m_keepSorted)
-      m_spawnList->sortByColumn(m_spawnList->sortColumn(),
-              m_spawnList->header()->sortIndicatorOrder());
+    sortAll();
 
   // update the count display
   updateCount();
@@ -1042,17 +1007,8 @@ void SpawnListWindow2::populateSpawns(void)
 
 void SpawnListWindow2::styleChanged()
 {
-    SEQListViewItemIterator it(m_spawnList);
-
-    QColor fg = palette().color(QPalette::WindowText);
-
-    while (*it)
-    {
-        SpawnListItem* litem = (SpawnListItem*)*it;
-        litem->pickTextColor(litem->item(), m_player, fg);
-
-        ++it;
-    }
+  // the palette's text color is looked up when the rows are drawn
+  m_model->changeColors();
 }
 
 
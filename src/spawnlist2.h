@@ -24,11 +24,13 @@
 #define SPAWNLIST2_H
 
 #include <QHash>
+#include <QSet>
 #include <QMenu>
 
 #include "seqwindow.h"
 #include "seqlistview.h"
 #include "spawnlistcommon.h"
+#include "spawnshell.h"
 
 //--------------------------------------------------
 // forward declarations
@@ -56,8 +58,8 @@ class SpawnListWindow2 : public SEQWindow
    virtual QMenu* menu();
 
 
-   SpawnListItem* selected();
-   SpawnListItem* find(const Item* item);
+   const Item* selected();
+   QModelIndex find(const Item* item);
 
    QString filterString(const Item* item);
 
@@ -72,6 +74,7 @@ public slots:
    void addItem(const Item *);
    void delItem(const Item *);
    void changeItem(const Item *, uint32_t changeType);
+   void changeItems(const ItemList& items, uint32_t changeType);
    void killSpawn(const Item *);
    void selectSpawn(const Item *);
    void clear(void);
@@ -103,8 +106,8 @@ public slots:
    void selChanged();
 
    void listMouseRightButtonPressed(QMouseEvent* event);
-   void listItemPressed(QTreeWidgetItem *litem, int col);
-   void listItemDoubleClicked(QTreeWidgetItem *litem, int col);
+   void listItemPressed(const QModelIndex& index);
+   void listItemDoubleClicked(const QModelIndex& index);
 
    // fpm spinbox signals
    void setFPM(int rate);
@@ -113,11 +116,18 @@ public slots:
    void toggle_immediateUpdate(bool enable);
    void toggle_keepSorted(bool enable);
    void toggle_keepSelectedVisible(bool enable);
+
+   // put changed rows back in order
+   void sortPending(void);
+
  private:
-   void setSelectedQuiet(SEQListViewItem* item, bool selected);
+   void setSelectedQuiet(const QModelIndex& index);
    void populateSpawns(void);
    void populateCategory(const Category* cat);
    void updateCount(void);
+   void markUnsorted(const Item* item, uint32_t changeType);
+   void scheduleSort(void);
+   void sortAll(void);
    // data sources
    Player *m_player;
    CategoryMgr* m_categoryMgr;
@@ -132,13 +142,11 @@ public slots:
    // GUI Items
    QComboBox* m_categoryCombo;
    QSpinBox* m_fpmSpinBox;
-   SEQListView* m_spawnList;
+   SEQTreeView* m_spawnList;
+   SpawnListModel* m_model;
    SpawnListMenu* m_menu;
    QLineEdit* m_totalSpawns;
 
-   // index dictionary for retrieving SpawnListItems by Item
-   QHash<void*, SpawnListItem*> m_spawnListItemDict;
-
    // timer used
    QTimer* m_timer;
 
@@ -151,6 +159,13 @@ public slots:
    bool m_immediateUpdate;
    bool m_keepSorted;
    bool m_keepSelectedVisible;
+
+   // items whose rows may be out of order, and whether every row is
+   bool m_fullSortPending;
+   bool m_sortScheduled;
+   QSet<const Item*> m_unsortedItems;
+   int m_sortBudget;
+   int m_fullSortPercent;
 };
 
 #endif // SPAWNLIST2_H
@@ -38,6 +38,7 @@
 #include "filterlistwindow.h"
 
 #include <cstring>
+#include <algorithm>
 
 #include <QApplication>
 #include <QFontDialog>
@@ -46,333 +47,373 @@
 #include <QFont>
 #include <QPainter>
 #include <QMenu>
+#include <QVector>
 
-SpawnListItem::SpawnListItem(SEQListViewItem *parent) : SEQListViewItem(parent)
+//----------------------------------------------------------------------
+// SpawnListNode
+struct SpawnListNode
+{
+  SpawnListNode(SpawnListNode* p, const Item* i, const Category* c)
+    : parent(p), item(i), category(c), row(0), level(0), npc(0),
+      dirty(false)
+  {}
+  ~SpawnListNode() { qDeleteAll(children); }
+
+  SpawnListNode* parent;
+  const Item* item;          // NULL on category rows
+  const Category* category;  // only set on category rows
+  int row;
+  int level;                 // what the item was listed as
+  int npc;
+  bool dirty;                // may be out of sort order
+  QString name;
+  QList<SpawnListNode*> children;
+};
+
+//----------------------------------------------------------------------
+// helpers
+static const Spawn* spawnOf(const Item* item)
 {
-  m_textColor = qApp->palette().color(QPalette::WindowText);
+  if ((item->type() == tSpawn) || (item->type() == tPlayer))
+    return (const Spawn*)item;
 
-  m_item = NULL;
-  m_npc = 0;
+  return NULL;
 }
 
-SpawnListItem::SpawnListItem(SEQListView *parent) : SEQListViewItem(parent)
+// renumber the rows from first to last (or the end)
+static void renumber(SpawnListNode* parent, int first, int last = -1)
 {
-  m_textColor = qApp->palette().color(QPalette::WindowText);
+  if ((last < 0) || (last >= parent->children.size()))
+    last = parent->children.size() - 1;
 
-  m_item = NULL;
-  m_npc = 0;
+  for (int i = first; i <= last; i++)
+    parent->children[i]->row = i;
 }
 
-SpawnListItem::~SpawnListItem()
+// is a above b when the whole tree is expanded
+static bool inTreeOrder(const SpawnListNode* a, const SpawnListNode* b)
 {
+  QList<int> pathA, pathB;
+  for (; a->parent; a = a->parent)
+    pathA.prepend(a->row);
+  for (; b->parent; b = b->parent)
+    pathB.prepend(b->row);
+
+  return std::lexicographical_compare(pathA.begin(), pathA.end(),
+				      pathB.begin(), pathB.end());
 }
 
-QVariant SpawnListItem::data(int column, int role) const
+static bool numericColumn(int column)
 {
-    QFont font = treeWidget()->font();
-    QFontMetrics metrics(font);
-    uint32_t filterFlags = 0;
-    if (m_item)
-        filterFlags = m_item->filterFlags();
+  return (column >= tSpawnColLevel) && (column <= tSpawnColDist);
+}
 
-    switch(role)
-    {
-        case Qt::FontRole:
-            if (!(filterFlags & (
-                            FILTER_FLAG_FILTERED |
-                            FILTER_FLAG_ALERT |
-                            FILTER_FLAG_LOCATE |
-                            FILTER_FLAG_CAUTION |
-                            FILTER_FLAG_DANGER)))
-            {
-                font.setBold(false);
-                font.setItalic(false);
-                font.setUnderline(false);
-            }
-            else
-            {
-                if (filterFlags & FILTER_FLAG_ALERT)
-                    font.setBold(true);
-                else
-                    font.setBold(false);
-
-                if (filterFlags & FILTER_FLAG_LOCATE)
-                    font.setItalic(true);
-                else
-                    font.setItalic(false);
-
-                if ((filterFlags & FILTER_FLAG_CAUTION) ||
-                        (filterFlags & FILTER_FLAG_DANGER))
-                    font.setUnderline(true);
-                else
-                    font.setUnderline(false);
-            }
-
-            return font;
-
-        case Qt::ForegroundRole:
-            if (filterFlags & FILTER_FLAG_FILTERED)
-                // color filtered spawns grey
-                return QColor(Qt::gray);
-            else
-                return m_textColor;
-
-        case Qt::SizeHintRole:
-            return QSize(-1, metrics.lineSpacing());
-
-        default:
-            return SEQListViewItem::data(column, role);
-    }
+static double sortValue(const Item* item, int column)
+{
+  const Spawn* spawn = spawnOf(item);
+
+  switch (column)
+  {
+  case tSpawnColLevel:
+    return spawn ? spawn->level() : 0;
+  case tSpawnColHP:
+    return spawn ? spawn->HP() : 0;
+  case tSpawnColMaxHP:
+    return spawn ? spawn->maxHP() : 0;
+  case tSpawnColXPos:
+    return showeq_params->retarded_coords ? (int)item->y() : (int)item->x();
+  case tSpawnColYPos:
+    return showeq_params->retarded_coords ? (int)item->x() : (int)item->y();
+  case tSpawnColZPos:
+    return (int)item->z();
+  case tSpawnColID:
+    return item->id();
+  case tSpawnColDist:
+    if (showeq_params->fast_machine)
+      return item->getFDistanceToPlayer();
+    return item->getIDistanceToPlayer();
+  }
+
+  return 0;
+}
+
+struct SpawnListSortKey
+{
+  double value;
+  QString text;
+  SpawnListNode* node;
+};
+
+static bool valueLess(const SpawnListSortKey& a, const SpawnListSortKey& b)
+{
+  return a.value < b.value;
+}
+
+static bool valueGreater(const SpawnListSortKey& a, const SpawnListSortKey& b)
+{
+  return b.value < a.value;
+}
+
+static bool textLess(const SpawnListSortKey& a, const SpawnListSortKey& b)
+{
+  return a.text < b.text;
+}
+
+static bool textGreater(const SpawnListSortKey& a, const SpawnListSortKey& b)
+{
+  return b.text < a.text;
+}
+
+//----------------------------------------------------------------------
+// SpawnListModel
+SpawnListModel::SpawnListModel(Player* player, QObject* parent)
+  : QAbstractItemModel(parent),
+    m_player(player),
+    m_root(new SpawnListNode(NULL, NULL, NULL)),
+    m_itemColor(Qt::black),
+    m_sortColumn(-1),
+    m_sortOrder(Qt::AscendingOrder),
+    m_keepSorted(true)
+{
+  m_headers << "Name" << "Lvl" << "Hp" << "MaxHP";
+  if (showeq_params->retarded_coords)
+    m_headers << "N/S" << "E/W";
+  else
+    m_headers << "X" << "Y";
+  m_headers << "Z" << "ID" << "Dist" << "Race" << "Class" << "Info"
+	    << "SpawnTime" << "Deity" << "Body Type" << "Guild Tag";
+}
 
+SpawnListModel::~SpawnListModel()
+{
+  delete m_root;
 }
 
-spawnItemType SpawnListItem::type()
+SpawnListNode* SpawnListModel::node(const QModelIndex& index) const
 {
-   return item() ? item()->type() : tUnknown;
+  if (!index.isValid())
+    return m_root;
+
+  return (SpawnListNode*)index.internalPointer();
+}
+
+QModelIndex SpawnListModel::nodeIndex(SpawnListNode* node, int column) const
+{
+  if (node == m_root)
+    return QModelIndex();
+
+  return createIndex(node->row, column, node);
+}
+
+QModelIndex SpawnListModel::index(int row, int column,
+				  const QModelIndex& parent) const
+{
+  SpawnListNode* parentNode = node(parent);
+
+  if ((row < 0) || (row >= parentNode->children.size()) ||
+      (column < 0) || (column >= tSpawnColMaxCols))
+    return QModelIndex();
+
+  return createIndex(row, column, parentNode->children[row]);
 }
 
-bool SpawnListItem::operator<(const SEQListViewItem& other) const
+QModelIndex SpawnListModel::parent(const QModelIndex& index) const
 {
-    int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+  if (!index.isValid())
+    return QModelIndex();
+
+  return nodeIndex(node(index)->parent);
+}
+
+int SpawnListModel::rowCount(const QModelIndex& parent) const
+{
+  if (parent.column() > 0)
+    return 0;
+
+  return node(parent)->children.size();
+}
+
+int SpawnListModel::columnCount(const QModelIndex& parent) const
+{
+  return tSpawnColMaxCols;
+}
+
+QVariant SpawnListModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid())
+    return QVariant();
+
+  const SpawnListNode* n = node(index);
+  uint32_t filterFlags = n->item ? n->item->filterFlags() : 0;
+
+  switch (role)
+  {
+  case Qt::DisplayRole:
+    if (n->item)
+      return text(n->item, index.column());
+
+    // category rows show how many rows they hold
+    if (n->category && (index.column() == tSpawnColName))
+      return QString("%1 (%2)").arg(n->category->name())
+	.arg(n->children.size());
+
+    return QVariant();
+
+  case Qt::ForegroundRole:
+    if (n->category)
+      return textColor(NULL, n->category->color());
+
+    // color filtered spawns grey
+    if (filterFlags & FILTER_FLAG_FILTERED)
+      return QColor(Qt::gray);
 
-    switch(column)
     {
-        case 1: // level
-        case 2: // hp
-        case 3: // max hp
-        case 4: // coord 1
-        case 5: // coord 2
-        case 6: // coord 3
-        case 7: // ID
-            return data(column, Qt::DisplayRole).value<int>() <
-                other.data(column, Qt::DisplayRole).value<int>();
-
-        case 8: // distance
-            // "fast machine" option will use float, not int
-            return
-                ((data(column, Qt::DisplayRole).canConvert<float>()) ?
-                data(column, Qt::DisplayRole).value<float>() :
-                data(column, Qt::DisplayRole).value<int>())
-                <
-                ((other.data(column, Qt::DisplayRole).canConvert<float>()) ?
-                other.data(column, Qt::DisplayRole).value<float>() :
-                other.data(column, Qt::DisplayRole).value<int>());
-
-        case 0: // name
-        case 9: // race
-        case 10:// class
-        case 11:// info
-        case 12:// spawn time
-        case 13:// diety
-        case 14:// body type
-        case 15:// guild tag
-        default: // Qt sorts values as strings by default
-            return text(column) < other.text(column);
+      // spawns are colored like the category they were listed in
+      const SpawnListNode* top = n;
+      while (top->parent != m_root)
+	top = top->parent;
+
+      return textColor(n->item,
+		       top->category ? top->category->color() : m_itemColor);
     }
 
+  case Qt::FontRole:
+    if (!(filterFlags & (FILTER_FLAG_ALERT | FILTER_FLAG_LOCATE |
+			 FILTER_FLAG_CAUTION | FILTER_FLAG_DANGER)))
+      return QVariant();
+
+    {
+      // only the styles are set, the rest comes from the view's font
+      QFont font;
+      font.setBold(filterFlags & FILTER_FLAG_ALERT);
+      font.setItalic(filterFlags & FILTER_FLAG_LOCATE);
+      font.setUnderline(filterFlags &
+			(FILTER_FLAG_CAUTION | FILTER_FLAG_DANGER));
+      return font;
+    }
+  }
+
+  return QVariant();
 }
 
-void SpawnListItem::update(Player* player, uint32_t changeType)
-{
-//   seqDebug("SpawnListItem::update()\n");
-   QString buff;
-   const Spawn* spawn = NULL;
-
-   if ((item()->type() == tSpawn) || (item()->type() == tPlayer))
-     spawn = (const Spawn*)item();
-
-   if (changeType & tSpawnChangedName)
-   {
-     // Name
-     if (!showeq_params->showRealName)
-       buff = item()->transformedName();
-     else
-       buff = item()->name();
-
-     if (spawn != NULL) 
-     {
-       if (!spawn->lastName().isEmpty())
-       {
-         buff = QString("%1 (%2)").arg(buff).arg(spawn->lastName());
-       }
-       if (spawn->gm())
-         buff += " *GM* ";
-     }
-
-     setText(tSpawnColName, buff);
-   }
-
-   // only spawns contain level info
-   if (spawn != NULL)
-   {
-     if (changeType & tSpawnChangedLevel)
-     {
-       // Level
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-       buff = QString::asprintf("%2d", spawn->level());
-#else
-       buff.sprintf("%2d", spawn->level());
-#endif
-       setText(tSpawnColLevel, buff);
-     }
-     
-     if (changeType & tSpawnChangedHP)
-     {
-       // Hitpoints
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-       buff = QString::asprintf("%5d", spawn->HP());
-#else
-       buff.sprintf("%5d", spawn->HP());
-#endif
-       setText(tSpawnColHP, buff);
-       
-       // Maximum Hitpoints
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-       buff = QString::asprintf("%5d", spawn->maxHP());
-#else
-       buff.sprintf("%5d", spawn->maxHP());
-#endif
-       setText(tSpawnColMaxHP, buff);
-     }
-
-     if (changeType == tSpawnChangedALL)
-     {
-       setText(tSpawnColDeity, spawn->deityName());
-       setText(tSpawnColBodyType, spawn->typeString());
-       if (!spawn->guildTag().isEmpty())
-            setText(tSpawnColGuildID, spawn->guildTag());
-       else if (spawn->guildID())
-            setText(tSpawnColGuildID, QString::number(spawn->guildID()));
-       else
-           setText(tSpawnColGuildID, " ");
-     }
-   }
-   else if (changeType == tSpawnChangedALL)
-   {
-     buff = "0";
-     setText(tSpawnColLevel, buff);
-     setText(tSpawnColHP, buff);
-     setText(tSpawnColMaxHP, buff);
-   }
-
-   if (changeType & tSpawnChangedPosition)
-   {
-     // X position
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-     buff = QString::asprintf("%5d", showeq_params->retarded_coords ? 
-		  (int)item()->y() : (int)item()->x());
-#else
-     buff.sprintf("%5d", showeq_params->retarded_coords ? 
-		  (int)item()->y() : (int)item()->x());
-#endif
-     setText(tSpawnColXPos, buff);
-     
-     // Y position
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-     buff = QString::asprintf("%5d", showeq_params->retarded_coords ? 
-		  (int)item()->x() : (int)item()->y());
-#else
-     buff.sprintf("%5d", showeq_params->retarded_coords ? 
-		  (int)item()->x() : (int)item()->y());
-#endif
-     setText(tSpawnColYPos, buff);
-     
-     // Z position
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-     buff = QString::asprintf("%5d", item()->z());
-#else
-     buff.sprintf("%5d", item()->z());
-#endif
-     setText(tSpawnColZPos, buff);
-
-     // Distance
-     if (!showeq_params->fast_machine)
-     {
-       //buff.sprintf("%5d", player->calcDist2DInt(*item()));
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-       buff = QString::asprintf("%5d", item()->getIDistanceToPlayer());
-#else
-       buff.sprintf("%5d", item()->getIDistanceToPlayer());
-#endif
-     }
-     else
-     {
-       //buff.sprintf("%5.1f", player->calcDist(*item()));
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-       buff = QString::asprintf("%5.1f", item()->getFDistanceToPlayer());
-#else
-       buff.sprintf("%5.1f", item()->getFDistanceToPlayer());
-#endif
-     }
-     setText(tSpawnColDist, buff);
-   }
-
-   if (changeType == tSpawnChangedALL)
-   {
-     // Id
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-     buff = QString::asprintf("%5d", item()->id());
-#else
-     buff.sprintf("%5d", item()->id());
-#endif
-     setText(tSpawnColID, buff);
-     
-     // Race
-     setText(tSpawnColRace, item()->raceString());
-     
-     // Class
-     setText(tSpawnColClass, item()->classString());
-     
-     // Spawntime
-     setText(tSpawnColSpawnTime, m_item->spawnTimeStr());
-
-     // CJD TODO - Deity, PVP teams
-   }
-
-   if (changeType & tSpawnChangedWearing)
-   {
-     // Info
-     setText(tSpawnColInfo, item()->info());
-   }
-
-   m_npc = item()->NPC();
-}
-
-void SpawnListItem::updateTitle(const QString& name)
-{
-  // update childcount in header
-  QString temp;
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-  temp = QString::asprintf("%s (%d)",
-          name.toLatin1().data(), childCount());
-#else
-  temp.sprintf("%s (%d)",
-          name.toLatin1().data(), childCount());
-#endif
+QVariant SpawnListModel::headerData(int section, Qt::Orientation orientation,
+				    int role) const
+{
+  if ((orientation == Qt::Horizontal) && (role == Qt::DisplayRole) &&
+      (section >= 0) && (section < m_headers.size()))
+    return m_headers[section];
+
+  return QVariant();
+}
+
+const Item* SpawnListModel::item(const QModelIndex& index) const
+{
+  if (!index.isValid())
+    return NULL;
+
+  return node(index)->item;
+}
+
+const Category* SpawnListModel::category(const QModelIndex& index) const
+{
+  if (!index.isValid())
+    return NULL;
 
-  setText(tSpawnColName, temp);
-} // end if spawn should be in this category
+  const SpawnListNode* top = node(index);
+  while (top->parent != m_root)
+    top = top->parent;
 
-void SpawnListItem::setShellItem(const Item *item)
+  return top->category;
+}
+
+QString SpawnListModel::text(const Item* item, int column) const
 {
-   m_item = item;
-   if (item)
-      m_npc = item->NPC();
+  const Spawn* spawn = spawnOf(item);
+  QString buff;
+
+  switch (column)
+  {
+  case tSpawnColName:
+    if (!showeq_params->showRealName)
+      buff = item->transformedName();
+    else
+      buff = item->name();
+
+    if (spawn != NULL)
+    {
+      if (!spawn->lastName().isEmpty())
+	buff = QString("%1 (%2)").arg(buff).arg(spawn->lastName());
+      if (spawn->gm())
+	buff += " *GM* ";
+    }
+    return buff;
+
+  case tSpawnColLevel:
+    if (spawn == NULL)
+      return "0";
+    return QString("%1").arg(spawn->level(), 2);
+
+  case tSpawnColHP:
+    if (spawn == NULL)
+      return "0";
+    return QString("%1").arg(spawn->HP(), 5);
+
+  case tSpawnColMaxHP:
+    if (spawn == NULL)
+      return "0";
+    return QString("%1").arg(spawn->maxHP(), 5);
+
+  case tSpawnColXPos:
+  case tSpawnColYPos:
+  case tSpawnColZPos:
+  case tSpawnColID:
+    return QString("%1").arg((int)sortValue(item, column), 5);
+
+  case tSpawnColDist:
+    if (!showeq_params->fast_machine)
+      return QString("%1").arg(item->getIDistanceToPlayer(), 5);
+    return QString("%1").arg(item->getFDistanceToPlayer(), 5, 'f', 1);
+
+  case tSpawnColRace:
+    return item->raceString();
+
+  case tSpawnColClass:
+    return item->classString();
+
+  case tSpawnColInfo:
+    return item->info();
+
+  case tSpawnColSpawnTime:
+    return item->spawnTimeStr();
+
+  case tSpawnColDeity:
+    return spawn ? spawn->deityName() : QString();
+
+  case tSpawnColBodyType:
+    return spawn ? spawn->typeString() : QString();
+
+  case tSpawnColGuildID:
+    if (spawn == NULL)
+      return QString();
+    if (!spawn->guildTag().isEmpty())
+      return spawn->guildTag();
+    if (spawn->guildID())
+      return QString::number(spawn->guildID());
+    return " ";
+  }
+
+  return QString();
 }
 
 //----------------------------------------------------------------------
 //
-// pickTextColor
+// textColor
 // 
 // insert color schemes here
 //
-void SpawnListItem::pickTextColor(const Item* item, 
-				  Player* player, 
-				  QColor def)
+QColor SpawnListModel::textColor(const Item* item, QColor def) const
 {
-
   QColor fg = qApp->palette().color(QPalette::WindowText);
-  QColor bg = qApp->palette().color(QPalette::Base);
 
   //Black is the parameter default, so if it's black, we should use the
   //foreground color instead.  That way we won't wind up with black text by
@@ -381,31 +422,21 @@ void SpawnListItem::pickTextColor(const Item* item,
       def = fg;
 
   if (item == NULL)
-  {
-    m_textColor = def;
-    return;
-  }
+    return def;
 
-  const Spawn* spawn = NULL;
-  if ((item->type() == tSpawn) || (item->type() == tPlayer))
-    spawn = (const Spawn*)item;
+  const Spawn* spawn = spawnOf(item);
 
   if (spawn == NULL)
-  {
-    m_textColor = def;
-    return;
-  }
+    return def;
 
   switch (spawn->typeflag())
   {
   case 65:
-    m_textColor = Qt::magenta;
-    return;
+    return Qt::magenta;
   case 66:
   case 67:
   case 100:
-    m_textColor = Qt::darkMagenta;
-    return;
+    return Qt::darkMagenta;
   }
 
   // color by pvp team
@@ -414,17 +445,13 @@ void SpawnListItem::pickTextColor(const Item* item,
     switch(spawn->raceTeam()) 
     {
     case RTEAM_HUMAN:
-      m_textColor = Qt::blue;
-      return;
+      return Qt::blue;
     case RTEAM_ELF:
-      m_textColor = QColor(196,206,12);
-      return;
+      return QColor(196,206,12);
     case RTEAM_DARK:
-      m_textColor = QColor(206,151,33);
-      return;
+      return QColor(206,151,33);
     case RTEAM_SHORT:
-      m_textColor = Qt::magenta;
-      return;
+      return Qt::magenta;
     }
   } 
   else if (showeq_params->deitypvp) // if deitypvp
@@ -432,26 +459,381 @@ void SpawnListItem::pickTextColor(const Item* item,
     switch(spawn->deityTeam()) 
     {
     case DTEAM_GOOD:
-      m_textColor = Qt::blue;
-      return;
+      return Qt::blue;
     case DTEAM_NEUTRAL:
-      m_textColor = QColor(196,206,12);
-      return;
+      return QColor(196,206,12);
     case DTEAM_EVIL:
-      m_textColor = Qt::magenta;
-      return;
+      return Qt::magenta;
     }
   }
 
   // color by consider difficulty
-  m_textColor = player->pickConColor(spawn->level());
-  if (m_textColor == Qt::white || m_textColor == Qt::black)
-    m_textColor = def;
-  if (m_textColor == Qt::yellow)
-    m_textColor = QColor(206,151,33);
-} // end pickTextColor
-
-SpawnListMenu::SpawnListMenu(SEQListView* spawnlist,
+  QColor color = m_player->pickConColor(spawn->level());
+  if (color == Qt::white || color == Qt::black)
+    color = def;
+  if (color == Qt::yellow)
+    color = QColor(206,151,33);
+
+  return color;
+} // end textColor
+
+bool SpawnListModel::contains(const Item* item) const
+{
+  return m_itemNodes.contains(item);
+}
+
+QModelIndexList SpawnListModel::indexes(const Item* item) const
+{
+  QList<SpawnListNode*> nodes = m_itemNodes.values(item);
+  std::sort(nodes.begin(), nodes.end(), inTreeOrder);
+
+  QModelIndexList result;
+  for (int i = 0; i < nodes.size(); i++)
+    result.append(nodeIndex(nodes[i]));
+
+  return result;
+}
+
+QModelIndex SpawnListModel::categoryIndex(const Category* cat) const
+{
+  SpawnListNode* n = m_categoryNodes.value(cat);
+  if (n == NULL)
+    return QModelIndex();
+
+  return nodeIndex(n);
+}
+
+bool SpawnListModel::sameListing(const Item* item) const
+{
+  const SpawnListNode* n = m_itemNodes.value(item);
+  if (n == NULL)
+    return false;
+
+  const Spawn* spawn = spawnOf(item);
+  return (n->level == (spawn ? spawn->level() : 0)) &&
+    (n->npc == item->NPC()) && (n->name == item->name());
+}
+
+QModelIndex SpawnListModel::addCategory(const Category* cat)
+{
+  // categories stay in the order they were added
+  SpawnListNode* n = new SpawnListNode(m_root, NULL, cat);
+  int row = m_root->children.size();
+
+  beginInsertRows(QModelIndex(), row, row);
+  m_root->children.append(n);
+  n->row = row;
+  m_categoryNodes.insert(cat, n);
+  endInsertRows();
+
+  return nodeIndex(n);
+}
+
+void SpawnListModel::removeCategory(const Category* cat)
+{
+  SpawnListNode* n = m_categoryNodes.value(cat);
+  if (n != NULL)
+    removeNode(n);
+}
+
+QModelIndex SpawnListModel::addItem(const Item* item,
+				    const QModelIndex& parent)
+{
+  SpawnListNode* parentNode = node(parent);
+  SpawnListNode* n = new SpawnListNode(parentNode, item, NULL);
+  const Spawn* spawn = spawnOf(item);
+  n->level = spawn ? spawn->level() : 0;
+  n->npc = item->NPC();
+  n->name = item->name();
+
+  int row = parentNode->children.size();
+  if (m_keepSorted && (m_sortColumn >= 0))
+    row = sortedRow(parentNode, n);
+
+  beginInsertRows(nodeIndex(parentNode), row, row);
+  parentNode->children.insert(row, n);
+  renumber(parentNode, row);
+  m_itemNodes.insert(item, n);
+  endInsertRows();
+
+  titleChanged(parentNode);
+
+  return nodeIndex(n);
+}
+
+void SpawnListModel::removeItem(const Item* item)
+{
+  QList<SpawnListNode*> nodes = m_itemNodes.values(item);
+  for (int i = 0; i < nodes.size(); i++)
+    removeNode(nodes[i]);
+}
+
+void SpawnListModel::clear()
+{
+  beginResetModel();
+  delete m_root;
+  m_root = new SpawnListNode(NULL, NULL, NULL);
+  m_itemNodes.clear();
+  m_categoryNodes.clear();
+  endResetModel();
+}
+
+void SpawnListModel::removeNode(SpawnListNode* n)
+{
+  SpawnListNode* parentNode = n->parent;
+  int row = n->row;
+
+  // rows under it (pets) go with it
+  beginRemoveRows(nodeIndex(parentNode), row, row);
+  parentNode->children.removeAt(row);
+  renumber(parentNode, row);
+  forgetNode(n);
+  endRemoveRows();
+
+  delete n;
+
+  titleChanged(parentNode);
+}
+
+void SpawnListModel::forgetNode(SpawnListNode* n)
+{
+  if (n->item)
+    m_itemNodes.remove(n->item, n);
+  if (n->category)
+    m_categoryNodes.remove(n->category);
+
+  for (int i = 0; i < n->children.size(); i++)
+    forgetNode(n->children[i]);
+}
+
+void SpawnListModel::titleChanged(SpawnListNode* n)
+{
+  if (n->category)
+  {
+    QModelIndex index = nodeIndex(n);
+    emit dataChanged(index, index);
+  }
+}
+
+void SpawnListModel::changeItem(const Item* item, uint32_t changeType)
+{
+  QList<SpawnListNode*> nodes = m_itemNodes.values(item);
+  for (int i = 0; i < nodes.size(); i++)
+  {
+    SpawnListNode* n = nodes[i];
+    emit dataChanged(nodeIndex(n, 0), nodeIndex(n, tSpawnColMaxCols - 1));
+    if (m_keepSorted && affectsSort(changeType))
+      resort(n);
+  }
+}
+
+void SpawnListModel::markUnsorted(const Item* item)
+{
+  QList<SpawnListNode*> nodes = m_itemNodes.values(item);
+  for (int i = 0; i < nodes.size(); i++)
+    nodes[i]->dirty = true;
+}
+
+void SpawnListModel::resortItem(const Item* item)
+{
+  QList<SpawnListNode*> nodes = m_itemNodes.values(item);
+  for (int i = 0; i < nodes.size(); i++)
+    resort(nodes[i]);
+}
+
+bool SpawnListModel::affectsSort(uint32_t changeType) const
+{
+  switch (m_sortColumn)
+  {
+  case tSpawnColName:
+    return (changeType & tSpawnChangedName) != 0;
+  case tSpawnColLevel:
+    return (changeType & tSpawnChangedLevel) != 0;
+  case tSpawnColHP:
+  case tSpawnColMaxHP:
+    return (changeType & tSpawnChangedHP) != 0;
+  case tSpawnColXPos:
+  case tSpawnColYPos:
+  case tSpawnColZPos:
+  case tSpawnColDist:
+    return (changeType & tSpawnChangedPosition) != 0;
+  case tSpawnColInfo:
+    return (changeType & tSpawnChangedWearing) != 0;
+  }
+
+  // the rest only change with everything else
+  return changeType == tSpawnChangedALL;
+}
+
+void SpawnListModel::changeDistances()
+{
+  columnsChanged(m_root, tSpawnColDist, tSpawnColDist);
+
+  if (m_keepSorted && (m_sortColumn == tSpawnColDist))
+    sort(m_sortColumn, m_sortOrder);
+}
+
+void SpawnListModel::changeColors()
+{
+  columnsChanged(m_root, 0, tSpawnColMaxCols - 1);
+}
+
+void SpawnListModel::columnsChanged(SpawnListNode* parent, int first, int last)
+{
+  if (parent->children.isEmpty())
+    return;
+
+  // one range per group of rows rather than one per row
+  QModelIndex parentIndex = nodeIndex(parent);
+  emit dataChanged(index(0, first, parentIndex),
+		   index(parent->children.size() - 1, last, parentIndex));
+
+  for (int i = 0; i < parent->children.size(); i++)
+    columnsChanged(parent->children[i], first, last);
+}
+
+bool SpawnListModel::lessThan(const SpawnListNode* a,
+			      const SpawnListNode* b) const
+{
+  // category rows keep their order
+  if (!a->item || !b->item)
+    return false;
+
+  if (m_sortOrder == Qt::DescendingOrder)
+    std::swap(a, b);
+
+  if (numericColumn(m_sortColumn))
+    return sortValue(a->item, m_sortColumn) < sortValue(b->item, m_sortColumn);
+
+  return text(a->item, m_sortColumn) < text(b->item, m_sortColumn);
+}
+
+int SpawnListModel::sortedRow(SpawnListNode* parent,
+			      const SpawnListNode* n) const
+{
+  // after any rows that sort the same.  Rows that may be out of order
+  // are stepped over, the rest are still sorted amongst themselves.
+  const QList<SpawnListNode*>& children = parent->children;
+  int lo = 0;
+  int hi = children.size();
+  while (lo < hi)
+  {
+    int mid = (lo + hi) / 2;
+    int probe = mid;
+    while ((probe < hi) &&
+	   (children[probe]->dirty || (children[probe] == n)))
+      probe++;
+
+    if (probe == hi)
+      hi = mid;
+    else if (lessThan(n, children[probe]))
+      hi = probe;
+    else
+      lo = probe + 1;
+  }
+
+  return lo;
+}
+
+void SpawnListModel::sort(int column, Qt::SortOrder order)
+{
+  m_sortColumn = column;
+  m_sortOrder = order;
+
+  if ((column < 0) || (column >= tSpawnColMaxCols))
+    return;
+
+  emit layoutAboutToBeChanged();
+
+  sortChildren(m_root);
+
+  // the rows moved, but the nodes the indexes point at didn't
+  QModelIndexList from = persistentIndexList();
+  QModelIndexList to;
+  for (int i = 0; i < from.size(); i++)
+    to.append(createIndex(node(from[i])->row, from[i].column(),
+			  from[i].internalPointer()));
+  changePersistentIndexList(from, to);
+
+  emit layoutChanged();
+}
+
+void SpawnListModel::sortChildren(SpawnListNode* parent)
+{
+  QList<SpawnListNode*>& children = parent->children;
+  if (children.isEmpty())
+    return;
+
+  // category rows keep their order, only what's in them is sorted
+  if (children.first()->item)
+  {
+    // work out each row's key once instead of on every comparison
+    bool numeric = numericColumn(m_sortColumn);
+    QVector<SpawnListSortKey> keys(children.size());
+    for (int i = 0; i < children.size(); i++)
+    {
+      keys[i].node = children[i];
+      if (numeric)
+	keys[i].value = sortValue(children[i]->item, m_sortColumn);
+      else
+	keys[i].text = text(children[i]->item, m_sortColumn);
+    }
+
+    bool (*compare)(const SpawnListSortKey&, const SpawnListSortKey&);
+    if (m_sortOrder == Qt::AscendingOrder)
+      compare = numeric ? valueLess : textLess;
+    else
+      compare = numeric ? valueGreater : textGreater;
+    std::stable_sort(keys.begin(), keys.end(), compare);
+
+    for (int i = 0; i < keys.size(); i++)
+    {
+      children[i] = keys[i].node;
+      children[i]->row = i;
+      children[i]->dirty = false;
+    }
+  }
+
+  for (int i = 0; i < children.size(); i++)
+    sortChildren(children[i]);
+}
+
+void SpawnListModel::resort(SpawnListNode* n)
+{
+  n->dirty = false;
+
+  if ((m_sortColumn < 0) || !n->item)
+    return;
+
+  SpawnListNode* parentNode = n->parent;
+  QList<SpawnListNode*>& siblings = parentNode->children;
+  int row = n->row;
+
+  // still in order with its nearest sorted neighbours, nothing moves
+  int prev = row - 1;
+  while ((prev >= 0) && siblings[prev]->dirty)
+    prev--;
+  int next = row + 1;
+  while ((next < siblings.size()) && siblings[next]->dirty)
+    next++;
+  if (((prev < 0) || !lessThan(n, siblings[prev])) &&
+      ((next >= siblings.size()) || !lessThan(siblings[next], n)))
+    return;
+
+  // find where it goes among the others
+  int dest = sortedRow(parentNode, n);
+  if ((dest == row) || (dest == row + 1))
+    return;
+
+  QModelIndex parentIndex = nodeIndex(parentNode);
+  int newRow = (dest > row) ? dest - 1 : dest;
+  beginMoveRows(parentIndex, row, row, parentIndex, dest);
+  siblings.move(row, newRow);
+  renumber(parentNode, qMin(row, newRow), qMax(row, newRow));
+  endMoveRows();
+}
+
+SpawnListMenu::SpawnListMenu(SEQTreeView* spawnlist,
 			     SEQWindow* spawnlistWindow,
 			     FilterMgr* filterMgr,
 			     CategoryMgr* categoryMgr,
@@ -36,7 +36,11 @@
 #endif
 
 #include <QString>
+#include <QStringList>
 #include <QMenu>
+#include <QHash>
+#include <QColor>
+#include <QAbstractItemModel>
 
 #include "spawn.h"
 #include "seqlistview.h"
@@ -48,11 +52,10 @@ class Category;
 class CategoryMgr;
 class SpawnShell;
 class FilterMgr;
-class SEQListView;
+class SEQTreeView;
 class SEQWindow;
 class Player;
 
-class SpawnListItem;
 class SpawnListMenu;
 
 //--------------------------------------------------
@@ -76,35 +79,100 @@ const int tSpawnColGuildID = 15;
 const int tSpawnColMaxCols = 16;
 
 //--------------------------------------------------
-// SpawnListItem
-class SpawnListItem : public SEQListViewItem
+// SpawnListModel
+//
+// The spawn list contents as a model, optionally grouped under category
+// rows and with pets under their owners.  Rows only refer to the Item,
+// the column text and colors are worked out in data() for the rows the
+// view actually shows.  An item can have several rows (one per category
+// it's in), all of which are found through a hash.
+struct SpawnListNode;
+
+class SpawnListModel : public QAbstractItemModel
 {
-public:
-   SpawnListItem(SEQListViewItem *parent);
-   SpawnListItem(SEQListView *parent);
-   virtual ~SpawnListItem();
-
-   const QColor textColor()  { return m_textColor; }
-   void setTextColor(const QColor &color) { m_textColor = color; }
-   void pickTextColor(const Item* item,
-		      Player* player, 
-		      QColor def = Qt::black);
-   const Item*    item() const { return m_item; }
-
-   void update(Player* player, uint32_t changeType);
-   void updateTitle(const QString& name);
-   void setShellItem(const Item *);
-   spawnItemType type();
-
-   QVariant data(int column, int role) const;
-   bool operator<(const SEQListViewItem& other) const;
-
-   //--------------------------------------------------
-   int m_npc;
-private:
-   QColor m_textColor;
-
-   const Item *m_item;
+   Q_OBJECT
+
+ public:
+   SpawnListModel(Player* player, QObject* parent = 0);
+   virtual ~SpawnListModel();
+
+   // QAbstractItemModel
+   virtual QModelIndex index(int row, int column,
+			     const QModelIndex& parent = QModelIndex()) const;
+   virtual QModelIndex parent(const QModelIndex& index) const;
+   virtual int rowCount(const QModelIndex& parent = QModelIndex()) const;
+   virtual int columnCount(const QModelIndex& parent = QModelIndex()) const;
+   virtual QVariant data(const QModelIndex& index,
+			 int role = Qt::DisplayRole) const;
+   virtual QVariant headerData(int section, Qt::Orientation orientation,
+			       int role = Qt::DisplayRole) const;
+   virtual void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+   // what a row is showing
+   const Item* item(const QModelIndex& index) const;
+   const Category* category(const QModelIndex& index) const;
+   QString text(const Item* item, int column) const;
+   QColor textColor(const Item* item, QColor def = Qt::black) const;
+
+   // rows of an item, in display order
+   bool contains(const Item* item) const;
+   QModelIndexList indexes(const Item* item) const;
+   QModelIndex categoryIndex(const Category* cat) const;
+
+   // was the item listed with the same name, level and NPC state that it
+   // has now, otherwise it may belong in different categories
+   bool sameListing(const Item* item) const;
+
+   // adding and removing rows
+   QModelIndex addCategory(const Category* cat);
+   void removeCategory(const Category* cat);
+   QModelIndex addItem(const Item* item,
+		       const QModelIndex& parent = QModelIndex());
+   void removeItem(const Item* item);
+   void clear();
+
+   // tell the views what changed
+   void changeItem(const Item* item, uint32_t changeType);
+   void changeDistances();
+   void changeColors();
+
+   // color for rows outside of any category
+   void setItemColor(const QColor& color) { m_itemColor = color; }
+
+   // keep rows in sort order as they are added and changed
+   bool keepSorted() const { return m_keepSorted; }
+   void setKeepSorted(bool keepSorted) { m_keepSorted = keepSorted; }
+
+   // for callers keeping order themselves: note the rows of changed items,
+   // then move each back into place amongst the rows that are still in
+   // order.  affectsSort() tells if a change can move a row at all.
+   void markUnsorted(const Item* item);
+   void resortItem(const Item* item);
+   bool affectsSort(uint32_t changeType) const;
+   int sortColumn() const { return m_sortColumn; }
+   Qt::SortOrder sortOrder() const { return m_sortOrder; }
+
+ private:
+   SpawnListNode* node(const QModelIndex& index) const;
+   QModelIndex nodeIndex(SpawnListNode* node, int column = 0) const;
+   bool lessThan(const SpawnListNode* a, const SpawnListNode* b) const;
+   int sortedRow(SpawnListNode* parent, const SpawnListNode* node) const;
+   void sortChildren(SpawnListNode* parent);
+   void resort(SpawnListNode* node);
+   void removeNode(SpawnListNode* node);
+   void forgetNode(SpawnListNode* node);
+   void titleChanged(SpawnListNode* node);
+   void columnsChanged(SpawnListNode* parent, int first, int last);
+
+   Player* m_player;
+   SpawnListNode* m_root;
+   QMultiHash<const Item*, SpawnListNode*> m_itemNodes;
+   QHash<const Category*, SpawnListNode*> m_categoryNodes;
+   QStringList m_headers;
+   QColor m_itemColor;
+   int m_sortColumn;
+   Qt::SortOrder m_sortOrder;
+   bool m_keepSorted;
 };
 
 //--------------------------------------------------
@@ -114,7 +182,7 @@ class SpawnListMenu : public QMenu
    Q_OBJECT
 
  public:
-  SpawnListMenu(SEQListView* spawnlist,
+  SpawnListMenu(SEQTreeView* spawnlist,
 		SEQWindow* spawnlistWindow,
 		FilterMgr* filterMgr,
 		CategoryMgr* categoryMgr,
@@ -136,7 +204,7 @@ class SpawnListMenu : public QMenu
    void set_caption();
 
  protected:
-  SEQListView* m_spawnlist;
+  SEQTreeView* m_spawnlist;
   SEQWindow* m_spawnlistWindow;
   FilterMgr* m_filterMgr;
   CategoryMgr* m_categoryMgr;
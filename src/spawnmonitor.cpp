@@ -27,11 +27,19 @@
 #include "util.h"
 #include "datalocationmgr.h"
 #include "diagnosticmessages.h"
+#include "xmlpreferences.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
+#include <QTimer>
+#include <QThreadPool>
+#include <QRunnable>
 
 
 SpawnPoint::SpawnPoint(uint16_t spawnID, 
@@ -42,26 +50,28 @@ SpawnPoint::SpawnPoint(uint16_t spawnID,
     m_spawnTime(time(0)),
     m_deathTime(0),
     m_diffTime(diffTime),
+    m_intervalCount(0),
+    m_nextInterval(0),
     m_count(count),
     m_name( name ),
     m_last( "" ),
     m_lastID(spawnID)
 {
+  // a saved respawn time counts as the first interval seen
+  if (diffTime != 0)
+    addInterval(diffTime);
 }
 
 SpawnPoint::~SpawnPoint()
 {
 }
 
-QString SpawnPoint::key( int x, int y, int z)
+uint64_t SpawnPoint::key( int x, int y, int z)
 {
-  QString		t;
-#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
-  t = QString::asprintf( "%d%d%d", x, y, z );
-#else
-  t.sprintf( "%d%d%d", x, y, z );
-#endif
-  return t;
+  // 16 bits per coordinate, which is all a spawn position has
+  return (uint64_t(uint16_t(x)) << 32) |
+    (uint64_t(uint16_t(y)) << 16) |
+    uint64_t(uint16_t(z));
 }
 
 Spawn* SpawnPoint::getSpawn() const
@@ -105,11 +115,158 @@ void SpawnPoint::update(const Spawn* spawn)
   m_spawnTime = time(0);
   
   if (m_deathTime != 0)
-    m_diffTime = m_spawnTime - m_deathTime;
+    addInterval(m_spawnTime - m_deathTime);
   
   m_count++;
 }
 
+void SpawnPoint::addInterval(time_t interval)
+{
+  m_intervals[m_nextInterval] = interval;
+  m_nextInterval = (m_nextInterval + 1) % spawnPointIntervals;
+  if (m_intervalCount < spawnPointIntervals)
+    m_intervalCount++;
+
+  // the median of the recent intervals, so a spawn that was missed or
+  // killed late once doesn't throw the estimate off
+  time_t sorted[spawnPointIntervals];
+  std::copy(m_intervals, m_intervals + m_intervalCount, sorted);
+  std::nth_element(sorted, sorted + m_intervalCount / 2,
+		   sorted + m_intervalCount);
+  m_diffTime = sorted[m_intervalCount / 2];
+}
+
+//----------------------------------------------------------------------
+// Spawn point journal
+//
+// Each zone's spawn points are kept in <zone>.spj in the user's spawnpoints
+// directory.  The file is a header followed by records, each a fixed part
+// and then the spawn point name as nameLength bytes of UTF-8.  A set record
+// holds everything about a spawn point and replaces any earlier one for the
+// same position, a delete record removes it, and a clear record removes
+// every spawn point before it.  Loading replays the records and only builds
+// the spawn points that are left at the end.  A record cut short by a crash
+// ends the journal, and is cut off before anything more is appended.
+//
+// Everything is in native byte order, the files never leave the machine
+// they were made on.  A journal with a different version is ignored and
+// the text file imported instead, if there is one.
+
+static const char journalMagic[8] = { 'S', 'E', 'Q', 'S', 'P', 'J', 0, 0 };
+static const uint32_t journalVersion = 1;
+
+// compact once the journal has this many records and more than
+// journalCompactRatio times as many records as there are spawn points
+static const int journalCompactMin = 1024;
+static const int journalCompactRatio = 4;
+
+enum
+{
+  tJournalSet = 1,
+  tJournalDelete = 2,
+  tJournalClear = 3,
+};
+
+struct SpawnPointJournalHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t pad;
+};
+
+struct SpawnPointJournalRecord
+{
+  qint64 diffTime;
+  uint32_t count;
+  int16_t x, y, z;
+  uint8_t op;
+  uint8_t nameLength;
+};
+
+static QByteArray journalRecord(uint8_t op, const SpawnPoint* sp)
+{
+  SpawnPointJournalRecord record;
+  memset(&record, 0, sizeof(record));
+  record.op = op;
+
+  QByteArray name;
+  if (sp)
+  {
+    record.x = sp->x();
+    record.y = sp->y();
+    record.z = sp->z();
+  }
+
+  if (sp && (op == tJournalSet))
+  {
+    record.diffTime = sp->diffTime();
+    record.count = sp->count();
+    // cut a long name short at a character, not in the middle of one
+    name = sp->name().toUtf8();
+    if (name.size() > 255)
+    {
+      int length = 255;
+      while ((length > 0) && ((uchar(name[length]) & 0xc0) == 0x80))
+	length--;
+      name.truncate(length);
+    }
+    record.nameLength = name.size();
+  }
+
+  QByteArray data((const char*)&record, sizeof(record));
+  data.append(name);
+  return data;
+}
+
+//----------------------------------------------------------------------
+// SpawnPointCompactJob
+//
+// Writes the current spawn points as a new journal next to the old one.
+// Records appended to the old journal while it runs are kept in tail and
+// added to the new one before it replaces the old one on the GUI thread.
+class SpawnPointCompactJob : public QRunnable
+{
+ public:
+  SpawnPointCompactJob(SpawnMonitor* monitor) : m_monitor(monitor) {}
+  void run();
+
+  QString fileName;
+  QByteArray snapshot;
+  int records;
+  QByteArray tail;
+  int tailRecords;
+  bool written;
+
+ protected:
+  SpawnMonitor* m_monitor;
+};
+
+void SpawnPointCompactJob::run()
+{
+  written = false;
+
+  QFile file(fileName + ".new");
+  if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    SpawnPointJournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, journalMagic, sizeof(journalMagic));
+    header.version = journalVersion;
+
+    written = (file.write((const char*)&header, sizeof(header)) ==
+	       qint64(sizeof(header))) &&
+      (file.write(snapshot) == snapshot.size()) &&
+      file.flush();
+    file.close();
+  }
+
+  QMetaObject::invokeMethod(m_monitor, "compactFinished",
+			    Qt::QueuedConnection,
+			    Q_ARG(void*, this));
+}
+
+//----------------------------------------------------------------------
+// SpawnMonitor
 SpawnMonitor::SpawnMonitor(const DataLocationMgr* dataLocMgr, 
 			   ZoneMgr* zoneMgr, SpawnShell* spawnShell, 
 			   QObject* parent, const char* name )
@@ -118,10 +275,22 @@ SpawnMonitor::SpawnMonitor(const DataLocationMgr* dataLocMgr,
   m_spawnShell(spawnShell),
   m_spawns(),
   m_points(),
-  m_selected(NULL)
+  m_selected(NULL),
+  m_journalRecords(0),
+  m_flushScheduled(false),
+  m_compactJob(NULL)
 {
   setObjectName(name);
 
+  // compaction gets a pool of its own, so it never waits on other work
+  m_compactPool = new QThreadPool(this);
+  m_compactPool->setMaxThreadCount(1);
+
+  // spawns closer than this to a spawn point are taken to be from it
+  m_radius = pSEQPrefs->getPrefInt("ClusterRadius", "SpawnMonitor", 5);
+  if (m_radius < 0)
+    m_radius = 0;
+
   connect(spawnShell, SIGNAL(addItem(const Item*)), 
 	  this, SLOT( newSpawn(const Item*)));
   connect(spawnShell, SIGNAL(killSpawn(const Item*, const Item*, uint16_t)), 
@@ -130,12 +299,16 @@ SpawnMonitor::SpawnMonitor(const DataLocationMgr* dataLocMgr,
 	  this, SLOT( zoneChanged(const QString&)));
   connect(zoneMgr, SIGNAL(zoneEnd(const QString&, const QString&)), 
 	  this, SLOT( zoneEnd( const QString&)));
-
-  m_modified = false;
 }
 
 SpawnMonitor::~SpawnMonitor()
 {
+  // finish any compaction here, its queued result goes away with us
+  m_compactPool->waitForDone();
+  if (m_compactJob)
+    compactFinished(m_compactJob);
+
+  closeJournal();
 }
 
 void SpawnMonitor::setName(const SpawnPoint* csp, const QString& name)
@@ -150,7 +323,7 @@ void SpawnMonitor::setName(const SpawnPoint* csp, const QString& name)
 
 void SpawnMonitor::setModified( SpawnPoint* changedSp )
 {
-  m_modified = true;
+  appendJournal(tJournalSet, changedSp);
 }
 
 void SpawnMonitor::setSelected(const SpawnPoint* selected)
@@ -166,11 +339,17 @@ void SpawnMonitor::setSelected(const SpawnPoint* selected)
 
 void SpawnMonitor::clear(void)
 {
+  if (!m_points.isEmpty())
+    appendJournal(tJournalClear, NULL);
+
   emit clearSpawnPoints();
   qDeleteAll(m_spawns);
   m_spawns.clear();
+  m_spawnGrid.clear();
   qDeleteAll(m_points);
   m_points.clear();
+  m_pointGrid.clear();
+  m_lastIDs.clear();
   m_selected = NULL;
 }
 
@@ -183,9 +362,26 @@ void SpawnMonitor::deleteSpawnPoint(const SpawnPoint* sp)
     emit selectionChanged(m_selected);
   }
 
-  // remove the spawn point
-  delete m_spawns.take(sp->key());
-  m_modified = true;
+  // remove the spawn point from whichever dictionary holds it, only the
+  // real spawn points are in the journal
+  SpawnPoint* point = (SpawnPoint*)sp;
+  if (m_points.value(point->key(), nullptr) == point)
+  {
+    removePoint(m_points, m_pointGrid, point);
+    appendJournal(tJournalDelete, point);
+  }
+  else if (m_spawns.value(point->key(), nullptr) == point)
+    removePoint(m_spawns, m_spawnGrid, point);
+  else
+    return;
+
+  // every spawn the point has seen left an id behind, not just the last
+  QMutableHashIterator<uint16_t, SpawnPoint*> it(m_lastIDs);
+  while (it.hasNext())
+    if (it.next().value() == point)
+      it.remove();
+
+  delete point;
 }
 
 void SpawnMonitor::newSpawn(const Item* item)
@@ -196,27 +392,18 @@ void SpawnMonitor::newSpawn(const Item* item)
 
 void SpawnMonitor::killSpawn(const Item* killedSpawn)
 {
-  QHashIterator<QString, SpawnPoint*> it( m_points );
-
-  SpawnPoint* sp;
-  while (it.hasNext())
-  {
-    it.next();
-    sp = it.value();
+  SpawnPoint* sp = m_lastIDs.take(killedSpawn->id());
 
-    if ( killedSpawn->id() == sp->lastID() )
-    {
-      restartSpawnPoint(sp);
-      break;
-    }
-  }
+  if (sp && (sp->lastID() == killedSpawn->id()) &&
+      (m_points.value(sp->key(), nullptr) == sp))
+    restartSpawnPoint(sp);
 }
 
 void SpawnMonitor::zoneChanged( const QString& newZoneName )
 {
   if ( m_zoneName != newZoneName )
   {
-    saveSpawnPoints();
+    closeJournal();
     
     clear();
     m_zoneName = newZoneName;
@@ -231,7 +418,7 @@ void SpawnMonitor::zoneEnd( const QString& newZoneName )
 
   if ( m_zoneName != lower )
   {
-    saveSpawnPoints();
+    closeJournal();
     m_zoneName = lower;
     clear();
     loadSpawnPoints();
@@ -249,68 +436,214 @@ void SpawnMonitor::checkSpawnPoint(const Spawn* spawn )
   if ( ( spawn->NPC() != SPAWN_NPC ) || ( spawn->petOwnerID() != 0 ) || spawn->isMount() || spawn->isAura() || spawn->isMercenary() )
     return;
   
-  QString key = SpawnPoint::key( *spawn );
-  
   SpawnPoint* sp;
-  sp = m_points.value(key, nullptr);
+  sp = findNear(m_pointGrid, spawn);
   if ( sp )
   {
-    m_modified = true;
     sp->update(spawn);
+    setLastID(sp, spawn->id());
+    setModified(sp);
   }
   else
   {
-    sp = m_spawns.value(key, nullptr);
-    if ( sp )
+    sp = findNear(m_spawnGrid, spawn);
+    if ( sp && !m_points.contains(sp->key()) )
     {
       sp->update(spawn);
+      setLastID(sp, spawn->id());
       
-      m_points.insert( key, sp );
+      removePoint(m_spawns, m_spawnGrid, sp);
+      insertPoint(m_points, m_pointGrid, sp);
       emit newSpawnPoint( sp );
-      m_modified = true;
-      m_spawns.take( key );
+      setModified(sp);
     }
-    else
+    else if (!sp && !m_spawns.contains(SpawnPoint::key(*spawn)))
     {
       sp = new SpawnPoint( spawn->id(), *spawn );
-      m_spawns.insert( key, sp );
+      insertPoint(m_spawns, m_spawnGrid, sp);
+      setLastID(sp, spawn->id());
     }
   }
 }
 
+uint64_t SpawnMonitor::cellKey(int x, int y, int z) const
+{
+  // cells are as big as the clustering radius, rounding towards negative
+  // infinity so the cells either side of 0 are the same size as the rest
+  int size = std::max(m_radius, 1);
+  int cx = (x >= 0) ? (x / size) : -((-x + size - 1) / size);
+  int cy = (y >= 0) ? (y / size) : -((-y + size - 1) / size);
+  int cz = (z >= 0) ? (z / size) : -((-z + size - 1) / size);
+  return SpawnPoint::key(cx, cy, cz);
+}
+
+SpawnPoint* SpawnMonitor::findNear(const SpawnPointGrid& grid,
+				   const Spawn* spawn) const
+{
+  int size = std::max(m_radius, 1);
+  int radius2 = m_radius * m_radius;
+  SpawnPoint* nearest = nullptr;
+  int nearest2 = radius2 + 1;
+
+  // anything within the radius is in this cell or one of its neighbours
+  for (int dx = -1; dx <= 1; dx++)
+    for (int dy = -1; dy <= 1; dy++)
+      for (int dz = -1; dz <= 1; dz++)
+      {
+	uint64_t cell = cellKey(spawn->x() + dx * size,
+				spawn->y() + dy * size,
+				spawn->z() + dz * size);
+	SpawnPointGrid::const_iterator it = grid.find(cell);
+	for (; (it != grid.end()) && (it.key() == cell); ++it)
+	{
+	  SpawnPoint* sp = it.value();
+	  int ddx = sp->x() - spawn->x();
+	  int ddy = sp->y() - spawn->y();
+	  int ddz = sp->z() - spawn->z();
+	  int dist2 = ddx * ddx + ddy * ddy + ddz * ddz;
+	  if (dist2 >= nearest2)
+	    continue;
+
+	  // a point whose last spawn is still up can't have spawned this one
+	  if (sp->lastID() && (sp->lastID() != spawn->id()) &&
+	      m_spawnShell->findID(tSpawn, sp->lastID()))
+	    continue;
+
+	  nearest = sp;
+	  nearest2 = dist2;
+	}
+      }
+
+  return nearest;
+}
+
+void SpawnMonitor::insertPoint(SpawnPointMap& map, SpawnPointGrid& grid,
+			       SpawnPoint* sp)
+{
+  map.insert(sp->key(), sp);
+  grid.insert(cellKey(sp->x(), sp->y(), sp->z()), sp);
+}
+
+void SpawnMonitor::removePoint(SpawnPointMap& map, SpawnPointGrid& grid,
+			       SpawnPoint* sp)
+{
+  map.remove(sp->key());
+  grid.remove(cellKey(sp->x(), sp->y(), sp->z()), sp);
+}
+
+void SpawnMonitor::setLastID(SpawnPoint* sp, uint16_t id)
+{
+  if (id)
+    m_lastIDs.insert(id, sp);
+}
+
 void SpawnMonitor::saveSpawnPoints()
 {
-  // only save if modified
-  if (!m_modified)
-    return;
+  // the journal is always up to date, it just needs to reach the disk
+  flushJournal();
+}
 
+void SpawnMonitor::loadSpawnPoints()
+{
   if ( !m_zoneName.length() )
   {
-    seqWarn("Zone name not set in 'SpawnMonitor::saveSpawnPoints'!" );
+    seqWarn("Zone name not set in 'SpawnMonitor::loadSpawnPoints'!" );
     return;
   }
-  
-  QString fileName;
-  
-  fileName = m_zoneName + ".sp";
 
-  QFileInfo fileInfo =
-    m_dataLocMgr->findWriteFile("spawnpoints", fileName, false);
+  QString fileName = journalFileName();
+
+  if (!loadJournal(fileName))
+  {
+    // keep a journal that couldn't be used out of the way instead of
+    // appending to it
+    if (QFile::exists(fileName))
+    {
+      QFile::remove(fileName + ".bak");
+      QFile::rename(fileName, fileName + ".bak");
+    }
+
+    // start a new journal, from the text file if there is one
+    openJournal(fileName);
+
+    QFileInfo fileInfo =
+      m_dataLocMgr->findExistingFile("spawnpoints", m_zoneName + ".sp", false);
+
+    if (fileInfo.exists())
+      importSpawnPoints(fileInfo.absoluteFilePath());
+    return;
+  }
+
+  openJournal(fileName);
+
+  // a journal from a long session may be due a compaction already, unless
+  // the last zone's is still running, then the next append starts it
+  if (!m_compactJob && (m_journalRecords >= journalCompactMin) &&
+      (m_journalRecords > (journalCompactRatio * m_points.count())))
+    startCompaction();
+}
+
+bool SpawnMonitor::importSpawnPoints(const QString& fileName)
+{
+  QFile spFile(fileName);
+
+  if (!spFile.open(QIODevice::ReadOnly))
+  {
+    seqWarn( "Can't open spawn point file %s", fileName.toLatin1().data());
+    return false;
+  }
+
+  QTextStream input( &spFile );
+
+  int16_t x, y, z;
+  unsigned long diffTime;
+  uint32_t count;
+  QString name;
+
+  while (!input.atEnd())
+  {
+    input >> x;
+    input >> y;
+    input >> z;
+    input >> diffTime;
+    input >> count;
+    name = input.readLine();
+    name = name.trimmed();
+
+    if (input.status() != QTextStream::Ok)
+      break;
+
+    EQPoint	loc(x, y, z);
+    uint64_t key = SpawnPoint::key(loc);
 
-  fileName = fileInfo.absoluteFilePath();
+    // spawn points that are already known win
+    if (m_points.value(key, nullptr))
+      continue;
 
+    SpawnPoint*	p = new SpawnPoint( 0, loc, name, diffTime, count );
+    insertPoint(m_points, m_pointGrid, p);
+    emit newSpawnPoint(p);
+    setModified(p);
+  }
+
+  seqInfo("Imported spawn points: %s", fileName.toLatin1().data());
+  return true;
+}
+
+bool SpawnMonitor::exportSpawnPoints(const QString& fileName)
+{
   QString newName = fileName + ".new";
   QFile spFile( newName );
 
   if (!spFile.open(QIODevice::WriteOnly))
   {
     seqWarn("Failed to open %s for writing", newName.toLatin1().data());
-    return;
+    return false;
   }
 
   QTextStream output(&spFile);
 
-  QHashIterator<QString, SpawnPoint*> it( m_points );
+  SpawnPointIterator it( m_points );
   SpawnPoint* sp;
 
   while (it.hasNext())
@@ -341,88 +674,262 @@ void SpawnMonitor::saveSpawnPoints()
 
   if (old.exists())
   {
+    dir.remove(backupName);
     if (dir.rename( fileName, backupName))
     {
       if (!dir.rename( newName, fileName))
+      {
           seqWarn( "Failed to rename %s to %s",
                   newName.toLatin1().data(), fileName.toLatin1().data());
+          return false;
+      }
     }
   }
   else
   {
     if (!dir.rename(newName, fileName))
+    {
       seqWarn("Failed to rename %s to %s",
               newName.toLatin1().data(), fileName.toLatin1().data());
+      return false;
+    }
   }
-  m_modified = false;
-  seqInfo("Saved spawn points: %s", fileName.toLatin1().data());
+
+  seqInfo("Exported spawn points: %s", fileName.toLatin1().data());
+  return true;
 }
 
+QString SpawnMonitor::journalFileName() const
+{
+  QFileInfo fileInfo =
+    m_dataLocMgr->findWriteFile("spawnpoints", m_zoneName + ".spj", false);
+
+  return fileInfo.absoluteFilePath();
+}
 
-void SpawnMonitor::loadSpawnPoints()
+bool SpawnMonitor::loadJournal(const QString& fileName)
 {
-  QString fileName;
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+
+  qint64 size = file.size();
+  if (size < qint64(sizeof(SpawnPointJournalHeader)))
+    return false;
+
+  const uchar* data = file.map(0, size);
+  if (!data)
+    return false;
+
+  const SpawnPointJournalHeader* header =
+    (const SpawnPointJournalHeader*)data;
+  if ((memcmp(header->magic, journalMagic, sizeof(journalMagic)) != 0) ||
+      (header->version != journalVersion))
+  {
+    seqWarn("Spawn point journal %s is from a different version, ignoring it",
+	    fileName.toLatin1().data());
+    file.unmap((uchar*)data);
+    return false;
+  }
 
-  fileName = m_zoneName + ".sp";
+  // replay the records, only remembering where the latest set record of
+  // each spawn point still around is
+  QHash<uint64_t, qint64> latest;
+  SpawnPointJournalRecord record;
+  qint64 offset = sizeof(SpawnPointJournalHeader);
+  int records = 0;
 
-  QFileInfo fileInfo =
-    m_dataLocMgr->findExistingFile("spawnpoints", fileName, false);
+  while ((offset + qint64(sizeof(record))) <= size)
+  {
+    memcpy(&record, data + offset, sizeof(record));
+    qint64 next = offset + sizeof(record) + record.nameLength;
+    if (next > size)
+      break;
+
+    uint64_t key = SpawnPoint::key(record.x, record.y, record.z);
+    if (record.op == tJournalSet)
+      latest.insert(key, offset);
+    else if (record.op == tJournalDelete)
+      latest.remove(key);
+    else if (record.op == tJournalClear)
+      latest.clear();
+    else
+      break;
 
-  if (!fileInfo.exists())
+    offset = next;
+    records++;
+  }
+
+  QHashIterator<uint64_t, qint64> it(latest);
+  while (it.hasNext())
   {
-    seqWarn("Can't find spawn point file %s",
-            fileInfo.absoluteFilePath().toLatin1().data());
-    return;
+    it.next();
+
+    memcpy(&record, data + it.value(), sizeof(record));
+    QString name =
+      QString::fromUtf8((const char*)data + it.value() + sizeof(record),
+			record.nameLength);
+
+    EQPoint loc(record.x, record.y, record.z);
+    SpawnPoint* p = new SpawnPoint(0, loc, name, time_t(record.diffTime),
+				   record.count);
+    insertPoint(m_points, m_pointGrid, p);
+    emit newSpawnPoint(p);
   }
 
-  fileName = fileInfo.absoluteFilePath();
+  file.unmap((uchar*)data);
 
-  QFile spFile(fileName);
+  // drop whatever a crash left behind so new records follow good ones
+  if (offset < size)
+  {
+    seqWarn("Spawn point journal %s is damaged after %lld bytes, dropping the rest",
+	    fileName.toLatin1().data(), offset);
+    file.close();
+    file.resize(offset);
+  }
 
-  if (!spFile.open(QIODevice::ReadOnly))
+  m_journalRecords = records;
+  seqInfo("Loaded spawn points: %s", fileName.toLatin1().data());
+  return true;
+}
+
+void SpawnMonitor::openJournal(const QString& fileName)
+{
+  m_journal.setFileName(fileName);
+  if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append))
   {
-    seqWarn( "Can't open spawn point file %s", fileName.toLatin1().data());
+    seqWarn("Failed to open %s for writing", fileName.toLatin1().data());
     return;
   }
 
-  QTextStream input( &spFile );
+  if (m_journal.size() == 0)
+  {
+    SpawnPointJournalHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, journalMagic, sizeof(journalMagic));
+    header.version = journalVersion;
+    m_journal.write((const char*)&header, sizeof(header));
+    m_journalRecords = 0;
+  }
+}
 
-  int16_t x, y, z;
-  unsigned long diffTime;
-  uint32_t count;
-  QString name;
+void SpawnMonitor::closeJournal()
+{
+  if (m_journal.isOpen())
+    m_journal.close();
 
-  while (!input.atEnd())
+  m_journalRecords = 0;
+}
+
+void SpawnMonitor::appendJournal(uint8_t op, const SpawnPoint* sp)
+{
+  if (!m_journal.isOpen())
+    return;
+
+  QByteArray data = journalRecord(op, sp);
+  m_journal.write(data);
+  m_journalRecords++;
+
+  // a compaction of this journal that's running needs it too
+  if (m_compactJob && (m_compactJob->fileName == m_journal.fileName()))
   {
-    input >> x;
-    input >> y;
-    input >> z;
-    input >> diffTime;
-    input >> count;
-    name = input.readLine();
-    name = name.trimmed();
+    m_compactJob->tail.append(data);
+    m_compactJob->tailRecords++;
+  }
 
-    EQPoint	loc(x, y, z);
-    SpawnPoint*	p = new SpawnPoint( 0, loc, name, diffTime, count );
-    if (p)
+  // batch the writes of everything that happens in one go
+  if (!m_flushScheduled)
+  {
+    m_flushScheduled = true;
+    QTimer::singleShot(0, this, SLOT(flushJournal()));
+  }
+
+  if (!m_compactJob && (m_journalRecords >= journalCompactMin) &&
+      (m_journalRecords > (journalCompactRatio * m_points.count())))
+    startCompaction();
+}
+
+void SpawnMonitor::flushJournal()
+{
+  m_flushScheduled = false;
+
+  if (m_journal.isOpen())
+    m_journal.flush();
+}
+
+void SpawnMonitor::startCompaction()
+{
+  SpawnPointCompactJob* job = new SpawnPointCompactJob(this);
+  job->setAutoDelete(false);
+  job->fileName = m_journal.fileName();
+  job->records = m_points.count();
+  job->tailRecords = 0;
+  job->written = false;
+
+  // the snapshot is cheap, it's the writing that's left to the worker
+  SpawnPointIterator it(m_points);
+  while (it.hasNext())
+  {
+    it.next();
+    job->snapshot.append(journalRecord(tJournalSet, it.value()));
+  }
+
+  m_compactJob = job;
+  m_compactPool->start(job);
+}
+
+void SpawnMonitor::compactFinished(void* data)
+{
+  SpawnPointCompactJob* job = (SpawnPointCompactJob*)data;
+  if (job != m_compactJob)
+  {
+    // superseded, its result is of no use unless it's the running job's
+    if (!m_compactJob || (m_compactJob->fileName != job->fileName))
+      QFile::remove(job->fileName + ".new");
+    delete job;
+    return;
+  }
+
+  m_compactJob = NULL;
+
+  QString newName = job->fileName + ".new";
+  bool current = m_journal.isOpen() &&
+    (m_journal.fileName() == job->fileName);
+  bool replaced = false;
+
+  if (job->written)
+  {
+    // catch the new journal up, then swap it in for the old one
+    QFile newFile(newName);
+    if (newFile.open(QIODevice::WriteOnly | QIODevice::Append) &&
+	(newFile.write(job->tail) == job->tail.size()) &&
+	newFile.flush())
     {
-      QString key = p->key();
+      newFile.close();
 
-      if (!m_points.value(key, nullptr))
-      {
-	m_points.insert(key, p);
-	emit newSpawnPoint(p);
-      }
-      else
+      if (current)
+	m_journal.close();
+
+      replaced = (::rename(QFile::encodeName(newName).constData(),
+			   QFile::encodeName(job->fileName).constData()) == 0);
+
+      if (current)
       {
-	seqWarn("Warning: spawn point key already in use!");
-	delete p;
+	openJournal(job->fileName);
+	if (replaced)
+	  m_journalRecords = job->records + job->tailRecords;
       }
     }
   }
 
-  seqInfo("Loaded spawn points: %s", fileName.toLatin1().data());
-  m_modified = false;
+  if (!replaced)
+  {
+    seqWarn("Failed to compact spawn point journal %s",
+	    job->fileName.toLatin1().data());
+    QFile::remove(newName);
+  }
+
+  delete job;
 }
 
 #ifndef QMAKEBUILD
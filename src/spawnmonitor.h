@@ -48,16 +48,37 @@
 //	i.e. if a spawn point in m_points doesn't get an update for over 2 weeks, remove
 //	it... i don't know enough yet to determine what length is "too old", since there
 //	are rumored to be very rare, yet static, spawns in EQ
+//
+//	spawns within a radius of each other count as the same spawn point, both
+//	dictionaries are backed by a grid of cells the size of that radius so
+//	finding the spawn point for a new spawn only looks at the cells around it
+//
+//	spawn points are kept in a binary journal per zone that each change is
+//	appended to, and that is rewritten with just the current spawn points
+//	in the background once it has grown too much.  the old text format can
+//	still be imported and exported.
 
 #include <ctime>
 #include <QObject>
 #include <QHash>
+#include <QFile>
+#include <QByteArray>
 #include "spawn.h"
 #include "zonemgr.h"
 #include "spawnshell.h"
 
 // forward declarations
 class DataLocationMgr;
+class SpawnPoint;
+class SpawnPointCompactJob;
+class QThreadPool;
+
+typedef QHash<uint64_t, SpawnPoint*> SpawnPointMap;
+typedef QHashIterator<uint64_t, SpawnPoint*> SpawnPointIterator;
+typedef QMultiHash<uint64_t, SpawnPoint*> SpawnPointGrid;
+
+// how many respawn intervals a spawn point keeps for its estimate
+const int spawnPointIntervals = 8;
 
 class SpawnPoint: public EQPoint
 {
@@ -70,9 +91,9 @@ public:
   
   long secsLeft() const { return m_diffTime - ( time( 0 ) - m_deathTime ); }
   
-  static QString key( int x, int y, int z );
-  static QString key( const EQPoint& l ) { return key( l.x(), l.y(), l.z() ); }
-  QString key() const { return key( x(), y(), z() ); }
+  static uint64_t key( int x, int y, int z );
+  static uint64_t key( const EQPoint& l ) { return key( l.x(), l.y(), l.z() ); }
+  uint64_t key() const { return key( x(), y(), z() ); }
 
   // getters
   unsigned char age() const;
@@ -83,7 +104,8 @@ public:
   Spawn* getSpawn() const;
   time_t spawnTime() const { return m_spawnTime; }
   time_t deathTime() const { return m_deathTime; } 
-  time_t diffTime() const { return m_diffTime; }
+  time_t diffTime() const { return m_diffTime; } // estimated respawn time
+  int intervals() const { return m_intervalCount; }
 
   // setters
   void setName(const QString& newName) { m_name = newName; }
@@ -95,9 +117,14 @@ public:
   void restart(void);
 
  protected:
+  void addInterval(time_t interval);
+
   time_t m_spawnTime;
   time_t m_deathTime;
   time_t m_diffTime;
+  time_t m_intervals[spawnPointIntervals];
+  uint8_t m_intervalCount;
+  uint8_t m_nextInterval;
   uint32_t m_count;
   QString m_name;
   QString m_last;
@@ -114,8 +141,8 @@ public:
 			     const char* name = "spawnmonitor" );
   virtual ~SpawnMonitor();
 
-  const QHash<QString, SpawnPoint*>& spawnPoints() { return m_points; }
-  const QHash<QString, SpawnPoint*>& spawns() { return m_spawns; }
+  const SpawnPointMap& spawnPoints() { return m_points; }
+  const SpawnPointMap& spawns() { return m_spawns; }
   const SpawnPoint* selected() { return m_selected; }
 
 public slots:
@@ -130,6 +157,8 @@ public slots:
   void zoneEnd( const QString& newZoneName );
   void saveSpawnPoints();
   void loadSpawnPoints();
+  bool importSpawnPoints(const QString& fileName);
+  bool exportSpawnPoints(const QString& fileName);
 
 signals:
   void newSpawnPoint( const SpawnPoint* spawnPoint );
@@ -139,14 +168,38 @@ signals:
 protected:
   void restartSpawnPoint( SpawnPoint* spawnPoint );
   void checkSpawnPoint(const Spawn* spawn );
- 
+  uint64_t cellKey(int x, int y, int z) const;
+  SpawnPoint* findNear(const SpawnPointGrid& grid, const Spawn* spawn) const;
+  void insertPoint(SpawnPointMap& map, SpawnPointGrid& grid, SpawnPoint* sp);
+  void removePoint(SpawnPointMap& map, SpawnPointGrid& grid, SpawnPoint* sp);
+  void setLastID(SpawnPoint* sp, uint16_t id);
+  QString journalFileName() const;
+  bool loadJournal(const QString& fileName);
+  void openJournal(const QString& fileName);
+  void closeJournal();
+  void appendJournal(uint8_t op, const SpawnPoint* sp);
+  void startCompaction();
+
+private slots:
+  void flushJournal();
+  void compactFinished(void* job);
+
+protected:
   const DataLocationMgr* m_dataLocMgr;
   SpawnShell* m_spawnShell;
   QString m_zoneName;
-  QHash<QString, SpawnPoint*> m_spawns;
-  QHash<QString, SpawnPoint*> m_points;
+  SpawnPointMap m_spawns;
+  SpawnPointMap m_points;
+  SpawnPointGrid m_spawnGrid;
+  SpawnPointGrid m_pointGrid;
+  QHash<uint16_t, SpawnPoint*> m_lastIDs;
+  int m_radius;
   const SpawnPoint* m_selected;
-  bool m_modified;
+  QFile m_journal;
+  int m_journalRecords;
+  bool m_flushScheduled;
+  QThreadPool* m_compactPool;
+  SpawnPointCompactJob* m_compactJob;
 };
 
 #endif
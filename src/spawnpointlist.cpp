@@ -27,6 +27,7 @@
 #include <QInputDialog>
 #include <QMessageBox>
 #include <QFontDialog>
+#include <QFileDialog>
 #include <QPainter>
 #include <QLayout>
 #include <QMenu>
@@ -199,7 +200,7 @@ SpawnPointList::SpawnPointList(SpawnMonitor* spawnMonitor,
 
   // put in all the spawn points that might already be present in
   // the spawn monitor
-  QHashIterator<QString, SpawnPoint*> it( m_spawnMonitor->spawnPoints() );
+  SpawnPointIterator it( m_spawnMonitor->spawnPoints() );
   SpawnPoint* sp;
   while (it.hasNext())
   {
@@ -394,6 +395,24 @@ void SpawnPointList::clearItems(void)
     m_spawnMonitor->clear();
 }
 
+void SpawnPointList::importItems(void)
+{
+  QString fn = QFileDialog::getOpenFileName(this, "Import Spawn Points",
+          QString(), "Spawn Point Files (*.sp)");
+
+  if (!fn.isEmpty())
+    m_spawnMonitor->importSpawnPoints(fn);
+}
+
+void SpawnPointList::exportItems(void)
+{
+  QString fn = QFileDialog::getSaveFileName(this, "Export Spawn Points",
+          QString(), "Spawn Point Files (*.sp)");
+
+  if (!fn.isEmpty())
+    m_spawnMonitor->exportSpawnPoints(fn);
+}
+
 void SpawnPointList::refresh()
 {
   bool aboutToPop = false;
@@ -414,7 +433,7 @@ void SpawnPointList::refresh()
       sortByColumn(sortColumn(), header()->sortIndicatorOrder());
 
   // iterate over all the spawn points and check how long till they pop
-  QHashIterator<QString, SpawnPoint*> it(m_spawnMonitor->spawnPoints());
+  SpawnPointIterator it(m_spawnMonitor->spawnPoints());
   SpawnPoint* sp;
 
   while (it.hasNext())
@@ -468,6 +487,10 @@ SpawnPointListMenu::SpawnPointListMenu(SpawnPointList* spawnPointList,
           this, SLOT(delete_item()));
   addAction("&Clear Spawn Points...",
           m_spawnPointList, SLOT(clearItems(void)));
+  addAction("&Import Spawn Points...",
+          m_spawnPointList, SLOT(importItems(void)));
+  addAction("&Export Spawn Points...",
+          m_spawnPointList, SLOT(exportItems(void)));
 
   QMenu* listColMenu = new QMenu("Show &Column");
   QAction* listColMenuAction = addMenu(listColMenu);
@@ -116,6 +116,8 @@ class SpawnPointList : public SEQListView
   void renameItem(const SpawnPointListItem* item);
   void deleteItem(const SpawnPointListItem* item);
   void clearItems(void);
+  void importItems(void);
+  void exportItems(void);
   void refresh();
   void handleSelectItem();
   void newSpawnPoint(const SpawnPoint* sp);
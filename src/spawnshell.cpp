@@ -29,6 +29,7 @@
 
 #include "spawnshell.h"
 #include "filtermgr.h"
+#include "filter.h"
 #include "zonemgr.h"
 #include "player.h"
 #include "util.h"
@@ -40,6 +41,11 @@
 #include <QFile>
 #include <QDataStream>
 #include <QTextStream>
+#include <QVector>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QMetaObject>
 
 #ifdef __FreeBSD__
 #include <sys/types.h>
@@ -73,6 +79,9 @@ static const char magicStr[5] = "spn4"; // magic is the size of uint32_t + a nul
 static const uint32_t* magic = (uint32_t*)magicStr;
 static const char * Spawn_Corpse_Designator = "'s corpse";
 
+// number of items handed to each refilter worker task
+static const int RefilterChunkSize = 256;
+
 //----------------------------------------------------------------------
 // Handy utility function
 #ifdef SPAWNSHELL_NAME_VALIDATE
@@ -105,6 +114,93 @@ static bool isValidName(const char* name, size_t len)
 }
 #endif
 
+//----------------------------------------------------------------------
+// RefilterJob
+//
+// A snapshot of the filter strings of every item and the filters to run
+// them against, so the regex work of a refilter can be done off the GUI
+// thread.  The resulting masks are applied back on the GUI thread.
+struct RefilterEntry
+{
+  spawnItemType type;
+  int id;
+  const Item* item;
+  QString filterString;
+  uint16_t filterSerial;
+  uint8_t level;
+};
+
+class RefilterJob
+{
+ public:
+  void calcMasks(int begin, int end);
+  void cancel();
+
+  bool runtime;
+  bool cancelled; // only touched on the GUI thread
+  QVector<RefilterEntry> entries;
+  QVector<uint32_t> masks;
+  CompiledFilters filters;
+  CompiledFilters zoneFilters;
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  QAtomicInt abort;     // tells the workers to skip what's left
+  QAtomicInt remaining; // chunks that haven't finished yet
+#endif
+};
+
+void RefilterJob::calcMasks(int begin, int end)
+{
+  for (int i = begin; i < end; i++)
+  {
+    const RefilterEntry& entry = entries[i];
+    uint32_t mask = filters.filterMask(entry.filterString, entry.level);
+    if (!runtime)
+      mask |= zoneFilters.filterMask(entry.filterString, entry.level);
+    masks[i] = mask;
+  }
+}
+
+void RefilterJob::cancel()
+{
+  cancelled = true;
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  abort.fetchAndStoreOrdered(1);
+#endif
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+//----------------------------------------------------------------------
+// RefilterTask
+//
+// One chunk of a RefilterJob.  QRegularExpression can be matched from
+// several threads at once, so this is only used with Qt >= 5.5.
+class RefilterTask : public QRunnable
+{
+ public:
+  RefilterTask(SpawnShell* shell, RefilterJob* job, int begin, int end)
+    : m_shell(shell), m_job(job), m_begin(begin), m_end(end) {}
+  void run();
+
+ protected:
+  SpawnShell* m_shell;
+  RefilterJob* m_job;
+  int m_begin;
+  int m_end;
+};
+
+void RefilterTask::run()
+{
+  if (!m_job->abort.loadAcquire())
+    m_job->calcMasks(m_begin, m_end);
+
+  // last one out queues the job back to the GUI thread
+  if (!m_job->remaining.deref())
+    QMetaObject::invokeMethod(m_shell, "refilterFinished",
+			      Qt::QueuedConnection,
+			      Q_ARG(void*, m_job));
+}
+#endif
+
 //----------------------------------------------------------------------
 // SpawnShell
 SpawnShell::SpawnShell(FilterMgr& filterMgr, 
@@ -122,6 +218,10 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
     m_players()
 {
    setObjectName("spawnshell");
+
+   // private pool for refiltering, so it doesn't compete with anything
+   // else using the global one
+   m_refilterPool = new QThreadPool(this);
    m_cntDeadSpawnIDs = 0;
    m_posDeadSpawnIDs = 0;
    for (int i = 0; i < MAX_DEAD_SPAWNIDS; i++)
@@ -147,6 +247,10 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
 	   this, SIGNAL(changeItem(const Item*, uint32_t)));
    connect(m_player, SIGNAL(playerUpdate(const uint8_t*, size_t, uint8_t)),
            this, SLOT(playerUpdate2(const uint8_t*, size_t, uint8_t)));
+   connect(m_player, SIGNAL(posChanged(int16_t,int16_t,int16_t,
+				       int16_t,int16_t,int16_t,int32_t)),
+	   this, SLOT(playerMoved(int16_t,int16_t,int16_t,
+				  int16_t,int16_t,int16_t,int32_t)));
 
    // connect Player signals to SpawnShell slots
    connect(m_player, SIGNAL(changedID(uint16_t, uint16_t)),
@@ -178,6 +282,12 @@ SpawnShell::SpawnShell(FilterMgr& filterMgr,
 
 SpawnShell::~SpawnShell()
 {
+    // let the workers finish with the jobs before they go away
+    cancelRefilters();
+    m_refilterPool->waitForDone();
+    qDeleteAll(m_refilterJobs);
+    m_refilterJobs.clear();
+
     clear();
 }
 
@@ -189,6 +299,11 @@ void SpawnShell::clear(void)
 
    emit clearItems();
 
+   // the items any pending refilters were for are gone
+   cancelRefilters();
+
+   m_positions.clear();
+
    qDeleteAll(m_spawns);
    m_spawns.clear();
 
@@ -202,6 +317,11 @@ void SpawnShell::clear(void)
    m_players.clear();
    m_players.insert(0, m_player);
 
+   // every item of the zone is gone, rewind the arenas they came from
+   Spawn::arena().reset();
+   Drop::arena().reset();
+   Door::arena().reset();
+
    // emit an changeItem for the player
    emit changeItem(m_player, tSpawnChangedALL);
 
@@ -340,14 +460,22 @@ void SpawnShell::deleteItem(spawnItemType type, int id)
    {
      emit delItem(item);
      theMap.remove(id);
+     m_positions.remove(item);
 
      // send notifcation of new spawn count
      emit numSpawns(m_spawns.count());
    }
 }
 
-bool SpawnShell::updateFilterFlags(Item* item)
+bool SpawnShell::updateFilterFlags(Item* item, bool force)
 {
+  // if nothing but the position changed since the filters were last
+  // evaluated the flags are still good, don't bother the regex engine
+  if (!force && !item->filterStale(tFilterStaleFilter))
+    return false;
+
+  item->clearFilterStale(tFilterStaleFilter);
+
   uint8_t level = 0;
 
   if (item->type() == tSpawn)
@@ -370,8 +498,14 @@ bool SpawnShell::updateFilterFlags(Item* item)
   return false;
 }
 
-bool SpawnShell::updateRuntimeFilterFlags(Item* item)
+bool SpawnShell::updateRuntimeFilterFlags(Item* item, bool force)
 {
+  // same as above, position only changes don't affect the flags
+  if (!force && !item->filterStale(tFilterStaleRuntime))
+    return false;
+
+  item->clearFilterStale(tFilterStaleRuntime);
+
   uint8_t level = 0;
 
   if (item->type() == tSpawn)
@@ -394,6 +528,15 @@ bool SpawnShell::updateRuntimeFilterFlags(Item* item)
   return false;
 }
 
+void SpawnShell::dumpArenaInfo(QTextStream& out)
+{
+  Spawn::arena().dumpInfo(out);
+  out << ENDL;
+  Drop::arena().dumpInfo(out);
+  out << ENDL;
+  Door::arena().dumpInfo(out);
+}
+
 void SpawnShell::dumpSpawns(spawnItemType type, QTextStream& out)
 {
    ItemIterator it(getMap(type));
@@ -481,6 +624,7 @@ void SpawnShell::newGroundItem(const uint8_t* data, size_t len, uint8_t dir)
   if (item != NULL)
   {
     item->update(&ds, name);
+    m_positions.update(item);
     if (!showeq_params->fast_machine)
        item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
     else
@@ -498,6 +642,7 @@ void SpawnShell::newGroundItem(const uint8_t* data, size_t len, uint8_t dir)
        item->setDistanceToPlayer(m_player->calcDist(*item));
     updateFilterFlags(item);
     m_drops.insert(ds.dropId, item);
+    m_positions.add(item);
     emit addItem(item);
   }
 }
@@ -539,6 +684,7 @@ void SpawnShell::newDoorSpawn(const doorStruct& d, size_t len, uint8_t dir)
    {
      Door* door = (Door*)item;
      door->update(&d);
+     m_positions.update(door);
      if (!showeq_params->fast_machine)
         item->setDistanceToPlayer(m_player->calcDist2DInt(*item));
      else
@@ -556,6 +702,7 @@ void SpawnShell::newDoorSpawn(const doorStruct& d, size_t len, uint8_t dir)
         item->setDistanceToPlayer(m_player->calcDist(*item));
      updateFilterFlags(item);
      m_doors.insert(d.doorId, item);
+     m_positions.add(item);
      emit addItem(item);
    }
 }
@@ -875,6 +1022,7 @@ void SpawnShell::zoneEntry(const uint8_t* data, size_t len)
         // Update existing spawn
       Spawn *s=(Spawn*)item;
       s->update(spawn);
+      m_positions.update(s);
     }
     else
     {
@@ -932,6 +1080,7 @@ void SpawnShell::newSpawn(const spawnStruct& s)
    {
      Spawn* spawn = (Spawn*)item;
      spawn->update(&s);
+     m_positions.update(spawn);
      updateFilterFlags(spawn);
      updateRuntimeFilterFlags(spawn);
      item->updateLastChanged();
@@ -952,6 +1101,7 @@ void SpawnShell::newSpawn(const spawnStruct& s)
      updateFilterFlags(spawn);
      updateRuntimeFilterFlags(spawn);
      m_spawns.insert(s.spawnId, item);
+     m_positions.add(item);
 
      spawn->setGuildTag(m_guildMgr->guildIdToName(spawn->guildID(), spawn->guildServerID()));
 
@@ -1209,6 +1359,7 @@ void SpawnShell::updateSpawn(uint16_t id,
         spawn->setPos(x, y, z,
 		    showeq_params->walkpathrecord,
 		    showeq_params->walkpathlength);
+        m_positions.update(spawn);
         spawn->setAnimation(animation);
 
         spawn->setDeltas(xVel, yVel, zVel);
@@ -1249,6 +1400,7 @@ void SpawnShell::updateSpawn(uint16_t id,
         updateFilterFlags(item);
         updateRuntimeFilterFlags(item);
         m_spawns.insert(id, item);
+        m_positions.add(item);
         emit addItem(item);
 
 #ifdef SPAWNSHELL_DIAG
@@ -1389,8 +1541,8 @@ void SpawnShell::shroudSpawn(const uint8_t* data, size_t len, uint8_t dir)
         m_player->loadProfile(shroud->profile);
 
         // We just updated a lot of stuff.
-        updateFilterFlags(m_player);
-        updateRuntimeFilterFlags(m_player);
+        updateFilterFlags(m_player, true);
+        updateRuntimeFilterFlags(m_player, true);
         m_player->updateLastChanged();
         emit changeItem(m_player, tSpawnChangedALL);
     }
@@ -1652,6 +1804,7 @@ void SpawnShell::respawnFromHover(const uint8_t* data, size_t len, uint8_t dir)
     updateFilterFlags(corpse);
     updateRuntimeFilterFlags(corpse);
     m_spawns.insert(corpse->id(), corpse);
+    m_positions.add(corpse);
 
     corpse->setGuildTag(m_guildMgr->guildIdToName(corpse->guildID(), corpse->guildServerID()));
 
@@ -1684,6 +1837,7 @@ void SpawnShell::corpseLoc(const uint8_t* data)
                       showeq_params->walkpathrecord,
                       showeq_params->walkpathlength);
     }
+    m_positions.update(spawn);
     spawn->killSpawn();
     spawn->updateLast();
     spawn->updateLastChanged();
@@ -1714,115 +1868,162 @@ void SpawnShell::playerChangedID(uint16_t oldPlayerID, uint16_t newPlayerID)
   emit changeItem(m_player, tSpawnChangedALL);
 }
 
+void SpawnShell::playerMoved(int16_t x, int16_t y, int16_t z,
+			     int16_t, int16_t, int16_t, int32_t)
+{
+  // recalculate the distance of every item to the player in one pass,
+  // the spawn lists read the results back from the items
+  m_positions.calcDistances(x, y, z, true, showeq_params->fast_machine);
+}
+
 void SpawnShell::refilterSpawns()
 {
-  refilterSpawns(tSpawn);
-  refilterSpawns(tDrop);
-  refilterSpawns(tDoors);
+  refilter(false);
 }
 
-void SpawnShell::refilterSpawns(spawnItemType type)
+void SpawnShell::refilterSpawnsRuntime()
 {
-   ItemMap& theMap = getMap(type);
-   ItemIterator it(theMap);
+  refilter(true);
+}
 
-   if (type == tSpawn)
-   {
-     Spawn* spawn;
-     // iterate over all the items in the map
-     while (it.hasNext())
-     {
-       it.next();
+void SpawnShell::refilter(bool runtime)
+{
+  // an older refilter of the same kind is now pointless, its results
+  // would just be overwritten
+  cancelRefilters(runtime);
+
+  RefilterJob* job = new RefilterJob;
+  job->runtime = runtime;
+  job->cancelled = false;
+  if (runtime)
+    job->filters = m_filterMgr.compiledRuntimeFilters();
+  else
+  {
+    job->filters = m_filterMgr.compiledFilters();
+    job->zoneFilters = m_filterMgr.compiledZoneFilters();
+  }
 
-       // get the item
-       spawn = (Spawn*)it.value();
-       if (!spawn)
-           break;
+  // snapshot everything the workers need, they never touch the items
+  static const spawnItemType types[] = { tSpawn, tDrop, tDoors };
+  RefilterEntry entry;
+  for (size_t i = 0; i < (sizeof(types) / sizeof(types[0])); i++)
+  {
+    ItemConstIterator it(getConstMap(types[i]));
+    while (it.hasNext())
+    {
+      it.next();
 
-       // update the flags, if they changed, send a notification
-       if (updateFilterFlags(spawn))
-       {
-    	 spawn->updateLastChanged();
-    	 emit changeItem(spawn, tSpawnChangedFilter);
-       }
-     }
-   }
-   else
-   {
-     Item* item;
-     // iterate over all the items in the map
-     while (it.hasNext())
-     {
-       it.next();
+      const Item* item = it.value();
+      if (!item)
+	break;
 
-       // get the item
-       item = it.value();
-       if (!item)
-           break;
+      entry.type = types[i];
+      entry.id = it.key();
+      entry.item = item;
+      entry.filterString = item->filterString();
+      entry.filterSerial = item->filterSerial();
+      entry.level = 0;
+      if (item->type() == tSpawn)
+	entry.level = ((const Spawn*)item)->level();
 
-       // update the flags, if they changed, send a notification
-       if (updateFilterFlags(item))
-       {
-		 item->updateLastChanged();
-		 emit changeItem(item, tSpawnChangedFilter);
-       }
-     }
-   }
+      job->entries.append(entry);
+    }
+  }
+
+  int count = job->entries.size();
+  job->masks.resize(count);
+  m_refilterJobs.append(job);
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5,5,0))
+  // hand the regex work to the pool in chunks, the last chunk to finish
+  // queues the results back to this thread
+  int chunks = (count + RefilterChunkSize - 1) / RefilterChunkSize;
+  if (chunks > 1)
+  {
+    job->remaining.fetchAndStoreOrdered(chunks);
+    for (int begin = 0; begin < count; begin += RefilterChunkSize)
+      m_refilterPool->start(new RefilterTask(this, job, begin,
+					     qMin(begin + RefilterChunkSize,
+						  count)));
+    return;
+  }
+#endif
+
+  // not worth the trip through the pool (or QRegExp, which can't be used
+  // from multiple threads)
+  job->calcMasks(0, count);
+  refilterFinished(job);
 }
 
-void SpawnShell::refilterSpawnsRuntime()
+void SpawnShell::refilterFinished(void* data)
 {
-  refilterSpawnsRuntime(tSpawn);
-  refilterSpawnsRuntime(tDrop);
-  refilterSpawnsRuntime(tDoors);
+  RefilterJob* job = (RefilterJob*)data;
+  m_refilterJobs.removeAll(job);
+
+  if (!job->cancelled)
+    applyRefilter(job);
+
+  delete job;
 }
 
-void SpawnShell::refilterSpawnsRuntime(spawnItemType type)
+void SpawnShell::applyRefilter(RefilterJob* job)
 {
-   ItemIterator it(getMap(type));
+  uint8_t stale = job->runtime ? tFilterStaleRuntime : tFilterStaleFilter;
+  ItemList changed;
 
-   if (type == tSpawn)
-   {
-     Spawn* spawn;
-     // iterate over all the items in the map
-     while (it.hasNext())
-     {
-       it.next();
+  for (int i = 0; i < job->entries.size(); i++)
+  {
+    const RefilterEntry& entry = job->entries[i];
 
-       // get the item
-       spawn = (Spawn*)it.value();
-       if (!spawn)
-           break;
+    // skip items that have gone away, and items whose filter fields changed
+    // since the snapshot, they were refiltered against the new filters then
+    Item* item = getMap(entry.type).value(entry.id, NULL);
+    if ((item != entry.item) || (item->filterSerial() != entry.filterSerial))
+      continue;
 
-       // update the flags, if they changed, send a notification
-       if (updateRuntimeFilterFlags(spawn))
-       {
-		 spawn->updateLastChanged();
-		 emit changeItem(spawn, tSpawnChangedRuntimeFilter);
-       }
-     }
-   }
-   else
-   {
-     Item* item;
-     // iterate over all the items in the map
-     while (it.hasNext())
-     {
-       it.next();
+    item->clearFilterStale(stale);
 
-       // get the item
-       item = it.value();
-       if (!item)
-           break;
+    // update the flags, if they changed, add it to the notification
+    uint32_t mask = job->masks[i];
+    if (job->runtime)
+    {
+      if (mask == item->runtimeFilterFlags())
+	continue;
 
-       // update the flags, if they changed, send a notification
-       if (updateRuntimeFilterFlags(item))
-       {
-		 item->updateLastChanged();
-		 emit changeItem(item, tSpawnChangedRuntimeFilter);
-       }
-     }
-   }
+      item->setRuntimeFilterFlags(mask);
+    }
+    else
+    {
+      if (mask == item->filterFlags())
+	continue;
+
+      item->setFilterFlags(mask);
+    }
+
+    item->updateLastChanged();
+    changed.append(item);
+  }
+
+  if (!changed.isEmpty())
+    emit changeItems(changed, job->runtime ?
+		     tSpawnChangedRuntimeFilter : tSpawnChangedFilter);
+}
+
+void SpawnShell::cancelRefilters(bool runtime)
+{
+  QListIterator<RefilterJob*> it(m_refilterJobs);
+  while (it.hasNext())
+  {
+    RefilterJob* job = it.next();
+    if (job->runtime == runtime)
+      job->cancel();
+  }
+}
+
+void SpawnShell::cancelRefilters(void)
+{
+  cancelRefilters(false);
+  cancelRefilters(true);
 }
 
 void SpawnShell::saveSpawns(void)
@@ -1937,6 +2138,7 @@ void SpawnShell::restoreSpawns(void)
       updateFilterFlags(item);
       updateRuntimeFilterFlags(item);
       m_spawns.insert(id, item);
+      m_positions.add(item);
       emit addItem(item);
     }
 
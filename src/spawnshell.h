@@ -48,6 +48,7 @@
 
 #include "everquest.h"
 #include "spawn.h"
+#include "itempositions.h"
 
 //----------------------------------------------------------------------
 // forward declarations
@@ -57,6 +58,8 @@ class FilterMgr;
 class SpawnShell;
 class EQItemDB;
 class GuildMgr;
+class RefilterJob;
+class QThreadPool;
 
 //----------------------------------------------------------------------
 // constants
@@ -72,6 +75,7 @@ const int MAX_DEAD_SPAWNIDS = 50;
 typedef QHash<int, Item*> ItemMap;
 typedef QHashIterator<int, Item*> ItemIterator;
 typedef QHashIterator<int, Item*> ItemConstIterator;
+typedef QList<const Item*> ItemList;
 
 //----------------------------------------------------------------------
 // SpawnShell
@@ -95,15 +99,18 @@ public:
    Spawn* findSpawnByName(const QString& name);
 
    void dumpSpawns(spawnItemType type, QTextStream& out);
+   void dumpArenaInfo(QTextStream& out);
    FilterMgr* filterMgr(void) { return &m_filterMgr; }
    const ItemMap& getConstMap(spawnItemType type) const;
    const ItemMap& spawns(void) const;
    const ItemMap& drops(void) const;
    const ItemMap& doors(void) const;
+   const ItemPositions& positions(void) const { return m_positions; }
 signals:
    void addItem(const Item* item);
    void delItem(const Item* item);
    void changeItem(const Item* item, uint32_t changeType);
+   void changeItems(const ItemList& items, uint32_t changeType);
    void killSpawn(const Item* deceased, const Item* killer, uint16_t killerId);
    void selectSpawn(const Item* item);
    void spawnConsidered(const Item* item);
@@ -146,6 +153,9 @@ public slots:
    void corpseLoc(const uint8_t* corpseLoc);
 
    void playerChangedID(uint16_t oldPlayerID, uint16_t newPlayerID);
+   void playerMoved(int16_t x, int16_t y, int16_t z,
+		    int16_t deltaX, int16_t deltaY, int16_t deltaZ,
+		    int32_t heading);
    void refilterSpawns();
    void refilterSpawnsRuntime();
    void saveSpawns(void);
@@ -154,15 +164,20 @@ public slots:
    void updateGuildTag(uint32_t guildId);
 
  protected:
-   void refilterSpawns(spawnItemType type);
-   void refilterSpawnsRuntime(spawnItemType type);
+   void refilter(bool runtime);
+   void applyRefilter(RefilterJob* job);
+   void cancelRefilters(bool runtime);
+   void cancelRefilters(void);
    void deleteItem(spawnItemType type, int id);
-   bool updateFilterFlags(Item* item);
-   bool updateRuntimeFilterFlags(Item* item);
+   bool updateFilterFlags(Item* item, bool force = false);
+   bool updateRuntimeFilterFlags(Item* item, bool force = false);
    int32_t fillSpawnStruct(spawnStruct *spawn, const uint8_t *data, size_t len, bool checkLen);
 
    ItemMap& getMap(spawnItemType type);
 
+ private slots:
+   void refilterFinished(void* job);
+
  private:
    ZoneMgr* m_zoneMgr;
    Player* m_player;
@@ -180,8 +195,15 @@ public slots:
    ItemMap m_doors;
    ItemMap m_players;
 
+   // contiguous copy of spawn/drop/door positions for batch distance updates
+   ItemPositions m_positions;
+
    // timer for saving spawns
    QTimer* m_timer;
+
+   // refilters waiting on the worker pool
+   QThreadPool* m_refilterPool;
+   QList<RefilterJob*> m_refilterJobs;
 };
 
 inline
@@ -143,6 +143,25 @@ const zonePointStruct* ZoneMgr::zonePoint(uint32_t zoneTrigger)
   return 0;
 }
 
+QStringList ZoneMgr::zonePointZoneNames()
+{
+  // the distinct known zones the current zone's zone points lead to
+  QStringList names;
+  for (size_t i = 0; i < m_zonePointCount; i++)
+  {
+    uint16_t zoneId = m_zonePoints[i].zoneId & 0x0fff;
+    if ((zoneId >= (sizeof(zoneNames) / sizeof(ZoneNames))) ||
+        (zoneNames[zoneId].shortName == NULL))
+      continue;
+
+    QString name = zoneNames[zoneId].shortName;
+    if (!names.contains(name))
+      names.append(name);
+  }
+
+  return names;
+}
+
 void ZoneMgr::saveZoneState(void)
 {
   QFile keyFile(showeq_params->saveRestoreBaseFilename + "Zone.dat");
@@ -737,6 +756,8 @@ void ZoneMgr::zonePoints(const uint8_t* data, size_t len, uint8_t)
   // copy the zone point information
   memcpy((void*)m_zonePoints, zp->zonePoints, 
 	 sizeof(zonePointStruct) * m_zonePointCount);
+
+  emit zonePointsChanged();
 }
 
 void ZoneMgr::dynamicZonePoints(const uint8_t *data, size_t len, uint8_t)
@@ -30,6 +30,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 
 #include "point.h"
 
@@ -60,6 +61,7 @@ class ZoneMgr : public QObject
   const Point3D<int16_t>& safePoint() const { return m_safePoint; }
   float zoneExpMultiplier() { return m_zone_exp_multiplier; }
   const zonePointStruct* zonePoint(uint32_t zoneTrigger);
+  QStringList zonePointZoneNames();
   uint32_t dzID() { return m_dzID; }
   const Point3D<int16_t>& dzPoint() const { return m_dzPoint; }
   QString dzLongName() { return m_dzLongName; }
@@ -87,6 +89,7 @@ class ZoneMgr : public QObject
   void zoneChanged(const QString& shortZoneName);
   void zoneChanged(const zoneChangeStruct*, size_t, uint8_t);
   void zoneEnd(const QString& shortZoneName, const QString& longZoneName);
+  void zonePointsChanged();
   
  private:
   QString m_longZoneName;